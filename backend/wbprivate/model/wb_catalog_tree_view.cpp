@@ -27,6 +27,7 @@
 #include "grt/icon_manager.h"
 #include "wb_model_diagram_form.h"
 #include "wb_catalog_tree_view.h"
+#include <algorithm>
 #include <unordered_set>
 
 using namespace wb;
@@ -178,6 +179,7 @@ CatalogTreeView::CatalogTreeView(ModelDiagramForm *owner)
 
 {
   _initialized = false;
+  _flush_pending = false;
   bool showHeaderText = true;
   set_selection_mode(mforms::TreeSelectMultiple);
 #ifdef _MSC_VER
@@ -207,25 +209,57 @@ void CatalogTreeView::node_activated(mforms::TreeNodeRef row, int column) {
     _activate_callback(data->get_object_ref());
 }
 
-static bool compare_db_object(db_DatabaseObjectRef a, db_DatabaseObjectRef b) {
-  return base::string_compare(a->name(), b->name()) < 0 ? true : false;
+CatalogTreeView::ObjectType CatalogTreeView::object_type(const grt::ValueRef &value) {
+  if (db_TableRef::can_wrap(value))
+    return ObjTable;
+  if (db_RoutineGroupRef::can_wrap(value))
+    return ObjRoutineGrp;
+  if (db_ViewRef::can_wrap(value))
+    return ObjView;
+  if (db_SchemaRef::can_wrap(value))
+    return ObjSchema;
+  return ObjNone;
 }
 
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * The order of the object nodes in a group: by name, objects with the same name by id.
+ */
+bool CatalogTreeView::entry_less(const Entry &a, const Entry &b) {
+  int result = base::string_compare(a.name, b.name);
+  if (result != 0)
+    return result < 0;
+  return a.id < b.id;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 template <typename T>
-static std::vector<grt::Ref<T> > sort_db_object(grt::ListRef<T> list) {
-  std::vector<grt::Ref<T> > vec;
-  for (size_t i = 0; i < list.count(); ++i) {
-    vec.push_back(list[i]);
+static void add_entries(std::vector<CatalogTreeView::Entry> &entries, grt::ListRef<T> list,
+                        const std::unordered_set<grt::internal::Value *> &on_diagram) {
+  entries.reserve(list.count());
+  for (size_t c = list.count(), i = 0; i < c; ++i) {
+    grt::Ref<T> object(list[i]);
+    CatalogTreeView::Entry entry;
+    entry.name = *object->name();
+    entry.id = object.id();
+    entry.object = object;
+    entry.marked = on_diagram.find(object.valueptr()) != on_diagram.end();
+    entries.push_back(entry);
   }
-  std::sort(vec.begin(), vec.end(), compare_db_object);
-  return vec;
 }
 
+//--------------------------------------------------------------------------------------------------
+
 void CatalogTreeView::refill(bool force) {
   if (_initialized && !force)
     return;
 
-  clear();
+  // Everything reported so far is part of the new content.
+  _pending.clear();
+  _pending_order.clear();
+
   model_ModelRef model = _owner->get_model_diagram()->owner();
 
   std::unordered_set<grt::internal::Value *> uset;
@@ -243,69 +277,136 @@ void CatalogTreeView::refill(bool force) {
       uset.insert(f.get_member("routineGroup").valueptr());
   }
 
-  freeze_refresh();
+  std::vector<std::pair<grt::ObjectRef, SchemaEntries> > schemata;
   grt::ListRef<db_Schema> schema_list = workbench_physical_ModelRef::cast_from(model)->catalog()->schemata();
   for (size_t i = 0; i < schema_list.count(); ++i) {
-    mforms::TreeNodeRef node = add_node();
-    node->set_string(0, schema_list[i]->name().c_str());
-    node->set_icon_path(0, get_node_icon_path(IconSchema));
-    ;
-    node->set_tag(schema_list[i].id());
-    node->set_data(new ObjectNodeData(schema_list[i]));
-    mforms::TreeNodeRef child = node->add_child();
-    if (i == 0) // we expand by default only first schema on the list
-      node->expand();
-    child->set_string(0, _("Tables"));
-    child->set_icon_path(0, get_node_icon_path(IconTablesMany));
-
-    std::vector<db_TableRef> table_list = sort_db_object<db_Table>(schema_list[i]->tables());
-
-    for (size_t j = 0; j < table_list.size(); ++j) {
-      db_TableRef table = table_list[j];
-      mforms::TreeNodeRef subchild = child->add_child();
-      subchild->set_string(0, table->name().c_str());
-      subchild->set_icon_path(0, get_node_icon_path(IconTable));
-      subchild->set_tag(table.id());
-      subchild->set_data(new ObjectNodeData(table));
-      if (uset.find(table.valueptr()) != uset.end())
-        subchild->set_string(1, "\xe2\x97\x8f");
-    }
+    schemata.push_back(std::make_pair(grt::ObjectRef(schema_list[i]), SchemaEntries()));
+    SchemaEntries &entries = schemata.back().second;
+
+    add_entries(entries.groups[0], schema_list[i]->tables(), uset);
+    add_entries(entries.groups[1], schema_list[i]->views(), uset);
+    add_entries(entries.groups[2], schema_list[i]->routineGroups(), uset);
+    for (int g = 0; g < 3; ++g)
+      std::sort(entries.groups[g].begin(), entries.groups[g].end(), entry_less);
+  }
 
-    child = node->add_child();
-    child->set_string(0, _("Views"));
-    child->set_icon_path(0, get_node_icon_path(IconViewsMany));
-    std::vector<db_ViewRef> view_list = sort_db_object<db_View>(schema_list[i]->views());
-    for (size_t j = 0; j < view_list.size(); ++j) {
-      db_ViewRef view = view_list[j];
-      mforms::TreeNodeRef subchild = child->add_child();
-      subchild->set_string(0, view->name().c_str());
-      subchild->set_icon_path(0, get_node_icon_path(IconView));
-      subchild->set_tag(view.id());
-      subchild->set_data(new ObjectNodeData(view));
-      if (uset.find(view.valueptr()) != uset.end())
-        subchild->set_string(1, "\xe2\x97\x8f");
+  freeze_refresh();
+
+  // If the schemas are still the same (which is the case after most bulk operations, like reverse engineering
+  // or synchronization) the tree is updated in place, which keeps selection and expansion state.
+  bool same_schemas = _initialized && root_node()->count() == (int)schemata.size();
+  for (size_t i = 0; same_schemas && i < schemata.size(); ++i)
+    same_schemas = root_node()->get_child((int)i)->get_tag() == schemata[i].first.id();
+
+  if (same_schemas)
+    sync(schemata);
+  else
+    rebuild(schemata);
+
+  thaw_refresh();
+  _initialized = true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void CatalogTreeView::rebuild(std::vector<std::pair<grt::ObjectRef, SchemaEntries> > &schemata) {
+  clear();
+  _entries.clear();
+
+  for (size_t i = 0; i < schemata.size(); ++i) {
+    db_SchemaRef schema(db_SchemaRef::cast_from(schemata[i].first));
+    mforms::TreeNodeRef node = create_new_node(ObjSchema, root_node(), *schema->name(), schema);
+    if (i != 0) // we expand by default only first schema on the list
+      node->collapse();
+
+    for (int g = 0; g < 3; ++g) {
+      mforms::TreeNodeRef group = node->get_child(g);
+      EntryList &entries = schemata[i].second.groups[g];
+      for (EntryList::iterator entry = entries.begin(); entry != entries.end(); ++entry) {
+        mforms::TreeNodeRef child = group->add_child();
+        child->set_string(0, entry->name);
+        child->set_icon_path(0, get_node_icon_path(g == 0 ? IconTable : g == 1 ? IconView : IconRoutineGroup));
+        child->set_tag(entry->id);
+        child->set_data(new ObjectNodeData(entry->object));
+        if (entry->marked)
+          child->set_string(1, "\xe2\x97\x8f");
+
+        entry->object.clear();
+      }
     }
+    _entries[schema.id()].groups[0].swap(schemata[i].second.groups[0]);
+    _entries[schema.id()].groups[1].swap(schemata[i].second.groups[1]);
+    _entries[schema.id()].groups[2].swap(schemata[i].second.groups[2]);
+  }
+}
 
-    child = node->add_child();
-    child->set_string(0, _("Routine Groups"));
-    child->set_icon_path(0, get_node_icon_path(IconRoutineGroupsMany));
-    std::vector<db_RoutineGroupRef> routine_group_list =
-      sort_db_object<db_RoutineGroup>(schema_list[i]->routineGroups());
-    for (size_t j = 0; j < routine_group_list.size(); ++j) {
-      db_RoutineGroupRef routineGrp = routine_group_list[j];
-      mforms::TreeNodeRef subchild = child->add_child();
-      subchild->set_string(0, routineGrp->name().c_str());
-      subchild->set_icon_path(0, get_node_icon_path(IconRoutineGroup));
-      subchild->set_tag(routineGrp.id());
-      subchild->set_data(new ObjectNodeData(routineGrp));
-      if (uset.find(routineGrp.valueptr()) != uset.end())
-        subchild->set_string(1, "\xe2\x97\x8f");
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Applies the differences between the tree and the given (sorted) content to the tree.
+ */
+void CatalogTreeView::sync(std::vector<std::pair<grt::ObjectRef, SchemaEntries> > &schemata) {
+  for (size_t i = 0; i < schemata.size(); ++i) {
+    mforms::TreeNodeRef node = root_node()->get_child((int)i);
+    grt::ObjectRef schema(schemata[i].first);
+    std::string name = *db_SchemaRef::cast_from(schema)->name();
+    if (node->get_string(0) != name)
+      node->set_string(0, name);
+
+    SchemaEntries &current = _entries[schema.id()];
+    for (int g = 0; g < 3; ++g) {
+      EntryList &existing = current.groups[g];
+      EntryList &wanted = schemata[i].second.groups[g];
+      mforms::TreeNodeRef group = node->get_child(g);
+
+      // Remove nodes of objects which are gone or renamed (these are added again at their new position).
+      std::unordered_map<std::string, const Entry *> wanted_ids;
+      for (EntryList::const_iterator entry = wanted.begin(); entry != wanted.end(); ++entry)
+        wanted_ids[entry->id] = &*entry;
+
+      EntryList kept;
+      kept.reserve(existing.size());
+      for (EntryList::iterator entry = existing.begin(); entry != existing.end(); ++entry) {
+        std::unordered_map<std::string, const Entry *>::const_iterator target = wanted_ids.find(entry->id);
+        if (target != wanted_ids.end() && target->second->name == entry->name)
+          kept.push_back(*entry);
+        else {
+          mforms::TreeNodeRef child = node_with_tag(entry->id);
+          if (child.is_valid())
+            child->remove_from_parent();
+        }
+      }
+
+      // What is left is in the wanted order already, so the missing nodes can be merged in.
+      size_t k = 0;
+      for (size_t w = 0; w < wanted.size(); ++w) {
+        Entry &entry = wanted[w];
+        mforms::TreeNodeRef child;
+        if (k < kept.size() && kept[k].id == entry.id) {
+          child = node_with_tag(entry.id);
+          ++k;
+        } else {
+          child = group->insert_child((int)w);
+          child->set_string(0, entry.name);
+          child->set_icon_path(0, get_node_icon_path(g == 0 ? IconTable : g == 1 ? IconView : IconRoutineGroup));
+          child->set_tag(entry.id);
+          child->set_data(new ObjectNodeData(entry.object));
+        }
+
+        if (child.is_valid()) {
+          std::string mark = entry.marked ? "\xe2\x97\x8f" : "";
+          if (child->get_string(1) != mark)
+            child->set_string(1, mark);
+        }
+        entry.object.clear();
+      }
+      existing.swap(wanted);
     }
   }
-  thaw_refresh();
-  _initialized = true;
 }
 
+//--------------------------------------------------------------------------------------------------
+
 void CatalogTreeView::set_activate_callback(const std::function<void(grt::ValueRef)> &active_callback) {
   _activate_callback = active_callback;
 }
@@ -353,121 +454,184 @@ void CatalogTreeView::context_menu_will_show(mforms::MenuItem *parent_item) {
   }
 }
 //--------------------------------------------------------------------------------------------------
-void CatalogTreeView::mark_node(grt::ValueRef val, bool mark) {
-  db_DatabaseObjectRef obj;
-  if (db_DatabaseObjectRef::can_wrap(val))
-    obj = db_DatabaseObjectRef::cast_from(val);
 
-  if (!obj.is_valid())
+CatalogTreeView::PendingChange &CatalogTreeView::pending_change(const grt::ObjectRef &object) {
+  std::unordered_map<std::string, PendingChange>::iterator iter = _pending.find(object.id());
+  if (iter == _pending.end()) {
+    PendingChange change;
+    change.object = object;
+    change.update = false;
+    change.remove = false;
+    change.mark = -1;
+    iter = _pending.insert(std::make_pair(object.id(), change)).first;
+    _pending_order.push_back(object.id());
+  }
+
+  if (!_flush_pending) {
+    _flush_pending = true;
+    bec::GRTManager::get()->run_once_when_idle(this, std::bind(&CatalogTreeView::flush_pending_changes, this));
+  }
+
+  return iter->second;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void CatalogTreeView::flush_pending_changes() {
+  _flush_pending = false;
+  if (!_initialized) {
+    // The next refill will load everything anyway.
+    _pending.clear();
+    _pending_order.clear();
     return;
+  }
 
-  mforms::TreeNodeRef node = node_with_tag(obj.id());
-  if (node.is_valid())
-    node->set_string(1, mark ? "\xe2\x97\x8f" : "");
+  std::vector<std::string> order;
+  std::unordered_map<std::string, PendingChange> pending;
+  order.swap(_pending_order);
+  pending.swap(_pending);
+
+  freeze_refresh();
+  for (std::vector<std::string>::const_iterator id = order.begin(); id != order.end(); ++id) {
+    PendingChange &change = pending[*id];
+    if (change.remove) {
+      remove_object_node(*id);
+      continue;
+    }
+
+    if (change.update)
+      update_object_node(change.object);
+    if (change.mark >= 0)
+      set_node_mark(*id, change.mark != 0);
+  }
+  thaw_refresh();
 }
 
-void CatalogTreeView::add_update_node_caption(grt::ValueRef val) {
-  ObjectType otype = ObjNone;
+//--------------------------------------------------------------------------------------------------
 
-  db_DatabaseObjectRef obj;
-  if (db_DatabaseObjectRef::can_wrap(val))
-    obj = db_DatabaseObjectRef::cast_from(val);
+mforms::TreeNodeRef CatalogTreeView::insert_object_node(const std::string &schema_id, ObjectType otype,
+                                                        const Entry &entry) {
+  mforms::TreeNodeRef schema_node = node_with_tag(schema_id);
+  if (!schema_node.is_valid())
+    return mforms::TreeNodeRef();
+
+  int group = otype - ObjTable;
+  EntryList &entries = _entries[schema_id].groups[group];
+  EntryList::iterator position = std::lower_bound(entries.begin(), entries.end(), entry, entry_less);
+  int index = (int)(position - entries.begin());
+  entries.insert(position, entry);
+
+  mforms::TreeNodeRef node = schema_node->get_child(group)->insert_child(index);
+  node->set_string(0, entry.name);
+  node->set_icon_path(0, get_node_icon_path(otype == ObjTable ? IconTable : otype == ObjView ? IconView
+                                                                                              : IconRoutineGroup));
+  node->set_tag(entry.id);
+  node->set_data(new ObjectNodeData(entry.object));
+
+  return node;
+}
 
-  if (!obj.is_valid())
-    return;
+//--------------------------------------------------------------------------------------------------
 
-  std::string new_name = obj->name().c_str();
-  if (db_TableRef::can_wrap(val))
-    otype = ObjTable;
-  else if (db_RoutineGroupRef::can_wrap(val))
-    otype = ObjRoutineGrp;
-  else if (db_ViewRef::can_wrap(val))
-    otype = ObjView;
-  else if (db_SchemaRef::can_wrap(val))
-    otype = ObjSchema;
-  else
-    return;
+void CatalogTreeView::update_object_node(const grt::ObjectRef &object) {
+  db_DatabaseObjectRef obj(db_DatabaseObjectRef::cast_from(object));
+  ObjectType otype = object_type(obj);
+  std::string name = *obj->name();
 
   mforms::TreeNodeRef node = node_with_tag(obj.id());
+  if (otype == ObjSchema) {
+    if (node.is_valid()) {
+      if (node->get_string(0) != name)
+        node->set_string(0, name);
+    } else {
+      create_new_node(otype, root_node(), name, obj);
+      _entries[obj.id()] = SchemaEntries();
+    }
+    return;
+  }
+
   if (node.is_valid()) {
-    node->set_string(0, new_name);
-  } else // if node is invalid it means that new object was added on diagram
-  {
-    node = node_with_tag(obj->owner().id());
+    if (node->get_string(0) == name)
+      return;
+
+    // A renamed object is moved to its new position.
+    remove_object_node(obj.id());
+  }
+
+  if (obj->owner().is_valid()) {
+    Entry entry;
+    entry.name = name;
+    entry.id = obj.id();
+    entry.object = obj;
+    node = insert_object_node(obj->owner().id(), otype, entry);
     if (node.is_valid()) {
-      mforms::TreeNodeRef prnt = node;
-      node = create_new_node(otype, prnt, new_name, obj);
       workbench_physical_DiagramRef view(workbench_physical_DiagramRef::cast_from(_owner->get_model_diagram()));
       if (view->getFigureForDBObject(obj).is_valid())
         node->set_string(1, "\xe2\x97\x8f");
-
-    } else if (db_SchemaRef::can_wrap(obj)) // check if it's schemaref
-      node = create_new_node(otype, root_node(), new_name, obj);
+    }
   }
+}
 
-  if (node.is_valid() &&
-      node->get_parent()->count() >
-        1) // We check if node is valid, and if so we need to rearrange this into different position.
-  {
-    mforms::TreeNodeRef next_node = node->next_sibling();
-    mforms::TreeNodeRef parent = node->get_parent();
-    mforms::TreeNodeRef prev_node = node->previous_sibling();
-    bool moved = false;
-    if (next_node.is_valid()) {
-      int new_idx = -1;
-      while (next_node.is_valid()) {
-        int ret = base::string_compare(node->get_string(0), next_node->get_string(0), false);
-        if (ret > 0)
-          new_idx = parent->get_child_index(next_node);
-        else {
-          next_node = next_node->previous_sibling(); // wee need to get back to the prev node
-          break;
-        }
+//--------------------------------------------------------------------------------------------------
 
-        if (next_node->next_sibling().is_valid())
-          next_node = next_node->next_sibling();
-        else
-          break;
-      }
-      if (new_idx > -1 && next_node.is_valid()) {
-        node->move_node(next_node, false);
-        moved = true;
-      }
-    }
-    if (prev_node.is_valid() && !moved) {
-      int new_idx = -1;
-      while (prev_node.is_valid()) {
-        int ret = base::string_compare(node->get_string(0), prev_node->get_string(0), false);
-        if (ret < 0)
-          new_idx = parent->get_child_index(prev_node);
-        else {
-          prev_node = prev_node->next_sibling(); // wee need to get back to the prev node
-          break;
-        }
+void CatalogTreeView::remove_object_node(const std::string &id) {
+  mforms::TreeNodeRef node = node_with_tag(id);
+  if (!node.is_valid())
+    return;
 
-        if (prev_node->previous_sibling().is_valid())
-          prev_node = prev_node->previous_sibling();
-        else
-          break;
-      }
-      if (new_idx > -1 && prev_node.is_valid()) {
-        node->move_node(prev_node, true);
-        moved = true;
-      }
+  mforms::TreeNodeRef group = node->get_parent();
+  if (group == root_node())
+    _entries.erase(id);
+  else if (group.is_valid() && group->get_parent().is_valid()) {
+    mforms::TreeNodeRef schema_node = group->get_parent();
+    int index = schema_node->get_child_index(group);
+    if (index >= 0 && index < 3) {
+      EntryList &entries = _entries[schema_node->get_tag()].groups[index];
+      Entry key;
+      key.name = node->get_string(0);
+      key.id = id;
+      EntryList::iterator position = std::lower_bound(entries.begin(), entries.end(), key, entry_less);
+      if (position != entries.end() && position->id == id)
+        entries.erase(position);
     }
   }
+
+  node->remove_from_parent();
 }
 
-void CatalogTreeView::remove_node(grt::ValueRef val) {
-  db_DatabaseObjectRef obj;
-  if (db_DatabaseObjectRef::can_wrap(val))
-    obj = db_DatabaseObjectRef::cast_from(val);
+//--------------------------------------------------------------------------------------------------
+
+void CatalogTreeView::set_node_mark(const std::string &id, bool mark) {
+  mforms::TreeNodeRef node = node_with_tag(id);
+  if (node.is_valid())
+    node->set_string(1, mark ? "\xe2\x97\x8f" : "");
+}
+
+//--------------------------------------------------------------------------------------------------
 
-  if (!obj.is_valid())
+void CatalogTreeView::mark_node(grt::ValueRef val, bool mark) {
+  if (!db_DatabaseObjectRef::can_wrap(val))
     return;
 
-  mforms::TreeNodeRef node = node_with_tag(obj.id());
-  if (node.is_valid())
-    node->remove_from_parent();
+  pending_change(db_DatabaseObjectRef::cast_from(val)).mark = mark ? 1 : 0;
+}
+
+void CatalogTreeView::add_update_node_caption(grt::ValueRef val) {
+  if (!db_DatabaseObjectRef::can_wrap(val) || object_type(val) == ObjNone)
+    return;
+
+  PendingChange &change = pending_change(db_DatabaseObjectRef::cast_from(val));
+  change.update = true;
+  change.remove = false;
+}
+
+void CatalogTreeView::remove_node(grt::ValueRef val) {
+  if (!db_DatabaseObjectRef::can_wrap(val))
+    return;
+
+  PendingChange &change = pending_change(db_DatabaseObjectRef::cast_from(val));
+  change.update = false;
+  change.remove = true;
+  change.mark = -1;
 }
 //--------------------------------------------------------------------------------------------------
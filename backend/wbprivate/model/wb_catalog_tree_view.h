@@ -29,6 +29,9 @@
 #include "mforms/treeview.h"
 #include "grtpp_value.h"
 
+#include <unordered_map>
+#include <vector>
+
 namespace mforms {
   class ContextMenu;
 }
@@ -64,11 +67,56 @@ namespace wb {
     };
 
     enum ObjectType { ObjSchema, ObjTable, ObjView, ObjRoutineGrp, ObjNone };
+
+  public:
+    // An object node below one of the group nodes of a schema (Tables, Views, Routine Groups).
+    struct Entry {
+      std::string name;
+      std::string id;
+      grt::ObjectRef object; // Only set while refilling.
+      bool marked;           // Ditto.
+    };
+    typedef std::vector<Entry> EntryList;
+
+    // The object nodes of a schema, per group and in display order, so that the position for a node can be
+    // found by binary search instead of walking the tree.
+    struct SchemaEntries {
+      EntryList groups[3];
+    };
+
+  private:
+
+    // A change reported for an object which was not yet applied to the tree. Changes are collected and applied
+    // together when idle, so that bulk operations (like reverse engineering) don't update the tree object by object.
+    struct PendingChange {
+      grt::ObjectRef object;
+      bool update;
+      bool remove;
+      int mark; // -1 for unchanged, otherwise the new mark state.
+    };
+
     ModelDiagramForm *_owner;
     mforms::ContextMenu *_menu;
     std::list<GrtObjectRef> _dragged_objects;
     bool _initialized;
 
+    std::unordered_map<std::string, SchemaEntries> _entries; // Keyed by schema id.
+    std::vector<std::string> _pending_order;
+    std::unordered_map<std::string, PendingChange> _pending;
+    bool _flush_pending;
+
+    static ObjectType object_type(const grt::ValueRef &value);
+    static bool entry_less(const Entry &a, const Entry &b);
+
+    PendingChange &pending_change(const grt::ObjectRef &object);
+    void flush_pending_changes();
+    void update_object_node(const grt::ObjectRef &object);
+    void remove_object_node(const std::string &id);
+    void set_node_mark(const std::string &id, bool mark);
+    mforms::TreeNodeRef insert_object_node(const std::string &schema_id, ObjectType otype, const Entry &entry);
+    void rebuild(std::vector<std::pair<grt::ObjectRef, SchemaEntries> > &schemata);
+    void sync(std::vector<std::pair<grt::ObjectRef, SchemaEntries> > &schemata);
+
     void context_menu_will_show(mforms::MenuItem *parent_item);
     std::function<void(grt::ValueRef)> _activate_callback;
 
@@ -645,23 +645,24 @@ std::string ResultFormView::get_full_column_type(SqlEditorForm *editor, const st
                                                  const std::string &table, const std::string &column) {
   // we only support 5.5+ for this feature
   if (bec::is_supported_mysql_version_at_least(editor->rdbms_version(), 5, 5)) {
-    std::string q = base::sqlstring(
-                      "SELECT COLUMN_TYPE FROM INFORMATION_SCHEMA.COLUMNS WHERE table_schema = ? and table_name = ? "
-                      "and column_name = ?",
-                      0)
-                    << schema << table << column;
+    std::string q =
+      "SELECT COLUMN_TYPE FROM INFORMATION_SCHEMA.COLUMNS WHERE table_schema = ? and table_name = ? "
+      "and column_name = ?";
     try {
       // XXX handle case where column is an alias, in that case we have to parse the query and extract the original
       // column name by hand
       sql::Dbc_connection_handler::Ref conn;
       base::RecMutexLock lock(editor->ensure_valid_aux_connection(conn));
 
-      std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
-      std::auto_ptr<sql::ResultSet> result(stmt->executeQuery(q));
-      if (result.get() && result->first())
+      sql::PreparedStatement *stmt = editor->prepared_aux_statement(conn, q);
+      stmt->setString(1, schema);
+      stmt->setString(2, table);
+      stmt->setString(3, column);
+      std::auto_ptr<sql::ResultSet> result(stmt->executeQuery());
+      if (result.get() && result->next())
         return result->getString(1);
     } catch (std::exception &e) {
-      logException(("Exception getting column information: " + q).c_str(), e);
+      logException(("Exception getting column information for " + schema + "." + table + "." + column).c_str(), e);
     }
   }
   return "";
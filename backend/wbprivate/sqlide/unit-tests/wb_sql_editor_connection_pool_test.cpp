@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include <thread>
+#include <atomic>
+
+#include "wb_helpers.h"
+
+#include "sqlide/wb_sql_editor_connection_pool.h"
+
+using namespace base;
+
+BEGIN_TEST_DATA_CLASS(wb_sql_editor_connection_pool_test)
+protected:
+  sql::Dbc_connection_handler::Ref _primary;
+
+TEST_DATA_CONSTRUCTOR(wb_sql_editor_connection_pool_test) : _primary(new sql::Dbc_connection_handler()) {
+}
+
+END_TEST_DATA_CLASS
+
+TEST_MODULE(wb_sql_editor_connection_pool_test, "SQL IDE auxiliary connection pool");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  // A thread holding a connection gets the same one again.
+  AuxConnectionPool pool(_primary, 3);
+
+  sql::Dbc_connection_handler::Ref first, second;
+  RecMutexLock lock1(pool.acquire(AuxConnectionPool::Interactive, first));
+  ensure("Primary connection expected", first == _primary);
+  {
+    RecMutexLock lock2(pool.acquire(AuxConnectionPool::Background, second));
+    ensure("Nested acquisition must return the same connection", first == second);
+
+    RecMutexLock lock3(pool.lockPrimary());
+  }
+  ensure_equals("Pool size", pool.size(), 1U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  // Connections are added on demand, but never more than the maximum. Background work leaves one connection free.
+  AuxConnectionPool pool(_primary, 3);
+
+  std::atomic<int> inUse(0), maxInUse(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.push_back(std::thread([&pool, &inUse, &maxInUse, i]() {
+      for (int j = 0; j < 100; ++j) {
+        sql::Dbc_connection_handler::Ref connection;
+        RecMutexLock lock(pool.acquire(AuxConnectionPool::Background, connection));
+
+        int current = ++inUse;
+        int maximum = maxInUse;
+        while (current > maximum && !maxInUse.compare_exchange_weak(maximum, current))
+          ;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        --inUse;
+      }
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  ensure("Pool exceeded its limit", pool.size() <= 3);
+  ensure("Background work must leave one connection free", maxInUse.load() <= 2);
+
+  AuxConnectionPool::Statistics statistics = pool.statistics();
+  ensure_equals("Background acquisitions", statistics.acquisitions[AuxConnectionPool::Background], 800U);
+  ensure_equals("Interactive acquisitions", statistics.acquisitions[AuxConnectionPool::Interactive], 0U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(3) {
+  // Retiring removes all but the primary connection, those in use when they are released.
+  AuxConnectionPool pool(_primary, 3);
+
+  std::atomic<bool> acquired(false), done(false);
+  std::thread worker([&pool, &acquired, &done]() {
+    sql::Dbc_connection_handler::Ref connection;
+    RecMutexLock lock(pool.acquire(AuxConnectionPool::Interactive, connection));
+    acquired = true;
+    while (!done)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  while (!acquired)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  sql::Dbc_connection_handler::Ref connection;
+  {
+    RecMutexLock lock(pool.acquire(AuxConnectionPool::Interactive, connection));
+    ensure("Second thread must get a different connection", connection != _primary);
+  }
+  ensure_equals("Pool size", pool.size(), 2U);
+
+  std::vector<sql::Dbc_connection_handler::Ref> retired = pool.retire();
+  ensure_equals("Idle connections retired", retired.size(), 1U);
+  ensure_equals("Pool size after retire", pool.size(), 1U);
+
+  done = true;
+  worker.join();
+  ensure_equals("Pool size at the end", pool.size(), 1U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+END_TESTS
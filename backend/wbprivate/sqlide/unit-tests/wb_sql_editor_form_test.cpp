@@ -21,6 +21,8 @@
  * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
  */
 
+#include <thread>
+
 #include "grts/structs.db.query.h"
 #include "sqlide/wb_context_sqlide.h"
 #include "sqlide/wb_live_schema_tree.h"
@@ -33,6 +35,8 @@
 #include "wb_helpers.h"
 #include "cppconn/driver.h"
 #include "cppconn/sqlstring.h"
+#include "cppconn/statement.h"
+#include "cppconn/resultset.h"
 
 #include "sqlide/wb_sql_editor_form.h"
 
@@ -691,6 +695,58 @@ TEST_FUNCTION(6) {
   ensure_equals("TF006CHK005 : Unexpected foreign key delete rule", pchild_data->referenced_table, "language");
 }
 
+// Runs "SELECT DATABASE()" on a background auxiliary connection in another thread and returns the connection used.
+static sql::Dbc_connection_handler::Ref query_from_other_thread(SqlEditorForm::Ref form, std::string &schema) {
+  sql::Dbc_connection_handler::Ref connection;
+  std::string error;
+  std::thread worker([&]() {
+    try {
+      base::RecMutexLock lock(form->ensure_valid_aux_connection(connection, false, AuxConnectionPool::Background));
+      std::unique_ptr<sql::Statement> statement(connection->ref->createStatement());
+      std::unique_ptr<sql::ResultSet> rs(statement->executeQuery("SELECT DATABASE()"));
+      if (rs->next())
+        schema = rs->getString(1);
+    } catch (std::exception &exc) {
+      error = exc.what();
+    }
+  });
+  worker.join();
+  tut::ensure_equals("Query on auxiliary connection failed", error, "");
+  return connection;
+}
+
+// Testing the auxiliary connection pool of the editor.
+TEST_FUNCTION(7) {
+  form->active_schema("wb_sql_editor_form_test");
+
+  // While one thread holds the main auxiliary connection, another one gets its own, opened on demand on the
+  // current default schema.
+  sql::Dbc_connection_handler::Ref first;
+  {
+    base::RecMutexLock lock(form->ensure_valid_aux_connection(first));
+
+    std::string schema;
+    sql::Dbc_connection_handler::Ref second = query_from_other_thread(form, schema);
+    ensure("TF007CHK001 : The busy connection was handed out twice", second != first);
+    ensure("TF007CHK002 : Added connection was not opened", second->ref.get_ptr() != nullptr);
+    ensure_equals("TF007CHK003 : Unexpected default schema", schema, "wb_sql_editor_form_test");
+  }
+
+  // Pooled connections follow changes of the default schema when they are handed out again.
+  form->active_schema("mysql");
+  {
+    base::RecMutexLock lock(form->ensure_valid_aux_connection(first));
+
+    std::string schema;
+    query_from_other_thread(form, schema);
+    ensure_equals("TF007CHK004 : Default schema change not applied", schema, "mysql");
+  }
+
+  // Without contention the main auxiliary connection is used.
+  std::string schema;
+  ensure("TF007CHK005 : Idle main connection not used", query_from_other_thread(form, schema) == first);
+}
+
 // Due to the tut nature, this must be executed as a last test always,
 // we can't have this inside of the d-tor.
 TEST_FUNCTION(99) {
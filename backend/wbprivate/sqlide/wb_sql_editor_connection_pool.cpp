@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "base/log.h"
+
+#include "wb_sql_editor_connection_pool.h"
+
+DEFAULT_LOG_DOMAIN("SqlEditor")
+
+using namespace base;
+
+// Number of prepared statements kept per connection. The recurring metadata queries are only a handful.
+static const std::size_t MaxCachedStatements = 32;
+
+// Waits longer than this are logged, to help finding the queries which block others.
+static const double LongWaitTime = 1.0;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+class AuxConnectionPool::Private {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Slot {
+    sql::Dbc_connection_handler::Ref connection;
+    RecMutex mutex;
+    std::thread::id owner;
+    std::size_t depth = 0;
+    bool retired = false;
+    Clock::time_point lastUsed;
+
+    sql::Connection *statementsConnection = nullptr; // The connection the cached statements were prepared on.
+    std::map<std::string, std::shared_ptr<sql::PreparedStatement>> statements;
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable condition;
+  std::vector<std::unique_ptr<Slot>> slots; // The first one is the primary connection.
+  std::size_t maxSize;
+  std::size_t waiting[2];
+  std::string activeSchema;
+  Statistics statistics;
+
+  Private(sql::Dbc_connection_handler::Ref primary, std::size_t size) : maxSize(std::max<std::size_t>(size, 1)) {
+    waiting[Interactive] = waiting[Background] = 0;
+    for (int i = 0; i < 2; ++i) {
+      statistics.acquisitions[i] = 0;
+      statistics.waits[i] = 0;
+      statistics.totalWaitTime[i] = 0;
+      statistics.maxWaitTime[i] = 0;
+    }
+
+    slots.push_back(std::unique_ptr<Slot>(new Slot()));
+    slots.back()->connection = primary;
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  Slot *ownedSlot(std::thread::id thread) {
+    for (auto &slot : slots)
+      if (slot->depth > 0 && slot->owner == thread)
+        return slot.get();
+    return nullptr;
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /**
+   * Picks a free slot or adds a new one, if the given priority allows it. Must be called with the mutex locked.
+   */
+  Slot *findFreeSlot(Priority priority) {
+    Slot *candidate = nullptr;
+    std::size_t freeCount = 0;
+    for (auto &slot : slots) {
+      if (slot->depth == 0 && !slot->retired) {
+        ++freeCount;
+        if (candidate == nullptr)
+          candidate = slot.get();
+      }
+    }
+
+    std::size_t available = freeCount + (maxSize > slots.size() ? maxSize - slots.size() : 0);
+
+    // Background work must leave one connection for interactive requests (unless there is only one at all).
+    if (priority == Background && (waiting[Interactive] > 0 || (available < 2 && maxSize > 1)))
+      return nullptr;
+
+    if (candidate != nullptr)
+      return candidate;
+
+    if (slots.size() < maxSize) {
+      slots.push_back(std::unique_ptr<Slot>(new Slot()));
+      slots.back()->connection.reset(new sql::Dbc_connection_handler());
+      slots.back()->connection->name = "aux" + std::to_string(slots.size() - 1);
+      return slots.back().get();
+    }
+
+    return nullptr;
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  RecMutexLock lock(Slot *slot) {
+    return RecMutexLock(slot->mutex, std::bind(&Private::release, this, slot));
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  void account(Priority priority, bool waited, Clock::time_point start) {
+    ++statistics.acquisitions[priority];
+    if (!waited)
+      return;
+
+    double waitTime = std::chrono::duration<double>(Clock::now() - start).count();
+    ++statistics.waits[priority];
+    statistics.totalWaitTime[priority] += waitTime;
+    if (waitTime > statistics.maxWaitTime[priority])
+      statistics.maxWaitTime[priority] = waitTime;
+
+    if (waitTime > LongWaitTime)
+      logDebug("%s request waited %.2fs for an auxiliary connection\n",
+               priority == Interactive ? "Interactive" : "Background", waitTime);
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  void release(Slot *slot) {
+    sql::Dbc_connection_handler::Ref retiredConnection;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      if (--slot->depth > 0)
+        return;
+
+      slot->owner = std::thread::id();
+      slot->lastUsed = Clock::now();
+      if (slot->retired) {
+        retiredConnection = slot->connection;
+        removeSlot(slot);
+      }
+    }
+    condition.notify_all();
+
+    if (retiredConnection && retiredConnection->ref.get_ptr() != nullptr) {
+      try {
+        retiredConnection->ref->close();
+      } catch (sql::SQLException &) {
+        // Ignore if the connection is already closed.
+      }
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  void removeSlot(Slot *slot) {
+    for (auto iterator = slots.begin(); iterator != slots.end(); ++iterator) {
+      if (iterator->get() == slot) {
+        slots.erase(iterator);
+        break;
+      }
+    }
+  }
+};
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AuxConnectionPool::AuxConnectionPool(sql::Dbc_connection_handler::Ref primary, std::size_t maxSize) {
+  _d = new Private(primary, maxSize);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AuxConnectionPool::~AuxConnectionPool() {
+  delete _d;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns a locked connection for the given priority, waiting if all connections are in use. If the calling thread
+ * already holds one, then this is returned again. A newly added connection has no server connection yet
+ * (connection->ref is not set), which the caller must establish while holding the lock.
+ */
+RecMutexLock AuxConnectionPool::acquire(Priority priority, sql::Dbc_connection_handler::Ref &connection) {
+  Private::Clock::time_point start = Private::Clock::now();
+  bool waited = false;
+
+  std::unique_lock<std::mutex> guard(_d->mutex);
+  std::thread::id self = std::this_thread::get_id();
+
+  Private::Slot *slot = _d->ownedSlot(self);
+  if (slot == nullptr) {
+    ++_d->waiting[priority];
+    while ((slot = _d->findFreeSlot(priority)) == nullptr) {
+      waited = true;
+      _d->condition.wait(guard);
+    }
+    --_d->waiting[priority];
+
+    // An interactive request might have blocked background requests, which can now continue.
+    if (priority == Interactive && _d->waiting[Interactive] == 0 && _d->waiting[Background] > 0)
+      _d->condition.notify_all();
+  }
+
+  slot->owner = self;
+  ++slot->depth;
+  _d->account(priority, waited, start);
+  connection = slot->connection;
+  guard.unlock();
+
+  return _d->lock(slot);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Locks the main connection, for operations which must work on this specific one (connecting, closing, keep alive).
+ */
+RecMutexLock AuxConnectionPool::lockPrimary(bool throwOnBlock) {
+  std::unique_lock<std::mutex> guard(_d->mutex);
+  std::thread::id self = std::this_thread::get_id();
+
+  Private::Slot *slot = _d->slots.front().get();
+  if (slot->depth > 0 && slot->owner != self) {
+    if (throwOnBlock)
+      throw mutex_busy_error();
+
+    while (slot->depth > 0)
+      _d->condition.wait(guard);
+  }
+
+  slot->owner = self;
+  ++slot->depth;
+  guard.unlock();
+
+  return _d->lock(slot);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns a prepared statement for the given query, which stays valid as long as the connection is locked.
+ * The connection must have been acquired by the calling thread.
+ */
+sql::PreparedStatement *AuxConnectionPool::preparedStatement(const sql::Dbc_connection_handler::Ref &connection,
+                                                             const std::string &query) {
+  Private::Slot *slot = nullptr;
+  {
+    std::lock_guard<std::mutex> guard(_d->mutex);
+    for (auto &candidate : _d->slots) {
+      if (candidate->connection == connection) {
+        slot = candidate.get();
+        break;
+      }
+    }
+  }
+
+  if (slot == nullptr || slot->owner != std::this_thread::get_id())
+    throw std::logic_error("Prepared statements can only be used with a locked pool connection");
+
+  // The slot is owned by this thread, so there's no need to keep the pool locked from here on.
+  if (slot->statementsConnection != connection->ref.get()) {
+    slot->statements.clear(); // The connection was re-established.
+    slot->statementsConnection = connection->ref.get();
+  }
+
+  auto iterator = slot->statements.find(query);
+  if (iterator != slot->statements.end())
+    return iterator->second.get();
+
+  if (slot->statements.size() >= MaxCachedStatements)
+    slot->statements.clear();
+
+  std::shared_ptr<sql::PreparedStatement> statement(connection->ref->prepareStatement(query));
+  slot->statements[query] = statement;
+  return statement.get();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes additional connections which were not used for the given number of seconds and returns them,
+ * so the caller can close them.
+ */
+std::vector<sql::Dbc_connection_handler::Ref> AuxConnectionPool::removeIdle(double maxIdleTime) {
+  std::vector<sql::Dbc_connection_handler::Ref> result;
+  Private::Clock::time_point now = Private::Clock::now();
+
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  for (std::size_t i = _d->slots.size() - 1; i > 0; --i) {
+    Private::Slot *slot = _d->slots[i].get();
+    if (slot->depth == 0 && std::chrono::duration<double>(now - slot->lastUsed).count() >= maxIdleTime) {
+      result.push_back(slot->connection);
+      _d->slots.erase(_d->slots.begin() + i);
+    }
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes all additional connections (e.g. on disconnect). Idle ones are returned for closing, those in use are
+ * closed when they are released.
+ */
+std::vector<sql::Dbc_connection_handler::Ref> AuxConnectionPool::retire() {
+  std::vector<sql::Dbc_connection_handler::Ref> result;
+
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  for (std::size_t i = _d->slots.size() - 1; i > 0; --i) {
+    Private::Slot *slot = _d->slots[i].get();
+    if (slot->depth == 0) {
+      result.push_back(slot->connection);
+      _d->slots.erase(_d->slots.begin() + i);
+    } else
+      slot->retired = true;
+  }
+
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void AuxConnectionPool::maxSize(std::size_t value) {
+  {
+    std::lock_guard<std::mutex> guard(_d->mutex);
+    _d->maxSize = std::max<std::size_t>(value, 1);
+  }
+  _d->condition.notify_all();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::size_t AuxConnectionPool::size() const {
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  return _d->slots.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * The default schema all pool connections should use. Connections are switched when they are acquired next time.
+ */
+void AuxConnectionPool::activeSchema(const std::string &schema) {
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  _d->activeSchema = schema;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::string AuxConnectionPool::activeSchema() const {
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  return _d->activeSchema;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AuxConnectionPool::Statistics AuxConnectionPool::statistics() const {
+  std::lock_guard<std::mutex> guard(_d->mutex);
+  return _d->statistics;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include "workbench/wb_backend_public_interface.h"
+
+#include "base/threading.h"
+
+#include "cppdbc.h"
+
+/**
+ * A small bounded pool of auxiliary connections for the background work of the SQL editor (live schema tree, object
+ * info, result set field info, live object editors etc.), so a slow metadata query doesn't block all others.
+ *
+ * The first connection is the editor's main auxiliary connection, additional ones are added on demand up to the
+ * configured maximum. Connection handlers are created here but connected by the owner (the pool doesn't know how to
+ * open a connection). A thread which already holds a pool connection gets the same one again on subsequent requests,
+ * so nested acquisitions behave like the recursive mutex they replace.
+ *
+ * Interactive requests are served before background requests and a background request never takes the last
+ * available connection, so there is always one left for the user.
+ *
+ * Each connection also has a small cache of prepared statements for recurring metadata queries.
+ */
+class MYSQLWBBACKEND_PUBLIC_FUNC AuxConnectionPool {
+public:
+  enum Priority { Interactive, Background };
+
+  struct Statistics {
+    std::size_t acquisitions[2]; // Indexed by priority.
+    std::size_t waits[2];        // Number of acquisitions which had to wait for a free connection.
+    double totalWaitTime[2];     // In seconds.
+    double maxWaitTime[2];
+  };
+
+  AuxConnectionPool(sql::Dbc_connection_handler::Ref primary, std::size_t maxSize);
+  ~AuxConnectionPool();
+
+  AuxConnectionPool(AuxConnectionPool const &o) = delete;
+  AuxConnectionPool &operator=(AuxConnectionPool const &o) = delete;
+
+  base::RecMutexLock acquire(Priority priority, sql::Dbc_connection_handler::Ref &connection);
+  base::RecMutexLock lockPrimary(bool throwOnBlock = false);
+
+  sql::PreparedStatement *preparedStatement(const sql::Dbc_connection_handler::Ref &connection,
+                                            const std::string &query);
+
+  std::vector<sql::Dbc_connection_handler::Ref> removeIdle(double maxIdleTime);
+  std::vector<sql::Dbc_connection_handler::Ref> retire();
+
+  void maxSize(std::size_t value);
+  std::size_t size() const;
+
+  void activeSchema(const std::string &schema);
+  std::string activeSchema() const;
+
+  Statistics statistics() const;
+
+private:
+  class Private;
+  Private *_d;
+};
@@ -266,6 +266,7 @@ SqlEditorForm::SqlEditorForm(wb::WBContextSQLIDE *wbsql)
     _version(grt::Initialized),
     _live_tree(SqlEditorTreeController::create(this)),
     _aux_dbc_conn(new sql::Dbc_connection_handler()),
+    _aux_pool(_aux_dbc_conn, 1),
     _usr_dbc_conn(new sql::Dbc_connection_handler()),
     _pimplMutex (new PrivateMutex) {
   _log = DbSqlEditorLog::create(this, 500);
@@ -417,8 +418,7 @@ void SqlEditorForm::finish_startup() {
 //--------------------------------------------------------------------------------------------------
 
 base::RecMutexLock SqlEditorForm::getAuxConnection(sql::Dbc_connection_handler::Ref &conn, bool lockOnly) {
-  RecMutexLock lock(ensure_valid_aux_connection(false, lockOnly));
-  conn = _aux_dbc_conn;
+  RecMutexLock lock(ensure_valid_aux_connection(conn, lockOnly));
   return lock;
 }
 
@@ -546,10 +546,11 @@ grt::StringRef SqlEditorForm::do_disconnect() {
     }
 
     {
-      RecMutexLock lock(_aux_dbc_conn_mutex);
+      RecMutexLock lock(_aux_pool.lockPrimary());
       close_connection(_aux_dbc_conn);
       _aux_dbc_conn->ref.reset();
     }
+    close_idle_aux_connections(true);
   }
 
   return grt::StringRef();
@@ -698,8 +699,9 @@ std::string SqlEditorForm::fetch_data_from_stored_procedure(std::string proc_cal
                                                             std::shared_ptr<sql::ResultSet> &rs) {
   std::string ret_val("");
   try {
-    RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection());
-    std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+    sql::Dbc_connection_handler::Ref conn;
+    RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection(conn));
+    std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
     stmt->execute(std::string(proc_call));
     do {
       rs.reset(stmt->getResultSet());
@@ -755,9 +757,10 @@ void SqlEditorForm::query_ps_statistics(std::int64_t conn_id, std::map<std::stri
                                       "NO_INDEX_USED",
                                       "NO_GOOD_INDEX_USED",
                                       nullptr};
-  RecMutexLock lock(ensure_valid_aux_connection());
+  sql::Dbc_connection_handler::Ref conn;
+  RecMutexLock lock(ensure_valid_aux_connection(conn));
 
-  std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+  std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
 
   try {
     std::auto_ptr<sql::ResultSet> result(stmt->executeQuery(base::strfmt(
@@ -775,9 +778,10 @@ void SqlEditorForm::query_ps_statistics(std::int64_t conn_id, std::map<std::stri
 }
 
 std::vector<SqlEditorForm::PSStage> SqlEditorForm::query_ps_stages(std::int64_t stmt_event_id) {
-  RecMutexLock lock(ensure_valid_aux_connection());
+  sql::Dbc_connection_handler::Ref conn;
+  RecMutexLock lock(ensure_valid_aux_connection(conn));
 
-  std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+  std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
   std::vector<PSStage> stages;
   try {
     std::auto_ptr<sql::ResultSet> result(stmt->executeQuery(
@@ -815,9 +819,10 @@ std::vector<SqlEditorForm::PSStage> SqlEditorForm::query_ps_stages(std::int64_t
 }
 
 std::vector<SqlEditorForm::PSWait> SqlEditorForm::query_ps_waits(std::int64_t stmt_event_id) {
-  RecMutexLock lock(ensure_valid_aux_connection());
+  sql::Dbc_connection_handler::Ref conn;
+  RecMutexLock lock(ensure_valid_aux_connection(conn));
 
-  std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+  std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
   std::vector<PSWait> waits;
   try {
     std::auto_ptr<sql::ResultSet> result(stmt->executeQuery(
@@ -1242,11 +1247,14 @@ std::string SqlEditorForm::get_client_lib_version() {
 grt::StringRef SqlEditorForm::do_connect(std::shared_ptr<sql::TunnelConnection> tunnel, sql::Authentication::Ref &auth,
                                          ConnectionErrorInfo *err_ptr) {
   try {
-    RecMutexLock aux_dbc_conn_mutex(_aux_dbc_conn_mutex);
+    RecMutexLock aux_dbc_conn_mutex(_aux_pool.lockPrimary());
     RecMutexLock usr_dbc_conn_mutex(_usr_dbc_conn_mutex);
 
     _aux_dbc_conn->ref.reset();
     _usr_dbc_conn->ref.reset();
+    close_idle_aux_connections(true);
+    long pool_size = bec::GRTManager::get()->get_app_option_int("DbSqlEditor:AuxConnectionPoolSize", 3);
+    _aux_pool.maxSize(pool_size > 0 ? (std::size_t)pool_size : 1);
 
     // connection info
     _connection_details["name"] = _connection->name();
@@ -1282,6 +1290,7 @@ grt::StringRef SqlEditorForm::do_connect(std::shared_ptr<sql::TunnelConnection>
     // open connections
     create_connection(_aux_dbc_conn, _connection, tunnel, auth, _aux_dbc_conn->autocommit_mode, false);
     create_connection(_usr_dbc_conn, _connection, tunnel, auth, _usr_dbc_conn->autocommit_mode, true);
+    _aux_pool.activeSchema(_aux_dbc_conn->active_schema);
     _serverIsOffline = false;
     cache_sql_mode();
 
@@ -1492,14 +1501,69 @@ bool SqlEditorForm::ping() const {
   return false;
 }
 
-base::RecMutexLock SqlEditorForm::ensure_valid_aux_connection(sql::Dbc_connection_handler::Ref &conn, bool lockOnly) {
-  RecMutexLock lock(ensure_valid_dbc_connection(_aux_dbc_conn, _aux_dbc_conn_mutex, lockOnly));
-  conn = _aux_dbc_conn;
+/**
+ * Returns one of the auxiliary connections from the pool, locked for the calling thread. Connections added
+ * to the pool are opened here on first use and switched to the current default schema when necessary.
+ */
+base::RecMutexLock SqlEditorForm::ensure_valid_aux_connection(sql::Dbc_connection_handler::Ref &conn, bool lockOnly,
+                                                              AuxConnectionPool::Priority priority) {
+  RecMutexLock lock(_aux_pool.acquire(priority, conn));
+
+  if (conn != _aux_dbc_conn && !conn->ref.get_ptr()) {
+    if (!_aux_dbc_conn->ref.get_ptr())
+      throw grt::db_not_connected("DBMS connection is not available");
+
+    conn->active_schema = _aux_pool.activeSchema();
+    std::shared_ptr<sql::TunnelConnection> tunnel = sql::DriverManager::getDriverManager()->getTunnel(_connection);
+    create_connection(conn, _connection, tunnel, sql::Authentication::Ref(), true, false);
+  } else
+    validate_dbc_connection(conn, lockOnly);
+
+  std::string schema = _aux_pool.activeSchema();
+  if (!lockOnly && conn->active_schema != schema) {
+    if (!schema.empty())
+      conn->ref->setSchema(schema);
+    conn->active_schema = schema;
+  }
+
   return lock;
 }
 
 RecMutexLock SqlEditorForm::ensure_valid_aux_connection(bool throw_on_block, bool lockOnly) {
-  return ensure_valid_dbc_connection(_aux_dbc_conn, _aux_dbc_conn_mutex, throw_on_block, lockOnly);
+  RecMutexLock lock(_aux_pool.lockPrimary(throw_on_block));
+  validate_dbc_connection(_aux_dbc_conn, lockOnly);
+  return lock;
+}
+
+/**
+ * Returns a cached prepared statement for the given auxiliary connection, which must be locked by the caller
+ * (see ensure_valid_aux_connection).
+ */
+sql::PreparedStatement *SqlEditorForm::prepared_aux_statement(const sql::Dbc_connection_handler::Ref &conn,
+                                                              const std::string &query) {
+  return _aux_pool.preparedStatement(conn, query);
+}
+
+/**
+ * Closes additional auxiliary connections, either all of them or only those not used for a while.
+ */
+void SqlEditorForm::close_idle_aux_connections(bool all) {
+  std::vector<sql::Dbc_connection_handler::Ref> connections;
+  if (all) {
+    connections = _aux_pool.retire();
+
+    AuxConnectionPool::Statistics statistics = _aux_pool.statistics();
+    for (int i = AuxConnectionPool::Interactive; i <= AuxConnectionPool::Background; ++i)
+      logDebug("Auxiliary connections, %s requests: %i, waited: %i (total %.2fs, max %.2fs)\n",
+               i == AuxConnectionPool::Interactive ? "interactive" : "background", (int)statistics.acquisitions[i],
+               (int)statistics.waits[i], statistics.totalWaitTime[i], statistics.maxWaitTime[i]);
+  } else {
+    long idle_time = bec::GRTManager::get()->get_app_option_int("DbSqlEditor:KeepAliveInterval", 600);
+    connections = _aux_pool.removeIdle((double)idle_time);
+  }
+
+  for (auto &connection : connections)
+    close_connection(connection);
 }
 
 RecMutexLock SqlEditorForm::ensure_valid_usr_connection(bool throw_on_block, bool lockOnly) {
@@ -1521,12 +1585,20 @@ RecMutexLock SqlEditorForm::ensure_valid_dbc_connection(sql::Dbc_connection_hand
                                                         base::RecMutex &dbc_conn_mutex, bool throw_on_block,
                                                         bool lockOnly) {
   RecMutexLock mutex_lock(dbc_conn_mutex, throw_on_block);
+  validate_dbc_connection(dbc_conn, lockOnly);
+  return mutex_lock;
+}
+
+/**
+ * Checks the given connection and tries to reconnect if it was lost. The connection must be locked by the caller.
+ */
+void SqlEditorForm::validate_dbc_connection(sql::Dbc_connection_handler::Ref &dbc_conn, bool lockOnly) {
   bool valid = false;
 
   sql::Dbc_connection_handler::Ref myref(dbc_conn);
   if (dbc_conn && dbc_conn->ref.get_ptr()) {
     if (lockOnly) // this is a special case, we need it in some situations like for example recordset_cdbc
-      return mutex_lock;
+      return;
 
     try {
       // use connector::isValid to check if server connection is valid
@@ -1553,8 +1625,6 @@ RecMutexLock SqlEditorForm::ensure_valid_dbc_connection(sql::Dbc_connection_hand
   }
   if (!valid)
     throw grt::db_not_connected("DBMS connection is not available");
-
-  return mutex_lock;
 }
 
 bool SqlEditorForm::auto_commit() {
@@ -1625,8 +1695,9 @@ void SqlEditorForm::cancel_query() {
 
   try {
     {
-      RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection());
-      std::auto_ptr<sql::Statement> stmt(_aux_dbc_conn->ref->createStatement());
+      sql::Dbc_connection_handler::Ref conn;
+      RecMutexLock aux_dbc_conn_mutex(ensure_valid_aux_connection(conn));
+      std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
       {
         base::ScopeExitTrigger schedule_timer_stop(std::bind(&Timer::stop, &timer));
         timer.run();
@@ -2417,6 +2488,7 @@ void SqlEditorForm::send_message_keep_alive() {
     // this also checks the connection state and restores it if possible
     ensure_valid_aux_connection();
     ensure_valid_usr_connection();
+    close_idle_aux_connections(false);
   } catch (const std::exception &) {
   }
 }
@@ -2776,6 +2848,7 @@ void SqlEditorForm::cache_active_schema_name() {
   std::string schema = _usr_dbc_conn->ref->getSchema();
   _usr_dbc_conn->active_schema = schema;
   _aux_dbc_conn->active_schema = schema;
+  _aux_pool.activeSchema(schema);
 
   exec_sql_task->execute_in_main_thread(std::bind(&SqlEditorForm::update_editor_title_schema, this, schema), false,
                                         true);
@@ -2791,6 +2864,7 @@ void SqlEditorForm::active_schema(const std::string &value) {
       if (!value.empty())
         _aux_dbc_conn->ref->setSchema(value);
       _aux_dbc_conn->active_schema = value;
+      _aux_pool.activeSchema(value);
     }
 
     {
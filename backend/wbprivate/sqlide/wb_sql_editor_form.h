@@ -39,6 +39,7 @@
 #include "sqlide/db_sql_editor_history_be.h"
 #include "sqlide/wb_context_sqlide.h"
 #include "sqlide/wb_live_schema_tree.h"
+#include "sqlide/wb_sql_editor_connection_pool.h"
 
 #include "cppdbc.h"
 
@@ -306,13 +307,18 @@ private:
   base::RecMutexLock ensure_valid_dbc_connection(sql::Dbc_connection_handler::Ref &dbc_conn,
                                                  base::RecMutex &dbc_conn_mutex, bool throw_on_block = false,
                                                  bool lockOnly = false);
+  void validate_dbc_connection(sql::Dbc_connection_handler::Ref &dbc_conn, bool lockOnly);
+  void close_idle_aux_connections(bool all);
   base::RecMutexLock ensure_valid_usr_connection(bool throw_on_block = false, bool lockOnly = false);
   base::RecMutexLock ensure_valid_aux_connection(bool throw_on_block = false, bool lockOnly = false);
 
   std::vector<std::pair<std::string, std::string>> runQueryForCache(const std::string &query);
 
 public:
-  base::RecMutexLock ensure_valid_aux_connection(sql::Dbc_connection_handler::Ref &conn, bool lockOnly = false);
+  base::RecMutexLock ensure_valid_aux_connection(sql::Dbc_connection_handler::Ref &conn, bool lockOnly = false,
+                                                 AuxConnectionPool::Priority priority = AuxConnectionPool::Interactive);
+  sql::PreparedStatement *prepared_aux_statement(const sql::Dbc_connection_handler::Ref &conn,
+                                                 const std::string &query);
   parsers::MySQLParserContext::Ref work_parser_context() {
     return _work_parser_context;
   };
@@ -547,7 +553,8 @@ private:
   db_mgmt_ConnectionRef _connection;
   // connection for maintenance operations, fetching schema contents & live editors (DDL only)
   sql::Dbc_connection_handler::Ref _aux_dbc_conn;
-  base::RecMutex _aux_dbc_conn_mutex;
+  // _aux_dbc_conn plus additional connections created on demand, for parallel background work
+  AuxConnectionPool _aux_pool;
 
   // connection for running sql scripts
   sql::Dbc_connection_handler::Ref _usr_dbc_conn;
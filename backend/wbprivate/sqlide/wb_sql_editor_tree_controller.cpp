@@ -375,7 +375,7 @@ bool SqlEditorTreeController::fetch_data_for_filter(
 
   sql::Dbc_connection_handler::Ref conn;
 
-  RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
+  RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn, false, AuxConnectionPool::Background));
 
   InternalSchema internal_schema(wb_internal_schema, conn);
 
@@ -431,7 +431,7 @@ std::vector<std::string> SqlEditorTreeController::fetch_schema_list() {
   try {
     sql::Dbc_connection_handler::Ref conn;
 
-    RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
+    RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn, false, AuxConnectionPool::Background));
 
     bool showSystemSchemas = bec::GRTManager::get()->get_app_option_int("DbSqlEditor:ShowMetadataSchemata", 0) != 0;
 
@@ -502,7 +502,7 @@ grt::StringRef SqlEditorTreeController::do_fetch_live_schema_contents(
 
     {
       sql::Dbc_connection_handler::Ref conn;
-      RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
+      RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn, false, AuxConnectionPool::Background));
       std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
 
       {
@@ -1717,15 +1717,14 @@ std::string SqlEditorTreeController::get_object_ddl_script(wb::LiveSchemaTree::O
     // Solve this by using the I_S.
     if (type == wb::LiveSchemaTree::View && e.getErrorCode() == 1356) {
       sql::Dbc_connection_handler::Ref conn;
-      std::string query, view;
       RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
-      query = base::sqlstring(
-                "SELECT DEFINER, SECURITY_TYPE, VIEW_DEFINITION FROM INFORMATION_SCHEMA.VIEWS WHERE TABLE_SCHEMA = ? "
-                "AND TABLE_NAME = ?",
-                0)
-              << schema_name << obj_name;
-      std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
-      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(query));
+      sql::PreparedStatement *stmt = _owner->prepared_aux_statement(
+        conn,
+        "SELECT DEFINER, SECURITY_TYPE, VIEW_DEFINITION FROM INFORMATION_SCHEMA.VIEWS WHERE TABLE_SCHEMA = ? "
+        "AND TABLE_NAME = ?");
+      stmt->setString(1, schema_name);
+      stmt->setString(2, obj_name);
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery());
 
       if (rs.get() && rs->next()) {
         std::string view, definer;
@@ -1809,15 +1808,14 @@ std::pair<std::string, std::string> SqlEditorTreeController::get_object_create_s
     if (type == wb::LiveSchemaTree::View && e.getErrorCode() == 1356) {
       // Error for not being allowed to run SHOW CREATE VIEW. Use I_S instead to get the code.
       sql::Dbc_connection_handler::Ref conn;
-      std::string query, view;
       RecMutexLock aux_dbc_conn_mutex(_owner->ensure_valid_aux_connection(conn));
-      query = base::sqlstring(
-                "SELECT DEFINER, SECURITY_TYPE, VIEW_DEFINITION FROM INFORMATION_SCHEMA.VIEWS WHERE TABLE_SCHEMA = ? "
-                "AND TABLE_NAME = ?",
-                0)
-              << schema_name << obj_name;
-      std::auto_ptr<sql::Statement> stmt(conn->ref->createStatement());
-      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery(query));
+      sql::PreparedStatement *stmt = _owner->prepared_aux_statement(
+        conn,
+        "SELECT DEFINER, SECURITY_TYPE, VIEW_DEFINITION FROM INFORMATION_SCHEMA.VIEWS WHERE TABLE_SCHEMA = ? "
+        "AND TABLE_NAME = ?");
+      stmt->setString(1, schema_name);
+      stmt->setString(2, obj_name);
+      std::auto_ptr<sql::ResultSet> rs(stmt->executeQuery());
 
       if (rs.get() && rs->next()) {
         std::string view, definer;
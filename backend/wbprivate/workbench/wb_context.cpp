@@ -53,6 +53,7 @@
 #include "model/wb_component_physical.h"
 
 #include "sqlide/wb_context_sqlide.h"
+#include "sqlide/analysis_executor.h"
 
 #include "upgrade_helper.h"
 
@@ -582,6 +583,7 @@ void WBContext::finalize() {
   }
 
   _grtManager->get_dispatcher()->shutdown();
+  AnalysisExecutor::stop();
   if (_tunnel_manager) {
     delete _tunnel_manager;
     _tunnel_manager = nullptr;
@@ -1414,10 +1416,13 @@ void WBContext::set_default_options(grt::DictRef options) {
   set_default(options, "DbSqlEditor:KeepAliveInterval", 600);            // in seconds
   set_default(options, "DbSqlEditor:ReadTimeOut", 30);                  // in seconds
   set_default(options, "DbSqlEditor:ConnectionTimeOut", 60);             // in seconds
+  set_default(options, "DbSqlEditor:AuxConnectionPoolSize", 3);
   set_default(options, "DbSqlEditor:MaxQuerySizeToHistory", 65536);
+  set_default(options, "DbSqlEditor:FullSyntaxCheckLimit", 10 * 1024 * 1024); // in bytes
   set_default(options, "DbSqlEditor:ContinueOnError", 0); // continue running sql script bypassing failed statements
   set_default(options, "DbSqlEditor:AutocommitMode", 1);  // when enabled, each statement will be committed immediately
   set_default(options, "DbSqlEditor:IsDataChangesCommitWizardEnabled", 1);
+  set_default(options, "DbSqlEditor:ApplyChangesBatchSize", 1000); // rows per multi-row statement
   set_default(options, "DbSqlEditor:ShowSchemaTreeSchemaContents", 1);
   set_default(options, "DbSqlEditor:SafeUpdates", 1);
   set_default(options, "DbSqlEditor:ShowWarnings", 1);
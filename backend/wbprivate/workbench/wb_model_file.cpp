@@ -391,6 +391,17 @@ std::string ModelFile::get_path_for(const std::string &file) {
 workbench_DocumentRef ModelFile::retrieve_document() {
   RecMutexLock lock(_mutex);
 
+  // Documents of the current version are streamed from the mapped file, which is much faster and needs
+  // a fraction of the memory for big models. Anything else goes through the DOM, which allows fixes on XML level.
+  {
+    workbench_DocumentRef doc(unserialize_mapped_document(get_path_for(MAIN_DOCUMENT_NAME)));
+    if (doc.is_valid()) {
+      if (!semantic_check(doc))
+        throw std::logic_error(_("Invalid model file content."));
+      return doc;
+    }
+  }
+
   xmlDocPtr xmldoc = grt::GRT::get()->load_xml(get_path_for(MAIN_DOCUMENT_NAME));
 
 retry:
@@ -550,7 +561,61 @@ std::list<std::string> ModelFile::unpack_zip(const std::string &zipfile, const s
   return unpacked_files;
 }
 
-static void zip_dir_contents(zip *z, const std::string &destdir, const std::string &partial) {
+// The CRC-32 used in zip files.
+static bool file_crc32(const std::string &path, zip_uint32_t &crc) {
+  static const std::vector<zip_uint32_t> table = []() {
+    std::vector<zip_uint32_t> result(256);
+    for (zip_uint32_t i = 0; i < 256; ++i) {
+      zip_uint32_t value = i;
+      for (int bit = 0; bit < 8; ++bit)
+        value = (value & 1) ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+      result[i] = value;
+    }
+    return result;
+  }();
+
+  FILE *file = base_fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+
+  unsigned char buffer[65536];
+  size_t c;
+  crc = 0xFFFFFFFF;
+  while ((c = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    for (size_t i = 0; i < c; ++i)
+      crc = table[(crc ^ buffer[i]) & 0xFF] ^ (crc >> 8);
+  }
+  crc ^= 0xFFFFFFFF;
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  return ok;
+}
+
+/**
+ * Returns a source for the member of the given name in the previous version of the archive, if the file
+ * has not changed since it was written there. Its compressed data is then copied as is, instead of compressing
+ * the file again (which is what takes most of the time when saving models with big attachments).
+ */
+static zip_source *unchanged_member_source(zip *z, zip *previous, const std::string &file) {
+  zip_int64_t index = zip_name_locate(previous, file.c_str(), 0);
+  if (index < 0)
+    return NULL;
+
+  struct zip_stat stat;
+  zip_stat_init(&stat);
+  if (zip_stat_index(previous, index, 0, &stat) < 0 || !(stat.valid & ZIP_STAT_SIZE) || !(stat.valid & ZIP_STAT_CRC))
+    return NULL;
+
+  long size = base_get_file_size(file.c_str());
+  zip_uint32_t crc;
+  if (size < 0 || (zip_uint64_t)size != stat.size || !file_crc32(file, crc) || crc != stat.crc)
+    return NULL;
+
+  return zip_source_zip(z, previous, index, 0, 0, 0);
+}
+
+static void zip_dir_contents(zip *z, const std::string &destdir, const std::string &partial, zip *previous) {
   GError *error = 0;
   GDir *dir = g_dir_open(destdir.empty() ? "." : destdir.c_str(), 0, &error);
   if (!dir) {
@@ -574,7 +639,7 @@ static void zip_dir_contents(zip *z, const std::string &destdir, const std::stri
       if (g_file_test(tmp.c_str(), G_FILE_TEST_IS_DIR)) {
         if (add_directories) {
           try {
-            zip_dir_contents(z, destdir.empty() ? entry : destdir + G_DIR_SEPARATOR + entry, tmp);
+            zip_dir_contents(z, destdir.empty() ? entry : destdir + G_DIR_SEPARATOR + entry, tmp, previous);
           } catch (...) {
             g_dir_close(dir);
             throw;
@@ -582,7 +647,9 @@ static void zip_dir_contents(zip *z, const std::string &destdir, const std::stri
         }
       } else {
         if (!add_directories) {
-          zip_source *src = zip_source_file(z, tmp.c_str(), 0, 0);
+          zip_source *src = previous != NULL ? unchanged_member_source(z, previous, tmp) : NULL;
+          if (!src)
+            src = zip_source_file(z, tmp.c_str(), 0, 0);
 #ifdef _MSC_VER
           if (!src || zip_file_add(z, tmp.c_str(), src, ZIP_FL_OVERWRITE | ZIP_FL_ENC_UTF_8) < 0) {
             zip_source_free(src);
@@ -604,7 +671,12 @@ static void zip_dir_contents(zip *z, const std::string &destdir, const std::stri
   g_dir_close(dir);
 }
 
-void ModelFile::pack_zip(const std::string &zipfile, const std::string &destdir, const std::string &comment) {
+/**
+ * Packs the contents of destdir into zipfile. If previous_zipfile is given (the last saved version of the file),
+ * members which did not change since are copied from there without compressing them again.
+ */
+void ModelFile::pack_zip(const std::string &zipfile, const std::string &destdir, const std::string &comment,
+                         const std::string &previous_zipfile) {
   std::string curdir;
 
   {
@@ -653,8 +725,13 @@ void ModelFile::pack_zip(const std::string &zipfile, const std::string &destdir,
   zip_set_archive_comment(z, zip_comment.c_str(), (int)zip_comment.size());
 #endif
 
+  // Must stay open until the new archive is written, as unchanged members are read from it.
+  zip *previous = NULL;
+  if (!previous_zipfile.empty())
+    previous = zip_open(previous_zipfile.c_str(), 0, &err);
+
   try {
-    zip_dir_contents(z, "", "");
+    zip_dir_contents(z, "", "", previous);
 
     if (zip_close(z) < 0) {
       std::string err = zip_strerror(z) ? zip_strerror(z) : "";
@@ -662,9 +739,13 @@ void ModelFile::pack_zip(const std::string &zipfile, const std::string &destdir,
       throw std::runtime_error(strfmt(_("Error writing zip file: %s"), err.c_str()));
     }
 
+    if (previous)
+      zip_close(previous);
     g_chdir(curdir.c_str());
   } catch (...) {
     zip_close(z);
+    if (previous)
+      zip_close(previous);
     g_chdir(curdir.c_str());
     throw;
   }
@@ -713,6 +794,42 @@ workbench_DocumentRef ModelFile::unserialize_document(xmlDocPtr xmldoc, const st
 
 //--------------------------------------------------------------------------------------------------
 
+/**
+ * Loads the document without building an XML tree first, if it is of the current version and needs no fixes
+ * on XML level. Returns an invalid ref if the document must be loaded via unserialize_document() instead.
+ */
+workbench_DocumentRef ModelFile::unserialize_mapped_document(const std::string &path) {
+  std::string doctype, version;
+  grt::ValueRef value;
+
+  try {
+    value = grt::GRT::get()->unserialize_mapped(path, DOCUMENT_VERSION, doctype, version);
+  } catch (std::exception &exc) {
+    logWarning("Streaming load of %s failed, falling back to full XML parsing: %s\n", path.c_str(), exc.what());
+    return workbench_DocumentRef();
+  }
+
+  if (!value.is_valid() || doctype != DOCUMENT_FORMAT || !workbench_DocumentRef::can_wrap(value))
+    return workbench_DocumentRef();
+
+  _loaded_version = version;
+
+  // reset list of warnings found during load
+  _load_warnings.clear();
+
+  workbench_DocumentRef doc(workbench_DocumentRef::cast_from(value));
+
+  doc = attempt_document_upgrade(doc, NULL, version);
+
+  cleanup_upgrade_data();
+
+  check_and_fix_inconsistencies(doc, version);
+
+  return doc;
+}
+
+//--------------------------------------------------------------------------------------------------
+
 /**
  * Core save routine for model files. It does a backup of the existing model file of the given name
  * (if there is one). Checks are performed to ensure existing backup files can be removed and existing
@@ -726,6 +843,7 @@ bool ModelFile::save_to(const std::string &path, const std::string &comment) {
   const int read_write = S_IRUSR | S_IWUSR;
 #endif
 
+  std::string backup_path;
   if (g_file_test(path.c_str(), G_FILE_TEST_EXISTS)) {
     std::string tmp = path + ".bak";
     if (g_file_test(tmp.c_str(), G_FILE_TEST_EXISTS)) {
@@ -774,6 +892,7 @@ bool ModelFile::save_to(const std::string &path, const std::string &comment) {
                             " could not"
                             "be backed up. The system returned the error: \n\n",
                           errno);
+    backup_path = tmp;
   }
 
   for (std::list<std::string>::const_iterator iter = _delete_queue.begin(); iter != _delete_queue.end(); ++iter)
@@ -786,10 +905,11 @@ bool ModelFile::save_to(const std::string &path, const std::string &comment) {
   g_remove(get_path_for("real_path").c_str());
 
   if (g_path_is_absolute(path.c_str()))
-    pack_zip(path, _content_dir, comment);
+    pack_zip(path, _content_dir, comment, backup_path);
   else {
     char *prefix = g_get_current_dir();
-    pack_zip(std::string(prefix).append("/").append(path), _content_dir, comment);
+    pack_zip(std::string(prefix).append("/").append(path), _content_dir, comment,
+             backup_path.empty() ? "" : std::string(prefix).append("/").append(backup_path));
     g_free(prefix);
   }
 
@@ -921,13 +1041,13 @@ std::string ModelFile::get_file_contents(const std::string &path) {
 
 // writing
 void ModelFile::store_document(const workbench_DocumentRef &doc) {
-  grt::GRT::get()->serialize(doc, get_path_for(MAIN_DOCUMENT_NAME), DOCUMENT_FORMAT, DOCUMENT_VERSION);
+  grt::GRT::get()->serialize(doc, get_path_for(MAIN_DOCUMENT_NAME), DOCUMENT_FORMAT, DOCUMENT_VERSION, false, true);
 
   _dirty = true;
 }
 
 void ModelFile::store_document_autosave(const workbench_DocumentRef &doc) {
-  grt::GRT::get()->serialize(doc, get_path_for("document-autosave.mwb.xml"), DOCUMENT_FORMAT, DOCUMENT_VERSION);
+  grt::GRT::get()->serialize(doc, get_path_for("document-autosave.mwb.xml"), DOCUMENT_FORMAT, DOCUMENT_VERSION, false, true);
 }
 
 void ModelFile::delete_file(const std::string &path) {
@@ -131,6 +131,7 @@ namespace wb {
     workbench_DocumentRef unserialize_document(xmlDocPtr xmldoc, const std::string &path);
 
   private:
+    workbench_DocumentRef unserialize_mapped_document(const std::string &path);
     bool attempt_xml_document_upgrade(xmlDocPtr xmldoc, const std::string &version);
     workbench_DocumentRef attempt_document_upgrade(const workbench_DocumentRef &doc, xmlDocPtr xmldoc,
                                                    const std::string &version);
@@ -145,7 +146,8 @@ namespace wb {
 
   public:
     static std::list<std::string> unpack_zip(const std::string &zipfile, const std::string &destdir);
-    void pack_zip(const std::string &zipfile, const std::string &destdir, const std::string &comment = "");
+    void pack_zip(const std::string &zipfile, const std::string &destdir, const std::string &comment = "",
+                  const std::string &previous_zipfile = "");
 
   private:
     static std::string add_attachment_file(const std::string &destdir, const std::string &path);
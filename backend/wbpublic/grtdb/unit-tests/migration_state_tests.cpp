@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "grt.h"
+
+#include "grts/structs.db.migration.h"
+#include "grts/structs.db.mysql.h"
+#include "grtpp_util.h"
+#include "wb_helpers.h"
+
+#define VERBOSE_OUTPUT 0
+
+using namespace grt;
+
+BEGIN_TEST_DATA_CLASS(migration_state_tests)
+public:
+WBTester *tester;
+
+TEST_DATA_CONSTRUCTOR(migration_state_tests) {
+  tester = new WBTester();
+  populate_grt(*tester);
+}
+END_TEST_DATA_CLASS
+
+TEST_MODULE(migration_state_tests, "Migration state lookups");
+
+static db_mysql_TableRef make_table(const db_mysql_SchemaRef &schema, const std::string &name) {
+  db_mysql_TableRef table(grt::Initialized);
+  table->owner(schema);
+  table->name(name);
+  schema->tables().insert(table);
+  return table;
+}
+
+static db_migration_DatatypeMappingRef make_mapping(const std::string &source, const std::string &target, ssize_t from,
+                                                    ssize_t to) {
+  db_migration_DatatypeMappingRef mapping(grt::Initialized);
+  mapping->sourceDatatypeName(source);
+  mapping->targetDatatypeName(target);
+  mapping->lengthConditionFrom(from);
+  mapping->lengthConditionTo(to);
+  return mapping;
+}
+
+TEST_FUNCTION(5) {
+  // Matching target objects.
+  db_migration_MigrationRef state(grt::Initialized);
+  db_mysql_SchemaRef source_schema(grt::Initialized);
+  source_schema->name("src");
+  db_mysql_SchemaRef target_schema(grt::Initialized);
+  target_schema->name("tgt");
+
+  db_mysql_TableRef source = make_table(source_schema, "Customers");
+  db_mysql_TableRef target = make_table(target_schema, "customers");
+  state->addMigrationLogEntry(0, source, target, "");
+  state->addMigrationLogEntry(1, source, target, "warning");
+
+  ensure_equals("one log object per source/target pair", state->migrationLog().count(), 1U);
+  ensure_equals("log entries", state->findMigrationLogEntry(source, target)->entries().count(), 2U);
+
+  // Matched by type, owner and case insensitive name, not by identity.
+  db_mysql_TableRef other = make_table(source_schema, "CUSTOMERS");
+  ensure("match by name", state->findMatchingTargetObject(other) == target);
+  ensure("no match for other names", !state->findMatchingTargetObject(make_table(source_schema, "orders")).is_valid());
+
+  db_mysql_SchemaRef other_schema(grt::Initialized);
+  other_schema->name("other");
+  ensure("no match in other schemas",
+         !state->findMatchingTargetObject(make_table(other_schema, "customers")).is_valid());
+
+  db_mysql_ViewRef view(grt::Initialized);
+  view->owner(source_schema);
+  view->name("customers");
+  ensure("no match for other types", !state->findMatchingTargetObject(view).is_valid());
+
+  // Changes made directly to the log are picked up, also if they keep its size.
+  db_mysql_TableRef new_target = make_table(target_schema, "clients");
+  GrtLogObjectRef replacement(grt::Initialized);
+  replacement->logObject(source);
+  replacement->refObject(new_target);
+  state->migrationLog().set(0, replacement);
+  ensure_equals("same size log", state->migrationLog().count(), 1U);
+  ensure("replaced match", state->findMatchingTargetObject(other) == new_target);
+  ensure("replaced log entry", !state->findMigrationLogEntry(source, target).is_valid());
+  ensure("replacement log entry", state->findMigrationLogEntry(source, new_target) == replacement);
+
+  state->migrationLog().remove_all();
+  ensure("log cleared", !state->findMatchingTargetObject(other).is_valid());
+  ensure("log entry removed", !state->findMigrationLogEntry(source, target).is_valid());
+}
+
+TEST_FUNCTION(10) {
+  // Datatype mappings and target datatypes.
+  db_migration_MigrationRef state(grt::Initialized);
+  state->genericDatatypeMappings().insert(make_mapping("varchar", "VARCHAR", 0, 255));
+  state->genericDatatypeMappings().insert(make_mapping("VARCHAR", "TEXT", 256, 0));
+  state->genericDatatypeMappings().insert(make_mapping("VARCHAR", "LONGTEXT", 0, 0));
+
+  db_mysql_ColumnRef column(grt::Initialized);
+  column->length(100);
+  ensure_equals("short varchar", *state->lookupDatatypeMapping(column, "Varchar")->targetDatatypeName(), "VARCHAR");
+  column->length(1000);
+  ensure_equals("long varchar", *state->lookupDatatypeMapping(column, "VARCHAR")->targetDatatypeName(), "TEXT");
+  column->length(0);
+  ensure_equals("no length", *state->lookupDatatypeMapping(column, "VARCHAR")->targetDatatypeName(), "VARCHAR");
+  ensure("unmapped type", !state->lookupDatatypeMapping(column, "MONEY").is_valid());
+
+  state->genericDatatypeMappings().insert(make_mapping("MONEY", "DECIMAL", 0, 0));
+  ensure_equals("added mapping", *state->lookupDatatypeMapping(column, "money")->targetDatatypeName(), "DECIMAL");
+
+  // Edits keeping the number of mappings, in place or by replacing one.
+  state->genericDatatypeMappings()[3]->sourceDatatypeName("CURRENCY");
+  ensure("renamed mapping", !state->lookupDatatypeMapping(column, "MONEY").is_valid());
+  ensure_equals("mapping by new name", *state->lookupDatatypeMapping(column, "CURRENCY")->targetDatatypeName(),
+                "DECIMAL");
+  state->genericDatatypeMappings().set(3, make_mapping("MONEY", "DOUBLE", 0, 0));
+  ensure("replaced mapping", !state->lookupDatatypeMapping(column, "CURRENCY").is_valid());
+  ensure_equals("replacement mapping", *state->lookupDatatypeMapping(column, "MONEY")->targetDatatypeName(),
+                "DOUBLE");
+
+  ensure("no target catalog", !state->lookupTargetDatatype("INT").is_valid());
+  db_mysql_CatalogRef catalog(grt::Initialized);
+  grt::replace_contents(catalog->simpleDatatypes(), tester->get_rdbms()->simpleDatatypes());
+  state->targetCatalog(catalog);
+  ensure_equals("target datatype", *state->lookupTargetDatatype("int")->name(), "INT");
+  ensure("unknown target datatype", !state->lookupTargetDatatype("MONEY").is_valid());
+
+  db_SimpleDatatypeRef money(grt::Initialized);
+  money->name("MONEY");
+  catalog->simpleDatatypes().set(0, money);
+  ensure("replaced target datatype", state->lookupTargetDatatype("money") == money);
+  money->name("CASH");
+  ensure("renamed target datatype", !state->lookupTargetDatatype("MONEY").is_valid());
+  ensure("target datatype by new name", state->lookupTargetDatatype("cash") == money);
+}
+
+TEST_FUNCTION(15) {
+  // Synthetic large catalog: every table and column is logged and then looked up again the way the migration
+  // modules do it while migrating foreign keys and column types.
+  const int table_count = 10000;
+  const int column_count = 50;
+
+  db_migration_MigrationRef state(grt::Initialized);
+  db_mysql_CatalogRef catalog(grt::Initialized);
+  grt::replace_contents(catalog->simpleDatatypes(), tester->get_rdbms()->simpleDatatypes());
+  state->targetCatalog(catalog);
+  for (int i = 0; i < 200; ++i)
+    state->genericDatatypeMappings().insert(make_mapping("TYPE" + std::to_string(i), "VARCHAR", 0, 0));
+  state->genericDatatypeMappings().insert(make_mapping("VARCHAR", "VARCHAR", 0, 255));
+  state->genericDatatypeMappings().insert(make_mapping("VARCHAR", "TEXT", 256, 0));
+
+  db_mysql_SchemaRef source_schema(grt::Initialized);
+  source_schema->name("src");
+  db_mysql_SchemaRef target_schema(grt::Initialized);
+  target_schema->name("tgt");
+
+  std::vector<db_mysql_ColumnRef> source_columns;
+  source_columns.reserve(table_count * column_count);
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  for (int t = 0; t < table_count; ++t) {
+    std::string name = "table_" + std::to_string(t);
+    db_mysql_TableRef source = make_table(source_schema, name);
+    db_mysql_TableRef target = make_table(target_schema, name);
+    state->addMigrationLogEntry(0, source, target, "");
+    for (int c = 0; c < column_count; ++c) {
+      db_mysql_ColumnRef source_column(grt::Initialized);
+      source_column->owner(source);
+      source_column->name("column_" + std::to_string(c));
+      source_column->length(c * 10);
+      db_mysql_ColumnRef target_column(grt::Initialized);
+      target_column->owner(target);
+      target_column->name(source_column->name());
+      state->addMigrationLogEntry(0, source_column, target_column, "");
+      source_columns.push_back(source_column);
+    }
+  }
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+#endif
+
+  size_t matched = 0, typed = 0;
+  for (std::vector<db_mysql_ColumnRef>::const_iterator column = source_columns.begin(); column != source_columns.end();
+       ++column) {
+    GrtObjectRef target = state->findMatchingTargetObject(*column);
+    if (target.is_valid() && *target->name() == *(*column)->name())
+      ++matched;
+    db_migration_DatatypeMappingRef mapping = state->lookupDatatypeMapping(*column, "varchar");
+    if (mapping.is_valid() && state->lookupTargetDatatype(mapping->targetDatatypeName()).is_valid())
+      ++typed;
+  }
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+  std::cout << "Migration state: logged " << table_count << " tables with " << source_columns.size() << " columns in "
+            << (t2 - t1) << ", looked them up in " << (t3 - t2) << std::endl;
+#endif
+
+  ensure_equals("log objects", state->migrationLog().count(), (size_t)(table_count * (column_count + 1)));
+  ensure_equals("matched columns", matched, source_columns.size());
+  ensure_equals("typed columns", typed, source_columns.size());
+}
+
+static db_SimpleDatatypeRef make_datatype(const std::string &name) {
+  db_SimpleDatatypeRef datatype(grt::Initialized);
+  datatype->name(name);
+  return datatype;
+}
+
+static db_mysql_ColumnRef make_column(const db_mysql_TableRef &table, const std::string &name,
+                                      const db_SimpleDatatypeRef &datatype, ssize_t length,
+                                      const std::string &default_value = "") {
+  db_mysql_ColumnRef column(grt::Initialized);
+  column->owner(table);
+  column->name(name);
+  column->simpleType(datatype);
+  column->length(length);
+  column->defaultValue(default_value);
+  table->columns().insert(column);
+  return column;
+}
+
+static grt::DictRef make_rule(const std::string &target) {
+  grt::DictRef rule(true);
+  rule.gset("target", target);
+  return rule;
+}
+
+// A subset of the rules the SQLite migration module uses.
+static grt::DictRef make_column_rules() {
+  grt::DictRef datatypes(true);
+
+  grt::BaseListRef varchar(true);
+  grt::DictRef rule = make_rule("VARCHAR");
+  rule.gset("minLength", 0);
+  rule.gset("maxLength", 255);
+  varchar.ginsert(rule);
+  varchar.ginsert(make_rule("LONGTEXT"));
+  datatypes.set("VARCHAR", varchar);
+
+  grt::BaseListRef integer(true);
+  rule = make_rule("INT");
+  rule.gset("precision", -1);
+  grt::StringListRef literals(grt::Initialized);
+  literals.insert("integer");
+  rule.set("defaultLiterals", literals);
+  integer.ginsert(rule);
+  datatypes.set("INTEGER", integer);
+
+  grt::BaseListRef boolean(true);
+  rule = make_rule("TINYINT");
+  rule.gset("length", 1);
+  rule.gset("message", "Source column type BOOLEAN was migrated to TINYINT(1)");
+  grt::StringListRef flags(grt::Initialized);
+  flags.insert("UNSIGNED");
+  rule.set("flags", flags);
+  grt::DictRef values(true);
+  values.gset("TRUE", "1");
+  values.gset("FALSE", "0");
+  rule.set("defaultValues", values);
+  boolean.ginsert(rule);
+  datatypes.set("BOOLEAN", boolean);
+
+  grt::BaseListRef unknown(true);
+  unknown.ginsert(make_rule("NO_SUCH_TYPE"));
+  datatypes.set("UNKNOWN", unknown);
+
+  grt::DictRef rules(true);
+  rules.gset("maxIdentifierLength", 64);
+  rules.gset("quotedIdentifierChars", "[\"");
+  rules.set("datatypes", datatypes);
+  return rules;
+}
+
+TEST_FUNCTION(20) {
+  // Native column migration.
+  db_migration_MigrationRef state(grt::Initialized);
+  db_mysql_CatalogRef catalog(grt::Initialized);
+  grt::replace_contents(catalog->simpleDatatypes(), tester->get_rdbms()->simpleDatatypes());
+  state->targetCatalog(catalog);
+
+  db_mysql_SchemaRef source_schema(grt::Initialized);
+  source_schema->name("src");
+  db_mysql_SchemaRef target_schema(grt::Initialized);
+  target_schema->name("tgt");
+  db_mysql_TableRef source = make_table(source_schema, "t");
+  db_mysql_TableRef target = make_table(target_schema, "t");
+
+  db_mysql_ColumnRef short_text = make_column(source, "short_text", make_datatype("varchar"), 100);
+  short_text->collationName("latin1_bin");
+  short_text->flags().insert("BINARY");
+  make_column(source, "long_text", make_datatype("VARCHAR"), 1000);
+  make_column(source, "id", make_datatype("INTEGER"), -1, "42");
+  make_column(source, "flag", make_datatype("BOOLEAN"), -1, "true");
+  make_column(source, "bad_default", make_datatype("INTEGER"), -1, "1.5");
+  make_column(source, std::string(70, 'x'), make_datatype("INTEGER"), -1);
+  make_column(source, "[quoted]", make_datatype("INTEGER"), -1);
+  make_column(source, "unmapped", make_datatype("MONEY"), -1, "0");
+  make_column(source, "unknown_target", make_datatype("UNKNOWN"), -1);
+  make_column(source, "no_type", db_SimpleDatatypeRef(), -1);
+
+  grt::DictListRef pending = state->migrateTableColumns(source, target, make_column_rules());
+  ensure_equals("target columns", target->columns().count(), source->columns().count());
+
+  db_mysql_ColumnRef column = target->columns()[0];
+  ensure("varchar type", column->simpleType() == state->lookupTargetDatatype("VARCHAR"));
+  ensure_equals("varchar length", *column->length(), 100);
+  ensure("source flags copied", column->flags().get_index("BINARY") != grt::BaseListRef::npos);
+  ensure("log entry", state->findMigrationLogEntry(short_text, column).is_valid());
+  ensure("source lookup", state->lookupSourceObject(column) == short_text);
+  ensure_equals("single collation moved to table", *target->defaultCollationName(), "latin1_bin");
+  ensure_equals("column collation cleared", *column->collationName(), "");
+
+  ensure("long varchar", target->columns()[1]->simpleType() == state->lookupTargetDatatype("LONGTEXT"));
+  column = target->columns()[2];
+  ensure("int type", column->simpleType() == state->lookupTargetDatatype("INT"));
+  ensure_equals("int precision", *column->precision(), -1);
+  ensure_equals("integer default", *column->defaultValue(), "42");
+  column = target->columns()[3];
+  ensure("tinyint type", column->simpleType() == state->lookupTargetDatatype("TINYINT"));
+  ensure_equals("tinyint length", *column->length(), 1);
+  ensure("rule flags", column->flags().get_index("UNSIGNED") != grt::BaseListRef::npos);
+  ensure_equals("rewritten default", *column->defaultValue(), "1");
+  ensure_equals("rule message", state->findMigrationLogEntry(source->columns()[3], column)->entries().count(), 2U);
+
+  // Everything the rules don't cover is left to the module.
+  ensure_equals("pending columns", pending.count(), 6U);
+  ensure("pending default", pending[0].get("targetColumn") == target->columns()[4]);
+  ensure_equals("pending default only", pending[0].count(), 3U);
+  ensure_equals("default hook", pending[0].get_int("defaultValue"), 1);
+  ensure_equals("long identifier", pending[1].get_int("identifier"), 1);
+  ensure_equals("quoted identifier", pending[2].get_int("identifier"), 1);
+  ensure_equals("unmapped type", pending[3].get_int("datatype"), 1);
+  ensure_equals("unmapped type default", pending[3].get_int("defaultValue"), 1);
+  ensure_equals("unknown target type", pending[4].get_int("datatype"), 1);
+  ensure_equals("no type", pending[5].get_int("datatype"), 1);
+  ensure("pending source", pending[5].get("sourceColumn") == source->columns()[9]);
+
+  // Collations are replaced if the rules name a target collation.
+  grt::DictRef rules = make_column_rules();
+  rules.gset("collation", "utf8_general_ci");
+  db_mysql_TableRef other = make_table(target_schema, "other");
+  state->migrateTableColumns(source, other, rules);
+  ensure_equals("replaced collation", *other->defaultCollationName(), "utf8_general_ci");
+  ensure_equals("replaced collation log",
+                *state->findMigrationLogEntry(short_text, other->columns()[0])->entries()[1]->name(),
+                "Collation latin1_bin migrated to utf8_general_ci");
+}
+
+TEST_FUNCTION(25) {
+  // Synthetic 100k column catalog migrated natively.
+  const int table_count = 2000;
+  const int column_count = 50;
+
+  db_migration_MigrationRef state(grt::Initialized);
+  db_mysql_CatalogRef catalog(grt::Initialized);
+  grt::replace_contents(catalog->simpleDatatypes(), tester->get_rdbms()->simpleDatatypes());
+  state->targetCatalog(catalog);
+
+  db_SimpleDatatypeRef types[] = {make_datatype("VARCHAR"), make_datatype("INTEGER"), make_datatype("BOOLEAN"),
+                                  make_datatype("MONEY")};
+
+  db_mysql_SchemaRef source_schema(grt::Initialized);
+  source_schema->name("src");
+  db_mysql_SchemaRef target_schema(grt::Initialized);
+  target_schema->name("tgt");
+  std::vector<db_mysql_TableRef> source_tables;
+  for (int t = 0; t < table_count; ++t) {
+    db_mysql_TableRef table = make_table(source_schema, "table_" + std::to_string(t));
+    for (int c = 0; c < column_count; ++c)
+      make_column(table, "column_" + std::to_string(c), types[c % 4], c * 10, c % 4 == 1 ? std::to_string(c) : "");
+    source_tables.push_back(table);
+  }
+  grt::DictRef rules = make_column_rules();
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  size_t pending = 0;
+  for (std::vector<db_mysql_TableRef>::const_iterator source = source_tables.begin(); source != source_tables.end();
+       ++source) {
+    db_mysql_TableRef target = make_table(target_schema, (*source)->name());
+    state->addMigrationLogEntry(0, *source, target, "");
+    pending += state->migrateTableColumns(*source, target, rules).count();
+  }
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+  std::cout << "Migration state: migrated " << table_count * column_count << " columns natively in " << (t2 - t1)
+            << ", " << pending << " left to the module" << std::endl;
+#endif
+
+  ensure_equals("log objects", state->migrationLog().count(), (size_t)(table_count * (column_count + 1)));
+  // MONEY columns have no rule.
+  ensure_equals("pending columns", pending, (size_t)(table_count * (column_count / 4)));
+  db_mysql_TableRef last = target_schema->tables()[table_count - 1];
+  ensure_equals("target columns", last->columns().count(), (size_t)column_count);
+  ensure("varchar type", last->columns()[0]->simpleType() == state->lookupTargetDatatype("VARCHAR"));
+  ensure("int type", last->columns()[1]->simpleType() == state->lookupTargetDatatype("INT"));
+  ensure("tinyint type", last->columns()[2]->simpleType() == state->lookupTargetDatatype("TINYINT"));
+  ensure("source lookup", state->lookupSourceObject(last->columns()[1]) == source_tables.back()->columns()[1]);
+}
+
+// Due to the tut nature, this must be executed as a last test always,
+// we can't have this inside of the d-tor.
+TEST_FUNCTION(99) {
+  delete tester;
+}
+
+END_TESTS
@@ -29,6 +29,7 @@
 #include "parsers-common.h"
 
 #include "grtdb/db_helpers.h"
+#include "base/threading.h"
 
 #include "grts/structs.db.mysql.h"
 
@@ -105,6 +106,13 @@ namespace parsers {
 
     virtual size_t checkSqlSyntax(MySQLParserContext::Ref context, const char *sql, size_t length,
                                   MySQLParseUnit unitType) = 0;
+
+    // Checks a list of statements (ranges relative to sql) one by one and collects their errors (with offsets
+    // relative to sql). Stops between two statements when the token is cancelled. Returns the number of checked
+    // statements.
+    virtual size_t checkSqlSyntax(MySQLParserContext::Ref context, const char *sql,
+                                  const std::vector<StatementRange> &ranges, MySQLParseUnit unitType,
+                                  const base::CancellationToken &token, std::vector<ParserErrorInfo> &errors) = 0;
     virtual size_t renameSchemaReferences(MySQLParserContext::Ref context, db_mysql_CatalogRef catalog,
                                           const std::string old_name, const std::string new_name) = 0;
 
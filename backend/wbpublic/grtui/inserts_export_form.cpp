@@ -78,6 +78,7 @@ std::string InsertsExportForm::run() {
       textStorage->parameter_value("GENERATOR_QUERY", _record_set->generator_query());
       textStorage->parameter_value("GENERATE_DATE", base::fmttime(time(NULL), DATETIME_FMT));
       textStorage->parameter_value("TABLE_NAME", storage->table_name().empty() ? "TABLE" : storage->table_name());
+      textStorage->parameter_value("ROWS_PER_STATEMENT", "1");
 
       if (!info.arguments.empty()) {
         mforms::SimpleForm form(_("Export Recordset"), _("Export"));
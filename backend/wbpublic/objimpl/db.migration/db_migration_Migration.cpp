@@ -22,13 +22,197 @@
  */
 
 #include <grts/structs.db.migration.h>
+#include <grts/structs.db.mysql.h>
 
 #include <grtpp_util.h>
+#include "base/string_utilities.h"
+#include "base/trackable.h"
 
-class db_migration_Migration::ImplData {
+#include <limits>
+#include <memory>
+#include <set>
+
+static std::string object_id(const GrtObjectRef &object) {
+  return object.is_valid() ? object->id() : "";
+}
+
+// Key under which findMatchingTargetObject() looks up a source object: its type, the type and name of its owner and
+// its lower case name.
+static std::string matching_key(const GrtObjectRef &object) {
+  std::string key = object.class_name();
+  key.append("\n");
+  if (object->owner().is_valid())
+    key.append(object->owner().class_name()).append("\n").append(*object->owner()->name());
+  key.append("\n").append(base::tolower(*object->name()));
+  return key;
+}
+
+// Checks default values against the literal kinds a datatype rule accepts unchanged.
+enum DefaultLiteralKind { IntegerLiteral = 1, NumberLiteral = 2, StringLiteral = 4 };
+
+static bool is_number_literal(const std::string &value, bool integer_only) {
+  std::string::const_iterator c = value.begin();
+  if (c != value.end() && (*c == '-' || *c == '+'))
+    ++c;
+  size_t digits = 0;
+  while (c != value.end() && isdigit(*c))
+    ++c, ++digits;
+  if (integer_only)
+    return digits > 0 && c == value.end();
+
+  if (c != value.end() && *c == '.') {
+    ++c;
+    while (c != value.end() && isdigit(*c))
+      ++c, ++digits;
+  }
+  if (digits == 0)
+    return false;
+  if (c != value.end() && (*c == 'e' || *c == 'E')) {
+    ++c;
+    if (c != value.end() && (*c == '-' || *c == '+'))
+      ++c;
+    if (c == value.end() || !isdigit(*c))
+      return false;
+    while (c != value.end() && isdigit(*c))
+      ++c;
+  }
+  return c == value.end();
+}
+
+// One entry of the datatype rules of a source type, see migrateTableColumns() for the meaning of the keys.
+struct ColumnDatatypeRule {
+  std::string target;
+  ssize_t minLength, maxLength;
+  ssize_t minPrecision, maxPrecision;
+  ssize_t minScale, maxScale;
+
+  ssize_t length, precision, scale; // -2 keeps the value of the source column
+  ssize_t autoIncrement;            // -1 keeps the value
+  std::string autoIncrementMember;
+  std::string characterSet;
+  std::vector<std::string> flags;
+  std::string message;
+  ssize_t messageType;
+
+  std::map<std::string, std::string> defaultValues;
+  int defaultLiterals;
+
+  ColumnDatatypeRule(const grt::DictRef &entry) {
+    const ssize_t lowest = std::numeric_limits<ssize_t>::min();
+    const ssize_t highest = std::numeric_limits<ssize_t>::max();
+
+    target = entry.get_string("target");
+    minLength = entry.get_int("minLength", lowest);
+    maxLength = entry.get_int("maxLength", highest);
+    minPrecision = entry.get_int("minPrecision", lowest);
+    maxPrecision = entry.get_int("maxPrecision", highest);
+    minScale = entry.get_int("minScale", lowest);
+    maxScale = entry.get_int("maxScale", highest);
+
+    length = entry.get_int("length", -2);
+    precision = entry.get_int("precision", -2);
+    scale = entry.get_int("scale", -2);
+    autoIncrement = entry.get_int("autoIncrement", -1);
+    autoIncrementMember = entry.get_string("autoIncrementMember");
+    characterSet = entry.get_string("characterSet");
+    message = entry.get_string("message");
+    messageType = entry.get_int("messageType", 0);
+
+    // Lists coming from Python dicts are untyped.
+    grt::BaseListRef list(grt::BaseListRef::cast_from(entry.get("flags")));
+    for (size_t i = 0; i < list.count(); ++i)
+      flags.push_back(grt::StringRef::cast_from(list[i]));
+
+    grt::DictRef values(grt::DictRef::cast_from(entry.get("defaultValues")));
+    if (values.is_valid()) {
+      for (grt::DictRef::const_iterator iter = values.begin(); iter != values.end(); ++iter)
+        defaultValues[base::toupper(iter->first)] = grt::StringRef::cast_from(iter->second);
+    }
+
+    defaultLiterals = 0;
+    list = grt::BaseListRef::cast_from(entry.get("defaultLiterals"));
+    for (size_t i = 0; i < list.count(); ++i) {
+      std::string kind = grt::StringRef::cast_from(list[i]);
+      if (kind == "integer")
+        defaultLiterals |= IntegerLiteral;
+      else if (kind == "number")
+        defaultLiterals |= NumberLiteral;
+      else if (kind == "string")
+        defaultLiterals |= StringLiteral;
+    }
+  }
+
+  bool matches(const db_ColumnRef &column) const {
+    return *column->length() >= minLength && *column->length() <= maxLength && *column->precision() >= minPrecision &&
+           *column->precision() <= maxPrecision && *column->scale() >= minScale && *column->scale() <= maxScale;
+  }
+
+  // Returns false if the value must be passed to the migrateColumnDefaultValue() method of the module.
+  bool migrateDefaultValue(const std::string &value, std::string &result) const {
+    std::map<std::string, std::string>::const_iterator rewrite = defaultValues.find(base::toupper(value));
+    if (rewrite != defaultValues.end())
+      result = rewrite->second;
+    else if (((defaultLiterals & IntegerLiteral) && is_number_literal(value, true)) ||
+             ((defaultLiterals & NumberLiteral) && is_number_literal(value, false)) ||
+             ((defaultLiterals & StringLiteral) && value[0] == '\''))
+      result = value;
+    else
+      return false;
+    return true;
+  }
+};
+
+struct ColumnMigrationRules {
+  size_t maxIdentifierLength;
+  std::string quotedIdentifierChars;
+  std::string collation;
+  std::map<std::string, std::vector<ColumnDatatypeRule> > datatypes;
+
+  ColumnMigrationRules(const grt::DictRef &rules) {
+    maxIdentifierLength = (size_t)rules.get_int("maxIdentifierLength", 64);
+    quotedIdentifierChars = rules.get_string("quotedIdentifierChars");
+    collation = rules.get_string("collation");
+
+    grt::DictRef types(grt::DictRef::cast_from(rules.get("datatypes")));
+    if (types.is_valid()) {
+      for (grt::DictRef::const_iterator iter = types.begin(); iter != types.end(); ++iter) {
+        std::vector<ColumnDatatypeRule> &entries = datatypes[base::toupper(iter->first)];
+        grt::BaseListRef list(grt::BaseListRef::cast_from(iter->second));
+        for (size_t i = 0; i < list.count(); ++i)
+          entries.push_back(ColumnDatatypeRule(grt::DictRef::cast_from(list[i])));
+      }
+    }
+  }
+
+  // Returns NULL for columns without a simple datatype or whose type has no matching rule.
+  const ColumnDatatypeRule *datatypeRule(const db_ColumnRef &column) const {
+    if (!column->simpleType().is_valid())
+      return NULL;
+    std::map<std::string, std::vector<ColumnDatatypeRule> >::const_iterator entries =
+      datatypes.find(base::toupper(column->simpleType()->name()));
+    if (entries == datatypes.end())
+      return NULL;
+    for (std::vector<ColumnDatatypeRule>::const_iterator rule = entries->second.begin(); rule != entries->second.end();
+         ++rule) {
+      if (rule->matches(column))
+        return &*rule;
+    }
+    return NULL;
+  }
+};
+
+class db_migration_Migration::ImplData : public base::trackable {
 public:
-  ImplData(){};
-  virtual ~ImplData(){};
+  ImplData(db_migration_Migration *owner)
+    : _owner(owner), _log_changes(0), _indexed_log_changes(0), _mappings_changed(true), _datatypes_changed(true) {
+    scoped_connect(owner->signal_list_changed(), std::bind(&ImplData::listChanged, this, std::placeholders::_1));
+  }
+
+  virtual ~ImplData() {
+    disconnectItems(_mapping_connections);
+    disconnectItems(_datatype_connections);
+  }
+
   void addSourceObject(const std::string &id, const grt::Ref<GrtObject> &object) {
     source_objects[id] = object;
   }
@@ -45,9 +229,140 @@ public:
     return target_objects[id];
   }
 
+  // The indexes below are built on first use and rebuilt whenever the list they were built from changes, so changes
+  // made to these lists from Python are picked up as well. The migration log is owned by the migration object, whose
+  // list signal counts its changes. Log objects are expected to be complete when they are added. The datatype lists
+  // are short, so they are compared item by item and the indexed items are watched for changes of their members.
+
+  void syncLogIndex(const grt::ListRef<GrtLogObject> &log) {
+    if (log.valueptr() == _indexed_log.valueptr() && _log_changes == _indexed_log_changes)
+      return;
+
+    _log_entries.clear();
+    _matching_targets.clear();
+    _indexed_log = log;
+    for (grt::ListRef<GrtLogObject>::const_iterator iter = log.begin(); iter != log.end(); ++iter)
+      addLogEntry(*iter);
+  }
+
+  // Must be called with a synced index for entries appended to the indexed log.
+  void addLogEntry(const GrtLogObjectRef &entry) {
+    _indexed_log_changes = _log_changes;
+    GrtObjectRef source(entry->logObject());
+    GrtObjectRef target(entry->refObject());
+    // The first entry for an object wins, as in a linear search of the log.
+    _log_entries.insert(std::make_pair(std::make_pair(object_id(source), object_id(target)), entry));
+    if (source.is_valid())
+      _matching_targets.insert(std::make_pair(matching_key(source), target));
+  }
+
+  GrtLogObjectRef findLogEntry(const GrtObjectRef &source, const GrtObjectRef &target) const {
+    std::map<std::pair<std::string, std::string>, GrtLogObjectRef>::const_iterator entry =
+      _log_entries.find(std::make_pair(object_id(source), object_id(target)));
+    return entry != _log_entries.end() ? entry->second : GrtLogObjectRef();
+  }
+
+  GrtObjectRef findMatchingTarget(const GrtObjectRef &source) const {
+    std::map<std::string, GrtObjectRef>::const_iterator target = _matching_targets.find(matching_key(source));
+    return target != _matching_targets.end() ? target->second : GrtObjectRef();
+  }
+
+  const std::vector<db_migration_DatatypeMappingRef> *datatypeMappings(
+    const grt::ListRef<db_migration_DatatypeMapping> &mappings, const std::string &name) {
+    if (_mappings_changed || !sameItems(mappings, _indexed_mappings)) {
+      _datatype_mappings.clear();
+      watchItems(mappings, _indexed_mappings, _mapping_connections, _mappings_changed);
+      for (grt::ListRef<db_migration_DatatypeMapping>::const_iterator iter = mappings.begin(); iter != mappings.end();
+           ++iter)
+        _datatype_mappings[base::toupper((*iter)->sourceDatatypeName())].push_back(*iter);
+    }
+
+    std::map<std::string, std::vector<db_migration_DatatypeMappingRef> >::const_iterator entry =
+      _datatype_mappings.find(base::toupper(name));
+    return entry != _datatype_mappings.end() ? &entry->second : NULL;
+  }
+
+  db_SimpleDatatypeRef targetDatatype(const grt::ListRef<db_SimpleDatatype> &datatypes, const std::string &name) {
+    if (_datatypes_changed || !sameItems(datatypes, _indexed_datatypes)) {
+      _target_datatypes.clear();
+      watchItems(datatypes, _indexed_datatypes, _datatype_connections, _datatypes_changed);
+      // Later types replace earlier ones with the same name.
+      for (grt::ListRef<db_SimpleDatatype>::const_iterator iter = datatypes.begin(); iter != datatypes.end(); ++iter)
+        _target_datatypes[base::toupper((*iter)->name())] = *iter;
+    }
+
+    std::map<std::string, db_SimpleDatatypeRef>::const_iterator entry = _target_datatypes.find(base::toupper(name));
+    return entry != _target_datatypes.end() ? entry->second : db_SimpleDatatypeRef();
+  }
+
+  // Modules pass the same rules dict for every table, so it is parsed only once.
+  const ColumnMigrationRules &columnMigrationRules(const grt::DictRef &rules) {
+    if (!_column_rules || rules.valueptr() != _parsed_rules.valueptr()) {
+      _column_rules.reset(new ColumnMigrationRules(rules));
+      _parsed_rules = rules;
+    }
+    return *_column_rules;
+  }
+
 private:
+  void listChanged(grt::internal::OwnedList *list) {
+    if (list == _owner->migrationLog().valueptr())
+      ++_log_changes;
+  }
+
+  static bool sameItems(const grt::BaseListRef &list, const std::vector<grt::internal::Value *> &items) {
+    if (list.count() != items.size())
+      return false;
+    for (size_t i = 0; i < items.size(); ++i)
+      if (list[i].valueptr() != items[i])
+        return false;
+    return true;
+  }
+
+  // Remembers the items of the list and flags any change of their members (e.g. a mapping edited in the datatype
+  // mapping editor).
+  template <class T>
+  static void watchItems(const grt::ListRef<T> &list, std::vector<grt::internal::Value *> &items,
+                         std::vector<boost::signals2::connection> &connections, bool &changed) {
+    disconnectItems(connections);
+    items.clear();
+    for (typename grt::ListRef<T>::const_iterator iter = list.begin(); iter != list.end(); ++iter) {
+      items.push_back((*iter).valueptr());
+      connections.push_back((*iter)->signal_changed()->connect(
+        [&changed](const std::string &, const grt::ValueRef &) { changed = true; }));
+    }
+    changed = false;
+  }
+
+  static void disconnectItems(std::vector<boost::signals2::connection> &connections) {
+    for (std::vector<boost::signals2::connection>::iterator connection = connections.begin();
+         connection != connections.end(); ++connection)
+      connection->disconnect();
+    connections.clear();
+  }
+
+  db_migration_Migration *_owner;
   std::map<std::string, grt::Ref<GrtObject> > target_objects;
   std::map<std::string, grt::Ref<GrtObject> > source_objects;
+
+  grt::ListRef<GrtLogObject> _indexed_log;
+  size_t _log_changes;
+  size_t _indexed_log_changes;
+  std::map<std::pair<std::string, std::string>, GrtLogObjectRef> _log_entries;
+  std::map<std::string, GrtObjectRef> _matching_targets;
+
+  std::vector<grt::internal::Value *> _indexed_mappings;
+  std::vector<boost::signals2::connection> _mapping_connections;
+  bool _mappings_changed;
+  std::map<std::string, std::vector<db_migration_DatatypeMappingRef> > _datatype_mappings;
+
+  std::vector<grt::internal::Value *> _indexed_datatypes;
+  std::vector<boost::signals2::connection> _datatype_connections;
+  bool _datatypes_changed;
+  std::map<std::string, db_SimpleDatatypeRef> _target_datatypes;
+
+  grt::DictRef _parsed_rules;
+  std::unique_ptr<ColumnMigrationRules> _column_rules;
 };
 
 //================================================================================
@@ -55,7 +370,7 @@ private:
 
 void db_migration_Migration::init() {
   if (!_data)
-    _data = new db_migration_Migration::ImplData();
+    _data = new db_migration_Migration::ImplData(this);
 }
 
 db_migration_Migration::~db_migration_Migration() {
@@ -74,6 +389,7 @@ grt::Ref<GrtLogObject> db_migration_Migration::addMigrationLogEntry(ssize_t type
     log->refObject(targetObject);
 
     migrationLog().insert(log);
+    _data->addLogEntry(log);
   }
 
   GrtLogEntryRef entry(grt::Initialized);
@@ -92,12 +408,169 @@ grt::Ref<GrtLogObject> db_migration_Migration::addMigrationLogEntry(ssize_t type
 
 grt::Ref<GrtLogObject> db_migration_Migration::findMigrationLogEntry(const grt::Ref<GrtObject> &sourceObject,
                                                                      const grt::Ref<GrtObject> &targetObject) {
-  for (size_t c = migrationLog().count(), i = 0; i < c; i++) {
-    GrtLogObjectRef log(migrationLog()[i]);
-    if (log->logObject() == sourceObject && log->refObject() == targetObject)
-      return log;
+  _data->syncLogIndex(migrationLog());
+  return _data->findLogEntry(sourceObject, targetObject);
+}
+
+grt::Ref<GrtObject> db_migration_Migration::findMatchingTargetObject(const grt::Ref<GrtObject> &sourceObject) {
+  if (!sourceObject.is_valid())
+    return GrtObjectRef();
+  _data->syncLogIndex(migrationLog());
+  return _data->findMatchingTarget(sourceObject);
+}
+
+db_migration_DatatypeMappingRef db_migration_Migration::lookupDatatypeMapping(const db_ColumnRef &column,
+                                                                              const std::string &datatypeName) {
+  if (!genericDatatypeMappings().is_valid())
+    return db_migration_DatatypeMappingRef();
+
+  const std::vector<db_migration_DatatypeMappingRef> *mappings =
+    _data->datatypeMappings(genericDatatypeMappings(), datatypeName);
+  if (mappings == NULL)
+    return db_migration_DatatypeMappingRef();
+
+  ssize_t length = column.is_valid() ? *column->length() : 0;
+  for (std::vector<db_migration_DatatypeMappingRef>::const_iterator mapping = mappings->begin();
+       mapping != mappings->end(); ++mapping) {
+    if (*(*mapping)->lengthConditionFrom() > 0 && length > 0 && *(*mapping)->lengthConditionFrom() > length)
+      continue;
+    if (*(*mapping)->lengthConditionTo() > 0 && length > 0 && *(*mapping)->lengthConditionTo() < length)
+      continue;
+    return *mapping;
+  }
+  return db_migration_DatatypeMappingRef();
+}
+
+db_SimpleDatatypeRef db_migration_Migration::lookupTargetDatatype(const std::string &datatypeName) {
+  if (!targetCatalog().is_valid())
+    return db_SimpleDatatypeRef();
+  return _data->targetDatatype(targetCatalog()->simpleDatatypes(), datatypeName);
+}
+
+/**
+ * Native counterpart of the column loop of GenericMigration.migrateTableToMySQL() in the migration modules. The rules
+ * are a dict describing what the module's Python methods do for the common cases:
+ *   maxIdentifierLength, quotedIdentifierChars: names that are longer or start with one of these chars are left to
+ *     migrateIdentifier()
+ *   collation: if set, source collations are replaced by it (and the character set cleared), otherwise both are kept
+ *   datatypes: for each upper case source type name a list of entries, the first one whose minLength/maxLength,
+ *     minPrecision/maxPrecision and minScale/maxScale conditions (inclusive) match the column is used. An entry sets
+ *     the target type, optionally length, precision, scale, autoIncrement (or copies it from autoIncrementMember of
+ *     the source column), characterSet, flags and logs message with messageType. Default values are rewritten
+ *     through defaultValues (case insensitive) or kept if they are one of the defaultLiterals (integer, number or
+ *     string, the latter meaning a quoted value).
+ * Anything the rules don't cover is returned as a dict with the source and target columns and the name of the module
+ * method to call (identifier, datatype, defaultValue) set to 1.
+ */
+grt::DictListRef db_migration_Migration::migrateTableColumns(const db_TableRef &sourceTable,
+                                                              const db_TableRef &targetTable, const grt::DictRef &rules) {
+  grt::DictListRef pending(grt::Initialized);
+  if (!sourceTable.is_valid() || !targetTable.is_valid() || !rules.is_valid())
+    return pending;
+
+  const ColumnMigrationRules &columnRules = _data->columnMigrationRules(rules);
+  std::set<std::string> collations;
+
+  for (grt::ListRef<db_Column>::const_iterator iter = sourceTable->columns().begin();
+       iter != sourceTable->columns().end(); ++iter) {
+    db_ColumnRef source(*iter);
+    db_mysql_ColumnRef target(grt::Initialized);
+    target->owner(targetTable);
+    addMigrationLogEntry(0, source, target, "");
+
+    std::string name = source->name();
+    bool identifierPending = name.size() > columnRules.maxIdentifierLength ||
+                             (!name.empty() && columnRules.quotedIdentifierChars.find(name[0]) != std::string::npos);
+    target->name(name);
+    target->oldName(name);
+
+    for (size_t i = 0; i < source->flags().count(); ++i) {
+      if (target->flags().get_index(source->flags()[i]) == grt::BaseListRef::npos)
+        target->flags().insert(source->flags()[i]);
+    }
+    target->defaultValueIsNull(source->defaultValueIsNull());
+    target->isNotNull(source->isNotNull());
+    target->length(source->length());
+    target->scale(source->scale());
+    target->precision(source->precision());
+    target->datatypeExplicitParams(source->datatypeExplicitParams());
+    if (!columnRules.collation.empty() && !source->collationName().empty()) {
+      target->characterSetName("");
+      target->collationName(columnRules.collation);
+      addMigrationLogEntry(0, source, target,
+                           "Collation " + *source->collationName() + " migrated to " + columnRules.collation);
+    } else {
+      target->characterSetName(source->characterSetName());
+      target->collationName(source->collationName());
+    }
+    target->comment(source->comment());
+
+    const ColumnDatatypeRule *rule = columnRules.datatypeRule(source);
+    db_SimpleDatatypeRef datatype;
+    if (rule != NULL)
+      datatype = lookupTargetDatatype(rule->target);
+    if (datatype.is_valid()) {
+      target->simpleType(datatype);
+      if (rule->length > -2)
+        target->length(rule->length);
+      if (rule->precision > -2)
+        target->precision(rule->precision);
+      if (rule->scale > -2)
+        target->scale(rule->scale);
+      if (rule->autoIncrement > -1)
+        target->autoIncrement(rule->autoIncrement);
+      if (!rule->autoIncrementMember.empty() && source.has_member(rule->autoIncrementMember)) {
+        grt::ValueRef value(source.get_member(rule->autoIncrementMember));
+        if (value.is_valid() && value.type() == grt::IntegerType)
+          target->autoIncrement(grt::IntegerRef::cast_from(value));
+      }
+      if (!rule->characterSet.empty())
+        target->characterSetName(rule->characterSet);
+      for (std::vector<std::string>::const_iterator flag = rule->flags.begin(); flag != rule->flags.end(); ++flag) {
+        if (target->flags().get_index(*flag) == grt::BaseListRef::npos)
+          target->flags().insert(*flag);
+      }
+      if (!rule->message.empty())
+        addMigrationLogEntry(rule->messageType, source, target, rule->message);
+    }
+
+    std::string defaultValue = source->defaultValue();
+    std::string targetDefaultValue;
+    bool defaultValuePending = false;
+    if (!defaultValue.empty() && !(datatype.is_valid() && rule->migrateDefaultValue(defaultValue, targetDefaultValue)))
+      defaultValuePending = true;
+    target->defaultValue(targetDefaultValue);
+
+    targetTable->columns().insert(target);
+    if (!target->collationName().empty())
+      collations.insert(target->collationName());
+
+    if (identifierPending || !datatype.is_valid() || defaultValuePending) {
+      grt::DictRef entry(true);
+      entry.set("sourceColumn", source);
+      entry.set("targetColumn", target);
+      if (identifierPending)
+        entry.set("identifier", grt::IntegerRef(1));
+      if (!datatype.is_valid())
+        entry.set("datatype", grt::IntegerRef(1));
+      if (defaultValuePending)
+        entry.set("defaultValue", grt::IntegerRef(1));
+      pending.insert(entry);
+    }
   }
-  return GrtLogObjectRef();
+
+  // If all columns use the same collation, make them inherit it from the table.
+  if (collations.size() == 1 && db_mysql_TableRef::can_wrap(targetTable)) {
+    db_mysql_TableRef table(db_mysql_TableRef::cast_from(targetTable));
+    if (table->defaultCollationName().empty()) {
+      for (grt::ListRef<db_mysql_Column>::const_iterator column = table->columns().begin();
+           column != table->columns().end(); ++column)
+        (*column)->collationName("");
+      table->defaultCollationName(*collations.begin());
+    }
+  }
+
+  return pending;
 }
 
 grt::Ref<GrtObject> db_migration_Migration::lookupMigratedObject(const grt::Ref<GrtObject> &sourceObject) {
@@ -0,0 +1,342 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "base/log.h"
+
+#include "analysis_executor.h"
+
+#include <algorithm>
+
+DEFAULT_LOG_DOMAIN("Analysis")
+
+//----------------------------------------------------------------------------------------------------------------------
+
+static AnalysisExecutor *executor = nullptr;
+static bool executorStopped = false;
+static std::mutex executorLock;
+
+/**
+ * Returns the shared executor used by all SQL editors, which is created on first use. It uses between 2 and 4
+ * threads, depending on the number of available cores. Returns nullptr once the executor was stopped, so that
+ * late requests can't start a new pool which is never shut down.
+ */
+AnalysisExecutor *AnalysisExecutor::get() {
+  std::lock_guard<std::mutex> guard(executorLock);
+  if (executor == nullptr && !executorStopped) {
+    unsigned cores = std::thread::hardware_concurrency();
+    executor = new AnalysisExecutor(std::max(2U, std::min(4U, cores)));
+  }
+  return executor;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the shared executor if it exists, without creating it. For cancellation, which has nothing to do if no
+ * task was ever submitted or the executor has been stopped already (e.g. for editors destroyed after shutdown).
+ * Like stop() this must be called on the main thread.
+ */
+AnalysisExecutor *AnalysisExecutor::instance() {
+  std::lock_guard<std::mutex> guard(executorLock);
+  return executor;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Called when the application goes down, to stop all threads gracefully. Running tasks are cancelled.
+ */
+void AnalysisExecutor::stop() {
+  std::lock_guard<std::mutex> guard(executorLock);
+  delete executor;
+  executor = nullptr;
+  executorStopped = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AnalysisExecutor::AnalysisExecutor(std::size_t threadCount) : _terminate(false), _nextSequence(0) {
+  resetStatistics();
+
+  for (std::size_t i = 0; i < std::max<std::size_t>(threadCount, 1); ++i)
+    _threads.push_back(std::thread(&AnalysisExecutor::workerLoop, this));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AnalysisExecutor::~AnalysisExecutor() {
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    _terminate = true;
+    _queue.clear();
+    for (auto &job : _running)
+      job.token.cancel();
+  }
+  _wakeup.notify_all();
+
+  for (auto &thread : _threads)
+    thread.join();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Queues a task for the given owner. A task of the same kind which is still waiting is dropped, a running one
+ * is cancelled.
+ *
+ * @param owner Identifies the requester (e.g. an editor instance), mostly to cancel all its work at once.
+ * @param kind An owner specific value to distinguish different kinds of work.
+ * @param task The work to do. Must check the token regularly and return as soon as it is cancelled.
+ * @param priority Determines which of the due tasks is started first.
+ * @param delay The time (in seconds) to wait before the task can be started.
+ * @return The token with which the task can be cancelled by the caller.
+ */
+base::CancellationToken AnalysisExecutor::submit(const void *owner, int kind, const Task &task, Priority priority,
+                                                 double delay) {
+  Job job;
+  job.owner = owner;
+  job.kind = kind;
+  job.priority = priority;
+  job.submitted = Clock::now();
+  job.due = job.submitted + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay));
+  job.task = task;
+
+  {
+    std::lock_guard<std::mutex> guard(_lock);
+    job.sequence = _nextSequence++;
+    ++_statistics.submitted;
+
+    for (auto iterator = _queue.begin(); iterator != _queue.end();) {
+      if (iterator->owner == owner && iterator->kind == kind) {
+        iterator->token.cancel();
+        iterator = _queue.erase(iterator);
+        ++_statistics.replaced;
+      } else
+        ++iterator;
+    }
+
+    for (auto &running : _running) {
+      if (running.owner == owner && running.kind == kind)
+        running.token.cancel();
+    }
+
+    _queue.push_back(job);
+  }
+  _wakeup.notify_all();
+
+  return job.token;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Cancels the waiting and running tasks of the given kind for that owner and waits until the running one returned,
+ * so that the caller can change the data it works on. When called from within a task no waiting takes place.
+ */
+void AnalysisExecutor::cancel(const void *owner, int kind) {
+  std::unique_lock<std::mutex> lock(_lock);
+  for (auto iterator = _queue.begin(); iterator != _queue.end();) {
+    if (iterator->owner == owner && iterator->kind == kind) {
+      iterator->token.cancel();
+      iterator = _queue.erase(iterator);
+      ++_statistics.cancelled;
+    } else
+      ++iterator;
+  }
+
+  for (auto &running : _running) {
+    if (running.owner == owner && running.kind == kind)
+      running.token.cancel();
+  }
+
+  if (!isWorkerThread())
+    _finished.wait(lock, [this, owner, kind]() { return !isRunning(owner, kind); });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Cancels all tasks of the given owner and waits until none of them is running anymore. Must be called before
+ * the owner goes away. When called from within a task no waiting takes place (it would never end).
+ */
+void AnalysisExecutor::cancel(const void *owner) {
+  std::unique_lock<std::mutex> lock(_lock);
+  for (auto iterator = _queue.begin(); iterator != _queue.end();) {
+    if (iterator->owner == owner) {
+      iterator->token.cancel();
+      iterator = _queue.erase(iterator);
+      ++_statistics.cancelled;
+    } else
+      ++iterator;
+  }
+
+  for (auto &running : _running) {
+    if (running.owner == owner)
+      running.token.cancel();
+  }
+
+  if (!isWorkerThread())
+    _finished.wait(lock, [this, owner]() { return !isRunning(owner); });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Blocks until the queue is empty and no task is running anymore. Mostly useful for tests.
+ */
+void AnalysisExecutor::waitForIdle() {
+  std::unique_lock<std::mutex> lock(_lock);
+  _finished.wait(lock, [this]() { return _queue.empty() && _running.empty(); });
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::size_t AnalysisExecutor::threadCount() const {
+  return _threads.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::size_t AnalysisExecutor::pendingCount() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _queue.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+AnalysisExecutor::Statistics AnalysisExecutor::statistics() {
+  std::lock_guard<std::mutex> guard(_lock);
+  return _statistics;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void AnalysisExecutor::resetStatistics() {
+  std::lock_guard<std::mutex> guard(_lock);
+  _statistics.submitted = 0;
+  _statistics.completed = 0;
+  _statistics.cancelled = 0;
+  _statistics.replaced = 0;
+  _statistics.lastLatency = 0;
+  _statistics.averageLatency = 0;
+  _statistics.maxLatency = 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * The thread function of all workers. Picks the due task with the highest priority (which is not blocked by
+ * a running task of the same owner and kind), or waits until the next task gets due.
+ */
+void AnalysisExecutor::workerLoop() {
+  std::unique_lock<std::mutex> lock(_lock);
+  while (!_terminate) {
+    Clock::time_point now = Clock::now();
+    Clock::time_point nextDue = Clock::time_point::max();
+    std::list<Job>::iterator next = _queue.end();
+    for (auto iterator = _queue.begin(); iterator != _queue.end(); ++iterator) {
+      if (isRunning(iterator->owner, iterator->kind))
+        continue;
+
+      if (iterator->due > now) {
+        nextDue = std::min(nextDue, iterator->due);
+        continue;
+      }
+
+      if (next == _queue.end() || iterator->priority > next->priority ||
+          (iterator->priority == next->priority && iterator->sequence < next->sequence))
+        next = iterator;
+    }
+
+    if (next == _queue.end()) {
+      if (nextDue == Clock::time_point::max())
+        _wakeup.wait(lock);
+      else
+        _wakeup.wait_until(lock, nextDue);
+      continue;
+    }
+
+    Job job = *next;
+    _queue.erase(next);
+    RunningJob running = { job.owner, job.kind, job.token };
+    auto runningEntry = _running.insert(_running.end(), running);
+    lock.unlock();
+
+    try {
+      job.task(job.token);
+    } catch (std::exception &e) {
+      logError("Analysis task failed: %s\n", e.what());
+    } catch (...) {
+      logError("Analysis task failed with an unknown exception\n");
+    }
+
+    double latency = std::chrono::duration<double>(Clock::now() - job.submitted).count();
+    lock.lock();
+    _running.erase(runningEntry);
+    if (job.token.isCancelled())
+      ++_statistics.cancelled;
+    else {
+      ++_statistics.completed;
+      _statistics.lastLatency = latency;
+      _statistics.averageLatency += (latency - _statistics.averageLatency) / _statistics.completed;
+      _statistics.maxLatency = std::max(_statistics.maxLatency, latency);
+    }
+
+    // Other workers might wait for this task to return, to run the next one of the same owner and kind.
+    _finished.notify_all();
+    _wakeup.notify_all();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool AnalysisExecutor::isRunning(const void *owner, int kind) const {
+  for (auto &running : _running) {
+    if (running.owner == owner && running.kind == kind)
+      return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool AnalysisExecutor::isRunning(const void *owner) const {
+  for (auto &running : _running) {
+    if (running.owner == owner)
+      return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool AnalysisExecutor::isWorkerThread() const {
+  std::thread::id current = std::this_thread::get_id();
+  for (auto &thread : _threads) {
+    if (thread.get_id() == current)
+      return true;
+  }
+  return false;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
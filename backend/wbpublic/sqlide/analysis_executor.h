@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include "wbpublic_public_interface.h"
+
+#include "base/threading.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed pool of worker threads for the background analysis of SQL editors (statement splitting, syntax checks
+ * and the like), so that such work neither blocks the UI nor competes with unrelated GRT tasks.
+ *
+ * Tasks are submitted for an owner (usually an editor) and a kind of work. Only the newest task of a kind is kept
+ * per owner: submitting a task replaces one of the same kind still waiting in the queue and cancels one which is
+ * already running. Tasks of the same owner and kind never run in parallel, so a replacement only starts after the
+ * task it cancelled returned. Cancellation is cooperative: tasks get a token they have to check regularly.
+ *
+ * Waiting tasks are started by priority, then in submission order. A delay can be given to coalesce quick
+ * successions of requests (like key strokes) into a single run.
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC AnalysisExecutor {
+public:
+  enum Priority { PriorityLow, PriorityNormal, PriorityHigh };
+
+  typedef std::function<void(const base::CancellationToken &)> Task;
+
+  // Latencies are measured from submission of a task until it returned (not counting cancelled tasks), in seconds.
+  struct Statistics {
+    std::size_t submitted;
+    std::size_t completed;
+    std::size_t cancelled; // Cancelled while running or removed before they could run.
+    std::size_t replaced;  // Replaced by a newer task while waiting.
+    double lastLatency;
+    double averageLatency;
+    double maxLatency;
+  };
+
+  static AnalysisExecutor *get();
+  static AnalysisExecutor *instance();
+  static void stop();
+
+  AnalysisExecutor(std::size_t threadCount);
+  ~AnalysisExecutor();
+
+  base::CancellationToken submit(const void *owner, int kind, const Task &task, Priority priority = PriorityNormal,
+                                 double delay = 0);
+  void cancel(const void *owner, int kind);
+  void cancel(const void *owner);
+  void waitForIdle();
+
+  std::size_t threadCount() const;
+  std::size_t pendingCount();
+  Statistics statistics();
+  void resetStatistics();
+
+private:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Job {
+    const void *owner;
+    int kind;
+    Priority priority;
+    std::size_t sequence;
+    Clock::time_point submitted;
+    Clock::time_point due;
+    Task task;
+    base::CancellationToken token;
+  };
+
+  struct RunningJob {
+    const void *owner;
+    int kind;
+    base::CancellationToken token;
+  };
+
+  std::mutex _lock;
+  std::condition_variable _wakeup;   // Signaled when the queue changed or on shutdown.
+  std::condition_variable _finished; // Signaled when a task returned.
+  bool _terminate;
+  std::size_t _nextSequence;
+  std::list<Job> _queue;
+  std::list<RunningJob> _running;
+  std::vector<std::thread> _threads;
+  Statistics _statistics;
+
+  void workerLoop();
+  bool isRunning(const void *owner, int kind) const;
+  bool isRunning(const void *owner) const;
+  bool isWorkerThread() const;
+};
@@ -87,6 +87,7 @@ Recordset::Recordset()
   _context_menu = 0;
   _id = g_atomic_int_get(&next_id);
   g_atomic_int_inc(&next_id);
+  _field_repr_cache_enabled = true;
 
   task->desc("Recordset task");
   task->send_task_res_msg(false);
@@ -102,6 +103,7 @@ Recordset::Recordset(GrtThreadedTask::Ref parent_task)
   _context_menu = 0;
   _id = g_atomic_int_get(&next_id);
   g_atomic_int_inc(&next_id);
+  _field_repr_cache_enabled = true;
 
   task->send_task_res_msg(false);
   apply_changes_cb = [this]() { apply_changes_(); };
@@ -479,6 +481,7 @@ bool Recordset::delete_nodes(std::vector<bec::NodeId> &nodes) {
         {
           Cell row_begin = _data.begin() + (row - _data_frame_begin) * _column_count;
           _data.erase(row_begin, row_begin + _column_count);
+          invalidate_field_repr_cache();
         }
 
         ++processed_node_count;
@@ -29,10 +29,14 @@
 #include "grtsqlparser/sql_facade.h"
 #include "base/string_utilities.h"
 #include "base/sqlstring.h"
+#include "base/log.h"
 #include <sqlite/query.hpp>
 #include <algorithm>
+#include <chrono>
 #include <ctype.h>
 
+DEFAULT_LOG_DOMAIN("Recordset")
+
 using namespace bec;
 using namespace grt;
 using namespace base;
@@ -429,30 +433,79 @@ void Recordset_cdbc_storage::do_unserialize(Recordset *recordset, sqlite::connec
       null_value_columns[col] = are_null_columns_possible && sqlide::is_var_blob(real_column_types[col]);
   }
 
+  // fetch plan, decided once per column instead of dispatching on the column type variant for every cell
+  enum FetchMethod { FetchNull, FetchInteger, FetchString, FetchVariant };
+  std::vector<FetchMethod> fetch_methods(editable_col_count);
+  std::vector<bool> native_columns(column_names.size());
+  for (ColumnId col = 0; editable_col_count > col; ++col) {
+    const std::string &db_type = dbColumnTypes[col];
+    std::string base_type = db_type.substr(0, db_type.find(' '));
+    bool is_integer = (base_type == "TINYINT" || base_type == "SMALLINT" || base_type == "MEDIUMINT" ||
+                       base_type == "INT" || base_type == "BIGINT");
+    if (null_value_columns[col])
+      fetch_methods[col] = FetchNull;
+    else if (sqlide::is_var_blob(column_types[col]) || sqlide::is_var_unknown(column_types[col]) ||
+             sqlide::is_var_null(column_types[col]))
+      fetch_methods[col] = FetchVariant;
+    else if (is_integer && db_type != "BIGINT UNSIGNED" && !rs_meta->isZerofill((unsigned int)col + 1))
+      fetch_methods[col] = FetchInteger; // all of TINYINT..BIGINT fit into int64, except unsigned BIGINT
+    else if (column_types[col].type() == typeid(std::string))
+      fetch_methods[col] = FetchString;
+    else
+      fetch_methods[col] = FetchVariant;
+    native_columns[col] = (fetch_methods[col] == FetchInteger);
+  }
+  for (ColumnId n = 0; rowid_col_count > n; ++n)
+    native_columns[editable_col_count + n] = native_columns[_pkey_columns[n]];
+
   // data
   {
     sqlide::Sqlite_transaction_guarder transaction_guarder(data_swap_db, false);
 
-    create_data_swap_tables(data_swap_db, column_names, column_types);
+    create_data_swap_tables(data_swap_db, column_names, column_types, native_columns);
 
     FetchVar fetch_var(rs.get());
-    Var_vector row_values(editable_col_count + rowid_col_count);
+    sqlide::BindSqlCommandVar bind_sql_command_var;
 
     std::list<std::shared_ptr<sqlite::command> > insert_commands =
       prepare_data_swap_record_add_statement(data_swap_db, column_names);
+    std::vector<sqlite::command *> partition_commands;
+    for (auto &insert_command : insert_commands)
+      partition_commands.push_back(insert_command.get());
+
+    // Values are bound straight into the partition insert statements, so that no intermediate variant or string copy
+    // of the row is built. Duplicated pk columns are read from the result set again.
+    ColumnId total_col_count = editable_col_count + rowid_col_count;
     // XXX this will fetch all records before displaying them, which will result in a huge unnecessary lag in the UI
     while (rs->next()) {
-      for (ColumnId n = 0; editable_col_count > n; ++n) {
-        if (rs->isNull((int)n + 1) || null_value_columns[n]) {
-          row_values[n] = sqlite::null_t();
-        } else {
-          sqlite::variant_t index = (int)n + 1;
-          row_values[n] = boost::apply_visitor(fetch_var, column_types[n], index);
+      for (sqlite::command *insert_command : partition_commands)
+        insert_command->clear();
+      for (ColumnId col = 0; total_col_count > col; ++col) {
+        ColumnId n = (col < editable_col_count) ? col : _pkey_columns[col - editable_col_count];
+        sqlite::command &insert_command = *partition_commands[Recordset::data_swap_db_column_partition(col)];
+        int index = (int)n + 1;
+        if (fetch_methods[n] == FetchNull || rs->isNull(index)) {
+          insert_command % sqlite::nil;
+          continue;
+        }
+        switch (fetch_methods[n]) {
+          case FetchInteger:
+            insert_command % (std::int64_t)rs->getInt64(index);
+            break;
+          case FetchString:
+            insert_command % std::string(rs->getString(index));
+            break;
+          default: {
+            sqlite::variant_t var_index = index;
+            sqlite::variant_t value = boost::apply_visitor(fetch_var, column_types[n], var_index);
+            bind_sql_command_var.sql_command(&insert_command);
+            boost::apply_visitor(bind_sql_command_var, value);
+            break;
+          }
         }
       }
-      for (ColumnId n = 0; rowid_col_count > n; ++n) // copy original value of pk field(s)
-        row_values[editable_col_count + n] = row_values[_pkey_columns[n]];
-      add_data_swap_record(insert_commands, row_values);
+      for (sqlite::command *insert_command : partition_commands)
+        insert_command->emit();
 
       if (conn->is_stop_query_requested)
         throw std::runtime_error(
@@ -540,52 +593,189 @@ void Recordset_cdbc_storage::run_sql_script(const Sql_script &sql_script, bool s
   base::RecMutexLock lock(
     _getUserConnection(conn, true)); // we can't perform full connection check, hence we use the simple one
 
+  // Row statements are merged into multi-row statements (see Sql_script::Statement_batch_part), but only as long as
+  // they were not modified by the user after generation.
+  struct Row_statement {
+    size_t index;
+    const std::string *sql;
+    const Sql_script::Statement_bindings *bindings;
+    const Sql_script::Statement_batch_part *batch_part;
+  };
+  static const Sql_script::Statement_bindings no_bindings;
+  std::vector<Row_statement> row_statements;
+  row_statements.reserve(sql_script.statements.size());
+  {
+    std::vector<const Sql_script::Statement_batch_part *> batch_parts(sql_script.statements.size(), NULL);
+    for (const Sql_script::Statement_batch_part &batch_part : sql_script.statements_batch_parts)
+      if (batch_part.statement < batch_parts.size() && !batch_part.prefix.empty())
+        batch_parts[batch_part.statement] = &batch_part;
+    Sql_script::Statements_bindings::const_iterator sql_bindings = sql_script.statements_bindings.begin();
+    for (const std::string &sql : sql_script.statements) {
+      Row_statement row_statement = {row_statements.size(), &sql, &no_bindings, batch_parts[row_statements.size()]};
+      if (sql_script.statements_bindings.end() != sql_bindings)
+        row_statement.bindings = &*sql_bindings++;
+      const Sql_script::Statement_batch_part *batch_part = row_statement.batch_part;
+      if (batch_part && batch_part->prefix + batch_part->values + batch_part->suffix != sql)
+        row_statement.batch_part = NULL;
+      row_statements.push_back(row_statement);
+    }
+  }
+
+  size_t batch_size = 1000;
+  DictRef options = DictRef::cast_from(grt::GRT::get()->get("/wb/options/options"));
+  if (options.is_valid())
+    batch_size = (size_t)std::max<ssize_t>(1, options.get_int("DbSqlEditor:ApplyChangesBatchSize", 1000));
+  const size_t MAX_BATCH_STATEMENT_LENGTH = 1024 * 1024; // well below the default max_allowed_packet
+  const int LOCK_DEADLOCK_ERROR = 1213;                  // ER_LOCK_DEADLOCK, rolls back the whole transaction
+
   float progress_state = 0.f;
   float progress_state_inc = sql_script.statements.empty() ? 1.f : 1.f / sql_script.statements.size();
   int err_count = 0;
   int processed_statement_count = 0;
   std::string msg;
   BlobVarToStream blob_var_to_stream;
-  Sql_script::Statements_bindings::const_iterator sql_bindings = sql_script.statements_bindings.begin();
   std::auto_ptr<sql::PreparedStatement> stmt;
-  for (const std::string &sql : sql_script.statements) {
-    try {
-      stmt.reset(conn->ref->prepareStatement(sql));
-      std::list<std::shared_ptr<std::stringstream> > blob_streams;
-      if (sql_script.statements_bindings.end() != sql_bindings) {
-        int bind_var_index = 1;
-        for (const sqlite::variant_t &bind_var : *sql_bindings) {
-          if (sqlide::is_var_null(bind_var)) {
-            stmt->setNull(bind_var_index, 0);
-          } else {
-            std::shared_ptr<std::stringstream> blob_stream = boost::apply_visitor(blob_var_to_stream, bind_var);
-            if (binding_blobs()) {
-              blob_streams.push_back(blob_stream);
-              stmt->setBlob(bind_var_index, blob_stream.get());
-            }
+  std::auto_ptr<sql::Statement> batch_stmt(conn->ref->createStatement());
+  // A failing batch is undone with a savepoint before its rows are replayed one by one, which needs a transaction.
+  // In autocommit mode (the default of the editor connection, where commit() and rollback() do nothing) the whole
+  // apply therefore runs in a transaction of its own, so that it is still applied completely or not at all. Without
+  // a transaction to use, rows are not batched.
+  bool autocommit = conn->ref->getAutoCommit();
+  bool own_transaction = autocommit && !skip_transaction;
+  bool autocommit_rows = autocommit && skip_transaction;
+  if (autocommit_rows)
+    batch_size = 1;
+  bool transaction_lost = false;
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  if (own_transaction)
+    batch_stmt->execute("START TRANSACTION");
+
+  // Once the server rolled back the whole transaction (e.g. on a deadlock) none of the remaining rows can be applied
+  // anymore, as they would be committed one by one. They are all reported as failed.
+  auto abandon_rows = [&](size_t begin) {
+    transaction_lost = true;
+    for (size_t n = begin; n < row_statements.size(); ++n) {
+      ++err_count;
+      on_sql_script_run_statement_error(row_statements[n].index);
+    }
+    processed_statement_count += (int)(row_statements.size() - begin);
+    on_sql_script_run_progress(1.f);
+  };
+
+  auto execute = [&](const std::string &sql, const std::list<const Sql_script::Statement_bindings *> &bindings) {
+    stmt.reset(conn->ref->prepareStatement(sql));
+    std::list<std::shared_ptr<std::stringstream> > blob_streams;
+    int bind_var_index = 1;
+    for (const Sql_script::Statement_bindings *statement_bindings : bindings) {
+      for (const sqlite::variant_t &bind_var : *statement_bindings) {
+        if (sqlide::is_var_null(bind_var)) {
+          stmt->setNull(bind_var_index, 0);
+        } else {
+          std::shared_ptr<std::stringstream> blob_stream = boost::apply_visitor(blob_var_to_stream, bind_var);
+          if (binding_blobs()) {
+            blob_streams.push_back(blob_stream);
+            stmt->setBlob(bind_var_index, blob_stream.get());
           }
-          ++bind_var_index;
         }
+        ++bind_var_index;
       }
-      stmt->executeUpdate();
+    }
+    stmt->executeUpdate();
+  };
+
+  // Executes the given rows one by one, so that errors are reported for the row statement which caused them.
+  auto execute_rows = [&](size_t begin, size_t end) {
+    for (size_t n = begin; n < end; ++n) {
+      const Row_statement &row_statement = row_statements[n];
+      try {
+        execute(*row_statement.sql, std::list<const Sql_script::Statement_bindings *>(1, row_statement.bindings));
+      } catch (sql::SQLException &e) {
+        msg = strfmt("%i: %s", e.getErrorCode(), e.what());
+        on_sql_script_run_error(e.getErrorCode(), msg, *row_statement.sql);
+        if (e.getErrorCode() == LOCK_DEADLOCK_ERROR && !autocommit_rows) {
+          abandon_rows(n);
+          return;
+        }
+        ++err_count;
+        on_sql_script_run_statement_error(row_statement.index);
+      }
+      ++processed_statement_count;
+      progress_state += progress_state_inc;
+      on_sql_script_run_progress(progress_state);
+    }
+  };
+
+  for (size_t begin = 0, end; begin < row_statements.size(); begin = end) {
+    // collect consecutive rows with the same statement shape
+    const Sql_script::Statement_batch_part *first = row_statements[begin].batch_part;
+    std::string sql;
+    std::list<const Sql_script::Statement_bindings *> bindings;
+    end = begin + 1;
+    if (first) {
+      sql = first->prefix + first->values;
+      bindings.push_back(row_statements[begin].bindings);
+      for (; end < row_statements.size() && end - begin < batch_size; ++end) {
+        const Sql_script::Statement_batch_part *next = row_statements[end].batch_part;
+        if (!next || next->prefix != first->prefix || next->suffix != first->suffix ||
+            sql.size() + next->values.size() + 2 > MAX_BATCH_STATEMENT_LENGTH)
+          break;
+        sql += ", " + next->values;
+        bindings.push_back(row_statements[end].bindings);
+      }
+      sql += first->suffix;
+    }
+
+    if (end - begin == 1) {
+      execute_rows(begin, end);
+      continue;
+    }
+
+    // A failing batch is rolled back and then replayed row by row to find the offending rows.
+    bool replay = false;
+    try {
+      batch_stmt->execute("SAVEPOINT wb_apply_batch");
+      execute(sql, bindings);
+      batch_stmt->execute("RELEASE SAVEPOINT wb_apply_batch");
     } catch (sql::SQLException &e) {
-      ++err_count;
-      msg = strfmt("%i: %s", e.getErrorCode(), e.what());
-      on_sql_script_run_error(e.getErrorCode(), msg, sql);
+      logDebug("Applying batch of %i row changes failed, retrying row by row: %s\n", (int)(end - begin), e.what());
+      try {
+        batch_stmt->execute("ROLLBACK TO SAVEPOINT wb_apply_batch");
+        replay = true;
+      } catch (sql::SQLException &) {
+        msg = strfmt("%i: %s", e.getErrorCode(), e.what());
+        on_sql_script_run_error(e.getErrorCode(), msg, sql);
+        abandon_rows(begin);
+        break;
+      }
+    }
+    if (replay) {
+      execute_rows(begin, end);
+      if (transaction_lost)
+        break;
+    } else {
+      processed_statement_count += (int)(end - begin);
+      progress_state += progress_state_inc * (float)(end - begin);
+      on_sql_script_run_progress(progress_state);
     }
-    ++processed_statement_count;
-    progress_state += progress_state_inc;
-    on_sql_script_run_progress(progress_state);
-    ++sql_bindings;
   }
+
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  logInfo("Applied %i row change(s) to %s in %.3fs, %i error(s)\n", processed_statement_count,
+          full_table_name().c_str(), elapsed, err_count);
+
   if (err_count) {
-    if (!skip_transaction)
+    if (own_transaction) {
+      if (!transaction_lost)
+        batch_stmt->execute("ROLLBACK");
+    } else if (!skip_transaction)
       conn->ref->rollback();
     msg = strfmt("%i error(s) saving changes to table %s", err_count, full_table_name().c_str());
     on_sql_script_run_statistics((processed_statement_count - err_count), err_count);
     throw std::runtime_error(msg.c_str());
   } else {
-    if (!skip_transaction)
+    if (own_transaction)
+      batch_stmt->execute("COMMIT");
+    else if (!skip_transaction)
       conn->ref->commit();
     on_sql_script_run_statistics((processed_statement_count - err_count), err_count);
   }
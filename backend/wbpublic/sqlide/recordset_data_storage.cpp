@@ -89,7 +89,8 @@ void Recordset_data_storage::fetch_blob_value(Recordset *recordset, sqlite::conn
 
 void Recordset_data_storage::create_data_swap_tables(sqlite::connection *data_swap_db,
                                                      Recordset::Column_names &column_names,
-                                                     Recordset::Column_types &column_types) {
+                                                     Recordset::Column_types &column_types,
+                                                     const std::vector<bool> &native_columns) {
   // generate sql
   std::list<std::string> data_partitions_creates;
   std::list<std::string> data_partitions_drops;
@@ -107,8 +108,12 @@ void Recordset_data_storage::create_data_swap_tables(sqlite::connection *data_sw
                     col_end = std::min<ColumnId>(column_names.size(),
                                                  (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT);
            col < col_end; ++col) {
-        std::string column_type = boost::apply_visitor(type_of_var, *column_type_i);
-        cr_table_stmt << "`_" << col << "` " << column_type << ", ";
+        if (col < native_columns.size() && native_columns[col])
+          cr_table_stmt << "`_" << col << "`, ";
+        else {
+          std::string column_type = boost::apply_visitor(type_of_var, *column_type_i);
+          cr_table_stmt << "`_" << col << "` " << column_type << ", ";
+        }
         ++column_type_i;
       }
       cr_table_stmt << "id integer primary key autoincrement)";
@@ -91,8 +91,13 @@ public:
   }
 
 public:
+  /**
+   * Creates the partitioned data tables. Columns flagged in native_columns are declared without type affinity,
+   * so integers bound to them are stored in SQLite's compact integer encoding instead of being converted to text.
+   */
   static void create_data_swap_tables(sqlite::connection *data_swap_db, Recordset::Column_names &column_names,
-                                      Recordset::Column_types &column_types);
+                                      Recordset::Column_types &column_types,
+                                      const std::vector<bool> &native_columns = std::vector<bool>());
 
 protected:
   std::list<std::shared_ptr<sqlite::command> > prepare_data_swap_record_add_statement(
@@ -25,6 +25,7 @@
 
 #include "recordset_sql_storage.h"
 #include "recordset_be.h"
+#include "sql_inserts_writer.h"
 #include "grtsqlparser/sql_facade.h"
 #include "base/string_utilities.h"
 #include "base/sqlstring.h"
@@ -66,6 +67,41 @@ std::string PrimaryKeyPredicate::operator()(std::vector<std::shared_ptr<sqlite::
   return predicate;
 }
 
+std::string PrimaryKeyPredicate::columns() const {
+  std::string columns;
+  for (auto col : *_pkey_columns) {
+    if (!columns.empty())
+      columns += ", ";
+    columns += "`" + (*_column_names)[col] + "`";
+  }
+
+  return (_pkey_columns->size() > 1) ? "(" + columns + ")" : columns;
+}
+
+bool PrimaryKeyPredicate::values(std::vector<std::shared_ptr<sqlite::result> > &data_row_results,
+                                 std::string &values) {
+  sqlite::variant_t v;
+
+  values.clear();
+  for (auto col : *_pkey_columns) {
+    if (!values.empty())
+      values += ", ";
+
+    size_t partition;
+    ColumnId partition_column = Recordset::translate_data_swap_db_column(col, &partition);
+    std::shared_ptr<sqlite::result> &data_row_rs = data_row_results[partition];
+
+    v = data_row_rs->get_variant((int)partition_column);
+    if (sqlide::is_var_null(v))
+      return false;
+    values += boost::apply_visitor(*_qv, (*_column_types)[col], v);
+  }
+  if (_pkey_columns->size() > 1)
+    values = "(" + values + ")";
+
+  return !_pkey_columns->empty();
+}
+
 //------------------------------------------------------------------------------
 
 class JsonTypeFinder : public boost::static_visitor<bool> {
@@ -101,7 +137,8 @@ Recordset_sql_storage::Recordset_sql_storage()
   : Recordset_data_storage(),
     _is_sql_script_substitute_enabled(false),
     _omit_schema_qualifier(false),
-    _binding_blobs(true) {
+    _binding_blobs(true),
+    _rows_per_statement(1) {
 }
 
 Recordset_sql_storage::~Recordset_sql_storage() {
@@ -229,12 +266,39 @@ void Recordset_sql_storage::load_insert_statement(const std::string &sql,
 }
 
 void Recordset_sql_storage::do_serialize(const Recordset *recordset, sqlite::connection *data_swap_db) {
+  // This one is used for generating inserts for export
+
   _sql_script = std::string();
-  Sql_script sql_script;
-  generate_inserts(recordset, data_swap_db, sql_script);
-  std::ostringstream oss;
-  std::copy(sql_script.statements.begin(), sql_script.statements.end(), std::ostream_iterator<std::string>(oss, ";\n"));
-  _sql_script = oss.str();
+  if (_is_sql_script_substitute_enabled) {
+    _sql_script = statements_as_sql_script(_sql_script_substitute.statements);
+    return;
+  }
+
+  const Recordset::Column_names &column_names = get_column_names(recordset);
+  const Recordset::Column_types &column_types = get_column_types(recordset);
+  const Recordset::Column_flags &column_flags = get_column_flags(recordset);
+  const Recordset::DBColumn_types &dbColumnTypes = getDbColumnTypes(recordset);
+
+  sqlide::QuoteVar qv;
+  init_variant_quoter(qv);
+  qv.store_unknown_as_string = true;
+
+  std::vector<SqlInsertsWriter::Column> columns(recordset->get_column_count());
+  for (ColumnId col = 0; col < columns.size(); ++col) {
+    SqlInsertsWriter::Column &column = columns[col];
+    column.name = column_names[col];
+    column.type = column_types[col];
+    column.needQuote = (column_flags[col] & Recordset::NeedsQuoteFlag) != 0;
+    column.bitMode = !dbColumnTypes.empty() && dbColumnTypes[col] == "BIT";
+    if (column_flags[col] & Recordset::NotNullFlag)
+      column.nullValue = "DEFAULT";
+    else
+      column.nullValue = boost::apply_visitor(qv, column.type, sqlite::variant_t(sqlite::null_t()));
+  }
+
+  SqlInsertsWriter writer(_omit_schema_qualifier ? "`" + table_name() + "`" : full_table_name(), columns, qv);
+  writer.rowsPerStatement(_rows_per_statement);
+  writer.write(recordset, data_swap_db, [this](const std::string &text) { _sql_script += text; });
 }
 
 void Recordset_sql_storage::do_apply_changes(const Recordset *recordset, sqlite::connection *data_swap_db,
@@ -405,6 +469,7 @@ void Recordset_sql_storage::generate_sql_script(const Recordset *recordset, sqli
         RowId rowid = rs->get_int(1);
         std::string sql;
         Sql_script::Statement_bindings sql_bindings;
+        Sql_script::Statement_batch_part batch_part;
 
         switch (rs->get_int(2)) // action
         {
@@ -414,6 +479,11 @@ void Recordset_sql_storage::generate_sql_script(const Recordset *recordset, sqli
             bind_vars.push_back((int)rowid);
             if (Recordset::emit_partition_queries(data_swap_db, deleted_row_queries, deleted_row_results, bind_vars)) {
               sql = strfmt("DELETE FROM %s WHERE %s", full_table_name.c_str(), pkey_pred(deleted_row_results).c_str());
+              if (pkey_pred.values(deleted_row_results, batch_part.values)) {
+                batch_part.prefix =
+                  strfmt("DELETE FROM %s WHERE %s IN (", full_table_name.c_str(), pkey_pred.columns().c_str());
+                batch_part.suffix = ")";
+              }
             }
           } break;
 
@@ -465,10 +535,13 @@ void Recordset_sql_storage::generate_sql_script(const Recordset *recordset, sqli
                 col_names.resize(col_names.size() - 2);
               if (!values.empty())
                 values.resize(values.size() - 2);
-              sql = strfmt("INSERT INTO %s (%s) VALUES (%s)",
-                           _omit_schema_qualifier ? (std::string("`") + table_name() + std::string("`")).c_str()
-                                                  : full_table_name.c_str(),
-                           col_names.c_str(), values.c_str());
+              batch_part.prefix = strfmt("INSERT INTO %s (%s) VALUES ",
+                                         _omit_schema_qualifier
+                                           ? (std::string("`") + table_name() + std::string("`")).c_str()
+                                           : full_table_name.c_str(),
+                                         col_names.c_str());
+              batch_part.values = "(" + values + ")";
+              sql = batch_part.prefix + batch_part.values;
             }
           } break;
 
@@ -515,8 +588,10 @@ void Recordset_sql_storage::generate_sql_script(const Recordset *recordset, sqli
           } break;
         }
 
+        batch_part.statement = sql_script.statements.size();
         sql_script.statements.push_back(sql);
         sql_script.statements_bindings.push_back(sql_bindings);
+        sql_script.statements_batch_parts.push_back(batch_part);
       } while (rs->next_row());
     }
   } else {
@@ -562,84 +637,3 @@ void Recordset_sql_storage::generate_sql_script(const Recordset *recordset, sqli
     }
   }
 }
-
-void Recordset_sql_storage::generate_inserts(const Recordset *recordset, sqlite::connection *data_swap_db,
-                                             Sql_script &sql_script) {
-  // This one is used for generating inserts for export
-
-  if (_is_sql_script_substitute_enabled) {
-    sql_script = _sql_script_substitute;
-    return;
-  }
-
-  const Recordset::Column_names &column_names = get_column_names(recordset);
-  const Recordset::Column_types &column_types = get_column_types(recordset);
-  const Recordset::Column_types &real_column_types = get_real_column_types(recordset);
-  const Recordset::Column_flags &column_flags = get_column_flags(recordset);
-  const Recordset::DBColumn_types &dbColumnTypes = getDbColumnTypes(recordset);
-  const size_t partition_count = recordset->data_swap_db_partition_count();
-
-  // RowId min_new_rowid= recordset->min_new_rowid();
-  ColumnId editable_col_count = recordset->get_column_count();
-  sqlide::QuoteVar qv;
-  init_variant_quoter(qv);
-  qv.store_unknown_as_string = true;
-  std::string full_table_name = this->full_table_name();
-
-  if (0 == editable_col_count)
-    return;
-
-  std::vector<bool> blob_columns(editable_col_count);
-  for (ColumnId col = 0; editable_col_count > col; ++col)
-    blob_columns[col] = sqlide::is_var_blob(real_column_types[col]);
-
-  std::string col_names;
-  for (ColumnId col = 0; editable_col_count > col; ++col)
-    col_names += strfmt("`%s`, ", column_names[col].c_str());
-  if (!col_names.empty())
-    col_names.resize(col_names.size() - 2);
-
-  std::list<std::shared_ptr<sqlite::query> > data_queries(partition_count);
-  Recordset::prepare_partition_queries(data_swap_db, "select * from `data%s`", data_queries);
-  std::vector<std::shared_ptr<sqlite::result> > data_results(data_queries.size());
-  if (Recordset::emit_partition_queries(data_swap_db, data_queries, data_results)) {
-    bool next_row_exists = true;
-    do {
-      sqlite::variant_t v;
-      std::string values;
-      for (size_t partition = 0; partition < partition_count; ++partition) {
-        std::shared_ptr<sqlite::result> &data_rs = data_results[partition];
-        for (ColumnId col_begin = partition * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT, col = col_begin,
-                      col_end = std::min<ColumnId>(editable_col_count,
-                                                   (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT);
-             col < col_end; ++col) {
-          ColumnId partition_column = col - col_begin;
-          v = data_rs->get_variant((int)partition_column);
-
-          std::string value;
-          if (sqlide::is_var_null(v) && (column_flags[col] & Recordset::NotNullFlag) != 0) {
-              value = "DEFAULT";
-          } else {
-
-            qv.bitMode = !dbColumnTypes.empty() && dbColumnTypes[col] == "BIT";
-            qv.needQuote = column_flags[col] & Recordset::NeedsQuoteFlag;
-
-            value = strfmt("%s", boost::apply_visitor(qv, column_types[col], v).c_str());
-          }
-
-          values += strfmt("%s, ", value.c_str());
-        }
-      }
-      if (!values.empty())
-        values.resize(values.size() - 2);
-      std::string sql = strfmt(
-        "INSERT INTO %s (%s) VALUES (%s)",
-        _omit_schema_qualifier ? (std::string("`") + table_name() + std::string("`")).c_str() : full_table_name.c_str(),
-        col_names.c_str(), values.c_str());
-      sql_script.statements.push_back(sql);
-
-      for (auto &data_rs : data_results)
-        next_row_exists = data_rs->next_row();
-    } while (next_row_exists);
-  }
-}
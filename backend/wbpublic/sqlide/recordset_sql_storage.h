@@ -35,11 +35,30 @@ public:
   typedef std::list<std::string> Statements;
   typedef std::list<sqlite::variant_t> Statement_bindings;
   typedef std::list<Statement_bindings> Statements_bindings;
+
+  /**
+   * Describes how a single row statement can be merged with its neighbours. Consecutive statements with the same
+   * prefix and suffix are executed as prefix + values joined by ", " + suffix, e.g. a multi-row INSERT.
+   * An empty prefix means the statement is always executed on its own. The part only applies to the statement at
+   * position `statement` in the script, which keeps identical statements apart when the script was edited.
+   */
+  struct Statement_batch_part {
+    size_t statement;
+    std::string prefix;
+    std::string values;
+    std::string suffix;
+    Statement_batch_part() : statement(0) {
+    }
+  };
+  typedef std::list<Statement_batch_part> Statements_batch_parts;
+
   Statements statements;
   Statements_bindings statements_bindings;
+  Statements_batch_parts statements_batch_parts; // at most one entry per statement
   void reset() {
     statements.clear();
     statements_bindings.clear();
+    statements_batch_parts.clear();
   }
 };
 
@@ -71,7 +90,6 @@ public:
 protected:
   virtual void generate_sql_script(const Recordset *recordset, sqlite::connection *data_swap_db, Sql_script &sql_script,
                                    bool is_update_script, bool binaryAsString = false);
-  virtual void generate_inserts(const Recordset *recordset, sqlite::connection *data_swap_db, Sql_script &sql_script);
   virtual void run_sql_script(const Sql_script &sql_script, bool skip_commit) {
   }
   virtual void init_variant_quoter(sqlide::QuoteVar &qv) const;
@@ -188,7 +206,9 @@ public:
   typedef boost::signals2::signal<int(long long, const std::string &, const std::string &)> Error_cb;
   typedef boost::signals2::signal<int(float)> Batch_exec_progress_cb;
   typedef boost::signals2::signal<int(long, long)> Batch_exec_stat_cb;
+  typedef boost::signals2::signal<int(size_t)> Statement_error_cb;
   Error_cb on_sql_script_run_error;
+  Statement_error_cb on_sql_script_run_statement_error; // position of the failed statement in the script
   Batch_exec_progress_cb on_sql_script_run_progress;
   Batch_exec_stat_cb on_sql_script_run_statistics;
 
@@ -204,8 +224,17 @@ public:
     _binding_blobs = val;
   }
 
+  // Number of rows combined into one INSERT statement by serialize().
+  std::size_t rows_per_statement() const {
+    return _rows_per_statement;
+  }
+  void rows_per_statement(std::size_t val) {
+    _rows_per_statement = val;
+  }
+
 private:
   bool _binding_blobs;
+  std::size_t _rows_per_statement;
 };
 
 namespace sqlite {
@@ -222,6 +251,10 @@ public:
   PrimaryKeyPredicate(const Recordset::Column_types *column_types, const Recordset::Column_names *column_names,
                       const std::vector<ColumnId> *pkey_columns, sqlide::QuoteVar *qv);
   std::string operator()(std::vector<std::shared_ptr<sqlite::result> > &data_row_results);
+
+  // Column list and value tuple usable for a "<columns> IN (<values>, ...)" predicate. False if any value is NULL.
+  std::string columns() const;
+  bool values(std::vector<std::shared_ptr<sqlite::result> > &data_row_results, std::string &values);
 };
 
 #endif /* _RECORDSET_SQL_STORAGE_BE_H_ */
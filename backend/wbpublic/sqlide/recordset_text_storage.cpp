@@ -25,12 +25,14 @@
 
 #include "recordset_text_storage.h"
 #include "recordset_be.h"
+#include "sql_inserts_writer.h"
 #include "base/string_utilities.h"
 #include "base/file_functions.h"
 #include "base/file_utilities.h"
 #include "base/config_file.h"
 #include "base/log.h"
 
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <errno.h>
@@ -67,6 +69,7 @@ static void process_templates(const std::list<std::string> &files) {
       info.include_column_types = cf.get_value("include_column_types");
       info.null_syntax = cf.get_value("null_syntax");
       info.row_separator = cf.get_value("row_separator");
+      info.insert_statements = cf.get_bool("insert_statements");
       if (info.include_column_types != "xls")
         info.include_column_types = "";
       std::string args = cf.get_value("arguments");
@@ -248,7 +251,27 @@ void Recordset_text_storage::do_serialize(const Recordset *recordset, sqlite::co
   // 3. dump post
   // otherwise, the whole thing is dumped at once
   mtemplate::TemplateOutputFile output(_file_path);
-  if (pre_template || post_template) {
+  if (info.insert_statements) {
+    // The row template only renders INSERT statements, so rows are written directly instead of expanding the
+    // template for each of them. Several rows can be combined into one statement.
+    std::vector<SqlInsertsWriter::Column> columns(visible_col_count);
+    for (ColumnId col = 0; col < visible_col_count; ++col) {
+      columns[col].name = (*column_names)[col];
+      columns[col].type = column_types[col];
+      columns[col].nullValue = null_syntax;
+      columns[col].quoted = strings_are_pre_quoted && (column_flags[col] & Recordset::NeedsQuoteFlag) != 0;
+    }
+
+    SqlInsertsWriter writer("`" + parameter_value("TABLE_NAME") + "`", columns, qv);
+    writer.separator(",");
+    writer.rowsPerStatement(std::max(1, base::atoi<int>(parameter_value("ROWS_PER_STATEMENT"), 1)));
+
+    if (pre_template)
+      pre_template->expand(dictionary, &output);
+    writer.write(recordset, data_swap_db, [&output](const std::string &text) { output.out(text); });
+    if (post_template)
+      post_template->expand(dictionary, &output);
+  } else if (pre_template || post_template) {
     if (pre_template)
       pre_template->expand(dictionary, &output);
 
@@ -38,6 +38,7 @@ public:
     std::string row_separator;
     bool pre_quote_strings;
     std::string quote;
+    bool insert_statements; // the template produces one INSERT statement per row, see SqlInsertsWriter
   };
   static std::vector<Recordset_storage_info> storage_types();
 
@@ -24,7 +24,6 @@
 #include "base/boost_smart_ptr_helpers.h"
 #include "base/log.h"
 #include "base/string_utilities.h"
-#include "base/threaded_timer.h"
 #include "base/util_functions.h"
 
 #include "grt/grt_manager.h"
@@ -45,6 +44,9 @@
 #include "SymbolTable.h"
 
 #include "sql_editor_be.h"
+#include "statement_index.h"
+#include "analysis_executor.h"
+#include <algorithm>
 #include <mutex>
 
 DEFAULT_LOG_DOMAIN("MySQL editor");
@@ -55,6 +57,9 @@ using namespace base;
 
 using namespace parsers;
 
+// The kinds of work an editor hands over to the analysis executor.
+static const int SyntaxCheckTask = 0;
+
 //----------------------------------------------------------------------------------------------------------------------
 
 class MySQLEditor::Private {
@@ -83,29 +88,55 @@ public:
   base::RecMutex _sql_checker_mutex;
   MySQLParseUnit parseUnit; // The type of query we want to limit our parsing to.
 
-  // We use 2 timers here for delayed work. One is a grt timer to run a task in
-  // the main thread after a certain delay.
-  // The other one is to run the actual work task in a background thread.
+  // A grt timer runs the preparation of a check in the main thread, the actual work is then done by the
+  // analysis executor in a background thread (as task kind SyntaxCheckTask).
   bec::GRTManager::Timer *_current_delay_timer;
-  int _current_work_timer_id;
 
   std::pair<const char *, size_t> _textInfo; // Only valid during a parse run.
 
   std::vector<ParserErrorInfo> _recognition_errors; // List of errors from the last sql check run.
-  std::set<size_t> _error_marker_lines;
+
+  // Error ranges (offset + length, sorted by offset) which have not yet been marked with an indicator because
+  // they are outside of the editor's markup window. Applied when they get near the visible area.
+  std::vector<std::pair<size_t, size_t> > _pending_error_indicators;
 
   bool _splitting_required;
-  bool _updating_statement_markers;
-  std::set<size_t> _statement_marker_lines;
   base::RecMutex _sql_statement_borders_mutex;
 
-  std::vector<StatementRange> _statementRanges;
+  // Statement boundaries, kept up-to-date incrementally. Edits shift the existing entries and mark a dirty range,
+  // which is the only part that gets split again.
+  StatementIndex _statementIndex;
+  bool _full_split_required;
+  bool _has_dirty_range;
+  size_t _dirty_start;
+  size_t _dirty_end;
+
+  // Text changes not yet applied to the statement index (see text_modified). These and the visible range below
+  // are set by the main thread and guarded by _edit_state_mutex instead of _sql_statement_borders_mutex, which
+  // is held for an entire split, so the main thread never has to wait for a split.
+  std::mutex _edit_state_mutex;
+  struct TextEdit {
+    size_t position;
+    size_t length;
+    bool added;
+  };
+  std::vector<TextEdit> _pending_edits;
+
+  // The text range in which statements changed since the last marker update (or all of them).
+  bool _full_marker_update;
+  bool _has_marker_range;
+  size_t _marker_start;
+  size_t _marker_end;
+
+  // The text range visible when the last check was triggered. Statements in this range are checked first and,
+  // for scripts larger than _full_check_limit, exclusively.
+  size_t _visible_start;
+  size_t _visible_end;
+  size_t _full_check_limit;
 
   bool _is_refresh_enabled;   // whether FE control is permitted to replace its
                               // contents from BE
   bool _is_sql_check_enabled; // Enables automatic syntax checks.
-  bool _stop_processing;      // To stop ongoing syntax checks (because of text
-                              // changes etc.).
   bool _owns_toolbar;
 
   boost::signals2::signal<void()> _text_change_signal;
@@ -116,18 +147,28 @@ public:
 
   // autocomplete_context will go after auto completion refactoring.
   Private(MySQLParserContext::Ref syntaxcheck_context, MySQLParserContext::Ref autocomplete_context)
-    : grtobj(grt::Initialized), _stop_processing(false) {
+    : grtobj(grt::Initialized) {
     _owns_toolbar = false;
     parseUnit = MySQLParseUnit::PuGeneric;
     _is_refresh_enabled = true;
     _splitting_required = false;
+    _full_split_required = true;
+    _has_dirty_range = false;
+    _dirty_start = 0;
+    _dirty_end = 0;
+    _full_marker_update = true;
+    _has_marker_range = false;
+    _marker_start = 0;
+    _marker_end = 0;
+    _visible_start = 0;
+    _visible_end = 0;
+    _full_check_limit = 10 * 1024 * 1024;
 
     parserContext = syntaxcheck_context;
     autocompletionContext = autocomplete_context;
     services = MySQLParserServices::get();
 
     _current_delay_timer = nullptr;
-    _current_work_timer_id = -1;
 
     _is_sql_check_enabled = true;
     container = nullptr;
@@ -135,68 +176,199 @@ public:
     editorContextMenu = nullptr;
     _toolbar = nullptr;
     _last_typed_char = 0;
-    _updating_statement_markers = false;
   }
 
   //--------------------------------------------------------------------------------------------------------------------
 
   /**
-   * Determines ranges for all statements in the current text.
+   * Determines ranges for all statements in the current text. The first run splits the entire text, later runs only
+   * split again what was touched by edits since the last run. Text changes which come in while a split is running
+   * make it stop early, the run triggered by them takes over.
+   */
+  /**
+   * Splits the text into statements if it changed. A split of changed lines stops early when further text changes
+   * come in or the given token (if any) is cancelled, the remaining lines are split on the next call then.
    */
-  void split_statements_if_required() {
+  void split_statements_if_required(const base::CancellationToken *token = nullptr) {
+    base::RecMutexLock lock(_sql_statement_borders_mutex);
+    apply_pending_edits();
+
     // If we have restricted content (e.g. for object editors) then we don't split and handle the entire content
     // as a single statement. This will then show syntax errors for any invalid additional input.
     if (_splitting_required) {
       logDebug3("Start splitting\n");
       _splitting_required = false;
 
-      base::RecMutexLock lock(_sql_statement_borders_mutex);
+      double start = timestamp();
+      StatementIndex::Splitter splitter = std::bind(&Private::split_text, this, std::placeholders::_1,
+                                                    std::placeholders::_2, std::placeholders::_3, std::placeholders::_4);
+      if (parseUnit != MySQLParseUnit::PuGeneric) {
+        StatementIndex::Entry entry;
+        entry.start = 0;
+        entry.length = _textInfo.second;
+        _statementIndex.assign(std::vector<StatementIndex::Entry>(1, entry));
+        _full_marker_update = true;
+      } else if (_full_split_required || _statementIndex.empty()) {
+        _statementIndex.split(_textInfo.first, _textInfo.second, splitter);
+        _full_marker_update = true;
+      } else if (_has_dirty_range) {
+        size_t changed_start, changed_end;
+        auto stop = [this, token]() { return has_pending_edits() || (token != nullptr && token->isCancelled()); };
+        if (!_statementIndex.resplit(_textInfo.first, _textInfo.second, _dirty_start, _dirty_end, splitter, stop,
+                                     changed_start, changed_end)) {
+          logDebug3("Splitting stopped for new text changes after %f ticks\n", timestamp() - start);
+          _splitting_required = true;
+          return;
+        }
+        add_marker_range(changed_start, changed_end);
+      }
+
+      _full_split_required = false;
+      _has_dirty_range = false;
+      logDebug3("Splitting ended after %f ticks\n", timestamp() - start);
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
 
-      _statementRanges.clear();
-      if (parseUnit == MySQLParseUnit::PuGeneric) {
-        double start = timestamp();
-        services->determineStatementRanges(_textInfo.first, _textInfo.second, ";", _statementRanges);
-        logDebug3("Splitting ended after %f ticks\n", timestamp() - start);
-      } else
-        _statementRanges.push_back({ 0, 0, _textInfo.second });
+  void split_text(const char *text, size_t length, const std::string &delimiter,
+                  std::vector<StatementIndex::Entry> &entries) {
+    std::vector<StatementRange> ranges;
+    services->determineStatementRanges(text, length, delimiter, ranges);
+
+    entries.reserve(ranges.size());
+    for (auto &range : ranges) {
+      StatementIndex::Entry entry;
+      entry.start = range.start;
+      entry.length = range.length;
+      entries.push_back(entry);
     }
   }
 
   //--------------------------------------------------------------------------------------------------------------------
 
   /**
-   * One or more markers on that line where changed. We have to stay in sync with our statement markers list
-   * to make the optimized add/remove algorithm working.
+   * Called for each text change (in the main thread). The change is only queued here, so typing never waits for
+   * a split running in the background. The queue is applied by whoever locks _sql_statement_borders_mutex next.
    */
-  void marker_changed(const mforms::LineMarkupChangeset &changeset, bool deleted) {
-    if (_updating_statement_markers || changeset.size() == 0)
-      return;
+  void text_modified(size_t position, size_t length, bool added) {
+    TextEdit edit = { position, length, added };
+    std::lock_guard<std::mutex> lock(_edit_state_mutex);
+    _pending_edits.push_back(edit);
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  bool has_pending_edits() {
+    std::lock_guard<std::mutex> lock(_edit_state_mutex);
+    return !_pending_edits.empty();
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /**
+   * Brings the statement index in sync with the text by applying all queued text changes. Edits shift the existing
+   * entries and extend the dirty range, which is the only part that gets split again.
+   * Must be called with _sql_statement_borders_mutex locked.
+   */
+  void apply_pending_edits() {
+    std::vector<TextEdit> edits;
+    {
+      std::lock_guard<std::mutex> lock(_edit_state_mutex);
+      edits.swap(_pending_edits);
+    }
 
-    if (deleted) {
-      for (mforms::LineMarkupChangeset::const_iterator iterator = changeset.begin(); iterator != changeset.end();
-           ++iterator) {
-        if ((iterator->markup & mforms::LineMarkupStatement) != 0)
-          _statement_marker_lines.erase(iterator->original_line);
-        if ((iterator->markup & mforms::LineMarkupError) != 0)
-          _error_marker_lines.erase(iterator->original_line);
+    for (auto &edit : edits) {
+      if (edit.added)
+        _statementIndex.textInserted(edit.position, edit.length);
+      else
+        _statementIndex.textRemoved(edit.position, edit.length);
+
+      if (_has_marker_range)
+        move_range(edit, _marker_start, _marker_end);
+
+      size_t change_end = edit.added ? edit.position + edit.length : edit.position;
+      if (!_has_dirty_range) {
+        _has_dirty_range = true;
+        _dirty_start = edit.position;
+        _dirty_end = change_end;
+      } else {
+        // Move the existing dirty range along with the text and include the new change.
+        move_range(edit, _dirty_start, _dirty_end);
+        _dirty_start = std::min(_dirty_start, edit.position);
+        _dirty_end = std::max(_dirty_end, change_end);
       }
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /**
+   * Adjusts a text range for a text change. An end of std::string::npos (up to the end of the text) stays as is.
+   */
+  static void move_range(const TextEdit &edit, size_t &start, size_t &end) {
+    if (edit.added) {
+      if (start > edit.position)
+        start += edit.length;
+      if (end >= edit.position && end != std::string::npos)
+        end += edit.length;
     } else {
-      for (mforms::LineMarkupChangeset::const_iterator iterator = changeset.begin(); iterator != changeset.end();
-           ++iterator) {
-        if ((iterator->markup & mforms::LineMarkupStatement) != 0)
-          _statement_marker_lines.erase(iterator->original_line);
-        if ((iterator->markup & mforms::LineMarkupError) != 0)
-          _error_marker_lines.erase(iterator->original_line);
-      }
-      for (mforms::LineMarkupChangeset::const_iterator iterator = changeset.begin(); iterator != changeset.end();
-           ++iterator) {
-        if ((iterator->markup & mforms::LineMarkupStatement) != 0)
-          _statement_marker_lines.insert(iterator->new_line);
-        if ((iterator->markup & mforms::LineMarkupError) != 0)
-          _error_marker_lines.insert(iterator->new_line);
-      }
+      if (start >= edit.position + edit.length)
+        start -= edit.length;
+      else if (start > edit.position)
+        start = edit.position;
+
+      if (end == std::string::npos)
+        return;
+      if (end >= edit.position + edit.length)
+        end -= edit.length;
+      else if (end > edit.position)
+        end = edit.position;
     }
   }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /**
+   * Records a text range in which statements were replaced, for the next statement marker update.
+   */
+  void add_marker_range(size_t start, size_t end) {
+    if (_full_marker_update)
+      return;
+
+    if (!_has_marker_range) {
+      _has_marker_range = true;
+      _marker_start = start;
+      _marker_end = end;
+    } else {
+      _marker_start = std::min(_marker_start, start);
+      _marker_end = std::max(_marker_end, end);
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------------------------
+
+  /**
+   * Called when the editor changed the range of lines for which it shows markup. Adds error indicators for all
+   * pending errors in that range.
+   */
+  void markup_window_changed(size_t first_line, size_t end_line) {
+    if (_pending_error_indicators.empty())
+      return;
+
+    size_t start = codeEditor->position_from_line(first_line);
+    size_t end = codeEditor->position_from_line(end_line);
+    size_t length = codeEditor->text_length();
+    if (end > length || end <= start)
+      end = length;
+
+    auto first = std::lower_bound(_pending_error_indicators.begin(), _pending_error_indicators.end(),
+                                  std::make_pair(start, (size_t)0));
+    auto last = std::lower_bound(first, _pending_error_indicators.end(), std::make_pair(end, (size_t)0));
+    for (auto iterator = first; iterator != last; ++iterator)
+      codeEditor->show_indicator(mforms::RangeIndicatorError, iterator->first, iterator->second);
+    _pending_error_indicators.erase(first, last);
+  }
 };
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -244,8 +416,9 @@ MySQLEditor::MySQLEditor(MySQLParserContext::Ref syntax_check_context, MySQLPars
   scoped_connect(d->codeEditor->signal_dwell(),
                  std::bind(&MySQLEditor::dwell_event, this, std::placeholders::_1, std::placeholders::_2,
                            std::placeholders::_3, std::placeholders::_4));
-  scoped_connect(d->codeEditor->signal_marker_changed(),
-                 std::bind(&MySQLEditor::Private::marker_changed, d, std::placeholders::_1, std::placeholders::_2));
+  scoped_connect(d->codeEditor->signal_markup_window_changed(),
+                 std::bind(&MySQLEditor::Private::markup_window_changed, d, std::placeholders::_1,
+                           std::placeholders::_2));
 
   setup_auto_completion();
   setup_editor_menu();
@@ -255,6 +428,9 @@ MySQLEditor::MySQLEditor(MySQLParserContext::Ref syntax_check_context, MySQLPars
 
 MySQLEditor::~MySQLEditor() {
   stop_processing();
+  AnalysisExecutor *executor = AnalysisExecutor::instance();
+  if (executor != nullptr)
+    executor->cancel(this); // Waits for a running check to return.
 
   {
     d->_is_sql_check_enabled = false;
@@ -551,8 +727,11 @@ void MySQLEditor::append_text(const std::string &text) {
  */
 void MySQLEditor::sql(const char *sql) {
   d->codeEditor->set_text(sql);
+  {
+    base::RecMutexLock lock(d->_sql_statement_borders_mutex);
+    d->_full_split_required = true;
+  }
   d->_splitting_required = true;
-  d->_statement_marker_lines.clear();
   d->codeEditor->set_eol_mode(mforms::EolLF, true);
 }
 
@@ -695,6 +874,9 @@ void MySQLEditor::restrict_content_to(ContentType type) {
       d->parseUnit = MySQLParseUnit::PuGeneric;
       break;
   }
+
+  base::RecMutexLock lock(d->_sql_statement_borders_mutex);
+  d->_full_split_required = true;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -716,7 +898,9 @@ void MySQLEditor::text_changed(int position, int length, int lines_changed, bool
     update_auto_completion(text);
   }
 
+  d->text_modified(position, length, added);
   d->_splitting_required = true;
+  d->_pending_error_indicators.clear(); // Offsets are no longer valid. The next check will bring them back.
   d->_textInfo = d->codeEditor->get_text_ptr();
   if (d->_is_sql_check_enabled)
     d->_current_delay_timer =
@@ -775,43 +959,86 @@ bool MySQLEditor::start_sql_processing() {
     d->_recognition_errors.clear();
   }
 
-  d->_stop_processing = false;
+  // Remember the currently visible text range (can only be determined in the main thread).
+  {
+    sptr_t first_visible_line = d->codeEditor->send_editor(SCI_GETFIRSTVISIBLELINE, 0, 0);
+    size_t first_line = (size_t)d->codeEditor->send_editor(SCI_DOCLINEFROMVISIBLE, first_visible_line, 0);
+    size_t line_count = (size_t)d->codeEditor->send_editor(SCI_LINESONSCREEN, 0, 0);
+
+    size_t visible_start = d->codeEditor->position_from_line(first_line);
+    size_t visible_end = d->codeEditor->position_from_line(first_line + line_count + 1);
+    if (visible_end <= visible_start)
+      visible_end = d->codeEditor->text_length();
+    size_t full_check_limit = (size_t)bec::GRTManager::get()->get_app_option_int("DbSqlEditor:FullSyntaxCheckLimit",
+                                                                                 10 * 1024 * 1024);
+
+    std::lock_guard<std::mutex> lock(d->_edit_state_mutex);
+    d->_visible_start = visible_start;
+    d->_visible_end = visible_end;
+    d->_full_check_limit = full_check_limit;
+  }
 
   d->codeEditor->set_status_text("");
-  if (d->_textInfo.first != nullptr && d->_textInfo.second > 0)
-    d->_current_work_timer_id = ThreadedTimer::get()->add_task(
-      TimerTimeSpan, 0.05, true, std::bind(&MySQLEditor::do_statement_split_and_check, this, std::placeholders::_1));
+  AnalysisExecutor *executor = AnalysisExecutor::get();
+  if (executor != nullptr && d->_textInfo.first != nullptr && d->_textInfo.second > 0)
+    executor->submit(this, SyntaxCheckTask,
+                     std::bind(&MySQLEditor::do_statement_split_and_check, this, std::placeholders::_1),
+                     AnalysisExecutor::PriorityNormal, 0.05);
   return false; // Don't re-run this task, it's a single-shot.
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
-bool MySQLEditor::do_statement_split_and_check(int id) {
-  d->split_statements_if_required();
+/**
+ * Splits the text (if needed) and checks the syntax of the statements in it. Runs in a thread of the analysis
+ * executor and returns early (without posting results) when the token gets cancelled by a newer request.
+ */
+void MySQLEditor::do_statement_split_and_check(const base::CancellationToken &token) {
+  d->split_statements_if_required(&token);
 
   // Start tasks that depend on the statement ranges (markers + auto completion).
   bec::GRTManager::get()->run_once_when_idle(this, std::bind(&MySQLEditor::splitting_done, this));
 
-  if (d->_stop_processing)
-    return false;
+  if (token.isCancelled())
+    return;
 
   base::RecMutexLock lock(d->_sql_checker_mutex);
 
-  // Now do error checking for each of the statements, collecting error
-  // positions for later markup.
-  for (auto &range : d->_statementRanges) {
-    if (d->_stop_processing)
-      return false;
+  // Now do error checking for each of the statements, collecting error positions for later markup.
+  // Statements in the visible area go first. Large scripts are only checked there, everything else would take
+  // much too long for a check which is triggered after each edit.
+  std::vector<StatementRange> statements;
+  {
+    size_t visible_start, visible_end, full_check_limit;
+    {
+      std::lock_guard<std::mutex> lock(d->_edit_state_mutex);
+      visible_start = d->_visible_start;
+      visible_end = d->_visible_end;
+      full_check_limit = d->_full_check_limit;
+    }
 
-    if (d->services->checkSqlSyntax(d->parserContext, d->_textInfo.first + range.start, range.length, d->parseUnit) > 0) {
-      std::vector<ParserErrorInfo> errors = d->parserContext->errorsWithOffset(range.start);
-      d->_recognition_errors.insert(d->_recognition_errors.end(), errors.begin(), errors.end());
+    RecMutexLock sql_statement_borders_mutex(d->_sql_statement_borders_mutex);
+    for (auto &entry : d->_statementIndex.entries(visible_start, visible_end)) {
+      StatementRange range = { 0, entry.start, entry.length };
+      statements.push_back(range);
+    }
+    if (d->_textInfo.second <= full_check_limit) {
+      for (auto &entry : d->_statementIndex.entries()) {
+        if (entry.end() <= visible_start || entry.start >= visible_end) {
+          StatementRange range = { 0, entry.start, entry.length };
+          statements.push_back(range);
+        }
+      }
     }
   }
 
-  bec::GRTManager::get()->run_once_when_idle(this, std::bind(&MySQLEditor::update_error_markers, this));
+  std::vector<ParserErrorInfo> errors;
+  d->services->checkSqlSyntax(d->parserContext, d->_textInfo.first, statements, d->parseUnit, token, errors);
+  if (token.isCancelled())
+    return; // The text changed meanwhile, a new check is on its way.
 
-  return false;
+  d->_recognition_errors.insert(d->_recognition_errors.end(), errors.begin(), errors.end());
+  bec::GRTManager::get()->run_once_when_idle(this, std::bind(&MySQLEditor::update_error_markers, this));
 }
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -829,42 +1056,59 @@ void *MySQLEditor::splitting_done() {
     show_auto_completion(false);
   }
 
-  std::set<size_t> removal_candidates;
-  std::set<size_t> insert_candidates;
-
-  std::set<size_t> lines;
-  for (auto &range : d->_statementRanges)
-    lines.insert(d->codeEditor->line_from_position(range.start));
-
-  std::set_difference(lines.begin(), lines.end(), d->_statement_marker_lines.begin(), d->_statement_marker_lines.end(),
-                      inserter(insert_candidates, insert_candidates.begin()));
-
-  std::set_difference(d->_statement_marker_lines.begin(), d->_statement_marker_lines.end(), lines.begin(), lines.end(),
-                      inserter(removal_candidates, removal_candidates.begin()));
-
-  d->_statement_marker_lines.swap(lines);
+  // Statement markers are only updated for the lines in which statements were split again. A full update is needed
+  // only after the entire text was split.
+  std::vector<size_t> lines;
+  bool full_update = false;
+  size_t first_line = 0;
+  size_t end_line = 0;
+  {
+    RecMutexLock sql_statement_borders_mutex(d->_sql_statement_borders_mutex);
+    d->apply_pending_edits();
+
+    if (d->_full_marker_update) {
+      full_update = true;
+      lines.reserve(d->_statementIndex.size());
+      for (auto &range : d->_statementIndex.entries())
+        lines.push_back(d->codeEditor->line_from_position(range.start));
+    } else if (d->_has_marker_range) {
+      // Extend the range to entire lines, other statements starting on these lines share the markers.
+      size_t length = d->codeEditor->text_length();
+      size_t line_count = d->codeEditor->line_count();
+      first_line = d->codeEditor->line_from_position(std::min(d->_marker_start, length));
+      end_line = d->codeEditor->line_from_position(std::min(d->_marker_end, length)) + 1;
+
+      size_t start = d->codeEditor->position_from_line(first_line);
+      size_t end = end_line < line_count ? d->codeEditor->position_from_line(end_line) : std::string::npos;
+      for (auto &range : d->_statementIndex.entries(start, end)) {
+        if (range.start >= start)
+          lines.push_back(d->codeEditor->line_from_position(range.start));
+      }
+    } else
+      return nullptr;
 
-  d->_updating_statement_markers = true;
-  for (std::set<size_t>::const_iterator iterator = removal_candidates.begin(); iterator != removal_candidates.end();
-       ++iterator)
-    d->codeEditor->remove_markup(mforms::LineMarkupStatement, *iterator);
+    d->_full_marker_update = false;
+    d->_has_marker_range = false;
+  }
 
-  for (std::set<size_t>::const_iterator iterator = insert_candidates.begin(); iterator != insert_candidates.end();
-       ++iterator)
-    d->codeEditor->show_markup(mforms::LineMarkupStatement, *iterator);
-  d->_updating_statement_markers = false;
+  if (full_update)
+    d->codeEditor->set_markup_lines(mforms::LineMarkupStatement, lines);
+  else
+    d->codeEditor->set_markup_lines(mforms::LineMarkupStatement, lines, first_line, end_line);
 
   return nullptr;
 }
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/**
+ * Sets error markers for all lines with errors. Error indicators are only added for errors in and around the
+ * visible area, the rest follows when scrolling (see markup_window_changed). Runs in the main thread.
+ */
 void *MySQLEditor::update_error_markers() {
-  std::set<size_t> removal_candidates;
-  std::set<size_t> insert_candidates;
-
-  std::set<size_t> lines;
+  std::vector<size_t> lines;
 
+  d->_pending_error_indicators.clear();
   d->codeEditor->remove_indicator(mforms::RangeIndicatorError, 0, d->codeEditor->text_length());
   if (d->_recognition_errors.size() > 0) {
     if (d->_recognition_errors.size() == 1)
@@ -872,29 +1116,19 @@ void *MySQLEditor::update_error_markers() {
     else
       d->codeEditor->set_status_text(base::strfmt(_("%lu errors found"), (unsigned long)d->_recognition_errors.size()));
 
+    lines.reserve(d->_recognition_errors.size());
+    d->_pending_error_indicators.reserve(d->_recognition_errors.size());
     for (size_t i = 0; i < d->_recognition_errors.size(); ++i) {
-      d->codeEditor->show_indicator(mforms::RangeIndicatorError, d->_recognition_errors[i].charOffset,
-                                   d->_recognition_errors[i].length);
-      lines.insert(d->codeEditor->line_from_position(d->_recognition_errors[i].charOffset));
+      d->_pending_error_indicators.push_back(
+        std::make_pair(d->_recognition_errors[i].charOffset, d->_recognition_errors[i].length));
+      lines.push_back(d->codeEditor->line_from_position(d->_recognition_errors[i].charOffset));
     }
+    std::sort(d->_pending_error_indicators.begin(), d->_pending_error_indicators.end());
   } else
     d->codeEditor->set_status_text("");
 
-  std::set_difference(lines.begin(), lines.end(), d->_error_marker_lines.begin(), d->_error_marker_lines.end(),
-                      inserter(insert_candidates, insert_candidates.begin()));
-
-  std::set_difference(d->_error_marker_lines.begin(), d->_error_marker_lines.end(), lines.begin(), lines.end(),
-                      inserter(removal_candidates, removal_candidates.begin()));
-
-  d->_error_marker_lines.swap(lines);
-
-  for (std::set<size_t>::const_iterator iterator = removal_candidates.begin(); iterator != removal_candidates.end();
-       ++iterator)
-    d->codeEditor->remove_markup(mforms::LineMarkupError, *iterator);
-
-  for (std::set<size_t>::const_iterator iterator = insert_candidates.begin(); iterator != insert_candidates.end();
-       ++iterator)
-    d->codeEditor->show_markup(mforms::LineMarkupError, *iterator);
+  // This also refreshes the markup window, which in turn applies the indicators for the visible errors.
+  d->codeEditor->set_markup_lines(mforms::LineMarkupError, lines);
 
   return nullptr;
 }
@@ -1080,7 +1314,9 @@ void MySQLEditor::set_sql_check_enabled(bool flag) {
   if (d->_is_sql_check_enabled != flag) {
     d->_is_sql_check_enabled = flag;
     if (flag) {
-      ThreadedTimer::get()->remove_task(d->_current_work_timer_id); // Does nothing if the id is -1.
+      AnalysisExecutor *executor = AnalysisExecutor::instance();
+      if (executor != nullptr)
+        executor->cancel(this, SyntaxCheckTask);
       if (d->_current_delay_timer == nullptr)
         d->_current_delay_timer =
           bec::GRTManager::get()->run_every(std::bind(&MySQLEditor::start_sql_processing, this), 0.01);
@@ -1325,7 +1561,7 @@ bool MySQLEditor::make_keywords_uppercase() {
 
 /**
  * Determines the start and end position of the current statement, that is, the statement where the caret is in.
- * For effective search in a large set binary search is used.
+ * The lookup in the statement index is O(log n).
  *
  * Note: search can be done in two modes:
  *       - strict: whitespaces before a statement belong to that statement.
@@ -1342,40 +1578,12 @@ bool MySQLEditor::get_current_statement_range(size_t &start, size_t &end, bool s
   RecMutexLock sql_statement_borders_mutex(d->_sql_statement_borders_mutex);
   d->split_statements_if_required();
 
-  if (d->_statementRanges.empty())
-    return false;
-
-  typedef std::vector<StatementRange>::iterator RangeIterator;
-
-  size_t caret_position = d->codeEditor->get_caret_pos();
-  RangeIterator low = d->_statementRanges.begin();
-  RangeIterator high = d->_statementRanges.end() - 1;
-  while (low < high) {
-    RangeIterator middle = low + (high - low + 1) / 2;
-    if (middle->start > caret_position)
-      high = middle - 1;
-    else {
-      size_t end = low->start + low->length;
-      if (end >= caret_position)
-        break;
-      low = middle;
-    }
-  }
-
-  if (low == d->_statementRanges.end())
+  StatementIndex::Entry entry;
+  if (!d->_statementIndex.statementAt(d->codeEditor->get_caret_pos(), strict, entry))
     return false;
 
-  // If we are between two statements (in white spaces) then the algorithm above
-  // returns the lower one.
-  if (strict) {
-    if (low->start + low->length < caret_position)
-      ++low;
-    if (low == d->_statementRanges.end())
-      return false;
-  }
-
-  start = low->start;
-  end = low->start + low->length;
+  start = entry.start;
+  end = entry.end();
   return true;
 }
 
@@ -1385,10 +1593,9 @@ bool MySQLEditor::get_current_statement_range(size_t &start, size_t &end, bool s
  * Stops any ongoing processing like splitting, syntax checking etc.
  */
 void MySQLEditor::stop_processing() {
-  d->_stop_processing = true;
-
-  ThreadedTimer::get()->remove_task(d->_current_work_timer_id);
-  d->_current_work_timer_id = -1;
+  AnalysisExecutor *executor = AnalysisExecutor::instance();
+  if (executor != nullptr)
+    executor->cancel(this, SyntaxCheckTask);
 
   if (d->_current_delay_timer != nullptr) {
     bec::GRTManager::get()->cancel_timer(d->_current_delay_timer);
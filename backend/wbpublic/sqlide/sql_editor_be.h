@@ -172,7 +172,7 @@ private:
   void activate_context_menu_item(const std::string &name);
 
   bool start_sql_processing();
-  bool do_statement_split_and_check(int id); // Run in worker thread.
+  void do_statement_split_and_check(const base::CancellationToken &token); // Run in worker thread.
 
   int on_report_sql_statement_border(int begin_lineno, int begin_line_pos, int end_lineno, int end_line_pos, int tag);
   int on_sql_error(int lineno, int tok_line_pos, int tok_len, const std::string &msg, int tag);
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include <sqlite/query.hpp>
+
+#include "sql_inserts_writer.h"
+#include "recordset_be.h"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <list>
+#include <thread>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+struct SqlInsertsWriter::Block {
+  std::vector<sqlite::variant_t> cells; // Row by row.
+  std::size_t rows;
+  bool last; // Contains the last row of the recordset, so the final statement must be closed.
+
+  Block() : rows(0), last(false) {
+  }
+};
+
+// The visitors convert through a member stream and can't be copied, so settings are transferred one by one.
+static void copy_quoter_settings(const sqlide::QuoteVar &source, sqlide::QuoteVar &target) {
+  target.escape_string = source.escape_string;
+  target.quote = source.quote;
+  target.blob_to_string = source.blob_to_string;
+  target.store_unknown_as_string = source.store_unknown_as_string;
+  target.allow_func_escaping = source.allow_func_escaping;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * @param table The table name as it should appear in the statements, already quoted.
+ * @param columns The columns to write, in swap db order. Only the first columns of the recordset can be written.
+ * @param quoter The visitor used for values without a fast path, configured for the target (escape function, quote
+ *        char, blob handling etc.). needQuote and bitMode are taken from the column descriptions.
+ */
+SqlInsertsWriter::SqlInsertsWriter(const std::string &table, const std::vector<Column> &columns,
+                                   const sqlide::QuoteVar &quoter)
+  : _table(table),
+    _columns(columns),
+    _separator(", "),
+    _rowsPerStatement(1),
+    _blockSize(1000),
+    _threadCount(std::max(1U, std::thread::hardware_concurrency())) {
+  copy_quoter_settings(quoter, _quoter);
+
+  for (const Column &column : _columns) {
+    ColumnFormatter formatter;
+    formatter.kind = column.quoted ? FormatQuoted : FormatPlain;
+
+    // Mirrors the QuoteVar overloads for string values: blob columns and unknown types which are not stored as
+    // strings are converted differently, anything else ends up quoted and escaped.
+    formatter.escapeStrings = column.quoted && !sqlide::is_var_blob(column.type) &&
+                              (_quoter.store_unknown_as_string || !sqlide::is_var_unknown(column.type));
+    if (column.needQuote) {
+      formatter.stringPrefix = (column.bitMode ? "b" : "") + _quoter.quote;
+      formatter.stringSuffix = _quoter.quote;
+    }
+    _formatters.push_back(formatter);
+  }
+  separator(_separator);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Sets the text written between values and between the rows of a multi-row statement. Default is ", ".
+ */
+void SqlInsertsWriter::separator(const std::string &value) {
+  _separator = value;
+
+  std::string names;
+  for (const Column &column : _columns) {
+    if (!names.empty())
+      names += _separator;
+    names += "`" + column.name + "`";
+  }
+  _statementPrefix = "INSERT INTO " + _table + " (" + names + ") VALUES ";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void SqlInsertsWriter::rowsPerStatement(std::size_t count) {
+  _rowsPerStatement = std::max<std::size_t>(count, 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * The number of rows read from the swap db before they are handed to a worker. It is rounded up to a multiple of
+ * the rows per statement, so that statements never span blocks.
+ */
+void SqlInsertsWriter::blockSize(std::size_t rows) {
+  _blockSize = std::max<std::size_t>(rows, 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * The number of blocks formatted in parallel. With 1 everything happens on the calling thread.
+ */
+void SqlInsertsWriter::threadCount(std::size_t count) {
+  _threadCount = std::max<std::size_t>(count, 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Writes INSERT statements for all rows in the swap db, each terminated by ";\n". The output callback is always
+ * called on the calling thread, with complete statements in row order.
+ *
+ * @returns the number of rows written.
+ */
+std::size_t SqlInsertsWriter::write(const Recordset *recordset, sqlite::connection *data_swap_db,
+                                    const Output &output) const {
+  const std::size_t column_count = _columns.size();
+  if (column_count == 0)
+    return 0;
+
+  const std::size_t partition_count = recordset->data_swap_db_partition_count();
+  std::list<std::shared_ptr<sqlite::query> > data_queries(partition_count);
+  Recordset::prepare_partition_queries(data_swap_db, "select * from `data%s`", data_queries);
+  std::vector<std::shared_ptr<sqlite::result> > data_results(data_queries.size());
+  if (!Recordset::emit_partition_queries(data_swap_db, data_queries, data_results))
+    return 0;
+
+  const std::size_t block_rows = (_blockSize + _rowsPerStatement - 1) / _rowsPerStatement * _rowsPerStatement;
+
+  // Formatted blocks are written in the order they were read. Limiting the number of blocks in flight keeps memory
+  // bounded when the output is slower than the formatting.
+  std::deque<std::future<std::string> > pending;
+  const std::size_t max_pending = _threadCount + 1;
+
+  std::size_t row_count = 0;
+  bool next_row_exists = true;
+  while (next_row_exists) {
+    std::shared_ptr<Block> block(new Block());
+    block->cells.reserve(block_rows * column_count);
+    do {
+      for (std::size_t partition = 0; partition < partition_count; ++partition) {
+        std::shared_ptr<sqlite::result> &data_rs = data_results[partition];
+        for (std::size_t col_begin = partition * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT, col = col_begin,
+                         col_end = std::min<std::size_t>(
+                           column_count, (partition + 1) * Recordset::DATA_SWAP_DB_TABLE_MAX_COL_COUNT);
+             col < col_end; ++col)
+          block->cells.push_back(data_rs->get_variant((int)(col - col_begin)));
+      }
+      ++block->rows;
+
+      for (std::shared_ptr<sqlite::result> &data_rs : data_results)
+        next_row_exists = data_rs->next_row();
+    } while (next_row_exists && block->rows < block_rows);
+    block->last = !next_row_exists;
+    row_count += block->rows;
+
+    if (_threadCount < 2) {
+      output(formatBlock(*block));
+      continue;
+    }
+
+    if (pending.size() >= max_pending) {
+      output(pending.front().get());
+      pending.pop_front();
+    }
+    pending.push_back(std::async(std::launch::async, [this, block]() { return formatBlock(*block); }));
+  }
+
+  while (!pending.empty()) {
+    output(pending.front().get());
+    pending.pop_front();
+  }
+
+  return row_count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::string SqlInsertsWriter::formatBlock(const Block &block) const {
+  // Blocks are formatted in parallel and the visitors aren't thread safe, so each block uses its own.
+  sqlide::QuoteVar quoter;
+  copy_quoter_settings(_quoter, quoter);
+  sqlide::VarToStr var_to_str;
+
+  std::string out;
+  out.reserve(block.rows * (_columns.size() * 8 + 4) + (block.rows / _rowsPerStatement + 1) * _statementPrefix.size());
+
+  const sqlite::variant_t *cell = block.cells.data();
+  for (std::size_t row = 0; row < block.rows; ++row) {
+    out += (row % _rowsPerStatement == 0) ? _statementPrefix : _separator;
+    out += '(';
+    for (std::size_t column = 0; column < _columns.size(); ++column, ++cell) {
+      if (column > 0)
+        out += _separator;
+      appendValue(out, column, *cell, quoter, var_to_str);
+    }
+    out += ')';
+
+    if ((row + 1) % _rowsPerStatement == 0 || (block.last && row + 1 == block.rows))
+      out += ";\n";
+  }
+
+  return out;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void SqlInsertsWriter::appendValue(std::string &out, std::size_t column, const sqlite::variant_t &value,
+                                   sqlide::QuoteVar &quoter, sqlide::VarToStr &var_to_str) const {
+  if (sqlide::is_var_null(value)) {
+    out += _columns[column].nullValue;
+    return;
+  }
+
+  const ColumnFormatter &formatter = _formatters[column];
+  if (const std::string *text = boost::get<std::string>(&value)) {
+    if (formatter.kind == FormatPlain) {
+      out += *text;
+      return;
+    }
+
+    // Values starting with a backslash may be function calls, which only the visitor knows how to handle.
+    if (formatter.escapeStrings && !(quoter.allow_func_escaping && !text->empty() && (*text)[0] == '\\')) {
+      out += formatter.stringPrefix;
+      out += quoter.escape_string(*text);
+      out += formatter.stringSuffix;
+      return;
+    }
+  } else if (const int *number = boost::get<int>(&value)) {
+    out += std::to_string(*number);
+    return;
+  } else if (const std::int64_t *number = boost::get<std::int64_t>(&value)) {
+    out += std::to_string(*number);
+    return;
+  }
+
+  if (formatter.kind == FormatPlain)
+    out += boost::apply_visitor(var_to_str, value);
+  else {
+    quoter.needQuote = _columns[column].needQuote;
+    quoter.bitMode = _columns[column].bitMode;
+    out += boost::apply_visitor(quoter, _columns[column].type, value);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include "wbpublic_public_interface.h"
+#include "sqlide/sqlide_generics.h"
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Recordset;
+
+/**
+ * Generates INSERT statements for all rows of a recordset's data swap db and hands them to an output callback,
+ * in row order and in chunks of many statements, instead of building a statement list in memory.
+ *
+ * Rows are read from the swap db in blocks on the calling thread. Blocks are turned into text on worker threads,
+ * using formatters chosen per column up front (strings go straight through the escape function, integers are
+ * printed directly, everything else is passed to the regular QuoteVar/VarToStr visitors), so the generated text
+ * is the same as when the values are converted one by one.
+ *
+ * Several rows can be combined into a single multi-row INSERT statement.
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC SqlInsertsWriter {
+public:
+  typedef std::function<void(const std::string &)> Output;
+
+  struct Column {
+    std::string name;       // Unquoted, written in backticks.
+    sqlite::variant_t type; // The type passed to the QuoteVar visitor.
+    std::string nullValue;  // Written for NULL values, e.g. "NULL" or "DEFAULT".
+    bool quoted;            // Values are converted with QuoteVar (otherwise with VarToStr).
+    bool needQuote;
+    bool bitMode;
+
+    Column() : quoted(true), needQuote(true), bitMode(false) {
+    }
+  };
+
+  SqlInsertsWriter(const std::string &table, const std::vector<Column> &columns, const sqlide::QuoteVar &quoter);
+
+  void separator(const std::string &value);
+  void rowsPerStatement(std::size_t count);
+  void blockSize(std::size_t rows);
+  void threadCount(std::size_t count);
+
+  std::size_t write(const Recordset *recordset, sqlite::connection *data_swap_db, const Output &output) const;
+
+private:
+  enum FormatterKind { FormatPlain, FormatQuoted };
+
+  struct ColumnFormatter {
+    FormatterKind kind;
+    bool escapeStrings; // String values can be escaped and quoted directly, without the visitor.
+    std::string stringPrefix;
+    std::string stringSuffix;
+  };
+
+  struct Block;
+
+  std::string formatBlock(const Block &block) const;
+  void appendValue(std::string &out, std::size_t column, const sqlite::variant_t &value, sqlide::QuoteVar &quoter,
+                   sqlide::VarToStr &varToStr) const;
+
+  std::string _table;
+  std::vector<Column> _columns;
+  std::vector<ColumnFormatter> _formatters;
+  sqlide::QuoteVar _quoter;
+  std::string _separator;
+  std::string _statementPrefix;
+  std::size_t _rowsPerStatement;
+  std::size_t _blockSize;
+  std::size_t _threadCount;
+};
@@ -151,6 +151,13 @@ namespace sqlide {
     result_type operator()(const std::string &t, const std::string &v) {
       return v;
     }
+    // Integer columns stored natively in the data swap db are presented as text in string typed columns.
+    result_type operator()(const std::string &t, const int &v) {
+      return std::to_string(v);
+    }
+    result_type operator()(const std::string &t, const std::int64_t &v) {
+      return std::to_string(v);
+    }
     template <typename T>
     result_type operator()(const T &t, const std::string &v) {
       T res;
@@ -320,6 +327,13 @@ namespace sqlide {
       }
       return (needQuote ? ((bitMode ? "b" : "" ) + quote) : "") + escape_string(v) + (needQuote ? quote : "");
     }
+    // Integer columns stored natively in the data swap db are quoted like the text they stand for.
+    result_type operator()(const std::string &t, const int &v) const {
+      return operator()(t, std::to_string(v));
+    }
+    result_type operator()(const std::string &t, const std::int64_t &v) const {
+      return operator()(t, std::to_string(v));
+    }
     template <typename T>
     result_type operator()(const T &, const blob_ref_t &v) const {
       return !blob_to_string ? "?" /*bind variable placeholder*/ : blob_to_string(&(*v)[0], v->size());
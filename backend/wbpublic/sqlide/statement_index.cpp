@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "statement_index.h"
+
+#include <algorithm>
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StatementIndex::StatementIndex() {
+  _delimiters.resize(1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void StatementIndex::clear() {
+  _tree.clear();
+  _delimiters.resize(1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the entire content with the given entries, which must be sorted by start offset. Runs in O(n).
+ */
+void StatementIndex::assign(const std::vector<Entry> &entries) {
+  clear();
+  insert(entries);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes all statements starting in the range [from, to) and inserts the given ones instead.
+ * The new entries must be sorted and must all start within that range.
+ */
+void StatementIndex::replace(std::size_t from, std::size_t to, const std::vector<Entry> &entries) {
+  _tree.removeRange(from, to);
+  insert(entries);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::size_t StatementIndex::size() const {
+  return _tree.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool StatementIndex::empty() const {
+  return _tree.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Moves all statements starting at or after the given position. A statement which contains the position
+ * (or ends directly at it) grows by the inserted length.
+ */
+void StatementIndex::textInserted(std::size_t position, std::size_t length) {
+  _tree.shift(position, (std::ptrdiff_t)length);
+
+  std::size_t start;
+  Tree::NodeId last = position > 0 ? _tree.lastAtOrBefore(position - 1, start) : 0;
+  if (last != 0 && start + _tree.value(last).length >= position)
+    _tree.value(last).length += length;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes all statements starting in the removed range, moves those behind it and trims a statement which
+ * overlaps the start of the removed range.
+ */
+void StatementIndex::textRemoved(std::size_t position, std::size_t length) {
+  _tree.removeRange(position, position + length);
+  _tree.shift(position, -(std::ptrdiff_t)length);
+
+  std::size_t start;
+  Tree::NodeId last = position > 0 ? _tree.lastAtOrBefore(position - 1, start) : 0;
+  if (last != 0) {
+    std::size_t end = start + _tree.value(last).length;
+    if (end > position) {
+      end = (end <= position + length) ? position : end - length;
+      _tree.value(last).length = end - start;
+    }
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Determines the statement at the given position (see MySQLEditor::get_current_statement_range for the meaning
+ * of strict). If the position is before the first statement then the first statement is returned.
+ */
+bool StatementIndex::statementAt(std::size_t position, bool strict, Entry &entry) const {
+  if (_tree.empty())
+    return false;
+
+  if (!lastStartingAtOrBefore(position, entry))
+    return firstStartingAtOrAfter(0, entry);
+
+  if (strict && entry.end() < position)
+    return firstStartingAtOrAfter(entry.start + 1, entry);
+
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool StatementIndex::lastStartingAtOrBefore(std::size_t position, Entry &entry) const {
+  std::size_t start;
+  Tree::NodeId found = _tree.lastAtOrBefore(position, start);
+  if (found == 0)
+    return false;
+
+  entry = makeEntry(found, start);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool StatementIndex::firstStartingAtOrAfter(std::size_t position, Entry &entry) const {
+  std::size_t start;
+  Tree::NodeId found = _tree.firstAtOrAfter(position, start);
+  if (found == 0)
+    return false;
+
+  entry = makeEntry(found, start);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Finds the last statement starting at or before the given position, which is preceded by a DELIMITER command.
+ * Uses the per subtree flags to skip parts without delimiter changes.
+ */
+bool StatementIndex::lastDelimiterChangeAtOrBefore(std::size_t position, Entry &entry) const {
+  std::size_t start = 0;
+  Tree::NodeId found = findDelimiterChange(_tree.root(), 0, position, start);
+  if (found == 0)
+    return false;
+
+  entry = makeEntry(found, start);
+  return true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns all statements in order. O(n).
+ */
+std::vector<StatementIndex::Entry> StatementIndex::entries() const {
+  std::vector<Entry> result;
+  result.reserve(_tree.size());
+  _tree.collect(0, std::string::npos,
+                [&](Tree::NodeId node, std::size_t start) { result.push_back(makeEntry(node, start)); });
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns all statements which overlap the range [from, to). O(log n + k).
+ */
+std::vector<StatementIndex::Entry> StatementIndex::entries(std::size_t from, std::size_t to) const {
+  std::vector<Entry> result;
+
+  Entry first;
+  if (lastStartingAtOrBefore(from, first) && first.end() > from)
+    result.push_back(first);
+
+  if (from < to)
+    _tree.collect(from + 1, to,
+                  [&](Tree::NodeId node, std::size_t start) { result.push_back(makeEntry(node, start)); });
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Splits the entire text in one go and replaces the current content with the result.
+ */
+void StatementIndex::split(const char *text, std::size_t length, const Splitter &splitter) {
+  std::vector<Entry> entries;
+  splitter(text, length, ";", entries);
+  findDelimiters(text, 0, entries);
+  assign(entries);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Splits the text again, starting with the statement in front of the dirty range [dirtyStart, dirtyEnd), until a new
+ * statement boundary behind the dirty range coincides with an existing one (with the same active delimiter). From
+ * there on the old (already shifted) boundaries are still valid. The text is processed in windows of 64KB, so that
+ * local edits only touch a few statements, regardless of the script size. A window only grows if not even a single
+ * statement fits into it.
+ *
+ * stop is called before each window and before the result is applied. If it returns true then the index is left
+ * as it is and false is returned. Otherwise [changedStart, changedEnd) is the range in which statements were replaced
+ * (changedEnd is std::string::npos if the split went through to the end of the text).
+ */
+bool StatementIndex::resplit(const char *text, std::size_t length, std::size_t dirtyStart, std::size_t dirtyEnd,
+                             const Splitter &splitter, const std::function<bool()> &stop, std::size_t &changedStart,
+                             std::size_t &changedEnd) {
+  // A statement starting directly at the dirty range may have been merged with the one before it (e.g. when its
+  // delimiter was removed), so the split starts with a statement before the dirty range.
+  std::size_t from = 0;
+  std::size_t gapStart = 0;
+  Entry entry;
+  if (dirtyStart > 0 && lastStartingAtOrBefore(dirtyStart - 1, entry)) {
+    from = std::min(entry.start, length);
+
+    Entry previous;
+    if (from > 0 && lastStartingAtOrBefore(from - 1, previous))
+      gapStart = std::min(previous.end(), from);
+  }
+
+  // The delimiter at the first statement comes from the text, as the edit might have changed the gap before it.
+  std::string delimiter = from > 0 ? delimiterAt(from - 1) : ";";
+  std::string gapDelimiter;
+  if (gapStart < from && findDelimiterCommand(text + gapStart, text + from, gapDelimiter))
+    delimiter = gapDelimiter;
+
+  std::vector<Entry> result;
+  std::size_t position = from;
+  std::size_t window = 64 * 1024;
+  while (true) {
+    if (stop && stop())
+      return false;
+
+    std::size_t to = std::min(length, position + window);
+    bool complete = to == length;
+
+    std::vector<Entry> entries;
+    splitter(text + position, to - position, delimiter, entries);
+
+    // The last statement might have been cut by the window end, so it's only reliable at the end of the text.
+    // Otherwise the next window starts with it.
+    Entry cut;
+    if (!complete && !entries.empty()) {
+      cut = entries.back();
+      cut.start += position;
+      entries.pop_back();
+    }
+
+    if (!complete && entries.empty()) {
+      window *= 4;
+      continue;
+    }
+
+    for (auto &candidate : entries)
+      candidate.start += position;
+    findDelimiters(text, gapStart, entries);
+
+    std::string active = delimiter;
+    for (auto &candidate : entries) {
+      if (!candidate.delimiter.empty())
+        active = candidate.delimiter;
+      result.push_back(candidate);
+
+      if (candidate.start < dirtyEnd)
+        continue;
+
+      Entry old;
+      if (!firstStartingAtOrAfter(candidate.start, old) || old.start != candidate.start)
+        continue;
+      if (delimiterAt(old.start) != active)
+        continue;
+
+      // Found a sync point. Everything up to and including the statement there is replaced by the new entries.
+      if (stop && stop())
+        return false;
+
+      changedStart = from;
+      changedEnd = candidate.start + 1;
+      replace(changedStart, changedEnd, result);
+      return true;
+    }
+
+    if (complete) {
+      if (stop && stop())
+        return false;
+
+      changedStart = from;
+      changedEnd = std::string::npos;
+      replace(changedStart, changedEnd, result);
+      return true;
+    }
+
+    gapStart = entries.back().end();
+    delimiter = active;
+    if (gapStart < cut.start && findDelimiterCommand(text + gapStart, text + cut.start, gapDelimiter))
+      delimiter = gapDelimiter;
+    position = cut.start;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Scans the text between two statements (which can only contain white spaces, comments and DELIMITER commands)
+ * for the last DELIMITER command and returns its new delimiter. Follows the rules of the statement splitter.
+ */
+bool StatementIndex::findDelimiterCommand(const char *begin, const char *end, std::string &delimiter) {
+  static const char keyword[] = "delimiter";
+
+  bool found = false;
+  const char *run = begin;
+  while (run < end) {
+    switch (*run) {
+      case '/':
+        if (run + 1 < end && run[1] == '*') {
+          run += 2;
+          while (run + 1 < end && !(run[0] == '*' && run[1] == '/'))
+            ++run;
+          run += 2;
+        } else
+          ++run;
+        break;
+
+      case '-':
+      case '#':
+        if (*run == '#' || (run + 1 < end && run[1] == '-')) {
+          while (run < end && *run != '\n')
+            ++run;
+        } else
+          ++run;
+        break;
+
+      case 'd':
+      case 'D': {
+        bool isKeyword = (std::size_t)(end - run) > sizeof(keyword) - 1;
+        for (std::size_t i = 0; isKeyword && i < sizeof(keyword) - 1; ++i)
+          isKeyword = (run[i] | 0x20) == keyword[i];
+        if (isKeyword && run[sizeof(keyword) - 1] == ' ') {
+          const char *head = run + sizeof(keyword);
+          run = head;
+          while (run < end && *run != '\n' && *run != '\r')
+            ++run;
+
+          const char *tail = run;
+          while (head < tail && (*head == ' ' || *head == '\t'))
+            ++head;
+          while (tail > head && (tail[-1] == ' ' || tail[-1] == '\t'))
+            --tail;
+          delimiter.assign(head, tail);
+          found = true;
+        } else
+          ++run;
+        break;
+      }
+
+      default:
+        ++run;
+        break;
+    }
+  }
+
+  return found;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void StatementIndex::insert(const std::vector<Entry> &entries) {
+  std::vector<Tree::NodeId> nodes;
+  nodes.reserve(entries.size());
+  for (const Entry &entry : entries) {
+    std::uint32_t delimiter = 0;
+    if (!entry.delimiter.empty()) {
+      delimiter = (std::uint32_t)(std::find(_delimiters.begin() + 1, _delimiters.end(), entry.delimiter) -
+                                  _delimiters.begin());
+      if (delimiter == _delimiters.size())
+        _delimiters.push_back(entry.delimiter);
+    }
+
+    Statement statement = { entry.length, delimiter, delimiter != 0 };
+    nodes.push_back(_tree.create(entry.start, statement));
+  }
+  _tree.insert(nodes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the delimiter which is active for a statement starting at the given position.
+ */
+std::string StatementIndex::delimiterAt(std::size_t position) const {
+  Entry entry;
+  if (lastDelimiterChangeAtOrBefore(position, entry))
+    return entry.delimiter;
+  return ";";
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Scans the gap before each of the given (absolute) entries for DELIMITER commands, starting at gapStart.
+ */
+void StatementIndex::findDelimiters(const char *text, std::size_t gapStart, std::vector<Entry> &entries) {
+  for (auto &entry : entries) {
+    entry.delimiter.clear();
+    if (gapStart < entry.start)
+      findDelimiterCommand(text + gapStart, text + entry.start, entry.delimiter);
+    gapStart = entry.end();
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StatementIndex::Entry StatementIndex::makeEntry(Tree::NodeId node, std::size_t start) const {
+  Entry entry;
+  entry.start = start;
+  entry.length = _tree.node(node).value.length;
+  entry.delimiter = _delimiters[_tree.node(node).value.delimiter];
+  return entry;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+StatementIndex::Tree::NodeId StatementIndex::findDelimiterChange(Tree::NodeId node, std::ptrdiff_t shift,
+                                                                 std::size_t position, std::size_t &start) const {
+  if (node == 0 || !_tree.node(node).value.anyDelimiterChange)
+    return 0;
+
+  const Tree::Node &entry = _tree.node(node);
+  std::size_t nodeStart = entry.position + shift;
+  shift += entry.pendingShift;
+
+  if (nodeStart > position)
+    return findDelimiterChange(entry.left, shift, position, start);
+
+  Tree::NodeId result = findDelimiterChange(entry.right, shift, position, start);
+  if (result != 0)
+    return result;
+
+  if (entry.value.delimiter != 0) {
+    start = nodeStart;
+    return node;
+  }
+
+  return findDelimiterChange(entry.left, shift, position, start);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
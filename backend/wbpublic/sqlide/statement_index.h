@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include "wbpublic_public_interface.h"
+#include "base/position_treap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Keeps the statement boundaries of a (potentially huge) SQL script in a base::PositionTreap, ordered by start
+ * offset. Moving all statements after an edit point is a single O(log n) operation, as are lookups of the statement
+ * at a given position. Ranges can be replaced in bulk, which allows to re-split only the part of a script that
+ * actually changed (see resplit).
+ *
+ * The class is not thread safe. Callers have to synchronize access.
+ */
+class WBPUBLICBACKEND_PUBLIC_FUNC StatementIndex {
+public:
+  struct Entry {
+    std::size_t start;
+    std::size_t length;
+    std::string delimiter; // Set if the gap before this statement contains a DELIMITER command (the new delimiter).
+
+    std::size_t end() const {
+      return start + length;
+    }
+  };
+
+  // Splits the given text into statements, starting with the given delimiter. Entry offsets are relative to text,
+  // delimiters are determined by the index itself.
+  typedef std::function<void(const char *text, std::size_t length, const std::string &delimiter,
+                             std::vector<Entry> &entries)>
+    Splitter;
+
+  StatementIndex();
+
+  void clear();
+  void assign(const std::vector<Entry> &entries);
+  void replace(std::size_t from, std::size_t to, const std::vector<Entry> &entries);
+
+  std::size_t size() const;
+  bool empty() const;
+
+  void textInserted(std::size_t position, std::size_t length);
+  void textRemoved(std::size_t position, std::size_t length);
+
+  bool statementAt(std::size_t position, bool strict, Entry &entry) const;
+  bool lastStartingAtOrBefore(std::size_t position, Entry &entry) const;
+  bool firstStartingAtOrAfter(std::size_t position, Entry &entry) const;
+  bool lastDelimiterChangeAtOrBefore(std::size_t position, Entry &entry) const;
+
+  std::vector<Entry> entries() const;
+  std::vector<Entry> entries(std::size_t from, std::size_t to) const;
+
+  void split(const char *text, std::size_t length, const Splitter &splitter);
+  bool resplit(const char *text, std::size_t length, std::size_t dirtyStart, std::size_t dirtyEnd,
+               const Splitter &splitter, const std::function<bool()> &stop, std::size_t &changedStart,
+               std::size_t &changedEnd);
+
+  static bool findDelimiterCommand(const char *begin, const char *end, std::string &delimiter);
+
+private:
+  struct Statement {
+    std::size_t length;
+    std::uint32_t delimiter; // Index into the delimiter table, 0 if the delimiter doesn't change here.
+    bool anyDelimiterChange; // Aggregate over the entire subtree.
+  };
+
+  struct DelimiterAggregate {
+    void operator()(Statement &statement, const Statement &left, const Statement &right) const {
+      statement.anyDelimiterChange = statement.delimiter != 0 || left.anyDelimiterChange || right.anyDelimiterChange;
+    }
+  };
+
+  typedef base::PositionTreap<Statement, DelimiterAggregate> Tree;
+
+  Tree _tree;
+  std::vector<std::string> _delimiters;
+
+  void insert(const std::vector<Entry> &entries);
+  std::string delimiterAt(std::size_t position) const;
+  static void findDelimiters(const char *text, std::size_t gapStart, std::vector<Entry> &entries);
+  Entry makeEntry(Tree::NodeId node, std::size_t start) const;
+  Tree::NodeId findDelimiterChange(Tree::NodeId node, std::ptrdiff_t shift, std::size_t position,
+                                   std::size_t &start) const;
+};
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "sqlide/analysis_executor.h"
+#include "grtsqlparser/mysql_parser_services.h"
+
+#include "wb_helpers.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+BEGIN_TEST_DATA_CLASS(analysis_executor_test)
+protected:
+  WBTester *_tester; // Loads the parser module.
+
+  TEST_DATA_CONSTRUCTOR(analysis_executor_test) {
+    _tester = new WBTester;
+  }
+END_TEST_DATA_CLASS
+
+TEST_MODULE(analysis_executor_test, "Analysis executor tests");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  // Waiting tasks of the same owner and kind are replaced by newer ones, other kinds are kept.
+  AnalysisExecutor executor(2);
+  int owner = 0;
+  std::atomic<int> lastRun(0);
+  std::atomic<int> runs(0);
+  std::atomic<int> otherRuns(0);
+
+  for (int i = 1; i <= 100; ++i)
+    executor.submit(&owner, 0, [&, i](const base::CancellationToken &) {
+      lastRun = i;
+      ++runs;
+    }, AnalysisExecutor::PriorityNormal, 0.1);
+  executor.submit(&owner, 1, [&](const base::CancellationToken &) { ++otherRuns; });
+
+  executor.waitForIdle();
+  ensure_equals("runs", runs.load(), 1);
+  ensure_equals("last run", lastRun.load(), 100);
+  ensure_equals("other runs", otherRuns.load(), 1);
+
+  AnalysisExecutor::Statistics statistics = executor.statistics();
+  ensure_equals("submitted", statistics.submitted, 101U);
+  ensure_equals("replaced", statistics.replaced, 99U);
+  ensure_equals("completed", statistics.completed, 2U);
+  ensure("latency", statistics.maxLatency >= statistics.averageLatency && statistics.averageLatency > 0);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  // A running task is cancelled by a newer one, which only starts after the old one returned.
+  AnalysisExecutor executor(4);
+  int owner = 0;
+  std::atomic<int> active(0);
+  std::atomic<int> maxActive(0);
+  std::atomic<bool> firstCancelled(false);
+  std::atomic<bool> started(false);
+
+  executor.submit(&owner, 0, [&](const base::CancellationToken &token) {
+    int count = ++active;
+    if (count > maxActive)
+      maxActive = count;
+    started = true;
+    while (!token.isCancelled())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    firstCancelled = true;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    --active;
+  });
+
+  while (!started)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  executor.submit(&owner, 0, [&](const base::CancellationToken &) {
+    int count = ++active;
+    if (count > maxActive)
+      maxActive = count;
+    --active;
+  });
+
+  executor.waitForIdle();
+  ensure("first cancelled", firstCancelled);
+  ensure_equals("never in parallel", maxActive.load(), 1);
+  ensure_equals("cancelled", executor.statistics().cancelled, 1U);
+  ensure_equals("completed", executor.statistics().completed, 1U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(3) {
+  // Priorities determine the start order of due tasks. Cancelling an owner waits for its running task.
+  AnalysisExecutor executor(1);
+  int blocker = 0;
+  int owners[3];
+  std::vector<int> order;
+  std::atomic<bool> release(false);
+
+  executor.submit(&blocker, 0, [&](const base::CancellationToken &) {
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Let the blocker start.
+
+  executor.submit(&owners[0], 0, [&](const base::CancellationToken &) { order.push_back(0); },
+                  AnalysisExecutor::PriorityLow);
+  executor.submit(&owners[1], 0, [&](const base::CancellationToken &) { order.push_back(1); },
+                  AnalysisExecutor::PriorityHigh);
+  executor.submit(&owners[2], 0, [&](const base::CancellationToken &) { order.push_back(2); });
+  release = true;
+
+  executor.waitForIdle();
+  ensure_equals("task count", order.size(), 3U);
+  ensure_equals("first", order[0], 1);
+  ensure_equals("second", order[1], 2);
+  ensure_equals("third", order[2], 0);
+
+  std::atomic<bool> returned(false);
+  std::atomic<bool> running(false);
+  executor.submit(&blocker, 0, [&](const base::CancellationToken &token) {
+    running = true;
+    while (!token.isCancelled())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    returned = true;
+  });
+  while (!running)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  executor.cancel(&blocker);
+  ensure("returned", returned);
+  ensure_equals("nothing pending", executor.pendingCount(), 0U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(4) {
+  // Typing into a 100k line script with a syntax check after each key stroke, as the editor does it: the check
+  // which is running is cancelled and waited for, then the text is changed and the check for the new text is
+  // submitted. The text is not locked, cancel() must not return while a check still reads it. Only the check of the
+  // final text may produce a result, and it must cover the entire script.
+  parsers::MySQLParserServices::Ref services = parsers::MySQLParserServices::get();
+  parsers::MySQLParserContext::Ref context =
+    services->createParserContext(_tester->get_rdbms()->characterSets(), _tester->get_rdbms()->version(), "", false);
+
+  std::string script;
+  const std::size_t lineCount = 100000;
+  for (std::size_t i = 0; i < lineCount; ++i)
+    script += "SELECT a, b, c FROM some_table WHERE id = " + std::to_string(i) + ";\n";
+
+  AnalysisExecutor executor(1);
+  int editor = 0;
+  std::mutex resultLock;
+  std::vector<std::size_t> resultVersions;
+  std::vector<std::size_t> checkedCounts;
+  std::size_t errorCount = 0;
+  std::size_t statementCount = 0;
+
+  auto check = [&](std::size_t version, const base::CancellationToken &token) {
+    std::vector<parsers::StatementRange> ranges;
+    services->determineStatementRanges(script.c_str(), script.size(), ";", ranges);
+    std::vector<parsers::ParserErrorInfo> errors;
+    std::size_t checked =
+      services->checkSqlSyntax(context, script.c_str(), ranges, MySQLParseUnit::PuGeneric, token, errors);
+
+    std::lock_guard<std::mutex> resultGuard(resultLock);
+    checkedCounts.push_back(checked);
+    if (!token.isCancelled()) {
+      resultVersions.push_back(version);
+      errorCount = errors.size();
+      statementCount = ranges.size();
+    }
+  };
+
+  // The first check only gets to the parser after it was cancelled, which must then check nothing.
+  std::atomic<bool> started(false);
+  executor.submit(&editor, 0, [&](const base::CancellationToken &token) {
+    started = true;
+    while (!token.isCancelled())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    check(1, token);
+  });
+  while (!started)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  // Keep the only worker busy with another owner's task, so that the following checks all wait in the queue.
+  std::atomic<bool> release(false);
+  std::atomic<bool> blocking(false);
+  int other = 0;
+  executor.cancel(&editor, 0);
+  {
+    std::lock_guard<std::mutex> resultGuard(resultLock);
+    ensure_equals("cancelled check returned", checkedCounts.size(), 1U);
+  }
+  executor.submit(&other, 0, [&](const base::CancellationToken &) {
+    blocking = true;
+    while (!release)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  while (!blocking)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  const std::size_t keyStrokes = 100;
+  for (std::size_t version = 2; version <= keyStrokes; ++version) {
+    executor.cancel(&editor, 0);
+    script += (version == keyStrokes) ? "SELEC 1;\n" : " ";
+    executor.submit(&editor, 0, [&, version](const base::CancellationToken &token) { check(version, token); });
+  }
+  ensure_equals("one check waiting", executor.pendingCount(), 1U);
+
+  release = true;
+  executor.waitForIdle();
+
+  ensure_equals("checks which ran", checkedCounts.size(), 2U);
+  ensure_equals("cancelled check", checkedCounts[0], 0U);
+  ensure_equals("results", resultVersions.size(), 1U);
+  ensure_equals("result of the final text", resultVersions[0], keyStrokes);
+  ensure_equals("statements checked", checkedCounts[1], statementCount);
+  ensure_equals("statement count", statementCount, lineCount + 1);
+  ensure("syntax error of the last statement", errorCount > 0);
+
+  AnalysisExecutor::Statistics statistics = executor.statistics();
+  ensure_equals("submitted", statistics.submitted, keyStrokes + 1);
+  ensure_equals("completed", statistics.completed, 2U); // The blocker and the final check.
+  ensure_equals("cancelled", statistics.cancelled, keyStrokes - 1);
+  ensure_equals("replaced", statistics.replaced, 0U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+// Due to the tut nature, this must be executed as a last test always,
+// we can't have this inside of the d-tor.
+TEST_FUNCTION(99) {
+  delete _tester;
+}
+
+END_TESTS
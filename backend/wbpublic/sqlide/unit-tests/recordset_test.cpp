@@ -25,12 +25,20 @@
 #include <sstream>
 #endif
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "base/string_utilities.h"
 #include "sqlide/recordset_cdbc_storage.h"
+#include "sqlide/recordset_sql_storage.h"
 #include "sqlide/recordset_be.h"
 #include "connection_helpers.h"
 #include "cppdbc.h"
 #include "wb_helpers.h"
 
+#define VERBOSE_OUTPUT 0
+
 BEGIN_TEST_DATA_CLASS(recordset)
 public:
 WBTester *wbt;
@@ -38,6 +46,34 @@ sql::Dbc_connection_handler::Ref dbc_conn;
 TEST_DATA_CONSTRUCTOR(recordset) {
   wbt = new WBTester;
 }
+
+Recordset::Ref createRecordset(const std::string &query, const std::string &schema = "",
+                               const std::string &table = "") {
+  Recordset_cdbc_storage::Ref data_storage(Recordset_cdbc_storage::create());
+  data_storage->schema_name(schema);
+  data_storage->table_name(table);
+  data_storage->setUserConnectionGetter(
+    [this](sql::Dbc_connection_handler::Ref &conn, bool LockOnly = false) -> base::RecMutexLock {
+      base::RecMutexLock lock(_connLock, false);
+      conn = dbc_conn;
+      return lock;
+    });
+
+  Recordset::Ref rs = Recordset::create();
+  rs->data_storage(data_storage);
+
+  std::shared_ptr<sql::Statement> dbc_statement(dbc_conn->ref->createStatement());
+  dbc_statement->execute(query);
+
+  std::shared_ptr<sql::ResultSet> rset(dbc_statement->getResultSet());
+  data_storage->dbc_resultset(rset);
+
+  rs->reset(true);
+  return rs;
+}
+
+private:
+base::RecMutex _connLock;
 END_TEST_DATA_CLASS
 
 TEST_MODULE(recordset, "Recordset");
@@ -84,6 +120,331 @@ TEST_FUNCTION(2) {
   ensure("NULL blob is NULL", rs->is_field_null(0, 1));
 }
 
+TEST_FUNCTION(3) {
+  // Integer columns are stored natively in the data swap db, but must still be presented as text.
+  Recordset::Ref rs = createRecordset(
+    "select -1, cast(255 as unsigned), cast(-9223372036854775808 as signed), 18446744073709551615, null + 1, 1.5");
+
+  std::string value;
+  ensure("get field 0", rs->get_field(0, 0, value));
+  ensure_equals("negative int", value, "-1");
+  rs->get_field(0, 1, value);
+  ensure_equals("unsigned int", value, "255");
+  rs->get_field(0, 2, value);
+  ensure_equals("bigint min", value, "-9223372036854775808");
+  rs->get_field(0, 3, value);
+  ensure_equals("unsigned bigint max", value, "18446744073709551615");
+  ensure("NULL int is NULL", rs->is_field_null(0, 4));
+  rs->get_field(0, 5, value);
+  ensure_equals("decimal", value, "1.5");
+}
+
+TEST_FUNCTION(4) {
+  // Benchmark: 1M rows x 50 integer columns, generated on the server from a digits table. Times storing the result
+  // in the data swap db, reading all cells as text and as integers and sorting on a column. Set VERBOSE_OUTPUT to
+  // see the timings.
+  std::string digits = "(select 0 d union all select 1 union all select 2 union all select 3 union all select 4 "
+                       "union all select 5 union all select 6 union all select 7 union all select 8 union all select 9)";
+  std::string query = "select ";
+  for (int i = 0; i < 50; ++i)
+    query += (i > 0 ? ", " : "") + std::string("t1.d + t2.d * 10 + t3.d * 100 + t4.d * 1000 + t5.d * 10000 + ") +
+             "t6.d * 100000 + " + std::to_string(i);
+  query += " from ";
+  for (int i = 1; i <= 6; ++i)
+    query += (i > 1 ? ", " : "") + digits + " t" + std::to_string(i);
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  Recordset::Ref rs = createRecordset(query);
+  ensure_equals("row count", rs->row_count(), 1000000U);
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+#endif
+
+  std::int64_t sum = 0;
+  std::string value;
+  for (size_t row = 0; row < rs->row_count(); ++row)
+    for (ColumnId column = 0; column < 50; ++column)
+      if (rs->get_field(row, column, value))
+        sum += std::stoll(value);
+
+  // each column holds 0..999999 shifted by its column index
+  const std::int64_t expected_sum = (std::int64_t)50 * 499999500000LL + (std::int64_t)1000000 * (49 * 50 / 2);
+  ensure_equals("sum", sum, expected_sum);
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+#endif
+
+  std::int64_t int_sum = 0;
+  ssize_t int_value;
+  for (size_t row = 0; row < rs->row_count(); ++row)
+    for (ColumnId column = 0; column < 50; ++column)
+      if (rs->get_field(row, column, int_value))
+        int_sum += int_value;
+  ensure_equals("integer sum", int_sum, expected_sum);
+
+#if VERBOSE_OUTPUT
+  test_time_point t4;
+#endif
+
+  rs->sort_by(7, -1, false);
+  ensure("sorted", rs->get_field(0, 7, value));
+  ensure_equals("largest value first", value, "1000006");
+
+#if VERBOSE_OUTPUT
+  test_time_point t5;
+  std::cout << "Recordset: 1M x 50 integer columns stored in " << (t2 - t1) << ", read as text in " << (t3 - t2)
+            << ", read as integers in " << (t4 - t3) << ", sorted in " << (t5 - t4) << std::endl;
+#endif
+}
+
+TEST_FUNCTION(5) {
+  // Simulates scrolling a 40 rows high grid through 100k rows x 20 columns, one row per frame, repainting all
+  // visible cells each frame.
+  std::string digits = "(select 0 d union all select 1 union all select 2 union all select 3 union all select 4 "
+                       "union all select 5 union all select 6 union all select 7 union all select 8 union all select 9)";
+  std::string query = "select ";
+  for (int i = 0; i < 20; ++i)
+    query += (i > 0 ? ", " : "") + std::string("concat('value ', t1.d + t2.d * 10 + t3.d * 100 + t4.d * 1000 + ") +
+             "t5.d * 10000, ' ', " + std::to_string(i) + ")";
+  query += " from ";
+  for (int i = 1; i <= 5; ++i)
+    query += (i > 1 ? ", " : "") + digits + " t" + std::to_string(i);
+
+  Recordset::Ref rs = createRecordset(query);
+  ensure_equals("row count", rs->row_count(), 100000U);
+
+  const size_t visible_rows = 40;
+  const size_t frames = rs->row_count() - visible_rows;
+  std::string value;
+  size_t painted = 0;
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  const std::string *repr;
+  for (size_t top = 0; top < frames; ++top) {
+    base::RecMutexLock lock(rs->read_lock());
+    for (size_t row = top; row < top + visible_rows; ++row)
+      for (ColumnId column = 0; column < 20; ++column)
+        if (rs->get_field_repr_ref(row, column, repr, value) && !repr->empty())
+          ++painted;
+  }
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+#endif
+
+  // Same scrolling through the NodeId based API.
+  for (size_t top = 0; top < frames; ++top)
+    for (size_t row = top; row < top + visible_rows; ++row)
+      for (ColumnId column = 0; column < 20; ++column)
+        rs->get_field_repr(bec::NodeId(row), column, value);
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+  std::cout << "Recordset: scrolled " << frames << " frames (" << painted << " cells) in " << (t2 - t1)
+            << " by reference, in " << (t3 - t2) << " by node id" << std::endl;
+#endif
+
+  ensure_equals("painted cells", painted, frames * visible_rows * 20);
+  {
+    // Text shown as is isn't copied, neither into the cache nor into the buffer.
+    base::RecMutexLock lock(rs->read_lock());
+    ensure("cell reference", rs->get_field_repr_ref(12345, 7, repr, value));
+    ensure("no copy", repr != &value);
+    ensure("cell text reference", repr->compare(0, 6, "value ") == 0);
+  }
+  ensure("cell read", rs->get_field_repr(12345, 7, value));
+  ensure("cell text", value.compare(0, 6, "value ") == 0 && value.compare(value.size() - 2, 2, " 7") == 0);
+}
+
+TEST_FUNCTION(6) {
+  // 100k rows exported as INSERT statements, one row and 100 rows per statement.
+  std::string digits = "(select 0 d union all select 1 union all select 2 union all select 3 union all select 4 "
+                       "union all select 5 union all select 6 union all select 7 union all select 8 union all select 9)";
+  std::string n = "(t1.d + t2.d * 10 + t3.d * 100 + t4.d * 1000 + t5.d * 10000)";
+  std::string query = "select " + n + " n, concat('value ', " + n + ", '''s') s, if(" + n + " % 3 = 0, null, " + n +
+                      ") m from ";
+  for (int i = 1; i <= 5; ++i)
+    query += (i > 1 ? ", " : "") + digits + " t" + std::to_string(i);
+  query += " order by n";
+
+  Recordset::Ref rs = createRecordset(query);
+  ensure_equals("row count", rs->row_count(), 100000U);
+
+  Recordset_sql_storage::Ref storage = Recordset_sql_storage::create();
+  storage->table_name("t");
+  storage->omit_schema_qualifier(true);
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  storage->serialize(rs);
+  std::string single_rows = storage->sql_script();
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+#endif
+
+  storage->rows_per_statement(100);
+  storage->serialize(rs);
+  std::string multi_rows = storage->sql_script();
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+  std::cout << "Recordset: exported 100k rows as INSERTs (" << single_rows.size() << " bytes) in " << (t2 - t1)
+            << ", with 100 rows per statement in " << (t3 - t2) << std::endl;
+#endif
+
+  std::string prefix = "INSERT INTO `t` (`n`, `s`, `m`) VALUES ";
+  std::string first_row = "(0, 'value 0''s', NULL)";
+  std::string last_row = "(99999, 'value 99999''s', NULL);\n";
+
+  ensure_equals("statement count", (size_t)std::count(single_rows.begin(), single_rows.end(), '\n'), 100000U);
+  ensure_equals("first statement", single_rows.substr(0, prefix.size() + first_row.size() + 2),
+                prefix + first_row + ";\n");
+  ensure_equals("last statement", single_rows.substr(single_rows.size() - last_row.size()), last_row);
+
+  // Rows are separated by ", " instead of ";\n" followed by the statement prefix.
+  ensure_equals("multi-row statement count", (size_t)std::count(multi_rows.begin(), multi_rows.end(), '\n'), 1000U);
+  ensure_equals("multi-row size", multi_rows.size(), single_rows.size() - 99000 * prefix.size());
+  ensure_equals("multi-row start", multi_rows.substr(0, prefix.size() + first_row.size() + 2),
+                prefix + first_row + ", ");
+  ensure_equals("multi-row end", multi_rows.substr(multi_rows.size() - last_row.size()), last_row);
+}
+
+TEST_FUNCTION(7) {
+  // Sorting, filtering and editing of integer columns must work as they did when their values were stored as text.
+  std::shared_ptr<sql::Statement> statement(dbc_conn->ref->createStatement());
+  statement->execute("DROP SCHEMA IF EXISTS recordset_test");
+  statement->execute("CREATE SCHEMA recordset_test");
+  statement->execute("CREATE TABLE recordset_test.numbers (id INT PRIMARY KEY, n INT, label VARCHAR(10))");
+  statement->execute("INSERT INTO recordset_test.numbers VALUES (1, 10, '10'), (2, 9, '9'), (3, 100, '100'), "
+                     "(4, -5, '-5')");
+
+  Recordset::Ref rs =
+    createRecordset("SELECT * FROM recordset_test.numbers ORDER BY id", "recordset_test", "numbers");
+  ensure_equals("row count", rs->row_count(), 4U);
+
+  // Numeric order, not the lexical one.
+  std::string value;
+  const char *sorted[] = {"-5", "9", "10", "100"};
+  rs->sort_by(1, 1, false);
+  for (size_t row = 0; row < 4; ++row) {
+    rs->get_field(row, 1, value);
+    ensure_equals("sorted value", value, sorted[row]);
+  }
+  rs->sort_by(1, 0, false);
+
+  // Filters match the text of the number.
+  rs->set_column_filter(1, "1%");
+  ensure_equals("rows matching filter", rs->row_count(), 2U);
+  rs->reset_column_filters();
+  rs->set_data_search_string("-5");
+  ensure_equals("rows matching search", rs->row_count(), 1U);
+  rs->set_data_search_string("");
+  ensure_equals("rows without filter", rs->row_count(), 4U);
+
+  // Setting the same text is no change, another one is applied as text, with the key quoted as before.
+  rs->get_field(0, 1, value);
+  ensure_equals("first value", value, "10");
+  ensure("same value is no change", !rs->set_field(0, 1, std::string("10")));
+  ensure("changed value", rs->set_field(0, 1, std::string("11")));
+  rs->get_field(0, 1, value);
+  ensure_equals("edited value", value, "11");
+
+  Recordset_sql_storage::Ref storage = std::dynamic_pointer_cast<Recordset_sql_storage>(rs->data_storage());
+  storage->init_sql_script_substitute(rs, true);
+  const Sql_script &script = storage->sql_script_substitute();
+  ensure_equals("statement count", script.statements.size(), 1U);
+  ensure_equals("update", script.statements.front(),
+                "UPDATE `recordset_test`.`numbers` SET `n` = '11' WHERE (`id` = '1')");
+
+  statement->execute("DROP SCHEMA recordset_test");
+}
+
+// Applies a multi-row INSERT with a duplicate key in the middle, and the same row again at the end, and returns the
+// positions of the failing statements.
+static std::vector<size_t> apply_batch_with_bad_rows(Recordset::Ref rs, bool skip_commit) {
+  Recordset_sql_storage::Ref storage = std::dynamic_pointer_cast<Recordset_sql_storage>(rs->data_storage());
+  Sql_script script;
+  for (int id : {1, 2, 3, 4, 5, 3}) {
+    Sql_script::Statement_batch_part part;
+    part.statement = script.statements.size();
+    part.prefix = "INSERT INTO `recordset_test`.`batch` (`id`, `v`) VALUES ";
+    part.values = "(" + std::to_string(id) + ", " + std::to_string(id * 10) + ")";
+    script.statements.push_back(part.prefix + part.values);
+    script.statements_bindings.push_back(Sql_script::Statement_bindings());
+    script.statements_batch_parts.push_back(part);
+  }
+  storage->sql_script_substitute(script);
+  storage->is_sql_script_substitute_enabled(true);
+
+  std::vector<size_t> failed;
+  boost::signals2::scoped_connection error_connection(
+    storage->on_sql_script_run_statement_error.connect([&failed](size_t statement) {
+      failed.push_back(statement);
+      return 0;
+    }));
+  try {
+    storage->apply_changes(rs, skip_commit);
+    fail("apply succeeded despite the duplicate key");
+  } catch (std::runtime_error &e) {
+    ensure("error count reported", std::string(e.what()).find("2 error(s)") != std::string::npos);
+  }
+  storage->is_sql_script_substitute_enabled(false);
+  return failed;
+}
+
+static std::string batch_table_content(sql::Dbc_connection_handler::Ref conn) {
+  std::unique_ptr<sql::Statement> statement(conn->ref->createStatement());
+  std::unique_ptr<sql::ResultSet> rset(statement->executeQuery("SELECT id, v FROM recordset_test.batch ORDER BY id"));
+  std::string content;
+  while (rset->next())
+    content += base::strfmt("(%i, %i)", rset->getInt(1), rset->getInt(2));
+  return content;
+}
+
+TEST_FUNCTION(8) {
+  // A row that fails inside a batch must not take the other rows of the batch with it and must be reported by its
+  // position, even if another statement has the same text. In autocommit mode (the default of the editor connection)
+  // the apply runs in a transaction of its own and nothing is applied if a row fails.
+  std::shared_ptr<sql::Statement> statement(dbc_conn->ref->createStatement());
+  statement->execute("DROP SCHEMA IF EXISTS recordset_test");
+  statement->execute("CREATE SCHEMA recordset_test");
+  statement->execute("CREATE TABLE recordset_test.batch (id INT PRIMARY KEY, v INT)");
+  statement->execute("INSERT INTO recordset_test.batch VALUES (3, 0)");
+
+  Recordset::Ref rs = createRecordset("SELECT * FROM recordset_test.batch", "recordset_test", "batch");
+
+  ensure("autocommit mode", dbc_conn->ref->getAutoCommit());
+  std::vector<size_t> failed = apply_batch_with_bad_rows(rs, false);
+  ensure_equals("failed rows in autocommit mode", failed.size(), 2U);
+  ensure_equals("first failed row in autocommit mode", failed[0], 2U);
+  ensure_equals("second failed row in autocommit mode", failed[1], 5U);
+  ensure_equals("rows applied in autocommit mode", batch_table_content(dbc_conn), "(3, 0)");
+  ensure("autocommit mode after apply", dbc_conn->ref->getAutoCommit());
+
+  dbc_conn->ref->setAutoCommit(false);
+  failed = apply_batch_with_bad_rows(rs, true);
+  ensure_equals("failed rows in transaction", failed.size(), 2U);
+  ensure_equals("first failed row in transaction", failed[0], 2U);
+  ensure_equals("second failed row in transaction", failed[1], 5U);
+  ensure_equals("rows applied in transaction", batch_table_content(dbc_conn), "(1, 10)(2, 20)(3, 0)(4, 40)(5, 50)");
+  dbc_conn->ref->rollback();
+  dbc_conn->ref->setAutoCommit(true);
+  ensure_equals("rows after rollback", batch_table_content(dbc_conn), "(3, 0)");
+
+  statement->execute("DROP SCHEMA recordset_test");
+}
+
 // Due to the tut nature, this must be executed as a last test always,
 // we can't have this inside of the d-tor.
 TEST_FUNCTION(99) {
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "sqlide/statement_index.h"
+
+#include "wb_helpers.h"
+
+#include <cstring>
+
+#define VERBOSE_OUTPUT 0
+
+BEGIN_TEST_DATA_CLASS(statement_index_test)
+protected:
+  StatementIndex index;
+
+  std::vector<StatementIndex::Entry> makeEntries(std::size_t count, std::size_t length, std::size_t gap) {
+    std::vector<StatementIndex::Entry> result;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+      StatementIndex::Entry entry = { start, length, "" };
+      result.push_back(entry);
+      start += length + gap;
+    }
+    return result;
+  }
+
+  // What StatementIndex::textInserted() and textRemoved() do, the simple way.
+  static void insertText(std::vector<StatementIndex::Entry> &entries, std::size_t position, std::size_t length) {
+    StatementIndex::Entry *last = nullptr;
+    for (auto &entry : entries) {
+      if (entry.start >= position)
+        entry.start += length;
+      else
+        last = &entry;
+    }
+    if (last != nullptr && last->end() >= position)
+      last->length += length;
+  }
+
+  static void removeText(std::vector<StatementIndex::Entry> &entries, std::size_t position, std::size_t length) {
+    std::vector<StatementIndex::Entry> result;
+    for (auto entry : entries) {
+      if (entry.start >= position + length)
+        entry.start -= length;
+      else if (entry.start >= position)
+        continue;
+      result.push_back(entry);
+    }
+    entries.swap(result);
+
+    StatementIndex::Entry *last = nullptr;
+    for (auto &entry : entries)
+      if (entry.start < position)
+        last = &entry;
+    if (last != nullptr && last->end() > position) {
+      std::size_t end = (last->end() <= position + length) ? position : last->end() - length;
+      last->length = end - last->start;
+    }
+  }
+
+  // A minimal statement splitter for the resplit tests (the real one lives in the parser module). Statements end
+  // at the current delimiter, lines starting with "DELIMITER " change the delimiter.
+  static void splitText(const char *text, std::size_t length, const std::string &delimiter,
+                        std::vector<StatementIndex::Entry> &entries) {
+    std::string current = delimiter;
+    std::size_t position = 0;
+    while (position < length) {
+      while (position < length && (text[position] == ' ' || text[position] == '\n'))
+        ++position;
+      if (position == length)
+        break;
+
+      if (length - position > 10 && strncmp(text + position, "DELIMITER ", 10) == 0) {
+        std::size_t head = position + 10;
+        position = head;
+        while (position < length && text[position] != '\n')
+          ++position;
+
+        std::size_t tail = position;
+        while (head < tail && text[head] == ' ')
+          ++head;
+        while (tail > head && text[tail - 1] == ' ')
+          --tail;
+        if (head < tail)
+          current.assign(text + head, tail - head);
+        continue;
+      }
+
+      const char *found = std::search(text + position, text + length, current.begin(), current.end());
+      StatementIndex::Entry entry = { position, (std::size_t)(found - text) - position, "" };
+      entries.push_back(entry);
+      position = entry.end() + current.size();
+    }
+  }
+
+  // Applies an edit to the text and the index and extends the dirty range, like MySQLEditor does.
+  void editText(std::string &text, std::size_t position, std::size_t length, const std::string &insert,
+                std::size_t &dirtyStart, std::size_t &dirtyEnd) {
+    std::size_t end = position;
+    if (insert.empty()) {
+      text.erase(position, length);
+      index.textRemoved(position, length);
+      if (dirtyEnd >= position + length)
+        dirtyEnd -= length;
+      else if (dirtyEnd > position)
+        dirtyEnd = position;
+    } else {
+      text.insert(position, insert);
+      index.textInserted(position, insert.size());
+      if (dirtyEnd >= position)
+        dirtyEnd += insert.size();
+      end = position + insert.size();
+    }
+    dirtyStart = std::min(dirtyStart, position);
+    dirtyEnd = std::max(dirtyEnd, end);
+  }
+
+  // Compares the index with a full split of the text.
+  void checkSplit(const std::string &text, const std::string &message) {
+    StatementIndex expected;
+    expected.split(text.c_str(), text.size(), splitText);
+
+    std::vector<StatementIndex::Entry> expectedEntries = expected.entries();
+    std::vector<StatementIndex::Entry> actualEntries = index.entries();
+    ensure_equals(message + " count", actualEntries.size(), expectedEntries.size());
+    for (std::size_t i = 0; i < actualEntries.size(); ++i) {
+      ensure_equals(message + " start", actualEntries[i].start, expectedEntries[i].start);
+      ensure_equals(message + " length", actualEntries[i].length, expectedEntries[i].length);
+      ensure_equals(message + " delimiter", actualEntries[i].delimiter, expectedEntries[i].delimiter);
+    }
+  }
+
+  bool resplit(const std::string &text, std::size_t dirtyStart, std::size_t dirtyEnd, std::size_t &changedStart,
+               std::size_t &changedEnd) {
+    return index.resplit(text.c_str(), text.size(), dirtyStart, dirtyEnd, splitText, nullptr, changedStart,
+                         changedEnd);
+  }
+
+  static std::string makeScript(std::size_t count, bool withProcedures = true) {
+    std::string result;
+    for (std::size_t i = 0; i < count; ++i) {
+      if (withProcedures && i % 1000 == 500)
+        result += "DELIMITER $$\nCREATE PROCEDURE p() BEGIN SELECT 1; END$$\nDELIMITER ;\n";
+      result += "SELECT " + std::to_string(i) + " FROM t;\n";
+    }
+    return result;
+  }
+END_TEST_DATA_CLASS
+
+TEST_MODULE(statement_index_test, "Statement index tests");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  // Lookups on a freshly assigned index (10 statements of 9 chars, separated by 1 char).
+  index.assign(makeEntries(10, 9, 1));
+  ensure_equals("count", index.size(), 10U);
+
+  StatementIndex::Entry entry;
+  ensure("lookup 1", index.statementAt(25, false, entry));
+  ensure_equals("lookup 1 start", entry.start, 20U);
+
+  ensure("lookup 2", index.statementAt(29, false, entry));
+  ensure_equals("lookup 2 start", entry.start, 20U);
+
+  ensure("lookup 3", index.statementAt(29, true, entry));
+  ensure_equals("lookup 3 start", entry.start, 20U); // Directly at the end still counts as within.
+
+  ensure("first after", index.firstStartingAtOrAfter(21, entry));
+  ensure_equals("first after start", entry.start, 30U);
+
+  ensure("last before", index.lastStartingAtOrBefore(99, entry));
+  ensure_equals("last before start", entry.start, 90U);
+
+  ensure("nothing after", !index.firstStartingAtOrAfter(91, entry));
+
+  std::vector<StatementIndex::Entry> range = index.entries(15, 35);
+  ensure_equals("range count", range.size(), 3U);
+  ensure_equals("range first", range[0].start, 10U);
+  ensure_equals("range last", range[2].start, 30U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  // Text edits move the boundaries.
+  index.assign(makeEntries(10, 9, 1));
+
+  index.textInserted(25, 5); // Statement 2 grows, all after it move.
+  StatementIndex::Entry entry;
+  ensure("grown", index.statementAt(20, false, entry));
+  ensure_equals("grown length", entry.length, 14U);
+  ensure("moved", index.firstStartingAtOrAfter(21, entry));
+  ensure_equals("moved start", entry.start, 35U);
+
+  index.textRemoved(20, 15); // Removes statement 2 entirely.
+  ensure_equals("count after removal", index.size(), 9U);
+  ensure("after removal", index.firstStartingAtOrAfter(11, entry));
+  ensure_equals("after removal start", entry.start, 20U);
+
+  index.textRemoved(15, 10); // Trims statement 1 and removes the one starting at 20.
+  ensure_equals("count after trim", index.size(), 8U);
+  ensure("trimmed", index.statementAt(10, false, entry));
+  ensure_equals("trimmed length", entry.length, 5U);
+  ensure("after trim", index.firstStartingAtOrAfter(11, entry));
+  ensure_equals("after trim start", entry.start, 20U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(3) {
+  // Replacing a range and tracking of delimiter changes.
+  index.assign(makeEntries(10, 9, 1));
+
+  std::vector<StatementIndex::Entry> replacement;
+  StatementIndex::Entry first = { 30, 4, "$$" };
+  StatementIndex::Entry second = { 36, 10, "" };
+  replacement.push_back(first);
+  replacement.push_back(second);
+  index.replace(30, 50, replacement);
+  ensure_equals("count", index.size(), 10U);
+
+  StatementIndex::Entry entry;
+  ensure("delimiter change", index.lastDelimiterChangeAtOrBefore(80, entry));
+  ensure_equals("delimiter change start", entry.start, 30U);
+  ensure_equals("delimiter", entry.delimiter, "$$");
+  ensure("no delimiter change", !index.lastDelimiterChangeAtOrBefore(29, entry));
+
+  ensure("replaced", index.statementAt(40, false, entry));
+  ensure_equals("replaced start", entry.start, 36U);
+  ensure_equals("replaced length", entry.length, 10U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(4) {
+  std::string delimiter;
+  std::string text = "  -- a comment\n/* another one */\nDELIMITER $$\n";
+  ensure("delimiter found", StatementIndex::findDelimiterCommand(text.c_str(), text.c_str() + text.size(), delimiter));
+  ensure_equals("delimiter", delimiter, "$$");
+
+  text = "  -- delimiter ;;\n ";
+  ensure("no delimiter", !StatementIndex::findDelimiterCommand(text.c_str(), text.c_str() + text.size(), delimiter));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(5) {
+  // A long series of edits, checked against a plain list of statements which is updated entry by entry.
+  std::vector<StatementIndex::Entry> expected = makeEntries(5000, 9, 1);
+  index.assign(expected);
+
+  std::uint32_t seed = 4711;
+  for (std::size_t i = 0; i < 4000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    std::size_t position = (seed >> 8) % (expected.back().end() + 2);
+    std::size_t length = 1 + (seed >> 4) % 12;
+
+    if (i % 2 == 0) {
+      index.textInserted(position, length);
+      insertText(expected, position, length);
+    } else {
+      index.textRemoved(position, length);
+      removeText(expected, position, length);
+    }
+    ensure("statements left", !expected.empty());
+  }
+
+  std::vector<StatementIndex::Entry> actual = index.entries();
+  ensure_equals("count", actual.size(), expected.size());
+  for (std::size_t i = 0; i < actual.size(); ++i) {
+    ensure_equals("start", actual[i].start, expected[i].start);
+    ensure_equals("length", actual[i].length, expected[i].length);
+  }
+
+  StatementIndex::Entry entry;
+  for (std::size_t i = 0; i < expected.size(); i += 97) {
+    ensure("lookup", index.statementAt(expected[i].start + 1, false, entry));
+    ensure_equals("lookup start", entry.start, expected[i].start);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(6) {
+  // Random edits on a script larger than a split window, each followed by a resplit of the dirty range. The result
+  // must always be the same as that of a full split.
+  std::string text = makeScript(20000);
+  index.split(text.c_str(), text.size(), splitText);
+
+  static const char *snippets[] = { "x", ";", "\n", " FROM t;\nSELECT ", "\nDELIMITER $$\n", "\nDELIMITER ;\n", "$$" };
+
+  std::uint32_t seed = 815;
+  for (std::size_t i = 0; i < 300; ++i) {
+    std::size_t dirtyStart = std::string::npos;
+    std::size_t dirtyEnd = 0;
+    for (std::size_t j = 0; j < 1 + i % 3; ++j) {
+      seed = seed * 1103515245 + 12345;
+      std::size_t position = (seed >> 8) % (text.size() + 1);
+      if (seed % 3 == 0) {
+        std::size_t length = std::min<std::size_t>(1 + (seed >> 4) % 20, text.size() - position);
+        editText(text, position, length, "", dirtyStart, dirtyEnd);
+      } else
+        editText(text, position, 0, snippets[(seed >> 4) % 7], dirtyStart, dirtyEnd);
+    }
+
+    std::size_t changedStart, changedEnd;
+    ensure("resplit", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+    ensure("changed range", changedStart <= dirtyStart);
+    checkSplit(text, "edit " + std::to_string(i));
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(7) {
+  // Adding and removing DELIMITER commands changes how all following statements are split, until the delimiter is
+  // the same again as before the edit.
+  std::string text = makeScript(10000);
+  index.split(text.c_str(), text.size(), splitText);
+
+  std::size_t position = text.find("DELIMITER $$");
+  std::size_t restore = text.find("DELIMITER ;", position);
+  std::size_t changedStart, changedEnd;
+
+  // Without its DELIMITER command the procedure is split at the semicolons inside it.
+  std::size_t dirtyStart = std::string::npos, dirtyEnd = 0;
+  editText(text, position, 13, "", dirtyStart, dirtyEnd);
+  ensure("removal", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+  checkSplit(text, "removal");
+  ensure("removal synced", changedEnd != std::string::npos && changedEnd <= restore);
+
+  dirtyStart = std::string::npos, dirtyEnd = 0;
+  editText(text, position, 0, "DELIMITER $$\n", dirtyStart, dirtyEnd);
+  ensure("insertion", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+  checkSplit(text, "insertion");
+  ensure("insertion synced", changedEnd != std::string::npos && changedEnd <= restore + 13);
+
+  // A delimiter which doesn't occur anywhere else turns the rest of the script into a single statement.
+  position = text.find("SELECT 100 ");
+  dirtyStart = std::string::npos, dirtyEnd = 0;
+  editText(text, position, 0, "DELIMITER //\n", dirtyStart, dirtyEnd);
+  ensure("new delimiter", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+  checkSplit(text, "new delimiter");
+  ensure("new delimiter range", changedEnd == std::string::npos);
+  ensure_equals("new delimiter count", index.size(), 101U);
+
+  // A stop request leaves the index as it is.
+  dirtyStart = std::string::npos, dirtyEnd = 0;
+  editText(text, position, 13, "", dirtyStart, dirtyEnd);
+  std::vector<StatementIndex::Entry> before = index.entries();
+  ensure("stopped", !index.resplit(text.c_str(), text.size(), dirtyStart, dirtyEnd, splitText,
+                                   []() { return true; }, changedStart, changedEnd));
+  ensure_equals("unchanged", index.entries().size(), before.size());
+  ensure("after stop", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+  checkSplit(text, "after stop");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(8) {
+  // A large script (about 30MB, 1M statements): single edits must only re-split a few statements, regardless of
+  // the script size. Set VERBOSE_OUTPUT to 1 to see timings.
+  std::string text = makeScript(1000000, false);
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  index.split(text.c_str(), text.size(), splitText);
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+  std::cout << "Full split of " << text.size() << " bytes: " << (t2 - t1) << std::endl;
+#endif
+
+  std::uint32_t seed = 99;
+  std::size_t maxChanged = 0;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    std::size_t position = (seed >> 4) % text.size();
+    std::size_t dirtyStart = std::string::npos, dirtyEnd = 0;
+    if (i % 2 == 0)
+      editText(text, position, 0, i % 4 == 0 ? ";" : "x", dirtyStart, dirtyEnd);
+    else
+      editText(text, position, 1, "", dirtyStart, dirtyEnd);
+
+    std::size_t changedStart, changedEnd;
+    ensure("resplit", resplit(text, dirtyStart, dirtyEnd, changedStart, changedEnd));
+    if (changedEnd != std::string::npos)
+      maxChanged = std::max(maxChanged, changedEnd - changedStart);
+    else
+      maxChanged = std::max(maxChanged, text.size() - changedStart);
+  }
+  ensure("local resplit", maxChanged < 1000);
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+  std::cout << "1000 edits with resplit: " << (t3 - t2) << std::endl;
+#endif
+
+  checkSplit(text, "large script");
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+END_TESTS
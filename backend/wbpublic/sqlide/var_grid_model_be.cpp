@@ -87,6 +87,7 @@ VarGridModel::VarGridModel()
     _column_count(0),
     _data_frame_begin(0),
     _data_frame_end(0),
+    _field_repr_cache_enabled(false),
     _is_field_value_truncation_enabled(false),
     _edited_field_row(-1),
     _edited_field_col(-1) {
@@ -127,6 +128,7 @@ void VarGridModel::reset() {
   }
 
   reinit(_data);
+  invalidate_field_repr_cache();
   reinit(_column_names);
   reinit(_column_types);
   reinit(_real_column_types);
@@ -334,16 +336,95 @@ bool VarGridModel::get_field_repr_no_truncate(const bec::NodeId &node, ColumnId
 //--------------------------------------------------------------------------------------------------
 
 bool VarGridModel::get_field_repr_(const NodeId &node, ColumnId column, std::string &value) {
-  Cell cell;
-  bool res = get_cell(cell, node, column, false);
-  if (res) {
-    if (_is_field_value_truncation_enabled) {
-      size_t row = node[0];
-      _var_to_str_repr.is_truncation_enabled = (row != _edited_field_row) || (column != _edited_field_col);
-    }
-    value = boost::apply_visitor(_var_to_str_repr, *cell);
+  if (!node.is_valid())
+    return false;
+  return get_field_repr_((RowId)node[0], column, value);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Row/column based variant of get_field_repr. No NodeId needs to be built and the display string comes from
+ * the display string cache. Passing in the same string object for all cells reuses its buffer.
+ */
+bool VarGridModel::get_field_repr(RowId row, ColumnId column, std::string &value) {
+  base::RecMutexLock data_mutex WB_UNUSED(_data_mutex);
+  return get_field_repr_(row, column, value);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool VarGridModel::get_field_repr_(RowId row, ColumnId column, std::string &value) {
+  const std::string *repr;
+  if (!get_field_repr_ref(row, column, repr, value))
+    return false;
+  if (repr != &value)
+    value.assign(*repr);
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Locks the data frame for a reader of get_field_repr_ref, so that no other thread changes it while the returned
+ * string is in use.
+ */
+base::RecMutexLock VarGridModel::read_lock() {
+  return base::RecMutexLock(_data_mutex);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Determines the display string of a cell without copying it, meant for painting grid cells. repr points to the
+ * cell's own text if it is shown as is, to the display string cache for converted or truncated values, or to buffer
+ * if the value can't be cached (the field being edited, or models without cache). The caller must hold read_lock()
+ * while using repr, and use it before the next call into the model (which might load another data frame).
+ */
+bool VarGridModel::get_field_repr_ref(RowId row, ColumnId column, const std::string *&repr, std::string &buffer) {
+  if ((row >= _row_count) || (column >= _column_count))
+    return false;
+
+  Cell cell = this->cell(row, column);
+
+  // The field being edited is shown without truncation.
+  bool is_edited_field = (row == _edited_field_row) && (column == _edited_field_col);
+  if (_is_field_value_truncation_enabled)
+    _var_to_str_repr.is_truncation_enabled = !is_edited_field;
+
+  const std::string *text = boost::get<std::string>(&*cell);
+  if (text != nullptr &&
+      (!_var_to_str_repr.is_truncation_enabled || text->size() <= _var_to_str_repr.truncation_threshold)) {
+    repr = text;
+    return true;
   }
-  return res;
+
+  if (!_field_repr_cache_enabled || is_edited_field) {
+    buffer = boost::apply_visitor(_var_to_str_repr, *cell);
+    repr = &buffer;
+    return true;
+  }
+
+  if (_data_repr.size() != _data.size()) {
+    _data_repr.clear();
+    _data_repr.resize(_data.size());
+    _data_repr_valid.assign(_data.size(), false);
+  }
+
+  size_t index = cell - _data.begin();
+  if (!_data_repr_valid[index]) {
+    _data_repr[index] = boost::apply_visitor(_var_to_str_repr, *cell);
+    _data_repr_valid[index] = true;
+  }
+  repr = &_data_repr[index];
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void VarGridModel::invalidate_field_repr_cache() {
+  _data_repr.clear();
+  _data_repr_valid.clear();
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -436,8 +517,12 @@ bool VarGridModel::set_field(const NodeId &node, ColumnId column, const sqlite::
         static const sqlide::VarEq var_eq;
         if (!is_blob_column)
           res = !boost::apply_visitor(var_eq, value, *cell);
-        if (res)
+        if (res) {
           *cell = value;
+          size_t index = cell - _data.begin();
+          if (index < _data_repr_valid.size())
+            _data_repr_valid[index] = false;
+        }
       }
     }
   }
@@ -511,6 +596,7 @@ void VarGridModel::cache_data_frame(RowId center_row, bool force_reload) {
   }
 
   _data.clear();
+  invalidate_field_repr_cache();
 
   // load data
   {
@@ -666,6 +752,7 @@ bool VarGridModel::is_field_value_truncation_enabled(bool val) {
       _var_to_str_repr.truncation_threshold = field_value_truncation_threshold;
   } else
     _var_to_str_repr.is_truncation_enabled = _is_field_value_truncation_enabled;
+  invalidate_field_repr_cache();
 
   return _is_field_value_truncation_enabled;
 }
@@ -115,6 +115,9 @@ public:
   virtual bool get_field(const bec::NodeId &node, ColumnId column, std::string &value);
   virtual bool get_field_repr(const bec::NodeId &node, ColumnId column, std::string &value);
   bool get_field_repr_no_truncate(const bec::NodeId &node, ColumnId column, std::string &value);
+  bool get_field_repr(RowId row, ColumnId column, std::string &value);
+  base::RecMutexLock read_lock();
+  bool get_field_repr_ref(RowId row, ColumnId column, const std::string *&repr, std::string &buffer);
   virtual bool get_field(const bec::NodeId &node, ColumnId column, ssize_t &value);
   virtual bool get_field(const bec::NodeId &node, ColumnId column, double &value);
   virtual bool get_field(const bec::NodeId &node, ColumnId column, bool &value);
@@ -123,6 +126,7 @@ public:
 protected:
   bool get_field_(const bec::NodeId &node, ColumnId column, std::string &value);
   bool get_field_repr_(const bec::NodeId &node, ColumnId column, std::string &value);
+  bool get_field_repr_(RowId row, ColumnId column, std::string &value);
   bool get_field_(const bec::NodeId &node, ColumnId column, ssize_t &value);
   bool get_field_(const bec::NodeId &node, ColumnId column, double &value);
   bool get_field_(const bec::NodeId &node, ColumnId column, bool &value);
@@ -201,6 +205,17 @@ protected:
   RowId _data_frame_end;
   sqlide::VarCast _var_cast;
 
+  // Display strings of the cells in the current data frame, laid out like _data and built on first use, so that
+  // repainting a grid doesn't convert the same values over and over again. Only values which need a conversion
+  // (numbers, truncated text etc.) are stored, text shown as is is used directly from _data. Must be invalidated
+  // whenever the data frame is reloaded, rows are added to or removed from it or the string conversion settings
+  // change. Subclasses which maintain invalidation for their own changes to _data enable it with
+  // _field_repr_cache_enabled.
+  void invalidate_field_repr_cache();
+  bool _field_repr_cache_enabled;
+  std::vector<std::string> _data_repr;
+  std::vector<bool> _data_repr_valid;
+
 public:
   virtual int floating_point_visible_scale();
   const sqlide::VarToStr *var2str_convertor() const {
@@ -35,6 +35,7 @@ GridViewModel::GridViewModel(bec::GridModel::Ref model, GridView *view, const st
   : Glib::ObjectBase(typeid(GridViewModel)),
     ListModelWrapper(model.get(), view, name),
     _model(model),
+    _var_grid_model(std::dynamic_pointer_cast<VarGridModel>(model)),
     _view(view),
     _row_numbers_visible(true),
     _text_cell_fixed_height(false) {
@@ -313,6 +314,25 @@ bool GridViewModel::handle_popup_event(GdkEvent *event) {
 }
 
 void GridViewModel::get_value_vfunc(const iterator &iter, int column, Glib::ValueBase &value) const {
+  // Cell texts are taken directly from the display string cache of the model instead of going through
+  // get_field_repr, which would copy each of them once more.
+  int model_column = _columns.ui2bec(column);
+  if (_var_grid_model && model_column >= 0 && *(_columns.types() + column) == G_TYPE_STRING) {
+    bec::NodeId node = node_for_iter(iter);
+    if (node.is_valid()) {
+      std::string buffer;
+      const std::string *repr = &buffer;
+      {
+        base::RecMutexLock lock(_var_grid_model->read_lock());
+        if (!_var_grid_model->get_field_repr_ref(node[0], model_column, repr, buffer))
+          repr = &buffer;
+        set_glib_string(value, *repr, true);
+      }
+      before_render(column, &value);
+      return;
+    }
+  }
+
   ListModelWrapper::get_value_vfunc(iter, column, value);
   before_render(column, &value);
 }
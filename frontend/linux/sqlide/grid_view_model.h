@@ -26,6 +26,7 @@
 
 #include "linux_utilities/listmodel_wrapper.h"
 #include "grt/tree_model.h"
+#include "sqlide/var_grid_model_be.h"
 
 class GridView;
 
@@ -70,6 +71,7 @@ protected:
 
 private:
   bec::GridModel::Ref _model;
+  std::shared_ptr<VarGridModel> _var_grid_model; // Set if the model provides cached display strings.
   GridView *_view;
   std::map<Gtk::TreeViewColumn *, int> _col_index_map;
   std::map<int, int> _current_column_size;
@@ -403,10 +403,12 @@ static int onRefresh(void *viewer)
     int columnIndex = aTableColumn.identifier.intValue;
     if ((*mData)->get_column_type(columnIndex) != bec::GridModel::BlobType)
     {
-      std::string text;
-      (*mData)->get_field_repr(rowIndex, columnIndex, text);
-      text = base::replaceString(text, "\n", " ");
-      return [NSString stringWithCPPString: text];
+      std::string buffer;
+      const std::string *repr = &buffer;
+      base::RecMutexLock lock((*mData)->read_lock());
+      if (!(*mData)->get_field_repr_ref(rowIndex, columnIndex, repr, buffer))
+        repr = &buffer;
+      return [NSString stringWithCPPString: base::replaceString(*repr, "\n", " ")];
     }
     return @"";
   }
@@ -1207,6 +1207,35 @@ obj.targetVersion = value
 
    */
   virtual GrtLogObjectRef findMigrationLogEntry(const GrtObjectRef &sourceObject, const GrtObjectRef &targetObject);
+  /** Method. finds the target object migrated from a source object of the same type, owner and name (case insensitive)
+  \param sourceObject
+  \return
+
+   */
+  virtual GrtObjectRef findMatchingTargetObject(const GrtObjectRef &sourceObject);
+  /** Method. finds the first entry in genericDatatypeMappings for the datatype name whose length conditions match the column
+  \param column
+  \param datatypeName
+  \return
+
+   */
+  virtual db_migration_DatatypeMappingRef lookupDatatypeMapping(const db_ColumnRef &column,
+                                                                const std::string &datatypeName);
+  /** Method. finds a simple datatype of the target catalog by name (case insensitive)
+  \param datatypeName
+  \return
+
+   */
+  virtual db_SimpleDatatypeRef lookupTargetDatatype(const std::string &datatypeName);
+  /** Method. creates the target columns for the columns of a source table following the column migration rules of the source module. Returns a dict for each column that still needs one of the identifier, datatype or defaultValue migration methods of the module
+  \param sourceTable
+  \param targetTable
+  \param rules
+  \return
+
+   */
+  virtual grt::DictListRef migrateTableColumns(const db_TableRef &sourceTable, const db_TableRef &targetTable,
+                                               const grt::DictRef &rules);
   /** Method.
   \param sourceObject
   \return
@@ -1267,6 +1296,24 @@ private:                                   // wrapper methods for use by grt
                                                                                GrtObjectRef::cast_from(args[1]));
   }
 
+  static grt::ValueRef call_findMatchingTargetObject(grt::internal::Object *self, const grt::BaseListRef &args) {
+    return dynamic_cast<db_migration_Migration *>(self)->findMatchingTargetObject(GrtObjectRef::cast_from(args[0]));
+  }
+
+  static grt::ValueRef call_lookupDatatypeMapping(grt::internal::Object *self, const grt::BaseListRef &args) {
+    return dynamic_cast<db_migration_Migration *>(self)->lookupDatatypeMapping(db_ColumnRef::cast_from(args[0]),
+                                                                               grt::StringRef::cast_from(args[1]));
+  }
+
+  static grt::ValueRef call_lookupTargetDatatype(grt::internal::Object *self, const grt::BaseListRef &args) {
+    return dynamic_cast<db_migration_Migration *>(self)->lookupTargetDatatype(grt::StringRef::cast_from(args[0]));
+  }
+
+  static grt::ValueRef call_migrateTableColumns(grt::internal::Object *self, const grt::BaseListRef &args) {
+    return dynamic_cast<db_migration_Migration *>(self)->migrateTableColumns(
+      db_TableRef::cast_from(args[0]), db_TableRef::cast_from(args[1]), grt::DictRef::cast_from(args[2]));
+  }
+
   static grt::ValueRef call_lookupMigratedObject(grt::internal::Object *self, const grt::BaseListRef &args) {
     return dynamic_cast<db_migration_Migration *>(self)->lookupMigratedObject(GrtObjectRef::cast_from(args[0]));
   }
@@ -1414,6 +1461,10 @@ public:
     }
     meta->bind_method("addMigrationLogEntry", &db_migration_Migration::call_addMigrationLogEntry);
     meta->bind_method("findMigrationLogEntry", &db_migration_Migration::call_findMigrationLogEntry);
+    meta->bind_method("findMatchingTargetObject", &db_migration_Migration::call_findMatchingTargetObject);
+    meta->bind_method("lookupDatatypeMapping", &db_migration_Migration::call_lookupDatatypeMapping);
+    meta->bind_method("lookupTargetDatatype", &db_migration_Migration::call_lookupTargetDatatype);
+    meta->bind_method("migrateTableColumns", &db_migration_Migration::call_migrateTableColumns);
     meta->bind_method("lookupMigratedObject", &db_migration_Migration::call_lookupMigratedObject);
     meta->bind_method("lookupSourceObject", &db_migration_Migration::call_lookupSourceObject);
   }
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace base {
+
+  template <typename Value>
+  struct NoTreapAggregate {
+    void operator()(Value &, const Value &, const Value &) const {
+    }
+  };
+
+  /**
+   * A randomized balanced search tree (treap) of values ordered by a position, like a line or a text offset.
+   * Positions are stored relative to lazy shift tags, so moving all entries behind an edit point is a single
+   * O(log n) operation, as are lookups and the removal or replacement of a range of entries. Nodes are kept in a
+   * pool and addressed by compact ids instead of pointers, 0 being the null node (with a value-initialized value).
+   *
+   * Update is called as update(value, leftValue, rightValue) whenever the children of a node change, which allows
+   * to keep aggregates over subtrees. Values can be modified in place as long as such aggregates don't depend on the
+   * modified parts.
+   *
+   * Walking the tree: the position of a node is node(id).position plus the sum of the pendingShift values of all
+   * its ancestors.
+   *
+   * The class is not thread safe. Callers have to synchronize access.
+   */
+  template <typename Value, typename Update = NoTreapAggregate<Value> >
+  class PositionTreap {
+  public:
+    typedef std::uint32_t NodeId;
+
+    struct Node {
+      std::size_t position;
+      std::ptrdiff_t pendingShift; // Not yet applied to the child nodes.
+      NodeId left;
+      NodeId right;
+      std::uint32_t priority;
+      Value value;
+    };
+
+    PositionTreap() : _root(0), _count(0), _seed(0x9E3779B9) {
+      _nodes.resize(1);
+    }
+
+    void clear() {
+      _nodes.resize(1);
+      _freeNodes.clear();
+      _root = 0;
+      _count = 0;
+    }
+
+    std::size_t size() const {
+      return _count;
+    }
+
+    bool empty() const {
+      return _count == 0;
+    }
+
+    NodeId root() const {
+      return _root;
+    }
+
+    const Node &node(NodeId id) const {
+      return _nodes[id];
+    }
+
+    Value &value(NodeId id) {
+      return _nodes[id].value;
+    }
+
+    /**
+     * Creates a node which is not yet part of the tree. See insert().
+     */
+    NodeId create(std::size_t position, const Value &value) {
+      // Simple xorshift generator for the node priorities.
+      _seed ^= _seed << 13;
+      _seed ^= _seed >> 17;
+      _seed ^= _seed << 5;
+
+      Node node = { position, 0, 0, 0, _seed, value };
+      if (!_freeNodes.empty()) {
+        NodeId id = _freeNodes.back();
+        _freeNodes.pop_back();
+        _nodes[id] = node;
+        return id;
+      }
+
+      _nodes.push_back(node);
+      return (NodeId)(_nodes.size() - 1);
+    }
+
+    /**
+     * Adds nodes from create(), which must be sorted by position, to the tree. No existing entry may lie between
+     * their positions. O(k + log n).
+     */
+    void insert(const std::vector<NodeId> &nodes) {
+      if (nodes.empty())
+        return;
+
+      NodeId left, right;
+      split(_root, _nodes[nodes.front()].position, left, right);
+      _root = merge(merge(left, build(nodes)), right);
+      _count += nodes.size();
+    }
+
+    /**
+     * Removes all entries at positions in the range [from, to).
+     */
+    void removeRange(std::size_t from, std::size_t to) {
+      NodeId left, middle, right;
+      split(_root, from, left, middle);
+      split(middle, to, middle, right);
+      release(middle);
+      _root = merge(left, right);
+    }
+
+    /**
+     * Moves all entries at or after the given position by delta.
+     */
+    void shift(std::size_t from, std::ptrdiff_t delta) {
+      if (delta == 0)
+        return;
+
+      NodeId left, right;
+      split(_root, from, left, right);
+      applyShift(right, delta);
+      _root = merge(left, right);
+    }
+
+    NodeId find(std::size_t position) const {
+      std::ptrdiff_t shift = 0;
+      NodeId run = _root;
+      while (run != 0) {
+        const Node &node = _nodes[run];
+        std::size_t nodePosition = node.position + shift;
+        if (nodePosition == position)
+          return run;
+
+        shift += node.pendingShift;
+        run = (nodePosition < position) ? node.right : node.left;
+      }
+      return 0;
+    }
+
+    NodeId lastAtOrBefore(std::size_t position, std::size_t &found) const {
+      NodeId result = 0;
+      std::ptrdiff_t shift = 0;
+      NodeId run = _root;
+      while (run != 0) {
+        const Node &node = _nodes[run];
+        std::size_t nodePosition = node.position + shift;
+        shift += node.pendingShift;
+        if (nodePosition <= position) {
+          result = run;
+          found = nodePosition;
+          run = node.right;
+        } else
+          run = node.left;
+      }
+      return result;
+    }
+
+    NodeId firstAtOrAfter(std::size_t position, std::size_t &found) const {
+      NodeId result = 0;
+      std::ptrdiff_t shift = 0;
+      NodeId run = _root;
+      while (run != 0) {
+        const Node &node = _nodes[run];
+        std::size_t nodePosition = node.position + shift;
+        shift += node.pendingShift;
+        if (nodePosition >= position) {
+          result = run;
+          found = nodePosition;
+          run = node.left;
+        } else
+          run = node.right;
+      }
+      return result;
+    }
+
+    /**
+     * Calls visit(id, position) for all entries at positions in the range [from, to), in order. O(log n + k).
+     */
+    template <typename Visitor>
+    void collect(std::size_t from, std::size_t to, Visitor visit) const {
+      collect(_root, 0, from, to, visit);
+    }
+
+  private:
+    std::vector<Node> _nodes;
+    std::vector<NodeId> _freeNodes;
+    NodeId _root;
+    std::size_t _count;
+    std::uint32_t _seed;
+
+    void release(NodeId node) {
+      if (node == 0)
+        return;
+
+      std::vector<NodeId> pending(1, node);
+      while (!pending.empty()) {
+        NodeId id = pending.back();
+        pending.pop_back();
+        if (_nodes[id].left != 0)
+          pending.push_back(_nodes[id].left);
+        if (_nodes[id].right != 0)
+          pending.push_back(_nodes[id].right);
+        _freeNodes.push_back(id);
+        --_count;
+      }
+    }
+
+    void applyShift(NodeId node, std::ptrdiff_t shift) {
+      if (node == 0 || shift == 0)
+        return;
+
+      _nodes[node].position += shift;
+      _nodes[node].pendingShift += shift;
+    }
+
+    void push(NodeId node) {
+      Node &entry = _nodes[node];
+      if (entry.pendingShift != 0) {
+        applyShift(entry.left, entry.pendingShift);
+        applyShift(entry.right, entry.pendingShift);
+        entry.pendingShift = 0;
+      }
+    }
+
+    void update(NodeId node) {
+      Node &entry = _nodes[node];
+      Update()(entry.value, _nodes[entry.left].value, _nodes[entry.right].value);
+    }
+
+    // Splits the given tree into one with all entries before position and one with the rest.
+    void split(NodeId node, std::size_t position, NodeId &left, NodeId &right) {
+      if (node == 0) {
+        left = 0;
+        right = 0;
+        return;
+      }
+
+      push(node);
+      NodeId subLeft, subRight;
+      if (_nodes[node].position < position) {
+        split(_nodes[node].right, position, subLeft, subRight);
+        _nodes[node].right = subLeft;
+        left = node;
+        right = subRight;
+      } else {
+        split(_nodes[node].left, position, subLeft, subRight);
+        _nodes[node].left = subRight;
+        left = subLeft;
+        right = node;
+      }
+      update(node);
+    }
+
+    // Merges two trees, where all entries in left come before those in right.
+    NodeId merge(NodeId left, NodeId right) {
+      if (left == 0)
+        return right;
+      if (right == 0)
+        return left;
+
+      if (_nodes[left].priority > _nodes[right].priority) {
+        push(left);
+        _nodes[left].right = merge(_nodes[left].right, right);
+        update(left);
+        return left;
+      }
+
+      push(right);
+      _nodes[right].left = merge(left, _nodes[right].left);
+      update(right);
+      return right;
+    }
+
+    // Builds a tree from a sorted list of nodes in linear time (cartesian tree construction).
+    NodeId build(const std::vector<NodeId> &nodes) {
+      std::vector<NodeId> stack;
+      for (NodeId node : nodes) {
+        NodeId last = 0;
+        while (!stack.empty() && _nodes[stack.back()].priority < _nodes[node].priority) {
+          last = stack.back();
+          update(last);
+          stack.pop_back();
+        }
+        _nodes[node].left = last;
+        if (!stack.empty())
+          _nodes[stack.back()].right = node;
+        stack.push_back(node);
+      }
+
+      if (stack.empty())
+        return 0;
+
+      for (typename std::vector<NodeId>::reverse_iterator iterator = stack.rbegin(); iterator != stack.rend();
+           ++iterator)
+        update(*iterator);
+
+      return stack.front();
+    }
+
+    template <typename Visitor>
+    void collect(NodeId node, std::ptrdiff_t shift, std::size_t from, std::size_t to, Visitor &visit) const {
+      while (node != 0) {
+        const Node &entry = _nodes[node];
+        std::size_t position = entry.position + shift;
+        shift += entry.pendingShift;
+
+        if (position > from)
+          collect(entry.left, shift, from, to, visit);
+
+        if (position >= to)
+          return;
+
+        if (position >= from)
+          visit(node, position);
+
+        // Tail iteration for the right subtree.
+        node = entry.right;
+      }
+    }
+  };
+
+}
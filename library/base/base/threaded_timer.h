@@ -26,8 +26,13 @@
 #include "common.h"
 
 #include "glib.h"
-#include <list>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "base/threading.h"
 
@@ -48,9 +53,12 @@ struct TimerTask {
   bool stop;              // Tells the scheduler to remove this task.
   bool single_shot;       // If true then this task will only run once.
   bool scheduled;         // True if the task has been scheduled currently (it is waiting in the pool to get executed).
+  size_t queue_index;     // Position in the timer queue, or TimerTask::npos if the task is not queued.
+
+  static const size_t npos = (size_t)-1;
 };
 
-typedef std::list<TimerTask> TaskList;
+typedef std::unordered_map<int, TimerTask> TaskMap;
 
 // The unit type of the timer value given to ThreadedTimer::add_task.
 enum TimerUnit { TimerFrequency, TimerTimeSpan };
@@ -60,6 +68,10 @@ enum TimerUnit { TimerFrequency, TimerTimeSpan };
  * trigger
  * a timer event, depending on the given frequency (if it is a repeating timer) or delay (for one-shot timers).
  * It forms the base for timed services like animations, server pings in the background etc.
+ *
+ * Pending tasks are kept in a binary min-heap ordered by their next execution time. The timer thread sleeps until
+ * the earliest deadline (or until a task is added which is due earlier) and then dispatches all tasks which are due
+ * within a small coalescing window, so nearby deadlines share a single wake-up.
  */
 class BASELIBRARY_PUBLIC_FUNC ThreadedTimer {
 public:
@@ -69,21 +81,34 @@ public:
   static int add_task(TimerUnit unit, double value, bool single_shot, TimerFunction callback);
   static bool remove_task(int task_id);
 
+  static size_t wakeup_count();
+
 private:
-  base::Mutex _timer_lock; // Synchronize access to the timer class.
+  std::mutex _timer_lock;          // Synchronize access to the timer class.
+  std::condition_variable _wakeup; // Signaled when the earliest deadline changed or on shutdown.
   GThreadPool* _pool;      // A number of threads which trigger the callbacks (to make them independant of each other).
-  int _wait_time;          // The time the timer thread has to wait until looking for new tasks to execute.
   bool _terminate;         // Set to true when shutting down the timer.
   int _next_id;            // A counter for task ids.
+  size_t _wakeup_count;    // How often the timer thread woke up to dispatch tasks (for diagnostics).
+  std::chrono::steady_clock::time_point _start_time; // The time base for all task deadlines.
 
   GThread* _thread; // This thread loops endlessly executing tasks as they come in.
-  TaskList _tasks;
+  TaskMap _tasks;
+  std::vector<TimerTask*> _queue; // Min-heap of all tasks which are neither stopped nor scheduled.
 
-  ThreadedTimer(int base_frequency);
+  ThreadedTimer();
   ~ThreadedTimer();
 
   static gpointer start(gpointer data);
   static void pool_function(gpointer data, gpointer user_data);
   void main_loop();
   bool remove(int task_id);
+  double elapsed() const;
+
+  void queue_push(TimerTask* task);
+  void queue_remove(TimerTask* task);
+  void sift_up(size_t index);
+  void sift_down(size_t index);
+  bool queue_less(size_t a, size_t b) const;
+  void queue_swap(size_t a, size_t b);
 };
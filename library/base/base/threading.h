@@ -26,7 +26,9 @@
 #include "common.h"
 
 #include <stdexcept>
+#include <functional>
 #include <glib.h>
+#include <memory>
 #include <vector>
 #include <string.h>
 
@@ -125,6 +127,9 @@ namespace base {
   struct BASELIBRARY_PUBLIC_FUNC RecMutexLock {
   public:
     RecMutexLock(RecMutex &mutex, bool throwOnBlock = false);
+
+    // The release function is called after the mutex was unlocked (e.g. to wake up a resource pool).
+    RecMutexLock(RecMutex &mutex, std::function<void()> const &release);
     RecMutexLock(RecMutexLock &&o);
     RecMutexLock(RecMutexLock const &o) = delete;
     RecMutexLock &operator=(RecMutexLock &o) = delete;
@@ -151,4 +156,18 @@ namespace base {
     Private *_d;
   };
 
+  // A flag shared between the requester of some (background) work and that work, to stop it early once its result
+  // is no longer needed. The work has to check the flag regularly. Copies share the same flag.
+  class BASELIBRARY_PUBLIC_FUNC CancellationToken {
+  public:
+    CancellationToken();
+
+    void cancel();
+    bool isCancelled() const;
+
+  private:
+    class Private;
+    std::shared_ptr<Private> _d;
+  };
+
 } // namespace base
@@ -25,6 +25,7 @@
 
 #include "common.h"
 
+#include <atomic>
 #include <string>
 #include <iterator>
 #include <glib.h>
@@ -40,6 +41,21 @@ namespace base {
     std::string _inner_string;
     int compareNormalized(const utf8string &s) const;
 
+    // Character index, built on first use and dropped by every modification. It holds the character count and, for
+    // strings with non-ASCII characters, the byte offset of every 32nd character, which makes index based access O(1)
+    // for ASCII text and O(1) with at most 31 UTF-8 steps for other text. The index never changes once built and is
+    // published atomically, so const instances can be read from several threads (like any std::string, modifications
+    // still need exclusive access). Plain ASCII text shares one static index, so only other text pays for an
+    // allocation, of about 40 bytes plus one offset per 32 characters. The string itself grows by one pointer.
+    struct Index;
+    mutable std::atomic<const Index *> _index{nullptr};
+    static const Index _plainAsciiIndex;
+
+    const Index &characterIndex() const;
+    void invalidateIndex();
+    size_t byteOffset(size_t index) const;
+    size_t charIndex(size_t offset) const;
+
   public:
     class utf8char;
     typedef std::string::size_type size_type;
@@ -99,6 +115,7 @@ namespace base {
     utf8string(const std::string &s);
     utf8string(const std::wstring &s);
     utf8string(const utf8string &s);
+    ~utf8string();
     utf8string(size_t size, char c);
     utf8string(size_t size, const utf8char &c);
     utf8string(const utf8string &str, size_t pos, size_t len);
@@ -310,6 +327,7 @@ namespace base {
     utf8string trim_right();
     utf8string trim_left();
     utf8string trim();
+    utf8string &operator=(const utf8string &s);
     utf8string &operator=(char c);
     bool operator==(const utf8string &s) const;
     bool operator==(const std::string &s) const;
@@ -32,6 +32,7 @@
 #include <math.h>
 #include <errno.h>
 #include <string.h>
+#include <cstdint>
 #include <fstream>
 #include <boost/locale/encoding_utf.hpp>
 
@@ -468,9 +469,46 @@ namespace base {
 
   //--------------------------------------------------------------------------------------------------
 
+  // Helpers for the text kernels below (validation, escaping). They look at 8 bytes at a time in a plain 64 bit
+  // integer ("SIMD within a register") to skip over runs of bytes which need no special treatment. This needs no CPU
+  // specific instructions or runtime dispatch and works the same with all our compilers.
+  namespace {
+    typedef std::uint64_t TextWord;
+
+    const TextWord lowBytes = 0x0101010101010101ULL;
+    const TextWord highBits = 0x8080808080808080ULL;
+
+    inline TextWord loadWord(const char *p) {
+      TextWord word;
+      memcpy(&word, p, sizeof(word));
+      return word;
+    }
+
+    // Non-zero if any byte in the word is 0 (exact, no false positives for the word as a whole).
+    inline TextWord hasZeroByte(TextWord word) {
+      return (word - lowBytes) & ~word & highBits;
+    }
+
+    inline TextWord hasByte(TextWord word, unsigned char c) {
+      return hasZeroByte(word ^ (lowBytes * c));
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------
+
   std::string sanitize_utf8(const std::string &s) {
+    // Skip the leading ASCII part word by word. g_utf8_validate stops at embedded nulls, so those end the skip too.
+    const char *p = s.data();
+    const char *stop = p + s.size();
+    while (stop - p >= (ptrdiff_t)sizeof(TextWord)) {
+      TextWord word = loadWord(p);
+      if ((word & highBits) | hasZeroByte(word))
+        break;
+      p += sizeof(TextWord);
+    }
+
     const char *end = 0;
-    if (!g_utf8_validate(s.data(), (gsize)s.size(), &end))
+    if (!g_utf8_validate(p, (gsize)(stop - p), &end))
       return std::string(s.data(), end);
     return s;
   }
@@ -1163,98 +1201,121 @@ namespace base {
 
   //--------------------------------------------------------------------------------------------------
 
+  namespace {
+    // Replacement strings for the bytes which must be escaped, indexed by byte value.
+    struct EscapeTable {
+      const char *replacements[256];
+
+      EscapeTable(std::initializer_list<std::pair<unsigned char, const char *> > entries) {
+        std::fill(replacements, replacements + 256, (const char *)nullptr);
+        for (auto &entry : entries)
+          replacements[entry.first] = entry.second;
+      }
+    };
+
+    const EscapeTable sqlEscapes({{0, "\\0"},
+                                  {'\n', "\\n"},
+                                  {'\r', "\\r"},
+                                  {'\\', "\\\\"},
+                                  {'\'', "\\'"},
+                                  {'"', "\\\""},
+                                  {'\032', "\\Z"}});
+    const EscapeTable sqlWildcardEscapes({{0, "\\0"},
+                                          {'\n', "\\n"},
+                                          {'\r', "\\r"},
+                                          {'\\', "\\\\"},
+                                          {'\'', "\\'"},
+                                          {'"', "\\\""},
+                                          {'\032', "\\Z"},
+                                          {'_', "\\_"},
+                                          {'%', "\\%"}});
+    const EscapeTable jsonEscapes({{'"', "\\\""},
+                                   {'\\', "\\\\"},
+                                   {'\b', "\\b"},
+                                   {'\f', "\\f"},
+                                   {'\n', "\\n"},
+                                   {'\r', "\\r"},
+                                   {'\t', "\\t"}});
+    const EscapeTable backtickEscapes({{0, "\\0"}, {'\n', "\\n"}, {'\r', "\\r"}, {'\032', "\\Z"}, {'`', "``"}});
+
+    // Word filters, telling if 8 bytes contain nothing to escape.
+    struct SqlClean {
+      bool operator()(TextWord w) const {
+        return !(hasZeroByte(w) | hasByte(w, '\n') | hasByte(w, '\r') | hasByte(w, '\\') | hasByte(w, '\'') |
+                 hasByte(w, '"') | hasByte(w, '\032'));
+      }
+    };
+
+    struct SqlWildcardClean {
+      bool operator()(TextWord w) const {
+        return SqlClean()(w) && !(hasByte(w, '_') | hasByte(w, '%'));
+      }
+    };
+
+    struct JsonClean {
+      bool operator()(TextWord w) const {
+        // \b, \t, \n, \f and \r are all in the range 8..13.
+        return !(hasByte(w, '"') | hasByte(w, '\\') | hasByte(w, '\b') | hasByte(w, '\t') | hasByte(w, '\n') |
+                 hasByte(w, '\f') | hasByte(w, '\r'));
+      }
+    };
+
+    struct BacktickClean {
+      bool operator()(TextWord w) const {
+        return !(hasZeroByte(w) | hasByte(w, '\n') | hasByte(w, '\r') | hasByte(w, '\032') | hasByte(w, '`'));
+      }
+    };
+
+    template <typename IsClean>
+    std::string escapeString(const std::string &s, const EscapeTable &table, IsClean isClean) {
+      const char *begin = s.data();
+      const char *end = begin + s.size();
+      const char *run = begin; // Start of the bytes not yet copied to the result.
+      const char *p = begin;
+      std::string result;
+
+      while (p < end) {
+        while (end - p >= (ptrdiff_t)sizeof(TextWord) && isClean(loadWord(p)))
+          p += sizeof(TextWord);
+        if (p == end)
+          break;
+
+        const char *replacement = table.replacements[(unsigned char)*p];
+        if (replacement != nullptr) {
+          if (run == begin)
+            result.reserve(s.size() + s.size() / 8 + 2);
+          result.append(run, p - run);
+          result.append(replacement, 2);
+          run = ++p;
+        } else
+          ++p;
+      }
+
+      if (run == begin) // Nothing to escape.
+        return s;
+      result.append(run, end - run);
+      return result;
+    }
+  }
+
+  //--------------------------------------------------------------------------------------------------
+
   /**
    * Escape a string to be used in a SQL query
    * Same code as used by mysql. Handles null bytes in the middle of the string.
    * If wildcards is true then _ and % are masked as well.
    */
   std::string escape_sql_string(const std::string &s, bool wildcards) {
-    std::string result;
-    result.reserve(s.size());
-
-    for (std::string::const_iterator ch = s.begin(); ch != s.end(); ++ch) {
-      char escape = 0;
-
-      switch (*ch) {
-        case 0: /* Must be escaped for 'mysql' */
-          escape = '0';
-          break;
-        case '\n': /* Must be escaped for logs */
-          escape = 'n';
-          break;
-        case '\r':
-          escape = 'r';
-          break;
-        case '\\':
-          escape = '\\';
-          break;
-        case '\'':
-          escape = '\'';
-          break;
-        case '"': /* Better safe than sorry */
-          escape = '"';
-          break;
-        case '\032': /* This gives problems on Win32 */
-          escape = 'Z';
-          break;
-        case '_':
-          if (wildcards)
-            escape = '_';
-          break;
-        case '%':
-          if (wildcards)
-            escape = '%';
-          break;
-      }
-      if (escape) {
-        result.push_back('\\');
-        result.push_back(escape);
-      } else
-        result.push_back(*ch);
-    }
-    return result;
+    if (wildcards)
+      return escapeString(s, sqlWildcardEscapes, SqlWildcardClean());
+    return escapeString(s, sqlEscapes, SqlClean());
   }
 
   /**
    * Escape a string to be used in a JSON
    */
   std::string escape_json_string(const std::string &s) {
-    std::string result;
-    result.reserve(s.size());
-    for (auto ch : s) {
-      char escape = 0;
-      switch (ch) {
-        case '"':
-          escape = '"';
-          break;
-        case '\\':
-          escape = '\\';
-          break;
-        case '\b':
-          escape = 'b';
-          break;
-        case '\f':
-          escape = 'f';
-          break;
-        case '\n':
-          escape = 'n';
-          break;
-        case '\r':
-          escape = 'r';
-          break;
-        case '\t':
-          escape = 't';
-          break;
-        default:
-          break;
-      }
-      if (escape) {
-        result.push_back('\\');
-        result.push_back(escape);
-      } else
-        result.push_back(ch);
-    }
-    return result;
+    return escapeString(s, jsonEscapes, JsonClean());
   }
 
   /**
@@ -1268,12 +1329,29 @@ namespace base {
     if (s.size() == 2 && s[0] == quote_char && s[1] == quote_char)
       return s;
 
+    // Fast path: copy everything up to the first quote char or backslash in one go.
+    const char *begin = s.data();
+    const char *end = begin + s.size();
+    const char *p = begin;
+    while (end - p >= (ptrdiff_t)sizeof(TextWord)) {
+      TextWord word = loadWord(p);
+      if (hasByte(word, (unsigned char)quote_char) | hasByte(word, '\\'))
+        break;
+      p += sizeof(TextWord);
+    }
+    while (p < end && *p != quote_char && *p != '\\')
+      ++p;
+    if (p == end)
+      return s;
+
     std::string result;
     result.reserve(s.size());
+    result.append(begin, p - begin);
 
     bool pendingQuote = false;
     bool pendingEscape = false;
-    for (auto c : s) {
+    for (; p < end; ++p) {
+      char c = *p;
       if (!pendingEscape && c == quote_char) {
         if (pendingQuote)
           pendingQuote = false;
@@ -1330,37 +1408,7 @@ namespace base {
   // NOTE: This is not the same as escape_sql_string, as embedded ` must be escaped as ``, not \`
   // and \ ' and " must not be escaped
   std::string escape_backticks(const std::string &s) {
-    std::string result;
-    result.reserve(s.size());
-
-    for (std::string::const_iterator ch = s.begin(); ch != s.end(); ++ch) {
-      char escape = 0;
-
-      switch (*ch) {
-        case 0: /* Must be escaped for 'mysql' */
-          escape = '0';
-          break;
-        case '\n': /* Must be escaped for logs */
-          escape = 'n';
-          break;
-        case '\r':
-          escape = 'r';
-          break;
-        case '\032': /* This gives problems on Win32 */
-          escape = 'Z';
-          break;
-        case '`':
-          // special case
-          result.push_back('`');
-          break;
-      }
-      if (escape) {
-        result.push_back('\\');
-        result.push_back(escape);
-      } else
-        result.push_back(*ch);
-    }
-    return result;
+    return escapeString(s, backtickEscapes, BacktickClean());
   }
 
   //--------------------------------------------------------------------------------------------------
@@ -29,11 +29,16 @@
 #include "base/threading.h"
 
 // 30 fps should ensure smooth animations. Higher values are better, but put higher load on a system.
+// The timer no longer ticks at this frequency, it only limits the highest task frequency.
 #define BASE_FREQUENCY 30
 
 // Define the maximum number of worker threads. If they are used up tasks have to wait.
 #define WORKER_THREAD_COUNT 2
 
+// The timer thread wakes up this long (in seconds) after the earliest deadline, so that all tasks which became due
+// in the meantime are dispatched together. No task is dispatched before its deadline.
+#define COALESCING_WINDOW 0.002
+
 DEFAULT_LOG_DOMAIN(DOMAIN_BASE)
 
 //--------------------------------------------------------------------------------------------------
@@ -47,7 +52,7 @@ G_LOCK_DEFINE(_timer);
 ThreadedTimer *ThreadedTimer::get() {
   G_LOCK(_timer);
   if (_timer == NULL) {
-    _timer = new ThreadedTimer(BASE_FREQUENCY);
+    _timer = new ThreadedTimer();
   }
   G_UNLOCK(_timer);
   return _timer;
@@ -78,7 +83,7 @@ void ThreadedTimer::stop() {
  * @result The id of the new task (can be used in the callback) or -1 if the task could not be added.
  */
 int ThreadedTimer::add_task(TimerUnit unit, double value, bool single_shot, TimerFunction callback) {
-  TimerTask task = {0, 0.0, 0.0, callback, false, single_shot, false};
+  TimerTask task = {0, 0.0, 0.0, callback, false, single_shot, false, TimerTask::npos};
 
   if (value <= 0)
     throw std::logic_error("The given timer value is invalid.");
@@ -102,7 +107,7 @@ int ThreadedTimer::add_task(TimerUnit unit, double value, bool single_shot, Time
   }
   if (task.wait_time > 0) {
     ThreadedTimer *timer = ThreadedTimer::get();
-    base::MutexLock lock(timer->_timer_lock);
+    std::lock_guard<std::mutex> lock(timer->_timer_lock);
 
     // in theory, it is possible to wrap around to 0 again.  Not a very likely scenario, but better safe than sorry
     if (timer->_next_id == 0) // 0 is special, skip it over
@@ -110,7 +115,13 @@ int ThreadedTimer::add_task(TimerUnit unit, double value, bool single_shot, Time
 
     // We have the lock acquired so it is save to increment the id counter.
     task.task_id = timer->_next_id++;
-    timer->_tasks.push_back(task);
+    task.next_time = timer->elapsed() + task.wait_time;
+    TimerTask &new_task = timer->_tasks[task.task_id] = task;
+    timer->queue_push(&new_task);
+
+    // Only wake up the timer thread if its next deadline changed.
+    if (new_task.queue_index == 0)
+      timer->_wakeup.notify_one();
 
     return task.task_id;
   }
@@ -121,7 +132,7 @@ int ThreadedTimer::add_task(TimerUnit unit, double value, bool single_shot, Time
 
 /**
  * Removes the given task from the task list by setting its stop flag. If the task is running
- * currently it can finish as usual. It is then removed on the next run of the scheduler.
+ * currently it can finish as usual. It is then removed when its callback returns.
  *
  * @param task_id The id of the task to remove. If it does not exist nothing happens.
  */
@@ -132,9 +143,19 @@ bool ThreadedTimer::remove_task(int task_id) {
 
 //--------------------------------------------------------------------------------------------------
 
-ThreadedTimer::ThreadedTimer(int base_frequency) : _terminate(false), _next_id(1) {
-  // Wait time in microseconds.
-  _wait_time = 1000 * 1000 / base_frequency;
+/**
+ * Returns how often the timer thread woke up to dispatch due tasks so far.
+ */
+size_t ThreadedTimer::wakeup_count() {
+  ThreadedTimer *timer = ThreadedTimer::get();
+  std::lock_guard<std::mutex> lock(timer->_timer_lock);
+  return timer->_wakeup_count;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ThreadedTimer::ThreadedTimer()
+  : _terminate(false), _next_id(1), _wakeup_count(0), _start_time(std::chrono::steady_clock::now()) {
   _thread = base::create_thread(start, this);
   _pool = g_thread_pool_new((GFunc)pool_function, this, WORKER_THREAD_COUNT, FALSE, NULL);
 }
@@ -149,8 +170,11 @@ ThreadedTimer::~ThreadedTimer() {
   // Pending tasks are discarded.
   logDebug2("Threaded timer shutdown...\n");
 
-  // Don't lock the mutex or we might deadlock here if the mutex is currently held by the work loop.
-  _terminate = true;
+  {
+    std::lock_guard<std::mutex> lock(_timer_lock);
+    _terminate = true;
+  }
+  _wakeup.notify_one();
 
   // Wait for the timer thread to terminate.
   g_thread_join(_thread);
@@ -180,80 +204,64 @@ void ThreadedTimer::pool_function(gpointer data, gpointer user_data) {
   ThreadedTimer *timer = static_cast<ThreadedTimer *>(user_data);
   TimerTask *task = static_cast<TimerTask *>(data);
 
+  bool do_stop;
   try {
-    bool do_stop = task->callback(task->task_id);
-    base::MutexLock lock(timer->_timer_lock);
-    task->stop = do_stop || task->single_shot;
-    task->scheduled = false;
+    do_stop = task->callback(task->task_id);
   } catch (std::exception &e) {
     // In the case of an exception we remove the task silently.
-    base::MutexLock lock(timer->_timer_lock);
-    task->stop = true;
-    task->scheduled = false;
+    do_stop = true;
     logWarning("Threaded timer: exception in pool function: %s\n", e.what());
   } catch (...) {
     // Most exceptions should be caught by the part above. Just to be on the safe side
     // do this extra branch.
-    base::MutexLock(timer->_timer_lock);
-    task->stop = true;
-    task->scheduled = false;
+    do_stop = true;
     logWarning("Threaded timer: unknown exception in pool function\n");
   }
 
-}
-
-//--------------------------------------------------------------------------------------------------
-
-// Helper predicate for removing finished tasks.
-class IsStopped : public std::unary_function<TimerTask, bool> {
-public:
-  bool operator()(TimerTask &task) {
-    return task.stop;
+  std::lock_guard<std::mutex> lock(timer->_timer_lock);
+  task->scheduled = false;
+  if (do_stop || task->single_shot || task->stop) {
+    timer->_tasks.erase(task->task_id);
+    return;
   }
-};
+
+  // Reschedule the task. Its next_time was already advanced when it was dispatched.
+  timer->queue_push(task);
+  if (task->queue_index == 0)
+    timer->_wakeup.notify_one();
+}
 
 //--------------------------------------------------------------------------------------------------
 
 void ThreadedTimer::main_loop() {
-  // Provides a high-quality clock which is used to compute execution times of tasks.
-  GTimer *clock = g_timer_new();
-  g_timer_start(clock);
+  std::unique_lock<std::mutex> lock(_timer_lock);
   while (!_terminate) {
-    // This sleep call forms our base frequency.
-    g_usleep(_wait_time);
-
-    if (_terminate)
-      break;
-
-    // 1. Compute next execution time for new tasks.
-    base::MutexLock lock(_timer_lock);
-    for (std::list<TimerTask>::iterator iterator = _tasks.begin(); iterator != _tasks.end(); iterator++) {
-      if (iterator->next_time == 0)
-        iterator->next_time = g_timer_elapsed(clock, NULL) + iterator->wait_time;
+    if (_queue.empty()) {
+      _wakeup.wait(lock);
+      continue;
     }
 
-    // 2. Execute all tasks which are due now.
-    // Processing of the task entries should be very fast here. No need to make a copy of them.
-    gdouble current_time = g_timer_elapsed(clock, NULL);
-    for (std::list<TimerTask>::iterator iterator = _tasks.begin(); iterator != _tasks.end(); ++iterator) {
-      if (_terminate)
-        break;
-
-      if (!iterator->scheduled && iterator->next_time <= current_time && !iterator->stop) {
-        // When the task is due push it to our thread pool. It will then get one of the
-        // free threads assigned to run in and pool_function is called in this thread's context.
-        // Do it only if it isn't already scheduled.
-        TimerTask &task = *iterator;
-        task.scheduled = true;
-        task.next_time += task.wait_time;
-        g_thread_pool_push(_pool, &task, NULL);
-      }
+    // Sleep until the coalescing window after the earliest deadline has passed. Adding an earlier task or shutting
+    // down wakes us up before that.
+    double current_time = elapsed();
+    double wakeup_time = _queue.front()->next_time + COALESCING_WINDOW;
+    if (wakeup_time > current_time) {
+      _wakeup.wait_for(lock, std::chrono::duration<double>(wakeup_time - current_time));
+      continue;
     }
 
-    // 3. Remove stopped task.
-    _tasks.remove_if(IsStopped());
+    // Execute all tasks which are due. When a task is due push it to our thread pool.
+    // It will then get one of the free threads assigned to run in and pool_function is called in this thread's
+    // context. The task is taken out of the queue until its callback has finished.
+    ++_wakeup_count;
+    while (!_queue.empty() && _queue.front()->next_time <= current_time) {
+      TimerTask *task = _queue.front();
+      queue_remove(task);
+      task->scheduled = true;
+      task->next_time += task->wait_time;
+      g_thread_pool_push(_pool, task, NULL);
+    }
   }
-  g_timer_destroy(clock);
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -264,15 +272,103 @@ void ThreadedTimer::main_loop() {
  * If the task is already scheduled for execution it cannot be removed anymore.
  */
 bool ThreadedTimer::remove(int task_id) {
-  base::MutexLock lock(_timer_lock);
-  for (std::list<TimerTask>::iterator iterator = _tasks.begin(); iterator != _tasks.end(); iterator++) {
-    if (iterator->task_id == task_id) {
-      iterator->stop = true;
-      TimerTask &task = *iterator;
-      return !static_cast<bool>(g_thread_pool_move_to_front(_pool, &task));
-    }
+  std::lock_guard<std::mutex> lock(_timer_lock);
+  TaskMap::iterator iterator = _tasks.find(task_id);
+  if (iterator == _tasks.end())
+    return true;
+
+  TimerTask &task = iterator->second;
+  if (task.scheduled) {
+    // The pool function removes the task when the callback returns.
+    task.stop = true;
+    return !static_cast<bool>(g_thread_pool_move_to_front(_pool, &task));
   }
+
+  queue_remove(&task);
+  _tasks.erase(iterator);
   return true;
 }
 
 //--------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the time in seconds since the timer was created, which is the time base for all tasks.
+ */
+double ThreadedTimer::elapsed() const {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time).count();
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadedTimer::queue_push(TimerTask *task) {
+  task->queue_index = _queue.size();
+  _queue.push_back(task);
+  sift_up(task->queue_index);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadedTimer::queue_remove(TimerTask *task) {
+  size_t index = task->queue_index;
+  if (index == TimerTask::npos)
+    return;
+
+  size_t last = _queue.size() - 1;
+  if (index != last) {
+    queue_swap(index, last);
+    _queue.pop_back();
+    sift_up(index);
+    sift_down(index);
+  } else
+    _queue.pop_back();
+  task->queue_index = TimerTask::npos;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadedTimer::sift_up(size_t index) {
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!queue_less(index, parent))
+      break;
+    queue_swap(index, parent);
+    index = parent;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadedTimer::sift_down(size_t index) {
+  size_t count = _queue.size();
+  while (true) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if (left < count && queue_less(left, smallest))
+      smallest = left;
+    if (right < count && queue_less(right, smallest))
+      smallest = right;
+    if (smallest == index)
+      break;
+    queue_swap(index, smallest);
+    index = smallest;
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+bool ThreadedTimer::queue_less(size_t a, size_t b) const {
+  if (_queue[a]->next_time != _queue[b]->next_time)
+    return _queue[a]->next_time < _queue[b]->next_time;
+  return _queue[a]->task_id < _queue[b]->task_id;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void ThreadedTimer::queue_swap(size_t a, size_t b) {
+  std::swap(_queue[a], _queue[b]);
+  _queue[a]->queue_index = a;
+  _queue[b]->queue_index = b;
+}
+
+//--------------------------------------------------------------------------------------------------
@@ -22,6 +22,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 
@@ -130,6 +131,7 @@ bool RecMutex::tryLock() {
 class RecMutexLock::Private {
 public:
   std::lock_guard<std::recursive_mutex> guard;
+  std::function<void()> release;
 
   Private(RecMutex const &mutex) : guard(mutex._d->mutex) {
   }
@@ -148,6 +150,13 @@ RecMutexLock::RecMutexLock(RecMutex &mutex, bool throwOnBlock) {
 
 //----------------------------------------------------------------------------------------------------------------------
 
+RecMutexLock::RecMutexLock(RecMutex &mutex, std::function<void()> const &release) {
+  _d = new Private(mutex);
+  _d->release = release;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 RecMutexLock::RecMutexLock(RecMutexLock &&o) {
   // Move ownership of the underlying guard.
   _d = o._d;
@@ -157,7 +166,13 @@ RecMutexLock::RecMutexLock(RecMutexLock &&o) {
 //----------------------------------------------------------------------------------------------------------------------
 
 RecMutexLock::~RecMutexLock() {
-  delete _d;
+  if (_d == nullptr)
+    return;
+
+  std::function<void()> release = std::move(_d->release);
+  delete _d; // Unlocks the mutex.
+  if (release)
+    release();
 }
 
 //----------------- Semaphore ------------------------------------------------------------------------------------------
@@ -198,4 +213,29 @@ void Semaphore::wait() {
   _d->count--;
 }
 
+//----------------- CancellationToken ----------------------------------------------------------------------------------
+
+class CancellationToken::Private {
+public:
+  std::atomic<bool> cancelled;
+
+  Private() : cancelled(false) {
+  }
+};
+
+CancellationToken::CancellationToken() : _d(std::make_shared<Private>()) {
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void CancellationToken::cancel() {
+  _d->cancelled = true;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool CancellationToken::isCancelled() const {
+  return _d->cancelled;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
@@ -26,6 +26,11 @@
 #include "wb_helpers.h"
 
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <random>
+
+#define VERBOSE_OUTPUT 0
 
 using namespace base;
 
@@ -944,4 +949,111 @@ TEST_FUNCTION(50) {
                 base::replaceString("D:/files/to/scan", "/", separator));
 }
 
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Simple byte-by-byte versions of the escape functions, to check the word-at-a-time implementations against.
+ */
+static std::string reference_escape(const std::string &s, const std::string &specials, const std::string &replacements) {
+  std::string result;
+  for (auto c : s) {
+    size_t index = specials.find(c);
+    if (index == std::string::npos)
+      result.push_back(c);
+    else
+      result.append(replacements, 2 * index, 2);
+  }
+  return result;
+}
+
+static std::string reference_escape_sql(const std::string &s, bool wildcards) {
+  if (wildcards)
+    return reference_escape(s, std::string("\0\n\r\\'\"\032_%", 9), "\\0\\n\\r\\\\\\'\\\"\\Z\\_\\%");
+  return reference_escape(s, std::string("\0\n\r\\'\"\032", 7), "\\0\\n\\r\\\\\\'\\\"\\Z");
+}
+
+static std::string reference_escape_json(const std::string &s) {
+  return reference_escape(s, "\"\\\b\f\n\r\t", "\\\"\\\\\\b\\f\\n\\r\\t");
+}
+
+static std::string reference_escape_backticks(const std::string &s) {
+  return reference_escape(s, std::string("\0\n\r\032`", 5), "\\0\\n\\r\\Z``");
+}
+
+/**
+ * Escaping and UTF-8 sanitizing of random strings, with the special characters at all positions relative to the
+ * 8 byte words the kernels work on.
+ */
+TEST_FUNCTION(55) {
+  static const char specials[] = "\0\n\r\t\b\f\\'\"`_%\032";
+  static const char *multibyte[] = {"\xC3\xA4", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xC3", "\xFF"};
+
+  std::mt19937 random(4711);
+  for (int i = 0; i < 20000; ++i) {
+    std::string text;
+    size_t length = random() % 40;
+    while (text.size() < length) {
+      switch (random() % 8) {
+        case 0:
+          text.push_back(specials[random() % (sizeof(specials) - 1)]);
+          break;
+        case 1:
+          text.append(multibyte[random() % 5]);
+          break;
+        default:
+          text.push_back((char)('a' + random() % 26));
+          break;
+      }
+    }
+
+    ensure_equals("escape_sql_string", escape_sql_string(text, false), reference_escape_sql(text, false));
+    ensure_equals("escape_sql_string with wildcards", escape_sql_string(text, true), reference_escape_sql(text, true));
+    ensure_equals("escape_json_string", escape_json_string(text), reference_escape_json(text));
+    ensure_equals("escape_backticks", escape_backticks(text), reference_escape_backticks(text));
+
+    // Everything escape_sql_string produces without wildcards must be understood by unescape_sql_string.
+    ensure_equals("unescape_sql_string", unescape_sql_string(escape_sql_string(text, false), '\''), text);
+
+    // sanitize_utf8 cuts the text at the first invalid sequence or null byte.
+    const char *end = nullptr;
+    g_utf8_validate(text.data(), (gssize)text.size(), &end);
+    ensure_equals("sanitize_utf8", sanitize_utf8(text), std::string(text.data(), end));
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Throughput of the escape and validation functions for typical cell data (mostly plain text).
+ */
+TEST_FUNCTION(56) {
+  std::string text;
+  std::mt19937 random(42);
+  while (text.size() < 16 * 1024 * 1024) {
+    text.append("Lorem ipsum dolor sit amet, consectetur adipiscing elit ");
+    if (random() % 4 == 0)
+      text.append("'quoted' \"text\" with a\nline break and caf\xC3\xA9 ");
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  auto measure = [&](const char *name, std::function<size_t()> run) {
+    Clock::time_point start = Clock::now();
+    size_t size = run();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ensure(name, size >= text.size());
+#if VERBOSE_OUTPUT
+    std::cout << name << ": " << text.size() / seconds / 1e9 << " GB/s" << std::endl;
+#else
+    (void)seconds;
+#endif
+  };
+
+  std::string escaped = escape_sql_string(text);
+  measure("escape_sql_string", [&]() { return escape_sql_string(text).size(); });
+  measure("escape_json_string", [&]() { return escape_json_string(text).size(); });
+  measure("escape_backticks", [&]() { return escape_backticks(text).size(); });
+  measure("unescape_sql_string", [&]() { return unescape_sql_string(escaped, '\'').size() + escaped.size(); });
+  measure("sanitize_utf8", [&]() { return sanitize_utf8(text).size(); });
+}
+
 END_TESTS
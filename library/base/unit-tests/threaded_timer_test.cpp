@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "base/threaded_timer.h"
+#include "wb_helpers.h"
+
+#include <atomic>
+#include <chrono>
+
+#define VERBOSE_OUTPUT 0
+
+BEGIN_TEST_DATA_CLASS(threaded_timer_test)
+protected:
+typedef std::chrono::steady_clock Clock;
+
+static double seconds_since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void sleep(double seconds) {
+  g_usleep((gulong)(seconds * 1000000));
+}
+
+TEST_DATA_CONSTRUCTOR(threaded_timer_test) {
+}
+
+END_TEST_DATA_CLASS;
+
+TEST_MODULE(threaded_timer_test, "Threaded timer tests");
+
+TEST_FUNCTION(10) {
+  // A one-shot task fires exactly once, not before its deadline.
+  std::atomic<int> count(0);
+  std::atomic<double> fired_after(0);
+  Clock::time_point start = Clock::now();
+  int id = ThreadedTimer::add_task(TimerTimeSpan, 0.2, true, [&](int) {
+    fired_after = seconds_since(start);
+    ++count;
+    return false;
+  });
+  ensure("valid task id", id > 0);
+
+  sleep(0.6);
+  ensure_equals("one-shot task fired once", count.load(), 1);
+  ensure("not fired before its deadline", fired_after >= 0.2);
+}
+
+TEST_FUNCTION(20) {
+  // A repeating task runs until its callback asks to stop.
+  std::atomic<int> count(0);
+  ThreadedTimer::add_task(TimerFrequency, 20, false, [&](int) { return ++count == 3; });
+
+  sleep(0.5);
+  ensure_equals("repeating task stopped itself", count.load(), 3);
+}
+
+TEST_FUNCTION(30) {
+  // Removing a task which is not yet due means it never fires. Removing an unknown id is harmless.
+  std::atomic<int> count(0);
+  int id = ThreadedTimer::add_task(TimerTimeSpan, 0.2, false, [&](int) {
+    ++count;
+    return false;
+  });
+  ensure("task removed", ThreadedTimer::remove_task(id));
+  ensure("unknown task", ThreadedTimer::remove_task(id));
+
+  sleep(0.4);
+  ensure_equals("removed task never fired", count.load(), 0);
+}
+
+TEST_FUNCTION(40) {
+  // An earlier task added while the timer sleeps for a later deadline must not wait for that deadline.
+  std::atomic<int> count(0);
+  int late_id = ThreadedTimer::add_task(TimerTimeSpan, 5, true, [](int) { return false; });
+  ThreadedTimer::add_task(TimerTimeSpan, 0.1, true, [&](int) {
+    ++count;
+    return false;
+  });
+
+  sleep(0.3);
+  ensure_equals("early task fired", count.load(), 1);
+  ThreadedTimer::remove_task(late_id);
+}
+
+TEST_FUNCTION(50) {
+  // 10k repeating tasks with periods between 0.5s and 1.5s. None may fire before it is due, and deadlines close to
+  // each other must share wake-ups of the timer thread. Measures wake-ups of the timer thread and the jitter
+  // (lateness) of the callbacks.
+  const int task_count = 10000;
+  const double run_time = 3.0;
+
+  std::vector<int> ids(task_count);
+  std::vector<std::atomic<int> > counts(task_count);
+  std::atomic<long long> total_jitter_us(0);
+  std::atomic<long long> max_jitter_us(0);
+  std::atomic<int> early_firings(0);
+  std::atomic<int> firings(0);
+
+  size_t wakeups_before = ThreadedTimer::wakeup_count();
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < task_count; ++i) {
+    double period = 0.5 + (i % 1000) / 1000.0;
+    counts[i] = 0;
+    Clock::time_point added = Clock::now();
+    ids[i] = ThreadedTimer::add_task(TimerTimeSpan, period, false, [&, i, period, added](int) {
+      int n = ++counts[i];
+      double expected = n * period;
+      double fired = seconds_since(added);
+      if (fired < expected)
+        ++early_firings;
+      long long jitter = (long long)((fired - expected) * 1000000);
+      total_jitter_us += jitter;
+      long long max = max_jitter_us;
+      while (jitter > max && !max_jitter_us.compare_exchange_weak(max, jitter))
+        ;
+      ++firings;
+      return false;
+    });
+  }
+
+  sleep(run_time);
+  for (int id : ids)
+    ThreadedTimer::remove_task(id);
+  double elapsed = seconds_since(start);
+  size_t wakeups = ThreadedTimer::wakeup_count() - wakeups_before;
+
+  // Let callbacks which were already dispatched finish before the captured locals go out of scope.
+  sleep(0.5);
+
+#if VERBOSE_OUTPUT
+  std::cout << "Threaded timer: " << task_count << " tasks, " << firings << " callbacks, " << wakeups / elapsed
+            << " wake-ups/s, mean jitter " << total_jitter_us / std::max(1, firings.load()) << "us, max jitter "
+            << max_jitter_us << "us" << std::endl;
+#else
+  (void)elapsed;
+#endif
+
+  for (int i = 0; i < task_count; ++i)
+    ensure("every task fired", counts[i] > 0);
+  ensure_equals("no task fired early", early_firings.load(), 0);
+  ensure("coalesced wake-ups", wakeups < (size_t)firings.load());
+}
+
+// Must be the last test.
+TEST_FUNCTION(99) {
+  ThreadedTimer::stop();
+}
+
+END_TESTS
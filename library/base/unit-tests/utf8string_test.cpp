@@ -28,6 +28,9 @@
 #include <cctype>
 #include <functional>
 #include <map>
+#include <thread>
+
+#define VERBOSE_OUTPUT 0
 using namespace base;
 
 TEST_MODULE(utf8string_test, "utf8string");
@@ -526,4 +529,146 @@ TEST_FUNCTION(70) {
   ensure_equals("TEST 70.5: --it", *it, base::utf8string::utf8char("ć"));
 }
 
+/*
+ * Testing index based access in long mixed-script strings, also after modifications.
+ */
+TEST_FUNCTION(75) {
+  std::string text;
+  std::vector<std::string> characters;
+  while (characters.size() < 100000) {
+    for (auto &entry : LanguageStrings) {
+      for (const char *p = entry.second._text; *p != 0; p = g_utf8_next_char(p))
+        characters.push_back(std::string(p, g_utf8_next_char(p) - p));
+    }
+  }
+  for (auto &character : characters)
+    text += character;
+
+  base::utf8string str(text);
+  ensure_equals("TEST 75.1: length", str.length(), characters.size());
+  ensure_equals("TEST 75.2: size", str.size(), characters.size());
+
+  size_t offset = 0;
+  bool matches = true;
+  for (size_t i = 0; i < characters.size() && matches; ++i) {
+    matches = str.charIndexToByteOffset(i) == offset && str.byteOffsetToCharIndex(offset) == i &&
+              str[i] == base::utf8string::utf8char(characters[i].c_str());
+    offset += characters[i].size();
+  }
+  ensure("TEST 75.3: sequential access", matches);
+
+  // Backwards and random access.
+  ensure_equals("TEST 75.4: operator[]", str[characters.size() - 1],
+                base::utf8string::utf8char(characters.back().c_str()));
+  ensure_equals("TEST 75.5: operator[]", str[12345], base::utf8string::utf8char(characters[12345].c_str()));
+  ensure_equals("TEST 75.6: at", str.at(77), base::utf8string::utf8char(characters[77].c_str()));
+  ensure_equals("TEST 75.7: substr", str.substr(50000, 3).to_string(),
+                characters[50000] + characters[50001] + characters[50002]);
+  ensure_equals("TEST 75.8: find", str.find("ὕαλον", 70000), str.substr(70000).find("ὕαλον") + 70000);
+
+  // Modifications must drop the index.
+  str.erase(0, 10);
+  ensure_equals("TEST 75.9: erase", str.length(), characters.size() - 10);
+  ensure_equals("TEST 75.10: erase", str[0], base::utf8string::utf8char(characters[10].c_str()));
+  str += "ż";
+  ensure_equals("TEST 75.11: append", str.length(), characters.size() - 9);
+  ensure_equals("TEST 75.12: append", str[str.length() - 1], base::utf8string::utf8char("ż"));
+}
+
+/*
+ * Reading a shared const string from several threads, which builds its character index on first use.
+ */
+TEST_FUNCTION(80) {
+  std::string text;
+  while (text.size() < 100000) {
+    for (auto &entry : LanguageStrings)
+      text += entry.second._text;
+  }
+  const base::utf8string str(text);
+  const size_t length = g_utf8_strlen(text.data(), text.size());
+
+  std::vector<uint64_t> checksums(8);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < checksums.size(); ++t) {
+    threads.push_back(std::thread([&str, &checksums, t]() {
+      uint64_t checksum = str.length();
+      for (size_t i = t; i < str.length(); i += 3)
+        checksum += (uint32_t)str[i] + str.charIndexToByteOffset(i);
+      checksums[t] = checksum;
+    }));
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  for (size_t t = 0; t < checksums.size(); ++t) {
+    uint64_t checksum = length;
+    const char *p = g_utf8_offset_to_pointer(text.data(), (glong)t);
+    for (size_t i = t; i < length; i += 3) {
+      checksum += g_utf8_get_char(p) + (p - text.data());
+      for (int k = 0; k < 3 && *p != 0; ++k)
+        p = g_utf8_next_char(p);
+    }
+    ensure_equals("TEST 80.1: concurrent access", checksums[t], checksum);
+  }
+
+  // Copies build their own index.
+  base::utf8string copy(str);
+  copy = base::utf8string("ascii");
+  ensure_equals("TEST 80.2: assignment", copy.length(), 5U);
+  copy = str;
+  ensure_equals("TEST 80.3: assignment", copy.length(), length);
+}
+
+/*
+ * Benchmark: character wise loops over a 1MB mixed-script string, which took quadratic time without the character
+ * index. Set VERBOSE_OUTPUT to 1 to see the timings.
+ */
+TEST_FUNCTION(85) {
+  std::string text;
+  while (text.size() < 1000000) {
+    for (auto &entry : LanguageStrings)
+      text += entry.second._text;
+  }
+  base::utf8string str(text);
+
+#if VERBOSE_OUTPUT
+  test_time_point t1;
+#endif
+
+  uint64_t checksum = 0;
+  size_t length = str.length();
+  for (size_t i = 0; i < length; ++i)
+    checksum += (uint32_t)str[i];
+
+#if VERBOSE_OUTPUT
+  test_time_point t2;
+#endif
+
+  size_t bytes = 0;
+  for (size_t i = 0; i < length; i += 1000)
+    bytes += str.substr(i, 10).bytes();
+
+#if VERBOSE_OUTPUT
+  test_time_point t3;
+  std::cout << "utf8string: " << length << " characters read one by one in " << (t2 - t1)
+            << ", substr at every 1000th character in " << (t3 - t2) << std::endl;
+#endif
+
+  // The same values, stepping through the text once.
+  std::vector<size_t> offsets;
+  uint64_t expectedChecksum = 0;
+  for (const char *p = text.c_str(); *p != 0; p = g_utf8_next_char(p)) {
+    offsets.push_back(p - text.c_str());
+    expectedChecksum += g_utf8_get_char(p);
+  }
+  offsets.push_back(text.size());
+  size_t expectedBytes = 0;
+  for (size_t i = 0; i + 1 < offsets.size(); i += 1000)
+    expectedBytes += offsets[std::min(i + 10, offsets.size() - 1)] - offsets[i];
+
+  ensure_equals("TEST 85.1: length", length, offsets.size() - 1);
+  ensure_equals("TEST 85.2: characters", checksum, expectedChecksum);
+  ensure_equals("TEST 85.3: substr", bytes, expectedBytes);
+}
+
 END_TESTS
@@ -83,20 +83,12 @@ namespace base {
     return utf8_byte_offset(str.data(), offset, str.size());
   }
 
-  // Converts byte offset to UTF-8 character offset.
-  inline utf8string::size_type utf8_char_offset(const std::string& str, utf8string::size_type offset) {
-    if (offset == utf8string::npos)
-      return utf8string::npos;
-
-    const char* const pdata = str.data();
-    return g_utf8_pointer_to_offset(pdata, pdata + offset);
-  }
-
   // Helper to implement ustring::find_first_of() and find_first_not_of().
   // Returns the UTF-8 character offset, or ustring::npos if not found.
+  // The byte offset of the start character is passed in by the caller, which knows it from its index.
   static utf8string::size_type utf8_find_first_of(const std::string& str, utf8string::size_type offset,
-                                                  const char* utf8_match, long utf8_match_size, bool find_not_of) {
-    const utf8string::size_type byte_offset = utf8_byte_offset(str, offset);
+                                                  utf8string::size_type byte_offset, const char* utf8_match,
+                                                  long utf8_match_size, bool find_not_of) {
     if (byte_offset == utf8string::npos)
       return utf8string::npos;
 
@@ -139,6 +131,18 @@ namespace base {
         _count = utf8_byte_offset(str.data() + _index, count, str.size() - _index);
     }
 
+    bounds(const utf8string& str, utf8string::size_type index, utf8string::size_type count)
+      : _index(str.byteOffset(index)), _count(utf8string::npos) {
+      if (_index == utf8string::npos) {
+        _index = str.bytes();
+        _count = 0;
+      } else if (count != utf8string::npos && index + count >= index) {
+        const utf8string::size_type end = str.byteOffset(index + count);
+        if (end != utf8string::npos)
+          _count = end - _index;
+      }
+    }
+
     utf8string::size_type index() const {
       return _index;
     }
@@ -215,6 +219,10 @@ namespace base {
   utf8string::utf8string(const utf8string& s) : _inner_string(s.to_string()) {
   }
 
+  utf8string::~utf8string() {
+    invalidateIndex();
+  }
+
   utf8string::utf8string(size_t size, char c) : _inner_string(size, c) {
   }
 
@@ -236,12 +244,12 @@ namespace base {
   }
 
   utf8string::utf8string(const char* s, size_t pos, size_t len) {
-    const bounds b(s, pos, len);
+    const bounds b(std::string(s), pos, len);
     _inner_string.assign(s, b.index(), b.count());
   }
 
   utf8string::utf8string(const utf8string& str, size_t pos, size_t len) {
-    const bounds b(str._inner_string, pos, len);
+    const bounds b(str, pos, len);
     _inner_string.assign(str._inner_string, b.index(), b.count());
   }
 
@@ -298,8 +306,17 @@ namespace base {
     return g_utf8_collate(normalize().c_str(), s.normalize().c_str());
   }
 
+  utf8string& utf8string::operator=(const utf8string& s) {
+    if (this != &s) {
+      _inner_string = s._inner_string;
+      invalidateIndex();
+    }
+    return *this;
+  }
+
   utf8string& utf8string::operator=(char c) {
     _inner_string = std::string(1, c);
+    invalidateIndex();
     return *this;
   }
 
@@ -464,11 +481,125 @@ namespace base {
   }
 
   size_t utf8string::charIndexToByteOffset(const size_t index) const {
+    const size_t offset = byteOffset(index);
+    if (offset != npos)
+      return offset;
     return g_utf8_offset_to_pointer(this->c_str(), (glong)index) - this->c_str();
   }
 
   size_t utf8string::byteOffsetToCharIndex(const size_t offset) const {
-    return g_utf8_pointer_to_offset(this->c_str(), this->c_str() + offset);
+    return charIndex(offset);
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  //  Character index
+  //////////////////////////////////////////////////////////////////////////////
+
+  static const size_t CHECKPOINT_DISTANCE = 32; // Characters between two entries in Index::checkpoints.
+
+  struct utf8string::Index {
+    size_t charCount;
+    size_t endOffset; // Byte offset after the last character (beyond the end if that is truncated).
+    bool asciiOnly;   // charCount and endOffset are then the byte count and not set in the index.
+    bool lengthIsCharCount; // No null bytes and no truncated character at the end.
+    std::vector<size_t> checkpoints;
+  };
+
+  // Shared by all strings which are ASCII only and free of null bytes.
+  const utf8string::Index utf8string::_plainAsciiIndex = {0, 0, true, true, {}};
+
+  const utf8string::Index& utf8string::characterIndex() const {
+    const Index* index = _index.load(std::memory_order_acquire);
+    if (index != nullptr)
+      return *index;
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(_inner_string.data());
+    const size_t size = _inner_string.size();
+    Index* built = nullptr;
+    if (std::find_if(data, data + size, [](unsigned char c) { return c >= 0x80; }) == data + size) {
+      if (std::memchr(data, 0, size) == nullptr)
+        index = &_plainAsciiIndex;
+      else
+        index = built = new Index{0, 0, true, false, {}};
+    } else {
+      // Step through the text the same way g_utf8_offset_to_pointer does, so the results for invalid input stay the
+      // same.
+      built = new Index{0, 0, false, false, {}};
+      built->checkpoints.reserve(size / CHECKPOINT_DISTANCE + 1);
+      const char* const utf8_skip = g_utf8_skip;
+      size_t offset = 0;
+      size_t count = 0;
+      bool hasNull = false;
+      while (offset < size) {
+        if (count % CHECKPOINT_DISTANCE == 0)
+          built->checkpoints.push_back(offset);
+        hasNull = hasNull || data[offset] == 0;
+        offset += utf8_skip[data[offset]];
+        ++count;
+      }
+      built->charCount = count;
+      built->endOffset = offset;
+      built->lengthIsCharCount = !hasNull && offset == size;
+      index = built;
+    }
+
+    // Another thread may have published an index for the same text in the meantime, which is then used instead.
+    const Index* expected = nullptr;
+    if (!_index.compare_exchange_strong(expected, index, std::memory_order_acq_rel, std::memory_order_acquire)) {
+      delete built;
+      index = expected;
+    }
+    return *index;
+  }
+
+  void utf8string::invalidateIndex() {
+    const Index* index = _index.exchange(nullptr, std::memory_order_acq_rel);
+    if (index != &_plainAsciiIndex)
+      delete index;
+  }
+
+  /**
+   * Returns the byte offset of the character with the given index, the end offset for index == size() and npos
+   * for anything beyond.
+   */
+  size_t utf8string::byteOffset(size_t index) const {
+    const Index& characters = characterIndex();
+    if (characters.asciiOnly)
+      return index <= _inner_string.size() ? index : npos;
+
+    if (index >= characters.charCount)
+      return index == characters.charCount ? characters.endOffset : npos;
+
+    size_t offset = characters.checkpoints[index / CHECKPOINT_DISTANCE];
+    const char* const utf8_skip = g_utf8_skip;
+    for (size_t current = index - index % CHECKPOINT_DISTANCE; current < index; ++current)
+      offset += utf8_skip[static_cast<unsigned char>(_inner_string[offset])];
+    return offset;
+  }
+
+  /**
+   * Returns the number of characters starting before the given byte offset (as g_utf8_pointer_to_offset does).
+   */
+  size_t utf8string::charIndex(size_t offset) const {
+    if (offset == npos)
+      return npos;
+
+    const Index& characters = characterIndex();
+    if (characters.asciiOnly)
+      return std::min(offset, _inner_string.size());
+
+    if (offset >= characters.endOffset)
+      return characters.charCount;
+
+    // Start at the last checkpoint not behind the offset.
+    size_t slot = std::upper_bound(characters.checkpoints.begin(), characters.checkpoints.end(), offset) -
+                  characters.checkpoints.begin() - 1;
+    size_t current = slot * CHECKPOINT_DISTANCE;
+    size_t position = characters.checkpoints[slot];
+    const char* const utf8_skip = g_utf8_skip;
+    for (; position < offset; ++current)
+      position += utf8_skip[static_cast<unsigned char>(_inner_string[position])];
+    return current;
   }
 
   utf8string::iterator::iterator(char* s, char* p) : str(s) {
@@ -516,8 +647,9 @@ namespace base {
   //  Operations
   //////////////////////////////////////////////////////////////////////////////
   utf8string& utf8string::erase(size_type index, size_type count) {
-    const bounds b(_inner_string, index, count);
+    const bounds b(*this, index, count);
     _inner_string.erase(b.index(), b.count());
+    invalidateIndex();
     return *this;
   }
   //
@@ -525,21 +657,25 @@ namespace base {
   //
   utf8string& utf8string::append(const char* s) {
     _inner_string += s;
+    invalidateIndex();
     return *this;
   }
 
   utf8string& utf8string::append(size_type count, char ch) {
     _inner_string.append(count, ch);
+    invalidateIndex();
     return *this;
   }
 
   utf8string& utf8string::append(size_type count, utf8string::utf8char ch) {
     _inner_string.append(utf8string(count, ch)._inner_string);
+    invalidateIndex();
     return *this;
   }
 
   utf8string& utf8string::append(const utf8string& str) {
     _inner_string += str._inner_string;
+    invalidateIndex();
     return *this;
   }
 
@@ -548,16 +684,19 @@ namespace base {
   //
   utf8string& utf8string::operator+=(const utf8string& str) {
     _inner_string += str._inner_string;
+    invalidateIndex();
     return *this;
   }
 
   utf8string& utf8string::operator+=(const utf8string::utf8char& c) {
     _inner_string.append(1, c);
+    invalidateIndex();
     return *this;
   }
 
   utf8string& utf8string::operator+=(const char* s) {
     _inner_string.append(s);
+    invalidateIndex();
     return *this;
   }
 
@@ -588,28 +727,33 @@ namespace base {
   }
 
   base::utf8string::const_reference utf8string::at(size_type pos) const {
-    const size_type byte_offset = utf8_byte_offset(_inner_string, pos);
+    const size_type byte_offset = byteOffset(pos);
 
     // Throws std::out_of_range if the index is invalid.
     return g_utf8_get_char(&_inner_string.at(byte_offset));
   }
 
   utf8string::const_reference utf8string::operator[](size_type pos) const {
-    return g_utf8_get_char(g_utf8_offset_to_pointer(_inner_string.data(), (glong)pos));
+    const size_type byte_offset = byteOffset(pos);
+    if (byte_offset == npos) // Out of range, unchecked as before.
+      return g_utf8_get_char(g_utf8_offset_to_pointer(_inner_string.data(), (glong)pos));
+    return g_utf8_get_char(_inner_string.data() + byte_offset);
   }
 
   //////////////////////////////////////////////////////////////////////////////
   //  Capacity
   //////////////////////////////////////////////////////////////////////////////
   size_t utf8string::size() const {
-    const char* ptr = _inner_string.data();
-    return g_utf8_pointer_to_offset(ptr, ptr + _inner_string.size());
+    const Index& characters = characterIndex();
+    return characters.asciiOnly ? _inner_string.size() : characters.charCount;
   }
 
   size_t utf8string::length() const {
-    const char* ptr = _inner_string.data();
-    // return g_utf8_pointer_to_offset(ptr, ptr + _inner_string.size());
-    return g_utf8_strlen(ptr, _inner_string.size());
+    if (characterIndex().lengthIsCharCount)
+      return size();
+
+    // g_utf8_strlen stops at null bytes and doesn't count a truncated last character.
+    return g_utf8_strlen(_inner_string.data(), _inner_string.size());
   }
 
   void utf8string::resize(size_t n) {
@@ -624,8 +768,10 @@ namespace base {
     const size_type size_now = size();
     if (n < size_now)
       erase(n, npos);
-    else if (n > size_now)
+    else if (n > size_now) {
       _inner_string.append(n - size_now, c);
+      invalidateIndex();
+    }
   }
 
   bool utf8string::empty() const {
@@ -644,28 +790,28 @@ namespace base {
   //  Search
   //////////////////////////////////////////////////////////////////////////////
   utf8string::size_type utf8string::find(const char* s, size_type pos) const {
-    return utf8_char_offset(_inner_string, _inner_string.find(s, utf8_byte_offset(_inner_string, pos)));
+    return charIndex(_inner_string.find(s, byteOffset(pos)));
   }
 
   utf8string::size_type utf8string::find(const utf8string& s, size_type pos) const {
-    return utf8_char_offset(_inner_string, _inner_string.find(s._inner_string, utf8_byte_offset(_inner_string, pos)));
+    return charIndex(_inner_string.find(s._inner_string, byteOffset(pos)));
   }
 
   utf8string::size_type utf8string::find(char ch, size_type pos) const {
-    return utf8_char_offset(_inner_string, _inner_string.find(ch, utf8_byte_offset(_inner_string, pos)));
+    return charIndex(_inner_string.find(ch, byteOffset(pos)));
   }
 
   utf8string::size_type utf8string::find(const utf8string::utf8char& ch, size_type pos) const {
-    return utf8_char_offset(_inner_string,
-                            _inner_string.find((const char*)ch, utf8_byte_offset(_inner_string, pos), ch.length()));
+    return charIndex(_inner_string.find((const char*)ch, byteOffset(pos), ch.length()));
   }
 
   utf8string::size_type utf8string::find_first_of(const utf8string& str, size_type pos) const {
-    return utf8_find_first_of(_inner_string, pos, str._inner_string.data(), (long)str._inner_string.size(), false);
+    return utf8_find_first_of(_inner_string, pos, byteOffset(pos), str._inner_string.data(),
+                              (long)str._inner_string.size(), false);
   }
 
   utf8string::size_type utf8string::find_first_not_of(const char* s, size_type pos) const {
-    return utf8_find_first_of(_inner_string, pos, s, -1, true);
+    return utf8_find_first_of(_inner_string, pos, byteOffset(pos), s, -1, true);
   }
 
   //////////////////////////////////////////////////////////////////////////////
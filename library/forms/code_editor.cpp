@@ -37,6 +37,9 @@
 #include "mysql/MySQLRecognizerCommon.h"
 #include "SymbolTable.h"
 
+#include <algorithm>
+#include <limits>
+
 DEFAULT_LOG_DOMAIN(DOMAIN_MFORMS_BE)
 
 using namespace mforms;
@@ -280,7 +283,8 @@ void CodeEditorConfig::parse_styles() {
 
 //----------------- CodeEditor ---------------------------------------------------------------------
 
-CodeEditor::CodeEditor(void* host, bool showInfo) : _host(host) {
+CodeEditor::CodeEditor(void* host, bool showInfo)
+  : _host(host), _markupWindowStart(0), _markupWindowEnd(0), _markupWindowValid(false) {
   _code_editor_impl = &ControlFactory::get_instance()->_code_editor_impl;
 
   _code_editor_impl->create(this, showInfo);
@@ -760,7 +764,7 @@ void CodeEditor::setupMarker(int marker, const std::string& name) {
 //--------------------------------------------------------------------------------------------------
 
 /**
- * Called before lines are removed. Need to record disappearing markers.
+ * Called before text is removed. Removes the markup of lines which disappear and moves up the markup behind them.
  */
 void CodeEditor::handleMarkerDeletion(int position, int length) {
   if (length == 0)
@@ -769,69 +773,118 @@ void CodeEditor::handleMarkerDeletion(int position, int length) {
   LineMarkupChangeset changeset;
   if (length == _code_editor_impl->send_editor(this, SCI_GETLENGTH, 0, 0)) {
     // Clean editor? Send empty changeset to signal that all markers can go.
+    _markup.clear();
+    _markupWindowValid = false;
     _marker_changed_event(changeset, true);
     return;
   }
 
-  sptr_t currentLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position, 0);
-  sptr_t endLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position + length - 1, 0);
-
-  // Don't include the first line as Scintilla merges current and last line markers, so we have to update them.
-  ++currentLine;
+  sptr_t firstLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position, 0);
+  sptr_t lastLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position + length, 0);
+  if (lastLine == firstLine)
+    return;
 
-  currentLine = _code_editor_impl->send_editor(this, SCI_MARKERNEXT, currentLine, LineMarkupAll);
+  // If entire lines are removed the markup of the line after them moves up. Otherwise the rest of the last line
+  // is appended to the first one, which keeps its markup.
+  std::size_t removalStart = (std::size_t)firstLine + 1;
+  if (position == _code_editor_impl->send_editor(this, SCI_POSITIONFROMLINE, firstLine, 0) &&
+      position + length == _code_editor_impl->send_editor(this, SCI_POSITIONFROMLINE, lastLine, 0))
+    removalStart = (std::size_t)firstLine;
 
-  while (currentLine > -1 && currentLine <= endLine) {
-    LineMarkup markup = (LineMarkup)_code_editor_impl->send_editor(this, SCI_MARKERGET, currentLine, LineMarkupAll);
-    LineMarkupChangeEntry entry = {(int)currentLine, 0, markup};
-    changeset.push_back(entry);
+  std::vector<LineMarkupStore::Entry> removed;
+  _markup.linesRemoved(removalStart, (std::size_t)(lastLine - firstLine), removed);
+  _markupWindowValid = false;
 
-    // MARKERNEXT effectively searches lines for the given markers, the docs say.
-    currentLine = _code_editor_impl->send_editor(this, SCI_MARKERNEXT, currentLine + 1, LineMarkupAll);
+  for (auto& entry : removed) {
+    LineMarkupChangeEntry change = {(int)entry.line, 0, (LineMarkup)entry.markup};
+    changeset.push_back(change);
   }
 
   if (!changeset.empty())
     _marker_changed_event(changeset, true);
+
+  reportMarkupMove(removalStart, -(std::ptrdiff_t)(lastLine - firstLine));
 }
 
 //--------------------------------------------------------------------------------------------------
 
 /**
- * Called after an edit action took place. We have to record markers that got moved by that action.
+ * Called after an edit action took place. Inserted lines move the markup behind them (removed lines have been
+ * handled already before the deletion). Only the store is updated here, the markers in the editor control are
+ * refreshed with the next UI update.
  */
 void CodeEditor::handleMarkerMove(int position, int linesAdded) {
   if (linesAdded == 0)
     return;
 
-  LineMarkupChangeset changeset;
-  sptr_t currentLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position, 0);
+  _markupWindowValid = false;
+  if (linesAdded < 0)
+    return;
 
-  if (linesAdded < 0) {
-    // Lines have been deleted and markers merged. Since we don't know which have been combined remove them all
-    // and send a separate deletion event for this case.
-    _code_editor_impl->send_editor(this, SCI_MARKERDELETE, currentLine, -1);
-    changeset.push_back({(int)currentLine, 0, LineMarkupAll});
-    _marker_changed_event(changeset, true);
-    changeset.clear();
-  }
+  sptr_t currentLine = _code_editor_impl->send_editor(this, SCI_LINEFROMPOSITION, position, 0);
 
   // Ignore the first line if it has been edited after the line start.
   if (position > _code_editor_impl->send_editor(this, SCI_POSITIONFROMLINE, currentLine, 0))
     ++currentLine;
 
-  currentLine = _code_editor_impl->send_editor(this, SCI_MARKERNEXT, currentLine, LineMarkupAll);
-  while (currentLine > -1) {
-    LineMarkup markup = (LineMarkup)_code_editor_impl->send_editor(this, SCI_MARKERGET, currentLine, LineMarkupAll);
-    LineMarkupChangeEntry entry = {(int)(currentLine - linesAdded), (int)currentLine, markup};
-    changeset.push_back(entry);
+  _markup.linesInserted((std::size_t)currentLine, (std::size_t)linesAdded);
+  reportMarkupMove((std::size_t)(currentLine + linesAdded), linesAdded);
+}
+
+//--------------------------------------------------------------------------------------------------
 
-    currentLine = _code_editor_impl->send_editor(this, SCI_MARKERNEXT, currentLine + 1, LineMarkupAll);
+/**
+ * Tells subscribers of signal_marker_changed which markup was moved by an edit, which is all markup from the given
+ * (new) line on. Skipped if nobody listens, as it costs O(n) in the number of markers.
+ */
+void CodeEditor::reportMarkupMove(std::size_t line, std::ptrdiff_t linesAdded) {
+  if (_marker_changed_event.empty())
+    return;
+
+  LineMarkupChangeset changeset;
+  for (auto& entry : _markup.entries(line, std::numeric_limits<std::size_t>::max())) {
+    LineMarkupChangeEntry change = {(int)(entry.line - linesAdded), (int)entry.line, (LineMarkup)entry.markup};
+    changeset.push_back(change);
   }
 
   if (!changeset.empty())
     _marker_changed_event(changeset, false);
 }
 
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Makes sure the markers in the editor control reflect the markup for the visible lines plus a page above and
+ * below. Scintilla keeps its markers in a per line array, so setting markers for all lines of a large script
+ * (and keeping them in sync with our markup store) would be expensive, while we only need those which can be seen.
+ * Returns true if the markers were set anew.
+ */
+bool CodeEditor::updateMarkupWindow(bool force) {
+  sptr_t firstVisible = _code_editor_impl->send_editor(this, SCI_GETFIRSTVISIBLELINE, 0, 0);
+  sptr_t linesOnScreen = _code_editor_impl->send_editor(this, SCI_LINESONSCREEN, 0, 0);
+  if (linesOnScreen <= 0)
+    linesOnScreen = 100; // Not yet shown.
+
+  size_t visibleStart = (size_t)_code_editor_impl->send_editor(this, SCI_DOCLINEFROMVISIBLE, firstVisible, 0);
+  size_t visibleEnd =
+    (size_t)_code_editor_impl->send_editor(this, SCI_DOCLINEFROMVISIBLE, firstVisible + linesOnScreen, 0) + 1;
+  if (!force && _markupWindowValid && visibleStart >= _markupWindowStart && visibleEnd <= _markupWindowEnd)
+    return false;
+
+  sptr_t windowStart = std::max<sptr_t>(0, firstVisible - linesOnScreen);
+  _markupWindowStart = (size_t)_code_editor_impl->send_editor(this, SCI_DOCLINEFROMVISIBLE, windowStart, 0);
+  _markupWindowEnd =
+    (size_t)_code_editor_impl->send_editor(this, SCI_DOCLINEFROMVISIBLE, firstVisible + 2 * linesOnScreen, 0) + 1;
+  _markupWindowValid = true;
+
+  _code_editor_impl->send_editor(this, SCI_MARKERDELETEALL, -1, 0);
+  for (auto& entry : _markup.entries(_markupWindowStart, _markupWindowEnd))
+    _code_editor_impl->send_editor(this, SCI_MARKERADDSET, entry.line, entry.markup);
+
+  _markup_window_changed_event(_markupWindowStart, _markupWindowEnd);
+  return true;
+}
+
 //----------------------------------------------------------------------------------------------------------------------
 
 /**
@@ -1005,47 +1058,71 @@ void CodeEditor::set_language(SyntaxHighlighterLanguage language) {
 //--------------------------------------------------------------------------------------------------
 
 void CodeEditor::show_markup(LineMarkup markup, size_t line) {
-  // The marker mask contains one bit for each set marker (0..31).
-  sptr_t marker_mask = _code_editor_impl->send_editor(this, SCI_MARKERGET, line, 0);
-  sptr_t new_marker_mask = 0;
-  if ((markup & mforms::LineMarkupStatement) != 0) {
-    if ((marker_mask & LineMarkupStatement) == 0)
-      new_marker_mask |= LineMarkupStatement;
-  }
-  if ((markup & mforms::LineMarkupErrorContinue) != 0) {
-    if ((marker_mask & LineMarkupErrorContinue) == 0)
-      new_marker_mask |= LineMarkupErrorContinue;
-  }
-  if ((markup & mforms::LineMarkupError) != 0) {
-    if ((marker_mask & LineMarkupError) == 0)
-      new_marker_mask |= LineMarkupError;
-  }
-  if ((markup & mforms::LineMarkupBreakpoint) != 0) {
-    if ((marker_mask & LineMarkupBreakpoint) == 0)
-      new_marker_mask |= LineMarkupBreakpoint;
-  }
-  if ((markup & mforms::LineMarkupBreakpointHit) != 0) {
-    if ((marker_mask & LineMarkupBreakpointHit) == 0)
-      new_marker_mask |= LineMarkupBreakpointHit;
+  int newMarkup = markup & LineMarkupAll & ~_markup.get(line);
+  if (newMarkup == 0)
+    return;
+
+  _markup.add(line, newMarkup);
+
+  // The marker mask contains one bit for each set marker (0..31), in the same order as our markup flags.
+  if (!updateMarkupWindow(false) && line >= _markupWindowStart && line < _markupWindowEnd)
+    _code_editor_impl->send_editor(this, SCI_MARKERADDSET, line, newMarkup);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void CodeEditor::set_markup_lines(LineMarkup markup, const std::vector<size_t>& lines) {
+  _markup.setLines(markup & LineMarkupAll, lines);
+  updateMarkupWindow(true);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+void CodeEditor::set_markup_lines(LineMarkup markup, const std::vector<size_t>& lines, size_t first_line,
+                                  size_t end_line) {
+  int flags = markup & LineMarkupAll;
+  std::vector<LineMarkupStore::Entry> previous = _markup.entries(first_line, end_line);
+  _markup.setLines(flags, lines, first_line, end_line);
+
+  if (!_markupWindowValid) {
+    updateMarkupWindow(true);
+    return;
   }
-  if ((markup & mforms::LineMarkupCurrent) != 0) {
-    if ((marker_mask & LineMarkupCurrent) == 0)
-      new_marker_mask |= LineMarkupCurrent;
+
+  // Only lines in the markup window have markers in the editor control.
+  size_t start = std::max(first_line, _markupWindowStart);
+  size_t end = std::min(end_line, _markupWindowEnd);
+  for (auto& entry : previous) {
+    if (entry.line < start || entry.line >= end)
+      continue;
+    for (int marker = 0; (1 << marker) <= LineMarkupAll; ++marker) {
+      if ((entry.markup & flags & (1 << marker)) != 0)
+        _code_editor_impl->send_editor(this, SCI_MARKERDELETE, entry.line, marker);
+    }
   }
 
-  if (new_marker_mask != 0)
-    _code_editor_impl->send_editor(this, SCI_MARKERADDSET, line, new_marker_mask);
+  for (size_t line : lines) {
+    if (line >= start && line < end)
+      _code_editor_impl->send_editor(this, SCI_MARKERADDSET, line, flags);
+  }
 }
 
 //--------------------------------------------------------------------------------------------------
 
 void CodeEditor::remove_markup(LineMarkup markup, ssize_t line) {
-  if (markup == mforms::LineMarkupAll || line < 0) {
-    if (line < 0)
-      _code_editor_impl->send_editor(this, SCI_MARKERDELETEALL, -1, 0);
-    else
-      _code_editor_impl->send_editor(this, SCI_MARKERDELETE, line, -1);
-  } else {
+  if (line < 0) {
+    _markup.clear();
+    _code_editor_impl->send_editor(this, SCI_MARKERDELETEALL, -1, 0);
+    return;
+  }
+
+  if ((_markup.get(line) & markup) == 0)
+    return;
+  _markup.remove(line, markup);
+
+  if (markup == mforms::LineMarkupAll)
+    _code_editor_impl->send_editor(this, SCI_MARKERDELETE, line, -1);
+  else {
     if ((markup & mforms::LineMarkupStatement) != 0)
       _code_editor_impl->send_editor(this, SCI_MARKERDELETE, line, CE_STATEMENT_MARKER);
     if ((markup & mforms::LineMarkupError) != 0)
@@ -1064,12 +1141,7 @@ void CodeEditor::remove_markup(LineMarkup markup, ssize_t line) {
 //--------------------------------------------------------------------------------------------------
 
 bool CodeEditor::has_markup(LineMarkup markup, size_t line) {
-  sptr_t markers = _code_editor_impl->send_editor(this, SCI_MARKERGET, line, 0);
-
-  if ((markup & markers) != 0)
-    return true;
-
-  return false;
+  return (_markup.get(line) & markup) != 0;
 }
 
 //--------------------------------------------------------------------------------------------------
@@ -1247,6 +1319,10 @@ void CodeEditor::on_notify(SCNotification* notification) {
       break;
 
     case SCN_UPDATEUI:
+      // Scrolling or line changing edits can make other lines visible, which might need markers.
+      if ((notification->updated & (SC_UPDATE_CONTENT | SC_UPDATE_V_SCROLL)) != 0)
+        updateMarkupWindow(false);
+
       switch (notification->updated) {
         case SC_UPDATE_CONTENT: // Contents, styling or markers have been changed.
           break;
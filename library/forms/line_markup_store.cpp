@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "mforms/line_markup_store.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace mforms;
+
+//----------------------------------------------------------------------------------------------------------------------
+
+LineMarkupStore::LineMarkupStore() {
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void LineMarkupStore::clear() {
+  _tree.clear();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Replaces the entire content with the given entries, which must be sorted by line (one entry per line). O(n).
+ */
+void LineMarkupStore::assign(const std::vector<Entry> &entries) {
+  _tree.clear();
+  insert(entries);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::size_t LineMarkupStore::size() const {
+  return _tree.size();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+bool LineMarkupStore::empty() const {
+  return _tree.empty();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Adds the given markup flags to a line, keeping any other markup there.
+ */
+void LineMarkupStore::add(std::size_t line, int markup) {
+  if (markup == 0)
+    return;
+
+  Tree::NodeId node = _tree.find(line);
+  if (node != 0) {
+    _tree.value(node) |= markup;
+    return;
+  }
+
+  _tree.insert(std::vector<Tree::NodeId>(1, _tree.create(line, markup)));
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes the given markup flags from a line. The entry for the line goes if no markup is left.
+ */
+void LineMarkupStore::remove(std::size_t line, int markup) {
+  Tree::NodeId node = _tree.find(line);
+  if (node == 0)
+    return;
+
+  _tree.value(node) &= ~markup;
+  if (_tree.value(node) == 0)
+    _tree.removeRange(line, line + 1);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int LineMarkupStore::get(std::size_t line) const {
+  Tree::NodeId node = _tree.find(line);
+  return node != 0 ? _tree.node(node).value : 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Sets the given markup on exactly the given lines (in any order) and removes it from all others. O(n + m log m).
+ */
+void LineMarkupStore::setLines(int markup, std::vector<std::size_t> lines) {
+  std::sort(lines.begin(), lines.end());
+  lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+
+  std::vector<Entry> current = entries();
+  std::vector<Entry> result;
+  result.reserve(current.size() + lines.size());
+
+  std::vector<Entry>::const_iterator run = current.begin();
+  std::vector<std::size_t>::const_iterator line = lines.begin();
+  while (run != current.end() || line != lines.end()) {
+    Entry entry;
+    if (line == lines.end() || (run != current.end() && run->line < *line)) {
+      entry.line = run->line;
+      entry.markup = (run++)->markup & ~markup;
+    } else if (run == current.end() || *line < run->line) {
+      entry.line = *line++;
+      entry.markup = markup;
+    } else {
+      entry.line = *line++;
+      entry.markup = (run++)->markup | markup;
+    }
+
+    if (entry.markup != 0)
+      result.push_back(entry);
+  }
+
+  assign(result);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Sets the given markup on exactly the given lines within [from, to) and removes it from all other lines in that
+ * range. Lines outside of the range are neither touched nor taken from the list. O((k + m) log n) for k entries in
+ * the range and m lines, so updating a few lines stays cheap regardless of the store size.
+ */
+void LineMarkupStore::setLines(int markup, const std::vector<std::size_t> &lines, std::size_t from, std::size_t to) {
+  for (const Entry &entry : entries(from, to)) {
+    if ((entry.markup & markup) != 0)
+      remove(entry.line, markup);
+  }
+
+  for (std::size_t line : lines) {
+    if (line >= from && line < to)
+      add(line, markup);
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Moves the markup of all lines starting with the given one down by count lines.
+ */
+void LineMarkupStore::linesInserted(std::size_t line, std::size_t count) {
+  _tree.shift(line, (std::ptrdiff_t)count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Removes the markup of the lines [line, line + count), which is returned in removed, and moves up the markup
+ * of all following lines.
+ */
+void LineMarkupStore::linesRemoved(std::size_t line, std::size_t count, std::vector<Entry> &removed) {
+  std::vector<Entry> lines = entries(line, line + count);
+  removed.insert(removed.end(), lines.begin(), lines.end());
+  _tree.removeRange(line, line + count);
+  _tree.shift(line, -(std::ptrdiff_t)count);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns all entries in order. O(n).
+ */
+std::vector<LineMarkupStore::Entry> LineMarkupStore::entries() const {
+  return entries(0, std::numeric_limits<std::size_t>::max());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+/**
+ * Returns the entries for the lines [from, to). O(log n + k).
+ */
+std::vector<LineMarkupStore::Entry> LineMarkupStore::entries(std::size_t from, std::size_t to) const {
+  std::vector<Entry> result;
+  _tree.collect(from, to, [&](Tree::NodeId node, std::size_t line) {
+    Entry entry = { line, _tree.node(node).value };
+    result.push_back(entry);
+  });
+  return result;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+void LineMarkupStore::insert(const std::vector<Entry> &entries) {
+  std::vector<Tree::NodeId> nodes;
+  nodes.reserve(entries.size());
+  for (const Entry &entry : entries)
+    nodes.push_back(_tree.create(entry.line, entry.markup));
+  _tree.insert(nodes);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
@@ -30,6 +30,7 @@
 
 #include "mforms/view.h"
 #include "mforms/utilities.h"
+#include "mforms/line_markup_store.h"
 
 /**
  * Provides a code editor with syntax highlighting for mforms.
@@ -294,9 +295,22 @@ namespace mforms {
     /** Sets the language for the syntax highlighter. */
     void set_language(SyntaxHighlighterLanguage language);
 
-    /** Adds the given markup to a line if not yet there. Does not touch other markup. */
+    /** Adds the given markup to a line if not yet there. Does not touch other markup.
+     *  Markup is kept by the editor itself and only passed on to the editor control for lines
+     *  in and around the visible area, so it is fine to have a marker on each of many thousand lines.
+     */
     void show_markup(LineMarkup markup, size_t line);
 
+    /** Sets the given markup on exactly the given lines (in any order) and removes it from all others.
+     *  Much faster than individual show_markup/remove_markup calls when many lines change at once.
+     */
+    void set_markup_lines(LineMarkup markup, const std::vector<size_t>& lines);
+
+    /** Like set_markup_lines above, but restricted to the lines [first_line, end_line). Markup outside of that
+     *  range is kept, so the cost only depends on the number of lines in the range.
+     */
+    void set_markup_lines(LineMarkup markup, const std::vector<size_t>& lines, size_t first_line, size_t end_line);
+
     /** Removes the given markup from that line, without affecting other markup (except for LineMarkupAll).
      *  If markup is LineMarkupAll then all markers are removed for the given line.
      *  If line is < 0 then all marker are removed from all lines.
@@ -536,16 +550,29 @@ namespace mforms {
       return &_char_added_event;
     }
 
-    /** Signal emitted when the Scintilla backend removes a set marker (e.g. on editing, pasting, manual marker
-     * setting).
+    /** Signal emitted when markup is removed because the lines it was set on were deleted, or moved because lines
+     *  were inserted or removed before it. Reporting moves touches every marker behind the edit point, so it only
+     *  happens while the signal has subscribers.
      *  Parameters are:
-     *    A vector of line + markup pairs.
-     *    A flag telling if those markers where deleted or only updated (moved).
+     *    A vector of original line + new line + markup entries. An empty vector means all markup was removed
+     *    (the text was cleared).
+     *    A flag telling if those markers where deleted (true) or moved (false).
      */
     boost::signals2::signal<void(const LineMarkupChangeset& changeset, bool deleted)>* signal_marker_changed() {
       return &_marker_changed_event;
     }
 
+    /** Signal emitted when the range of lines changes for which markup is shown in the editor control, which
+     *  covers the visible lines and some more above and below them (e.g. after scrolling or editing).
+     *  Can be used to lazily apply other visual decorations, like indicators, only where they can be seen.
+     *  Parameters are:
+     *    The first line in the range.
+     *    The line after the last line in the range.
+     */
+    boost::signals2::signal<void(size_t, size_t)>* signal_markup_window_changed() {
+      return &_markup_window_changed_event;
+    }
+
     boost::signals2::signal<bool(mforms::KeyCode code, mforms::ModifierKey modifier, const std::string& text)>*
     key_event_signal() {
       return &_key_event_signal;
@@ -584,9 +611,17 @@ namespace mforms {
 
     MarginSizes _marginSize;
 
+    // All line markup. Only the part in the markup window is materialized as markers in the editor control.
+    LineMarkupStore _markup;
+    size_t _markupWindowStart;
+    size_t _markupWindowEnd;
+    bool _markupWindowValid;
+
     void setupMarker(int marker, const std::string& name);
     void handleMarkerDeletion(int position, int length);
     void handleMarkerMove(int position, int linesAdded);
+    void reportMarkupMove(std::size_t line, std::ptrdiff_t linesAdded);
+    bool updateMarkupWindow(bool force);
     bool ensureImage(std::string const& name);
 
     void loadConfiguration(SyntaxHighlighterLanguage language);
@@ -599,6 +634,7 @@ namespace mforms {
     boost::signals2::signal<void(int)> _char_added_event;
     boost::signals2::signal<void()> _signal_lost_focus;
     boost::signals2::signal<void(const LineMarkupChangeset& changeset, bool deleted)> _marker_changed_event;
+    boost::signals2::signal<void(size_t, size_t)> _markup_window_changed_event;
     boost::signals2::signal<bool(mforms::KeyCode code, mforms::ModifierKey modifier, const std::string& text)>
       _key_event_signal;
 
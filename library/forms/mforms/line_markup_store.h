@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include "mforms/base.h"
+#include "base/position_treap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mforms {
+
+  /**
+   * Keeps the line markup of a code editor (a set of LineMarkup flags per line), independent of what the editor
+   * control currently shows. Entries are held in a base::PositionTreap ordered by line, so inserting or removing
+   * lines moves all markup behind the edit point in O(log n), regardless of how many markers there are. Single lines
+   * and line ranges are looked up in O(log n) (+ k for the entries returned).
+   *
+   * The class is not thread safe. Callers have to synchronize access.
+   */
+  class MFORMS_EXPORT LineMarkupStore {
+  public:
+    struct Entry {
+      std::size_t line;
+      int markup;
+    };
+
+    LineMarkupStore();
+
+    void clear();
+    void assign(const std::vector<Entry> &entries);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    void add(std::size_t line, int markup);
+    void remove(std::size_t line, int markup);
+    int get(std::size_t line) const;
+    void setLines(int markup, std::vector<std::size_t> lines);
+    void setLines(int markup, const std::vector<std::size_t> &lines, std::size_t from, std::size_t to);
+
+    void linesInserted(std::size_t line, std::size_t count);
+    void linesRemoved(std::size_t line, std::size_t count, std::vector<Entry> &removed);
+
+    std::vector<Entry> entries() const;
+    std::vector<Entry> entries(std::size_t from, std::size_t to) const;
+
+  private:
+    typedef base::PositionTreap<int> Tree;
+
+    Tree _tree;
+
+    void insert(const std::vector<Entry> &entries);
+  };
+
+}
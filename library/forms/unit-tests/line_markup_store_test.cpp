@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "mforms/code_editor.h"
+#include "mforms/line_markup_store.h"
+
+#include "wb_helpers.h"
+
+#include <map>
+
+using namespace mforms;
+
+BEGIN_TEST_DATA_CLASS(mforms_line_markup_store_test)
+protected:
+  LineMarkupStore store;
+
+  void fill(std::size_t count, std::size_t step, int markup) {
+    std::vector<LineMarkupStore::Entry> entries;
+    for (std::size_t i = 0; i < count; ++i) {
+      LineMarkupStore::Entry entry = { i * step, markup };
+      entries.push_back(entry);
+    }
+    store.assign(entries);
+  }
+END_TEST_DATA_CLASS
+
+TEST_MODULE(mforms_line_markup_store_test, "mforms line markup store tests");
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  // Adding and removing single markup flags.
+  store.add(10, LineMarkupStatement);
+  store.add(10, LineMarkupError);
+  store.add(5, LineMarkupBreakpoint);
+  ensure_equals("count", store.size(), 2U);
+  ensure_equals("combined markup", store.get(10), LineMarkupStatement | LineMarkupError);
+  ensure_equals("no markup", store.get(7), 0);
+
+  store.remove(10, LineMarkupStatement);
+  ensure_equals("partially removed", store.get(10), (int)LineMarkupError);
+  store.remove(10, LineMarkupAll);
+  ensure_equals("count after removal", store.size(), 1U);
+
+  std::vector<LineMarkupStore::Entry> entries = store.entries();
+  ensure_equals("entry count", entries.size(), 1U);
+  ensure_equals("entry line", entries[0].line, 5U);
+
+  store.clear();
+  ensure("cleared", store.empty());
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  // Inserted and removed lines move the markup behind them.
+  fill(10, 10, LineMarkupStatement); // Lines 0, 10, ..., 90.
+
+  store.linesInserted(15, 3);
+  ensure_equals("before insertion", store.get(10), (int)LineMarkupStatement);
+  ensure_equals("moved by insertion", store.get(23), (int)LineMarkupStatement);
+  ensure_equals("old line empty", store.get(20), 0);
+
+  std::vector<LineMarkupStore::Entry> removed;
+  store.linesRemoved(20, 15, removed); // Removes lines 20 - 34, i.e. the markers at 23 and 33.
+  ensure_equals("removed count", removed.size(), 2U);
+  ensure_equals("first removed", removed[0].line, 23U);
+  ensure_equals("second removed", removed[1].line, 33U);
+  ensure_equals("count", store.size(), 8U);
+  ensure_equals("moved by removal", store.get(28), (int)LineMarkupStatement); // Was 43 (originally 40).
+
+  std::vector<LineMarkupStore::Entry> range = store.entries(10, 50);
+  ensure_equals("range count", range.size(), 4U);
+  ensure_equals("range first", range[0].line, 10U);
+  ensure_equals("range last", range[3].line, 48U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(3) {
+  // Setting the lines for one markup type doesn't touch other markup.
+  store.add(1, LineMarkupBreakpoint);
+  store.add(2, LineMarkupStatement);
+
+  std::vector<std::size_t> lines;
+  lines.push_back(7);
+  lines.push_back(1);
+  lines.push_back(7);
+  store.setLines(LineMarkupStatement, lines);
+
+  ensure_equals("count", store.size(), 2U);
+  ensure_equals("combined", store.get(1), LineMarkupBreakpoint | LineMarkupStatement);
+  ensure_equals("removed", store.get(2), 0);
+  ensure_equals("added", store.get(7), (int)LineMarkupStatement);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(4) {
+  // Random edits on many markers, checked against a plain map of line to markup.
+  fill(2000, 3, LineMarkupStatement);
+  std::map<std::size_t, int> reference;
+  for (std::size_t i = 0; i < 2000; ++i)
+    reference[i * 3] = LineMarkupStatement;
+
+  std::size_t seed = 12345;
+  for (std::size_t i = 0; i < 4000; ++i) {
+    seed = (seed * 7919 + 104729) % 1000003;
+    std::size_t line = seed % 6000;
+    std::size_t count = seed % 5;
+    int markup = 1 << (seed % 6);
+
+    switch (i % 4) {
+      case 0: {
+        store.linesInserted(line, count);
+        std::map<std::size_t, int> moved;
+        for (auto &entry : reference)
+          moved[entry.first >= line ? entry.first + count : entry.first] = entry.second;
+        reference.swap(moved);
+        break;
+      }
+      case 1: {
+        std::vector<LineMarkupStore::Entry> removed;
+        store.linesRemoved(line, count, removed);
+        std::vector<LineMarkupStore::Entry> expected;
+        std::map<std::size_t, int> moved;
+        for (auto &entry : reference) {
+          if (entry.first < line)
+            moved[entry.first] = entry.second;
+          else if (entry.first >= line + count)
+            moved[entry.first - count] = entry.second;
+          else {
+            LineMarkupStore::Entry gone = { entry.first, entry.second };
+            expected.push_back(gone);
+          }
+        }
+        reference.swap(moved);
+        ensure_equals("removed count", removed.size(), expected.size());
+        for (std::size_t j = 0; j < removed.size(); ++j) {
+          ensure_equals("removed line", removed[j].line, expected[j].line);
+          ensure_equals("removed markup", removed[j].markup, expected[j].markup);
+        }
+        break;
+      }
+      case 2:
+        store.add(line, markup);
+        reference[line] |= markup;
+        break;
+      case 3:
+        store.remove(line, markup);
+        if (reference.count(line) > 0 && (reference[line] &= ~markup) == 0)
+          reference.erase(line);
+        break;
+    }
+
+    if (i % 100 == 0) {
+      std::vector<LineMarkupStore::Entry> range = store.entries(line, line + 100);
+      std::map<std::size_t, int>::const_iterator expected = reference.lower_bound(line);
+      for (auto &entry : range) {
+        ensure("range entry", expected != reference.end());
+        ensure_equals("range line", entry.line, expected->first);
+        ensure_equals("range markup", entry.markup, expected->second);
+        ++expected;
+      }
+      ensure("range end", expected == reference.end() || expected->first >= line + 100);
+    }
+  }
+
+  ensure_equals("count after edits", store.size(), reference.size());
+  std::vector<LineMarkupStore::Entry> entries = store.entries();
+  std::map<std::size_t, int>::const_iterator expected = reference.begin();
+  for (auto &entry : entries) {
+    ensure_equals("line after edits", entry.line, expected->first);
+    ensure_equals("markup after edits", entry.markup, expected->second);
+    ++expected;
+  }
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(5) {
+  // Setting the lines for a line range only changes markup within that range.
+  fill(10, 2, LineMarkupStatement);
+  store.add(6, LineMarkupError);
+
+  std::vector<std::size_t> lines;
+  lines.push_back(1);
+  lines.push_back(5);
+  lines.push_back(7);
+  lines.push_back(12);
+  store.setLines(LineMarkupStatement, lines, 4, 10);
+
+  ensure_equals("before range", store.get(2), (int)LineMarkupStatement);
+  ensure_equals("ignored line", store.get(1), 0);
+  ensure_equals("removed", store.get(4), 0);
+  ensure_equals("added", store.get(5), (int)LineMarkupStatement);
+  ensure_equals("other markup", store.get(6), (int)LineMarkupError);
+  ensure_equals("added 2", store.get(7), (int)LineMarkupStatement);
+  ensure_equals("removed 2", store.get(8), 0);
+  ensure_equals("after range", store.get(10), (int)LineMarkupStatement);
+  ensure_equals("ignored line 2", store.get(12), (int)LineMarkupStatement);
+  ensure_equals("count", store.size(), 10U);
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+END_TESTS
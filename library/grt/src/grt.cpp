@@ -575,10 +575,10 @@ ObjectRef GRT::find_object_by_id(const std::string &id, const std::string &subpa
 //--------------------------------------------------------------------------------------------------
 
 void GRT::serialize(const ValueRef &value, const std::string &path, const std::string &doctype,
-                    const std::string &version, bool list_objects_as_links) {
+                    const std::string &version, bool list_objects_as_links, bool parallel) {
   internal::Serializer ser;
 
-  ser.save_to_xml(value, path, doctype, version, list_objects_as_links);
+  ser.save_to_xml(value, path, doctype, version, list_objects_as_links, parallel);
 }
 
 std::shared_ptr<grt::internal::Unserializer> GRT::get_unserializer() {
@@ -612,6 +612,19 @@ ValueRef GRT::unserialize(const std::string &path, std::string &doctype_ret, std
   }
 }
 
+ValueRef GRT::unserialize_mapped(const std::string &path, const std::string &required_version,
+                                 std::string &doctype_ret, std::string &version_ret) {
+  internal::Unserializer unser(_check_serialized_crc);
+
+  if (!g_file_test(path.c_str(), G_FILE_TEST_EXISTS))
+    throw os_error(path);
+  try {
+    return unser.load_from_mapped_xml(path, required_version, &doctype_ret, &version_ret);
+  } catch (std::exception &exc) {
+    throw grt_runtime_error("Error unserializing GRT data from " + path, exc.what());
+  }
+}
+
 xmlDocPtr GRT::load_xml(const std::string &path) {
   return base::xml::loadXMLDoc(path);
 }
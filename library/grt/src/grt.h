@@ -2474,11 +2474,16 @@ namespace grt {
     }
 
     // serialization
+    // parallel serializes big object lists on several threads, for saving large documents.
     void serialize(const ValueRef &value, const std::string &path, const std::string &doctype = "",
-                   const std::string &version = "", bool list_objects_as_links = false);
+                   const std::string &version = "", bool list_objects_as_links = false, bool parallel = false);
     ValueRef unserialize(const std::string &path, std::shared_ptr<grt::internal::Unserializer> unserializer =
                                                     std::shared_ptr<grt::internal::Unserializer>());
     ValueRef unserialize(const std::string &path, std::string &doctype_ret, std::string &version_ret);
+    // Streams a document of the given version from a memory mapped file. Returns an invalid value if the
+    // document cannot be loaded this way (e.g. a different version), use unserialize() then.
+    ValueRef unserialize_mapped(const std::string &path, const std::string &required_version,
+                                std::string &doctype_ret, std::string &version_ret);
     std::shared_ptr<grt::internal::Unserializer> get_unserializer();
 
     xmlDocPtr load_xml(const std::string &path);
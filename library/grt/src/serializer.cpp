@@ -30,12 +30,22 @@
 
 #include <glib.h>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+
 #include "base/log.h"
 #include "base/file_functions.h"
 
 #define GRT_FILE_VERSION_TAG "grt_format"
 #define GRT_FILE_VERSION "2.0"
 
+// In parallel saves, the objects of lists with at least this many items are serialized as separate fragments.
+#define MIN_FRAGMENT_LIST_SIZE 16
+// Worker threads are only started for at least this many fragments, below that they don't pay off.
+#define MIN_PARALLEL_FRAGMENTS 512
+
 #define new_node(node, name, value) xmlNewTextChild(node, NULL, (xmlChar *)name, (xmlChar *)value)
 
 DEFAULT_LOG_DOMAIN("serializer")
@@ -53,8 +63,7 @@ static xmlNodePtr new_int_node(xmlNodePtr node, const char *name, int value) {
 using namespace grt;
 using namespace grt::internal;
 
-xmlDocPtr internal::Serializer::create_xmldoc_for_value(const ValueRef &value, const std::string &doctype,
-                                                        const std::string &docversion, bool list_objects_as_links) {
+xmlDocPtr internal::Serializer::create_xmldoc(const std::string &doctype, const std::string &docversion) {
   xmlDocPtr doc;
 
   doc = xmlNewDoc((xmlChar *)"1.0");
@@ -67,12 +76,141 @@ xmlDocPtr internal::Serializer::create_xmldoc_for_value(const ValueRef &value, c
   if (!docversion.empty())
     set_prop(doc->children, "version", docversion.c_str());
 
-  serialize_value(value, doc->children, list_objects_as_links);
+  return doc;
+}
+
+xmlDocPtr internal::Serializer::create_xmldoc_for_value(const ValueRef &value, const std::string &doctype,
+                                                        const std::string &docversion, bool list_objects_as_links,
+                                                        bool parallel) {
+  xmlDocPtr doc = create_xmldoc(doctype, docversion);
+
+  // Objects in big lists are left out in this pass and serialized in parallel afterwards.
+  std::vector<Fragment> fragments;
+  if (parallel && std::thread::hardware_concurrency() > 1)
+    _fragments = &fragments;
+
+  try {
+    serialize_value(value, doc->children, list_objects_as_links);
+  } catch (...) {
+    _fragments = NULL;
+    xmlFreeDoc(doc);
+    throw;
+  }
+  _fragments = NULL;
+
+  bool complete = true;
+  try {
+    if (!fragments.empty())
+      complete = complete_fragments(fragments);
+  } catch (...) {
+    xmlFreeDoc(doc);
+    throw;
+  }
+
+  if (!complete) {
+    // Values are shared between fragments, so the parallel result would differ from what a sequential run
+    // writes (the full value at its first occurrence and links everywhere else). Start over sequentially.
+    xmlFreeDoc(doc);
+    _cache.clear();
+
+    doc = create_xmldoc(doctype, docversion);
+    serialize_value(value, doc->children, list_objects_as_links);
+  }
 
   return doc;
 }
 
-internal::Serializer::Serializer() {
+internal::Serializer::Serializer() : _fragments(NULL) {
+}
+
+/**
+ * Serializes the objects left out by the main pass on worker threads and moves the results into the document.
+ * Each fragment is serialized with its own set of seen values. The result is only the same as that of
+ * a sequential run if no value was fully serialized in more than one place (the main pass or a fragment),
+ * otherwise the document is left as it is and false is returned.
+ *
+ * The GRT is not thread safe in general, but the workers only read values: they follow stored members (calculated
+ * ones are skipped, see serialize_member) and the metaclasses, which don't change once loaded. The only thing they
+ * write to is the refcount of the values they hold, which is atomic. What makes this safe is that the calling
+ * thread, which owns the values, is blocked here until all workers are done, so nothing can modify the values
+ * meanwhile. Loading is different, it creates objects, registers them and sets their members, so it has to stay
+ * on one thread.
+ */
+bool internal::Serializer::complete_fragments(std::vector<Fragment> &fragments) {
+  // Must be called on the main thread before libxml is used from several threads.
+  xmlInitParser();
+
+  std::atomic<size_t> next(0);
+  auto worker = [&fragments, &next]() {
+    size_t index;
+    while ((index = next++) < fragments.size()) {
+      Fragment &fragment = fragments[index];
+      Serializer serializer;
+      xmlNodePtr parent = xmlNewNode(NULL, (xmlChar *)"fragment");
+
+      try {
+        fragment.node = serializer.serialize_value(fragment.object, parent, false);
+      } catch (...) {
+        xmlFreeNode(parent);
+        next = fragments.size();
+        throw;
+      }
+      xmlUnlinkNode(fragment.node);
+      xmlFreeNode(parent);
+      fragment.seen.swap(serializer._cache);
+    }
+  };
+
+  size_t thread_count = 1;
+  if (fragments.size() >= MIN_PARALLEL_FRAGMENTS)
+    thread_count = std::min<size_t>(std::thread::hardware_concurrency(), fragments.size());
+  std::vector<std::future<void> > workers;
+  std::exception_ptr error;
+  try {
+    for (size_t i = 1; i < thread_count; ++i)
+      workers.push_back(std::async(std::launch::async, worker));
+    worker();
+  } catch (...) {
+    error = std::current_exception();
+    next = fragments.size();
+  }
+  for (auto &future : workers) {
+    try {
+      future.get();
+    } catch (...) {
+      if (!error)
+        error = std::current_exception();
+    }
+  }
+
+  bool disjoint = !error;
+  std::unordered_set<void *> seen(_cache);
+  for (auto fragment = fragments.begin(); disjoint && fragment != fragments.end(); ++fragment) {
+    for (auto ptr : fragment->seen) {
+      if (!seen.insert(ptr).second) {
+        disjoint = false;
+        break;
+      }
+    }
+  }
+
+  for (auto &fragment : fragments) {
+    if (fragment.node == NULL)
+      continue;
+
+    if (disjoint) {
+      xmlReplaceNode(fragment.placeholder, fragment.node);
+      xmlFreeNode(fragment.placeholder);
+    } else
+      xmlFreeNode(fragment.node);
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+
+  if (disjoint)
+    _cache.swap(seen);
+  return disjoint;
 }
 
 static int base_xmlSaveFile(const char *filename, xmlDocPtr doc) {
@@ -118,13 +256,14 @@ static int base_xmlSaveFile(const char *filename, xmlDocPtr doc) {
  * @param filename name of file to store data
  * @param type document format type
  * @param version version of document format
+ * @param parallel serialize big object lists on several threads, meant for saving large documents
  *
  ****************************************************************************/
 void internal::Serializer::save_to_xml(const ValueRef &value, const std::string &path, const std::string &doctype,
-                                       const std::string &docversion, bool list_objects_as_links) {
+                                       const std::string &docversion, bool list_objects_as_links, bool parallel) {
   xmlDocPtr doc;
 
-  doc = create_xmldoc_for_value(value, doctype, docversion, list_objects_as_links);
+  doc = create_xmldoc_for_value(value, doctype, docversion, list_objects_as_links, parallel);
 
   if (base_xmlSaveFile(path.c_str(), doc) == -1) {
     xmlFreeDoc(doc);
@@ -201,6 +340,8 @@ xmlNodePtr internal::Serializer::serialize_value(const ValueRef &value, xmlNodeP
       if (!list.content_class_name().empty())
         set_prop(node, "content-struct-name", list.content_class_name().c_str());
 
+      bool split = _fragments != NULL && !list_objects_as_links && list.count() >= MIN_FRAGMENT_LIST_SIZE;
+
       // check if the list is part of a struct and has no 'owned' set,
       // it should serialize the contents as links
       for (size_t c = list.count(), i = 0; i < c; i++) {
@@ -210,6 +351,13 @@ xmlNodePtr internal::Serializer::serialize_value(const ValueRef &value, xmlNodeP
           if (list_objects_as_links && cvalue.type() == ObjectType) {
             xmlNodePtr child = new_node(node, "link", ObjectRef::cast_from(cvalue).id().c_str());
             set_prop(child, "type", "object");
+          } else if (split && cvalue.type() == ObjectType) {
+            // Serialized later, see complete_fragments().
+            Fragment fragment;
+            fragment.object = ObjectRef::cast_from(cvalue);
+            fragment.placeholder = new_node(node, "value", NULL);
+            fragment.node = NULL;
+            _fragments->push_back(fragment);
           } else
             serialize_value(cvalue, node, false);
         } else {
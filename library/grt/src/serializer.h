@@ -25,7 +25,8 @@
 
 #include "grt.h"
 
-#include <set>
+#include <unordered_set>
+#include <vector>
 
 namespace grt {
   namespace internal {
@@ -34,16 +35,30 @@ namespace grt {
       Serializer();
 
       void save_to_xml(const ValueRef &value, const std::string &path, const std::string &doctype = "",
-                       const std::string &docversion = "", bool list_objects_as_links = false);
+                       const std::string &docversion = "", bool list_objects_as_links = false, bool parallel = false);
 
       xmlDocPtr create_xmldoc_for_value(const ValueRef &value, const std::string &doctype,
-                                        const std::string &docversion, bool list_objects_as_links);
+                                        const std::string &docversion, bool list_objects_as_links,
+                                        bool parallel = false);
 
       std::string serialize_to_xmldata(const ValueRef &value, const std::string &type, const std::string &version,
                                        bool list_objects_as_links);
 
     protected:
-      std::set<void *> _cache;
+      // An object from a big list which is serialized on a worker thread, into a node that later takes the place
+      // of the placeholder node in the document.
+      struct Fragment {
+        ObjectRef object;
+        xmlNodePtr placeholder;
+        xmlNodePtr node;
+        std::unordered_set<void *> seen;
+      };
+
+      std::unordered_set<void *> _cache;
+      std::vector<Fragment> *_fragments;
+
+      xmlDocPtr create_xmldoc(const std::string &doctype, const std::string &docversion);
+      bool complete_fragments(std::vector<Fragment> &fragments);
 
       xmlNodePtr serialize_value(const ValueRef &value, xmlNodePtr parent, bool owned_objects);
       xmlNodePtr serialize_object(const Ref<Object> &object, xmlNodePtr parent);
@@ -29,6 +29,11 @@
 #include "base/log.h"
 #include "base/xml_functions.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <memory>
+
 DEFAULT_LOG_DOMAIN(DOMAIN_GRT)
 
 using namespace grt;
@@ -58,6 +63,64 @@ ValueRef internal::Unserializer::load_from_xml(const std::string &path, std::str
   return value;
 }
 
+/**
+ * Loads a document from a memory mapped file, streaming over the XML text instead of building a DOM first, which
+ * takes several times the memory of the file itself for large documents. All objects are created upfront from
+ * a quick scan over the object elements, so links can be resolved while reading, regardless of their order.
+ *
+ * Returns an invalid value (without loading anything) if the document has a different version than the required
+ * one (unless that is empty) or contains null list entries, which might need fixes on XML level before they can be
+ * loaded. Use load_from_xml in that case.
+ */
+ValueRef internal::Unserializer::load_from_mapped_xml(const std::string &path, const std::string &required_version,
+                                                      std::string *doctype, std::string *docversion) {
+  GError *error = NULL;
+  GMappedFile *file = g_mapped_file_new(path.c_str(), FALSE, &error);
+  if (file == NULL) {
+    std::string message = error != NULL ? error->message : "unknown error";
+    g_clear_error(&error);
+    throw std::runtime_error("unable to map XML file " + path + ": " + message);
+  }
+  std::shared_ptr<GMappedFile> file_guard(file, g_mapped_file_unref);
+
+  const char *data = g_mapped_file_get_contents(file);
+  size_t size = g_mapped_file_get_length(file);
+
+  XmlObjectScan scan;
+  if (data == NULL || size > INT_MAX || !scan.scan(data, size))
+    return ValueRef();
+
+  if (doctype && docversion) {
+    *doctype = scan.doctype();
+    *docversion = scan.version();
+  }
+
+  if (scan.has_null_entries() || (!required_version.empty() && scan.version() != required_version))
+    return ValueRef();
+
+  _source_name = path;
+  for (auto &entry : scan.objects())
+    _cache[entry.id] = create_object(entry.struct_name, entry.id, entry.checksum, 0);
+
+  xmlTextReaderPtr reader = xmlReaderForMemory(data, (int)size, path.c_str(), NULL, 0);
+  if (reader == NULL)
+    throw std::runtime_error("unable to parse XML file " + path);
+  std::shared_ptr<xmlTextReader> reader_guard(reader, xmlFreeTextReader);
+
+  // The document value is the first value element in the root node.
+  int result;
+  while ((result = xmlTextReaderRead(reader)) == 1) {
+    if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT && xmlTextReaderDepth(reader) == 1 &&
+        xmlStrcmp(xmlTextReaderConstName(reader), (xmlChar *)"value") == 0)
+      return read_value(reader);
+  }
+
+  if (result < 0)
+    throw std::runtime_error("unable to parse XML file " + path);
+
+  return ValueRef();
+}
+
 ValueRef internal::Unserializer::unserialize_xmldoc(xmlDocPtr doc, const std::string &source_path) {
   xmlNodePtr root;
   ValueRef value;
@@ -123,41 +186,10 @@ void internal::Unserializer::traverse_xml_creating_objects(xmlNodePtr node) {
 
 ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node) {
   if (strcmp((char *)node->name, "link") == 0) {
-    std::string link_id;
-
     // this is a link instead of a value, look up for the original value and
     // return it
-    link_id = base::xml::getContent(node);
-    ValueRef value = find_cached(link_id);
-
-    if (!value.is_valid() && (_invalid_cache.find(link_id) == _invalid_cache.end())) {
-      // if link is not object, then quit
-      std::string node_type = base::xml::getProp(node, "type");
-      if (node_type.empty() || node_type != "object") {
-        logWarning("%s: link of type '%s' could not be resolved during unserialized", _source_name.c_str(),
-                   node_type.c_str());
-        return ValueRef();
-      }
-
-      // we have looked up already
-      // check if the object was loaded in the 1st step
-
-      // if the linked object is not in the current tree, look for it in the global tree
-      ObjectRef object(grt::GRT::get()->find_object_by_id(link_id, "/"));
-
-      if (object.is_valid())
-        _cache[object->id()] = object;
-      else
-        _invalid_cache.insert(link_id);
-      value = object;
-
-      if (!value.is_valid() /*&& base::xml::getProp(node, "key") != "owner"*/)
-        logWarning("%s:%i: link '%s' <%s %s> key=%s could not be resolved\n", _source_name.c_str(), node->line,
-                   link_id.c_str(), base::xml::getProp(node, "type").c_str(),
-                   base::xml::getProp(node, "struct-name").c_str(), base::xml::getProp(node, "key").c_str());
-    }
-
-    return value;
+    return resolve_link(base::xml::getContent(node), node->line,
+                        [node](const char *name) { return base::xml::getProp(node, name); });
   } else if (strcmp((char *)node->name, "value") != 0)
     return ValueRef();
 
@@ -185,31 +217,8 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node) {
       break;
 
     case DictType: {
-      std::string ptr;
-      DictRef dict;
-
-      // check if the dictionary was already created
-      ptr = base::xml::getProp(node, "_ptr_");
-      if (!ptr.empty())
-        value = find_cached(ptr);
-
-      if (!value.is_valid()) {
-        std::string prop = base::xml::getProp(node, "content-type");
-        if (!prop.empty()) {
-          Type content_type = str_to_type(prop);
-          if (content_type != UnknownType) {
-            std::string content_class_name = base::xml::getProp(node, "content-struct-name");
-
-            value = dict = DictRef(content_type, content_class_name);
-          } else
-            throw std::runtime_error("Error parsing XML. Invalid type " + prop);
-        } else
-          value = dict = DictRef(true);
-
-        if (!ptr.empty())
-          _cache[ptr] = value;
-      } else
-        dict = DictRef::cast_from(value);
+      DictRef dict = create_dict([node](const char *name) { return base::xml::getProp(node, name); });
+      value = dict;
 
       xmlNodePtr child = node->children;
       while (child) {
@@ -226,25 +235,10 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node) {
     }
 
     case ListType: {
-      Type content_type = str_to_type(base::xml::getProp(node, "content-type"));
-      std::string cclass_name = base::xml::getProp(node, "content-struct-name");
       xmlNodePtr child;
-      std::string prop;
-      BaseListRef list;
-
-      prop = base::xml::getProp(node, "_ptr_");
-
-      if (!prop.empty()) {
-        // look up for this ptr, in case the owner object already has created this list
-        value = find_cached(prop);
-        if (!value.is_valid()) {
-          value = list = BaseListRef(content_type, cclass_name);
-
-          _cache[prop] = value;
-        } else
-          list = BaseListRef::cast_from(value);
-      } else
-        value = list = BaseListRef(content_type, cclass_name);
+      BaseListRef list = create_list([node](const char *name) { return base::xml::getProp(node, name); });
+      std::string cclass_name = list.content_class_name();
+      value = list;
 
       child = node->children;
       while (child) {
@@ -294,32 +288,39 @@ ValueRef internal::Unserializer::traverse_xml_recreating_tree(xmlNodePtr node) {
 }
 
 ObjectRef internal::Unserializer::unserialize_object_step1(xmlNodePtr node) {
-  MetaClass *gstruct;
-  std::string id;
-
   std::string prop = base::xml::getProp(node, "type");
   if (prop != "object")
     throw std::runtime_error("error unserializing object (unexpected type)");
 
-  prop = base::xml::getProp(node, "struct-name");
-  if (prop.empty())
+  return create_object(base::xml::getProp(node, "struct-name"), base::xml::getProp(node, "id"),
+                       base::xml::getProp(node, "struct-checksum"), node->line);
+}
+
+/**
+ * Allocates an (empty) object of the given struct. Its members are filled in a second step.
+ * Line is the position of the object in the source (for messages), if known (> 0).
+ */
+ObjectRef internal::Unserializer::create_object(const std::string &struct_name, const std::string &id,
+                                                const std::string &checksum, int line) {
+  if (struct_name.empty())
     throw std::runtime_error("error unserializing object (missing struct-name)");
 
-  gstruct = grt::GRT::get()->get_metaclass(prop);
+  MetaClass *gstruct = grt::GRT::get()->get_metaclass(struct_name);
   if (!gstruct) {
-    logWarning("%s:%i: error unserializing object: struct '%s' unknown", _source_name.c_str(), node->line,
-               prop.c_str());
-    throw std::runtime_error(base::strfmt("error unserializing object (struct '%s' unknown)", prop.c_str()));
+    if (line > 0)
+      logWarning("%s:%i: error unserializing object: struct '%s' unknown", _source_name.c_str(), line,
+                 struct_name.c_str());
+    else
+      logWarning("%s: error unserializing object: struct '%s' unknown", _source_name.c_str(), struct_name.c_str());
+    throw std::runtime_error(base::strfmt("error unserializing object (struct '%s' unknown)", struct_name.c_str()));
   }
 
-  id = base::xml::getProp(node, "id");
   if (id.empty())
     throw std::runtime_error("missing id in unserialized object");
 
-  prop = base::xml::getProp(node, "struct-checksum");
-  if (!prop.empty()) {
-    unsigned int checksum = (unsigned int)strtol(prop.c_str(), NULL, 0);
-    if (_check_serialized_crc && checksum != gstruct->crc32()) {
+  if (!checksum.empty()) {
+    unsigned int crc = (unsigned int)strtol(checksum.c_str(), NULL, 0);
+    if (_check_serialized_crc && crc != gstruct->crc32()) {
       logWarning("current checksum of struct of serialized object %s (%s) differs from the one when it was saved",
                  id.c_str(), gstruct->name().c_str());
     }
@@ -331,6 +332,94 @@ ObjectRef internal::Unserializer::unserialize_object_step1(xmlNodePtr node) {
   return value;
 }
 
+/**
+ * Looks up the object a link refers to, first in the objects of the document, then in the global tree.
+ * The property reader gives access to the attributes of the link element (only needed if the link cannot be
+ * resolved).
+ */
+ValueRef internal::Unserializer::resolve_link(const std::string &link_id, int line, const PropertyReader &prop) {
+  ValueRef value = find_cached(link_id);
+
+  if (!value.is_valid() && (_invalid_cache.find(link_id) == _invalid_cache.end())) {
+    // if link is not object, then quit
+    std::string node_type = prop("type");
+    if (node_type.empty() || node_type != "object") {
+      logWarning("%s: link of type '%s' could not be resolved during unserialized", _source_name.c_str(),
+                 node_type.c_str());
+      return ValueRef();
+    }
+
+    // we have looked up already
+    // check if the object was loaded in the 1st step
+
+    // if the linked object is not in the current tree, look for it in the global tree
+    ObjectRef object(grt::GRT::get()->find_object_by_id(link_id, "/"));
+
+    if (object.is_valid())
+      _cache[object->id()] = object;
+    else
+      _invalid_cache.insert(link_id);
+    value = object;
+
+    if (!value.is_valid() /*&& prop("key") != "owner"*/)
+      logWarning("%s:%i: link '%s' <%s %s> key=%s could not be resolved\n", _source_name.c_str(), line,
+                 link_id.c_str(), node_type.c_str(), prop("struct-name").c_str(), prop("key").c_str());
+  }
+
+  return value;
+}
+
+/**
+ * Returns the dictionary for a dict element. If its owner object already created it, that one is reused.
+ */
+DictRef internal::Unserializer::create_dict(const PropertyReader &prop) {
+  ValueRef value;
+
+  // check if the dictionary was already created
+  std::string ptr = prop("_ptr_");
+  if (!ptr.empty())
+    value = find_cached(ptr);
+
+  if (value.is_valid())
+    return DictRef::cast_from(value);
+
+  DictRef dict;
+  std::string type = prop("content-type");
+  if (!type.empty()) {
+    Type content_type = str_to_type(type);
+    if (content_type != UnknownType)
+      dict = DictRef(content_type, prop("content-struct-name"));
+    else
+      throw std::runtime_error("Error parsing XML. Invalid type " + type);
+  } else
+    dict = DictRef(true);
+
+  if (!ptr.empty())
+    _cache[ptr] = dict;
+
+  return dict;
+}
+
+/**
+ * Returns the list for a list element. If its owner object already created it, that one is reused.
+ */
+BaseListRef internal::Unserializer::create_list(const PropertyReader &prop) {
+  std::string ptr = prop("_ptr_");
+
+  if (!ptr.empty()) {
+    // look up for this ptr, in case the owner object already has created this list
+    ValueRef value = find_cached(ptr);
+    if (value.is_valid())
+      return BaseListRef::cast_from(value);
+  }
+
+  BaseListRef list(str_to_type(prop("content-type")), prop("content-struct-name"));
+  if (!ptr.empty())
+    _cache[ptr] = list;
+
+  return list;
+}
+
 ObjectRef internal::Unserializer::unserialize_object_step2(xmlNodePtr node) {
   std::string id = base::xml::getProp(node, "id");
 
@@ -415,3 +504,426 @@ ValueRef internal::Unserializer::unserialize_xmldata(const char *data, size_t si
 
   return value;
 }
+
+//----------------- Streaming unserialization -------------------------------------------------------------------------
+
+static std::string reader_prop(xmlTextReaderPtr reader, const char *name) {
+  xmlChar *prop = xmlTextReaderGetAttribute(reader, (xmlChar *)name);
+  std::string tmp = prop ? (char *)prop : "";
+  xmlFree(prop);
+  return tmp;
+}
+
+static std::string reader_content(xmlTextReaderPtr reader) {
+  xmlChar *content = xmlTextReaderReadString(reader);
+  std::string tmp = content ? (char *)content : "";
+  xmlFree(content);
+  return tmp;
+}
+
+static int reader_line(xmlTextReaderPtr reader) {
+  return (int)xmlGetLineNo(xmlTextReaderCurrentNode(reader));
+}
+
+static void read_next(xmlTextReaderPtr reader) {
+  if (xmlTextReaderRead(reader) != 1)
+    throw std::runtime_error("unexpected end of XML data");
+}
+
+/**
+ * Moves the reader from the start of an element to its end.
+ */
+static void skip_element(xmlTextReaderPtr reader) {
+  if (xmlTextReaderIsEmptyElement(reader) == 1)
+    return;
+
+  int depth = xmlTextReaderDepth(reader);
+  do
+    read_next(reader);
+  while (xmlTextReaderNodeType(reader) != XML_READER_TYPE_END_ELEMENT || xmlTextReaderDepth(reader) != depth);
+}
+
+/**
+ * Calls the handler for each child element of the current element. The handler must leave the reader at the end
+ * of the child element. Afterwards the reader is at the end of the current element.
+ */
+static void read_children(xmlTextReaderPtr reader, const std::function<void()> &handler) {
+  if (xmlTextReaderIsEmptyElement(reader) == 1)
+    return;
+
+  int depth = xmlTextReaderDepth(reader);
+  while (true) {
+    read_next(reader);
+    int type = xmlTextReaderNodeType(reader);
+    if (type == XML_READER_TYPE_END_ELEMENT && xmlTextReaderDepth(reader) == depth)
+      break;
+    if (type == XML_READER_TYPE_ELEMENT)
+      handler();
+  }
+}
+
+/**
+ * The streaming counterpart of traverse_xml_recreating_tree. The reader must be at the start of a value or link
+ * element and is at its end when this function returns.
+ */
+ValueRef internal::Unserializer::read_value(xmlTextReaderPtr reader) {
+  PropertyReader prop = [reader](const char *name) { return reader_prop(reader, name); };
+  const char *name = (const char *)xmlTextReaderConstName(reader);
+
+  if (strcmp(name, "link") == 0) {
+    ValueRef value = resolve_link(reader_content(reader), reader_line(reader), prop);
+    skip_element(reader);
+    return value;
+  } else if (strcmp(name, "value") != 0) {
+    skip_element(reader);
+    return ValueRef();
+  }
+
+  std::string node_type = prop("type");
+  if (node_type.empty())
+    throw std::runtime_error(std::string("Node '").append(name).append("' in xml doesn't have a type property"));
+
+  ValueRef value;
+  switch (str_to_type(node_type)) {
+    case IntegerType:
+      value = IntegerRef(strtol(reader_content(reader).c_str(), NULL, 0));
+      skip_element(reader);
+      break;
+
+    case DoubleType:
+      value = DoubleRef(base::atof<double>(reader_content(reader)));
+      skip_element(reader);
+      break;
+
+    case StringType:
+      value = StringRef(reader_content(reader));
+      skip_element(reader);
+      break;
+
+    case DictType: {
+      DictRef dict = create_dict(prop);
+      value = dict;
+
+      read_children(reader, [&]() {
+        std::string key = reader_prop(reader, "key");
+        if (!key.empty())
+          dict.set(key, read_value(reader));
+        else
+          skip_element(reader);
+      });
+      break;
+    }
+
+    case ListType: {
+      BaseListRef list = create_list(prop);
+      value = list;
+
+      bool failed = false;
+      read_children(reader, [&]() {
+        if (failed) {
+          skip_element(reader);
+          return;
+        }
+
+        if (xmlStrcmp(xmlTextReaderConstName(reader), (xmlChar *)"null") == 0) {
+          if (!list->null_allowed())
+            logWarning("%s: Attempt o add null value to %s list", _source_name.c_str(),
+                       list.content_class_name().c_str());
+          list.ginsert(ValueRef());
+          skip_element(reader);
+          return;
+        }
+
+        int line = reader_line(reader);
+        std::string child_name = (const char *)xmlTextReaderConstName(reader);
+        ValueRef sub_value = read_value(reader);
+        if (sub_value.is_valid()) {
+          try {
+            list.ginsert(sub_value);
+          } catch (const std::exception &exc) {
+            logWarning("%s: Error inserting %s to list: %s", _source_name.c_str(),
+                       sub_value.debugDescription().c_str(), exc.what());
+            throw;
+          }
+        } else {
+          // error!
+          logWarning("%s: skipping element '%s' in unserialized document, line %i", _source_name.c_str(),
+                     child_name.c_str(), line);
+          failed = true;
+        }
+      });
+
+      if (failed)
+        value.clear();
+      break;
+    }
+
+    case ObjectType: {
+      std::string id = prop("id");
+      if (id.empty())
+        throw std::runtime_error(std::string("missing id property unserializing node ").append(name));
+
+      ObjectRef object = ObjectRef::cast_from(find_cached(id));
+      if (!object.is_valid())
+        logWarning("%s: Unknown object-id '%s' in unserialized file", _source_name.c_str(), id.c_str());
+      read_object_contents(object, reader);
+      value = object;
+      break;
+    }
+
+    default:
+      skip_element(reader);
+      break;
+  }
+
+  return value;
+}
+
+/**
+ * The streaming counterpart of unserialize_object_contents.
+ */
+void internal::Unserializer::read_object_contents(const ObjectRef &object, xmlTextReaderPtr reader) {
+  MetaClass *mc = object->get_metaclass();
+
+  read_children(reader, [&]() {
+    std::string key = reader_prop(reader, "key");
+    if (key.empty()) {
+      skip_element(reader);
+      return;
+    }
+
+    if (!object->has_member(key)) {
+      logWarning("in %s: %s", object.id().c_str(),
+                 std::string("unserialized XML contains invalid member " + object.class_name() + "::" + key).c_str());
+      skip_element(reader);
+      return;
+    }
+
+    // Containers which were already created by the object are reused (see unserialize_object_contents).
+    ValueRef sub_value = object->get_member(key);
+    if (sub_value.is_valid()) {
+      std::string ptr = reader_prop(reader, "_ptr_");
+      if (!ptr.empty())
+        _cache[ptr] = sub_value;
+    }
+
+    try {
+      sub_value = read_value(reader);
+    } catch (grt::null_value &exc) {
+      logWarning("%s in %s:%s %s", exc.what(), object->class_name().c_str(), key.c_str(), object->id().c_str());
+      throw;
+    }
+    if (sub_value.is_valid()) {
+      try {
+        mc->set_member_internal((internal::Object *)object.valueptr(), key, sub_value, true);
+      } catch (const std::exception &exc) {
+        logWarning("exception setting %s<%s>:%s to %s %s", object.id().c_str(), object.class_name().c_str(),
+                   key.c_str(), sub_value.debugDescription().c_str(), exc.what());
+        throw;
+      }
+    }
+  });
+}
+
+//----------------- XmlObjectScan -------------------------------------------------------------------------------------
+
+static bool is_xml_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static const char *find_text(const char *start, const char *end, const char *text) {
+  size_t length = strlen(text);
+  const char *result = std::search(start, end, text, text + length);
+  return result == end ? NULL : result + length;
+}
+
+/**
+ * Decodes the predefined XML entities and character references in an attribute value.
+ */
+static std::string decode_xml_text(const char *start, const char *end) {
+  const char *amp = (const char *)memchr(start, '&', end - start);
+  if (amp == NULL)
+    return std::string(start, end);
+
+  std::string result(start, amp);
+  while (amp < end) {
+    if (*amp != '&') {
+      result += *amp++;
+      continue;
+    }
+
+    const char *semicolon = (const char *)memchr(amp, ';', end - amp);
+    if (semicolon == NULL) {
+      result.append(amp, end);
+      break;
+    }
+
+    std::string entity(amp + 1, semicolon);
+    if (entity == "amp")
+      result += '&';
+    else if (entity == "lt")
+      result += '<';
+    else if (entity == "gt")
+      result += '>';
+    else if (entity == "quot")
+      result += '"';
+    else if (entity == "apos")
+      result += '\'';
+    else if (entity.size() > 1 && entity[0] == '#') {
+      gunichar c = (gunichar)(entity[1] == 'x' ? strtoul(entity.c_str() + 2, NULL, 16)
+                                                : strtoul(entity.c_str() + 1, NULL, 10));
+      char buffer[6];
+      result.append(buffer, g_unichar_to_utf8(c, buffer));
+    } else
+      result.append(amp, semicolon + 1);
+    amp = semicolon + 1;
+  }
+
+  return result;
+}
+
+internal::XmlObjectScan::XmlObjectScan() : _has_null_entries(false) {
+}
+
+/**
+ * Scans the given XML text (as written by the serializer) and records the ids, struct names and checksums of all
+ * object elements, in document order. This only looks at the markup, so it is much faster than a real parser.
+ * Returns false if the text has content which is not supported by the scanner (e.g. a DTD) or is not well formed,
+ * as far as the scanner can tell.
+ */
+bool internal::XmlObjectScan::scan(const char *data, size_t size) {
+  _doctype.clear();
+  _version.clear();
+  _has_null_entries = false;
+  _objects.clear();
+
+  size_t open_elements = 0;
+  bool have_root = false;
+  const char *end = data + size;
+  const char *run = data;
+  while ((run = (const char *)memchr(run, '<', end - run)) != NULL) {
+    if (run + 1 == end)
+      return false;
+
+    switch (run[1]) {
+      case '?': // Processing instruction (e.g. the XML declaration).
+        run = find_text(run + 2, end, "?>");
+        break;
+
+      case '!':
+        if (find_text(run, std::min(run + 4, end), "<!--") != NULL)
+          run = find_text(run + 4, end, "-->");
+        else if (find_text(run, std::min(run + 9, end), "<![CDATA[") != NULL)
+          run = find_text(run + 9, end, "]]>");
+        else
+          return false; // A document type declaration, which might define entities.
+        break;
+
+      case '/': { // End tag.
+        run = (const char *)memchr(run, '>', end - run);
+        if (run == NULL || open_elements == 0)
+          return false;
+
+        --open_elements;
+        ++run;
+        break;
+      }
+
+      default: { // Start tag.
+        const char *name = run + 1;
+        run = name;
+        while (run < end && !is_xml_space(*run) && *run != '>' && *run != '/')
+          ++run;
+        std::string tag(name, run);
+
+        const char *type = NULL, *type_end = NULL;
+        Entry entry;
+        bool empty_element = false;
+        while (true) {
+          while (run < end && is_xml_space(*run))
+            ++run;
+          if (run == end)
+            return false;
+
+          if (*run == '>') {
+            ++run;
+            break;
+          }
+          if (*run == '/') {
+            if (run + 1 == end || run[1] != '>')
+              return false;
+            run += 2;
+            empty_element = true;
+            break;
+          }
+
+          const char *attribute = run;
+          while (run < end && *run != '=' && !is_xml_space(*run))
+            ++run;
+          const char *attribute_end = run;
+          while (run < end && is_xml_space(*run))
+            ++run;
+          if (run == end || *run != '=')
+            return false;
+          ++run;
+          while (run < end && is_xml_space(*run))
+            ++run;
+          if (run == end || (*run != '"' && *run != '\''))
+            return false;
+
+          const char *value = run + 1;
+          const char *value_end = (const char *)memchr(value, *run, end - value);
+          if (value_end == NULL)
+            return false;
+          run = value_end + 1;
+
+          std::string attribute_name(attribute, attribute_end);
+          if (attribute_name == "type") {
+            type = value;
+            type_end = value_end;
+          } else if (attribute_name == "id")
+            entry.id = decode_xml_text(value, value_end);
+          else if (attribute_name == "struct-name")
+            entry.struct_name = decode_xml_text(value, value_end);
+          else if (attribute_name == "struct-checksum")
+            entry.checksum = decode_xml_text(value, value_end);
+          else if (!have_root && attribute_name == "document_type")
+            _doctype = decode_xml_text(value, value_end);
+          else if (!have_root && attribute_name == "version")
+            _version = decode_xml_text(value, value_end);
+        }
+        have_root = true;
+
+        if (tag == "value" && type != NULL && std::string(type, type_end) == "object")
+          _objects.push_back(entry);
+        else if (tag == "null")
+          _has_null_entries = true;
+
+        if (!empty_element)
+          ++open_elements;
+        break;
+      }
+    }
+
+    if (run == NULL)
+      return false;
+  }
+
+  return have_root && open_elements == 0;
+}
+
+const std::string &internal::XmlObjectScan::doctype() const {
+  return _doctype;
+}
+
+const std::string &internal::XmlObjectScan::version() const {
+  return _version;
+}
+
+bool internal::XmlObjectScan::has_null_entries() const {
+  return _has_null_entries;
+}
+
+const std::vector<internal::XmlObjectScan::Entry> &internal::XmlObjectScan::objects() const {
+  return _objects;
+}
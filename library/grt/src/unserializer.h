@@ -24,21 +24,55 @@
 #pragma once
 
 #include "grt.h"
+
+#include <functional>
+#include <libxml/xmlreader.h>
 #include <set>
 
 namespace grt {
   namespace internal {
+    // The object elements of a serialized GRT document, found by a quick scan over its raw text (e.g. a memory
+    // mapped file) instead of parsing it into a DOM, plus the document meta info. It keeps no positions in the text:
+    // it is only used to create all objects before the values are read in one streaming pass.
+    class XmlObjectScan {
+    public:
+      struct Entry {
+        std::string id;
+        std::string struct_name;
+        std::string checksum;
+      };
+
+      XmlObjectScan();
+
+      bool scan(const char *data, size_t size);
+
+      const std::string &doctype() const;
+      const std::string &version() const;
+      bool has_null_entries() const;
+      const std::vector<Entry> &objects() const;
+
+    private:
+      std::string _doctype;
+      std::string _version;
+      bool _has_null_entries;
+      std::vector<Entry> _objects;
+    };
+
     class Unserializer {
     public:
       Unserializer(bool check_crc);
 
       ValueRef load_from_xml(const std::string &path, std::string *doctype = 0, std::string *docversion = 0);
+      ValueRef load_from_mapped_xml(const std::string &path, const std::string &required_version,
+                                    std::string *doctype = 0, std::string *docversion = 0);
 
       ValueRef unserialize_xmldoc(xmlDocPtr doc, const std::string &source_path = "");
 
       ValueRef unserialize_xmldata(const char *data, size_t size);
 
     protected:
+      typedef std::function<std::string(const char *)> PropertyReader;
+
       std::string _source_name;
       std::map<std::string, ValueRef> _cache;
       std::set<std::string> _invalid_cache;
@@ -52,6 +86,15 @@ namespace grt {
       ObjectRef unserialize_object_step2(xmlNodePtr node);
       void unserialize_object_contents(const ObjectRef &object, xmlNodePtr node);
       ValueRef find_cached(const std::string &id);
+
+      ObjectRef create_object(const std::string &struct_name, const std::string &id, const std::string &checksum,
+                              int line);
+      ValueRef resolve_link(const std::string &link_id, int line, const PropertyReader &prop);
+      DictRef create_dict(const PropertyReader &prop);
+      BaseListRef create_list(const PropertyReader &prop);
+
+      ValueRef read_value(xmlTextReaderPtr reader);
+      void read_object_contents(const ObjectRef &object, xmlTextReaderPtr reader);
     };
   };
 };
@@ -101,6 +101,12 @@ namespace mtemplate {
   //-----------------------------------------------------------------------------------
   //  Dictionary stuff
   //-----------------------------------------------------------------------------------
+  Dictionary::~Dictionary() {
+    for (auto &section : _section_dictionaries)
+      for (DictionaryInterface *item : section.second)
+        delete item;
+  }
+
   void Dictionary::setValue(const base::utf8string &key, const base::utf8string &value) {
     _dictionary[key] = value;
   }
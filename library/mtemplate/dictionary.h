@@ -98,8 +98,7 @@ namespace mtemplate {
     Dictionary(const base::utf8string &name, DictionaryInterface *parent = NULL)
       : DictionaryInterface(name), _parent(parent) {
     }
-    virtual ~Dictionary() {
-    }
+    virtual ~Dictionary();
 
     //  DictionaryInterface
     virtual void setValue(const base::utf8string &key, const base::utf8string &value);
@@ -24,6 +24,8 @@
 #include "output.h"
 #include <base/file_functions.h>
 
+#include <vector>
+
 namespace mtemplate {
 
   TemplateOutput::TemplateOutput() {
@@ -53,4 +55,74 @@ namespace mtemplate {
     fwrite(str.data(), 1, str.bytes(), _file.file());
   }
 
+  //-----------------------------------------------------------------------------------
+  //  TemplateOutputSpool stuff
+  //-----------------------------------------------------------------------------------
+  TemplateOutputSpool::TemplateOutputSpool(std::size_t memory_threshold)
+    : _file(nullptr), _threshold(memory_threshold) {
+  }
+
+  TemplateOutputSpool::~TemplateOutputSpool() {
+    if (_file != nullptr)
+      fclose(_file);
+  }
+
+  void TemplateOutputSpool::out(const base::utf8string &str) {
+    if (_file != nullptr) {
+      fwrite(str.data(), 1, str.bytes(), _file);
+      return;
+    }
+
+    _buffer.append(str.data(), str.bytes());
+    if (_buffer.size() > _threshold) {
+      // If we cannot get a temp file we simply keep collecting in memory.
+      _file = tmpfile();
+      if (_file != nullptr) {
+        fwrite(_buffer.data(), 1, _buffer.size(), _file);
+        std::string().swap(_buffer);
+      }
+    }
+  }
+
+  void TemplateOutputSpool::replay(TemplateOutput *output) {
+    if (_file == nullptr) {
+      if (!_buffer.empty())
+        output->out(_buffer);
+      return;
+    }
+
+    fflush(_file);
+    rewind(_file);
+
+    const std::size_t chunk_size = 64 * 1024;
+    std::string chunk;
+    std::vector<char> buffer(chunk_size);
+    std::size_t count;
+    while ((count = fread(buffer.data(), 1, chunk_size, _file)) > 0) {
+      chunk.append(buffer.data(), count);
+
+      // Never pass on a partial UTF-8 sequence, keep it for the next round.
+      std::size_t end = chunk.size();
+      std::size_t lead = end;
+      while (lead > 0 && end - lead < 3 && ((unsigned char)chunk[lead - 1] & 0xC0) == 0x80)
+        --lead;
+      if (lead > 0 && ((unsigned char)chunk[lead - 1] & 0x80) != 0) {
+        unsigned char c = (unsigned char)chunk[lead - 1];
+        std::size_t expected = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 1;
+        if (end - (lead - 1) < expected)
+          end = lead - 1;
+      }
+
+      if (end > 0) {
+        output->out(chunk.substr(0, end));
+        chunk.erase(0, end);
+      }
+    }
+    if (!chunk.empty())
+      output->out(chunk);
+
+    // Further output goes after what we have so far.
+    fseek(_file, 0, SEEK_END);
+  }
+
 } //  namespace mtemplate
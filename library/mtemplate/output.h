@@ -27,7 +27,9 @@
 
 #include "base/utf8string.h"
 #include "base/file_utilities.h"
-// class FILE;
+
+#include <cstdio>
+#include <string>
 
 namespace mtemplate {
 
@@ -55,4 +57,23 @@ namespace mtemplate {
     virtual void out(const base::utf8string &str);
   };
 
+  /**
+   * @brief Collects output in memory up to a given threshold and moves it into an anonymous temporary file
+   *        once the threshold is exceeded. The collected text can be replayed into another output (in chunks).
+   *        Used to keep memory bounded when parts of a document are rendered out of order.
+   */
+  class MTEMPLATELIBRARY_PUBLIC_FUNC TemplateOutputSpool : public TemplateOutput {
+    std::string _buffer;
+    FILE *_file;
+    std::size_t _threshold;
+
+  public:
+    TemplateOutputSpool(std::size_t memory_threshold = 1024 * 1024);
+    virtual ~TemplateOutputSpool();
+
+    virtual void out(const base::utf8string &str);
+
+    void replay(TemplateOutput *output);
+  };
+
 } //  namespace mtemplate
@@ -64,6 +64,24 @@ namespace mtemplate {
     }
   }
 
+  void Template::expand(DictionaryInterface *dict, TemplateOutput *output, const SectionExpander &expander) {
+    for (NodeStorageType node : _document) {
+      if (node->type() == TemplateObject_Section)
+        expander(node->_text, output);
+      else
+        node->expand(output, dict);
+    }
+  }
+
+  void Template::expandSection(const base::utf8string &section, DictionaryInterface *dict, TemplateOutput *output) {
+    for (NodeStorageType node : _document) {
+      if (node->type() == TemplateObject_Section && node->_text == section) {
+        node->expand(output, dict);
+        break;
+      }
+    }
+  }
+
   Template *GetTemplate(const base::utf8string &path, PARSE_TYPE type) {
     if (type == STRIP_WHITESPACE)
       throw std::invalid_argument("STRIP_WHITESPACE");
@@ -29,6 +29,7 @@
 #include "modifier.h"
 #include "output.h"
 
+#include <functional>
 #include <string>
 
 namespace mtemplate {
@@ -38,10 +39,25 @@ namespace mtemplate {
     TemplateDocument _document;
 
   public:
+    typedef std::function<void(const base::utf8string &section, TemplateOutput *output)> SectionExpander;
+
     Template(TemplateDocument document);
     ~Template();
 
     void expand(DictionaryInterface *dict, TemplateOutput *output);
+
+    /**
+     * @brief Expands the template like the plain expand() but leaves rendering of top level sections to the
+     *        given callback. Together with expandSection() this allows to render top level section instances
+     *        as soon as they are complete instead of keeping their dictionaries until the end.
+     */
+    void expand(DictionaryInterface *dict, TemplateOutput *output, const SectionExpander &expander);
+
+    /**
+     * @brief Renders a single instance of the top level section with the given name, using the passed dictionary
+     *        as section dictionary. If a section name is used more than once on top level, the first one wins.
+     */
+    void expandSection(const base::utf8string &section, DictionaryInterface *dict, TemplateOutput *output);
     void dump(int indent = 0);
   };
 
@@ -253,4 +253,49 @@ TEST_FUNCTION(4) {
               compare_file_contents("data/mtemplate/test_result.html", "test_output/test_result.html"));
 }
 
+TEST_FUNCTION(5) {
+  // Rendering top level sections one by one through spools must give the same result as expanding
+  // a complete dictionary tree.
+  mtemplate::Template tpl(mtemplate::parseTemplate(
+    "Header\n{{#ITEM}}- {{NAME}}{{#SUB}} [{{VALUE}}]{{/SUB}}\n{{/ITEM}}Middle\n{{#OTHER}}{{NAME}}\n{{/OTHER}}Footer\n",
+    mtemplate::DO_NOT_STRIP));
+
+  mtemplate::Dictionary *dictionary = mtemplate::CreateMainDictionary();
+  for (auto item : language_details_map) {
+    mtemplate::DictionaryInterface *item_dictionary = dictionary->addSectionDictionary("ITEM");
+    item_dictionary->setValue("NAME", item.first);
+    item_dictionary->setValueAndShowSection("VALUE", item.second, "SUB");
+    dictionary->addSectionDictionary("OTHER")->setValue("NAME", item.second);
+  }
+  mtemplate::TemplateOutputString expected;
+  tpl.expand(dictionary, &expected);
+  delete dictionary;
+
+  // A tiny threshold forces the spools to go through temporary files.
+  mtemplate::TemplateOutputSpool item_spool(16);
+  mtemplate::TemplateOutputSpool other_spool(16);
+  mtemplate::Dictionary *main_dictionary = mtemplate::CreateMainDictionary();
+  for (auto item : language_details_map) {
+    mtemplate::Dictionary item_dictionary("/ITEM/", main_dictionary);
+    item_dictionary.setValue("NAME", item.first);
+    item_dictionary.setValueAndShowSection("VALUE", item.second, "SUB");
+    tpl.expandSection("ITEM", &item_dictionary, &item_spool);
+
+    mtemplate::Dictionary other_dictionary("/OTHER/", main_dictionary);
+    other_dictionary.setValue("NAME", item.second);
+    tpl.expandSection("OTHER", &other_dictionary, &other_spool);
+  }
+
+  mtemplate::TemplateOutputString streamed;
+  tpl.expand(main_dictionary, &streamed, [&](const base::utf8string &section, mtemplate::TemplateOutput *output) {
+    if (section == "ITEM")
+      item_spool.replay(output);
+    else if (section == "OTHER")
+      other_spool.replay(output);
+  });
+  delete main_dictionary;
+
+  ensure_equals("Streamed output", streamed.get(), expected.get());
+}
+
 END_TESTS
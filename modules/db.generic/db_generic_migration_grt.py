@@ -32,29 +32,16 @@ ModuleInfo = DefineModule(name= "DbGenericMigration", author= "Oracle Corp.", ve
 
 truncated_identifier_serial = 0
 key_names = {}
+column_migration_rules = {}
 class GenericMigration(object):
     ## Note: do not add member variables in this class or subclasses
 
     def findMatchingTargetObject(self, state, sourceObject):
-        """Finds the matching target object for a given source object, by searching in the migrationLog"""
-        for log in state.migrationLog:
-            if type(log.logObject) == type(sourceObject)\
-               and type(log.logObject.owner) == type(sourceObject.owner)\
-               and log.logObject.owner.name == sourceObject.owner.name\
-               and log.logObject.name.lower() == sourceObject.name.lower():
-                return log.refObject
-        return None
+        """Finds the matching target object for a given source object, by looking it up in the migrationLog"""
+        return state.findMatchingTargetObject(sourceObject)
         
     def findDatatypeMapping(self, state, column, datatype):
-        if state.genericDatatypeMappings:
-            for typemap in state.genericDatatypeMappings:
-                if typemap.sourceDatatypeName.upper() == datatype.upper():
-                    if typemap.lengthConditionFrom > 0 and column.length > 0 and not (typemap.lengthConditionFrom <= column.length):
-                        continue
-                    if typemap.lengthConditionTo > 0 and column.length > 0 and not (typemap.lengthConditionTo >= column.length):
-                        continue
-                    return typemap        
-        return None
+        return state.lookupDatatypeMapping(column, datatype)
 
     def shouldMigrate(self, state, otype, object):
         if "%s:*" % otype in state.ignoreList or "%s:%s.%s" % (otype, object.owner.name, object.name) in state.ignoreList:
@@ -76,10 +63,6 @@ class GenericMigration(object):
         return mysql_name
 
     def migrateDatatypeForColumn(self, state, source_column, target_column):
-        targetCatalog = state.targetCatalog
-    
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
@@ -94,13 +77,14 @@ class GenericMigration(object):
             # check the type mapping table
             typemap = self.findDatatypeMapping(state, source_column, source_datatype)
             if typemap:
-                if not mysql_simpleTypes.has_key(typemap.targetDatatypeName.upper()):
+                mysql_type = state.lookupTargetDatatype(typemap.targetDatatypeName)
+                if not mysql_type:
                     grt.log_warning("migrateTableColumnsToMySQL", "Can't find mapped datatype %s for type %s\n" % (typemap.targetDatatypeName, source_datatype))
                     state.addMigrationLogEntry(2, source_column, target_column, 
                         'Unknown mapped datatype "%s" for source type "%s" (check type mapping table)' % (typemap.targetDatatypeName, source_datatype) )
                     return False
 
-                target_column.simpleType = mysql_simpleTypes[typemap.targetDatatypeName.upper()]
+                target_column.simpleType = mysql_type
                 if typemap.length > -2:
                     target_column.length = typemap.length
                 if typemap.scale > -2:
@@ -112,8 +96,8 @@ class GenericMigration(object):
                         target_column.flags.append("UNSIGNED")
 
             # try a direct mapping to mysql types
-            elif mysql_simpleTypes.has_key(target_datatype.upper()):
-                target_column.simpleType = mysql_simpleTypes[target_datatype.upper()]
+            elif state.lookupTargetDatatype(target_datatype):
+                target_column.simpleType = state.lookupTargetDatatype(target_datatype)
             else:
                 grt.log_warning("migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column, 
@@ -266,20 +250,8 @@ class GenericMigration(object):
         
         if True:
             # migrate columns 1st, because everything else depend on them
-            column_collations = set()
-            for sourceColumn in sourceTable.columns:
-                targetColumn = self.migrateTableColumnToMySQL(state, sourceColumn, targetTable)
-                if targetColumn:
-                    targetTable.columns.append(targetColumn)
-                    if targetColumn.collationName:
-                        column_collations.add(targetColumn.collationName)
-
-            # check if all columns are of the same collation and if so, just make them inherit from table default
-            if len(column_collations) == 1 and targetTable.defaultCollationName == "":
-                for column in targetTable.columns:
-                    column.collationName = ""
-                targetTable.defaultCollationName = column_collations.pop()
-            
+            self.migrateTableColumnsToMySQL(state, sourceTable, targetTable)
+
             # indexes next, because FKs and PK depend on them
             for sourceIndex in sourceTable.indices:
                 targetIndex = self.migrateTableIndexToMySQL(state, sourceIndex, targetTable)
@@ -325,6 +297,98 @@ class GenericMigration(object):
         return targetTable
 
 
+    def columnMigrationRules(self, target_version):
+        """Returns the rules used by state.migrateTableColumns() to migrate the columns of a table natively, or None
+        to migrate them one by one with migrateTableColumnToMySQL().
+
+        The rules must give the same results as migrateIdentifier(), migrateCharsetCollation() and
+        migrateColumnDefaultValue(). Whatever they don't cover is passed to these methods and to
+        migrateDatatypeForColumn(), which should get its datatype mappings from migrateDatatypeWithRules() so that
+        they are kept in one place. See db_migration_Migration::migrateTableColumns() for the format."""
+        return None
+
+    def _columnMigrationRules(self, state):
+        # (rules dict, same rules as a GRT dict), both made once per target version
+        version = state.targetCatalog.version
+        key = (self.__class__.__name__, version.majorNumber, version.minorNumber, version.releaseNumber)
+        if key not in column_migration_rules:
+            rules = self.columnMigrationRules(version)
+            grt_rules = None
+            if rules:
+                # Convert the rules once, so that the native side can reuse them for all tables
+                grt_rules = grt.Dict()
+                for name, value in rules.items():
+                    grt_rules[name] = value
+            column_migration_rules[key] = (rules, grt_rules)
+        return column_migration_rules[key]
+
+    def getColumnMigrationRules(self, state):
+        return self._columnMigrationRules(state)[1]
+
+    def migrateDatatypeWithRules(self, state, source_datatype, source_column, target_column):
+        """Applies the first datatype rule of columnMigrationRules() for source_datatype that matches the source column
+        to the target column, like state.migrateTableColumns() does, except for setting its simpleType.
+        Returns the name of the target datatype, or None if there's no such rule."""
+        rules = self._columnMigrationRules(state)[0]
+        if not rules:
+            return None
+        for rule in rules.get('datatypes', {}).get(source_datatype.upper(), []):
+            if not all(rule.get('min' + name, value) <= value <= rule.get('max' + name, value)
+                       for name, value in (('Length', source_column.length), ('Precision', source_column.precision),
+                                           ('Scale', source_column.scale))):
+                continue
+            if 'length' in rule:
+                target_column.length = rule['length']
+            if 'precision' in rule:
+                target_column.precision = rule['precision']
+            if 'scale' in rule:
+                target_column.scale = rule['scale']
+            if 'autoIncrement' in rule:
+                target_column.autoIncrement = rule['autoIncrement']
+            if rule.get('autoIncrementMember') and hasattr(source_column, rule['autoIncrementMember']):
+                target_column.autoIncrement = getattr(source_column, rule['autoIncrementMember'])
+            if rule.get('characterSet'):
+                target_column.characterSetName = rule['characterSet']
+            for flag in rule.get('flags', []):
+                if flag not in target_column.flags:
+                    target_column.flags.append(flag)
+            if rule.get('message'):
+                state.addMigrationLogEntry(rule.get('messageType', 0), source_column, target_column, rule['message'])
+            return rule['target']
+        return None
+
+    def migrateTableColumnsToMySQL(self, state, sourceTable, targetTable):
+        target_catalog = targetTable.owner.owner
+        rules = self.getColumnMigrationRules(state)
+        if rules:
+            for pending in state.migrateTableColumns(sourceTable, targetTable, rules):
+                source_column, target_column = pending['sourceColumn'], pending['targetColumn']
+                if pending.get('identifier', 0):
+                    log = state.findMigrationLogEntry(source_column, target_column)
+                    target_column.name = self.migrateIdentifier(source_column.name, log, dots_allowed=True)
+                if pending.get('datatype', 0):
+                    self.migrateDatatypeForColumn(state, source_column, target_column)
+                if pending.get('defaultValue', 0):
+                    target_column.defaultValue = self.migrateColumnDefaultValue(state, source_column.defaultValue, source_column, target_column)
+                if (target_catalog.version.majorNumber, target_catalog.version.minorNumber, target_catalog.version.releaseNumber) < (5, 6, 5):
+                    self.secondary_default_value_validation(state, source_column, target_column)
+            return
+
+        column_collations = set()
+        for sourceColumn in sourceTable.columns:
+            targetColumn = self.migrateTableColumnToMySQL(state, sourceColumn, targetTable)
+            if targetColumn:
+                targetTable.columns.append(targetColumn)
+                if targetColumn.collationName:
+                    column_collations.add(targetColumn.collationName)
+
+        # check if all columns are of the same collation and if so, just make them inherit from table default
+        if len(column_collations) == 1 and targetTable.defaultCollationName == "":
+            for column in targetTable.columns:
+                column.collationName = ""
+            targetTable.defaultCollationName = column_collations.pop()
+
+
     def migrateTableToMySQL2ndPass(self, state, sourceTable, targetTable):
         for sourceFK in sourceTable.foreignKeys:
             targetFK = self.migrateTableForeignKeyToMySQL(state, sourceFK, targetTable)
@@ -37,6 +37,10 @@ ModuleInfo = DefineModule(name= "DbGenericRE", author= "Oracle Corp.", version="
 class GenericReverseEngineering(object):
     _connections = {}
 
+    # See use_bulk_columns()
+    bulk_columns_min_tables = 10
+    bulk_columns_min_share = 0.5
+
 
     @classmethod
     def check_interruption(cls):
@@ -70,6 +74,48 @@ class GenericReverseEngineering(object):
         else:
             raise NotConnectedError("No open connection to %s" % connection_object.hostIdentifier)
 
+    @classmethod
+    def get_odbc_datatypes(cls, connection_object):
+        """Returns a dict mapping the ODBC data type codes to the driver type names, queried once per connection."""
+        connection_info = cls._connections[connection_object.__id__]
+        if 'odbc_datatypes' not in connection_info:
+            connection_info['odbc_datatypes'] = dict( (dtype.data_type, dtype.type_name) for dtype in cls.get_connection(connection_object).cursor().getTypeInfo() )
+        return connection_info['odbc_datatypes']
+
+    @classmethod
+    def use_bulk_columns(cls, connection_object, catalog_name, schema_name, table_names):
+        """Tells whether the columns of the given tables are better fetched with one catalog call for the whole schema.
+
+        That call also returns the columns of all other tables, views and system tables in the schema, so it is only
+        worth it if the given tables are a good part of them and more than a few.
+        """
+        if len(table_names) < cls.bulk_columns_min_tables:
+            return False
+        schema_objects = len(cls.get_connection(connection_object).cursor().tables(catalog=catalog_name, schema=schema_name).fetchall())
+        return len(table_names) >= cls.bulk_columns_min_share * schema_objects
+
+    @classmethod
+    def get_table_columns(cls, connection_object, table):
+        """Returns the SQLColumns rows for a table.
+
+        While the tables of a schema are reverse engineered the columns of all of them may be fetched in a single
+        catalog call (see reverseEngineerTables), otherwise the table is queried on its own.
+        """
+        schema = table.owner
+        catalog = schema.owner
+        cached_schemas = cls._connections[connection_object.__id__].get('schema_columns', {})
+        if (catalog.name, schema.name) in cached_schemas:
+            schema_columns = cached_schemas[(catalog.name, schema.name)]
+            if schema_columns is None:
+                schema_columns = {}
+                for column_info in cls.get_connection(connection_object).cursor().columns(catalog=catalog.name, schema=schema.name):
+                    if column_info[1] and column_info[1] != schema.name:  # the schema name is a search pattern
+                        continue
+                    schema_columns.setdefault(column_info[2], []).append(column_info)  # table_name
+                cached_schemas[(catalog.name, schema.name)] = schema_columns
+            return schema_columns.get(table.name, [])
+        return cls.get_connection(connection_object).cursor().columns(catalog=catalog.name, schema=schema.name, table=table.name).fetchall()
+
     # Note: try to avoid executing SQL code within this module
     @classmethod
     def execute_query(cls, connection_object, query, *args, **kwargs):
@@ -416,19 +462,28 @@ class GenericReverseEngineering(object):
             getCommentForTable = cls.getCommentForTable if hasattr(cls, 'getCommentForTable') else lambda conn, tbl:''
             total = len(table_names) + 1e-10
             i = 0.0
-            for table_name in table_names:
-                grt.send_progress(i / total, 'Retrieving table %s.%s...' % (schema.name, table_name))
-                table = grt.classes.db_Table()
-                table.name = table_name
-                schema.tables.append(table)
-                table.owner = schema
-                table.comment = getCommentForTable(connection, table)
+
+            # Let get_table_columns() fetch the columns of the whole schema at once instead of issuing a catalog
+            # call per table, which is very slow with remote ODBC drivers
+            if cls.use_bulk_columns(connection, catalog.name, schema.name, table_names):
+                cls._connections[connection.__id__].setdefault('schema_columns', {})[(catalog.name, schema.name)] = None
+
+            try:
+                for table_name in table_names:
+                    grt.send_progress(i / total, 'Retrieving table %s.%s...' % (schema.name, table_name))
+                    table = grt.classes.db_Table()
+                    table.name = table_name
+                    schema.tables.append(table)
+                    table.owner = schema
+                    table.comment = getCommentForTable(connection, table)
         
-                cls.reverseEngineerTableColumns(connection, table)
-                cls.reverseEngineerTablePK(connection, table)
-                cls.reverseEngineerTableIndices(connection, table)
+                    cls.reverseEngineerTableColumns(connection, table)
+                    cls.reverseEngineerTablePK(connection, table)
+                    cls.reverseEngineerTableIndices(connection, table)
         
-                i += 1.0
+                    i += 1.0
+            finally:
+                cls._connections[connection.__id__].get('schema_columns', {}).pop((catalog.name, schema.name), None)
             progress_flags.add('%s_tables_first_pass' % schema.name)
         else:  # Second pass
             i = 0.0
@@ -449,9 +504,9 @@ class GenericReverseEngineering(object):
         simple_datatypes_list = [ datatype.name.upper() for datatype in catalog.simpleDatatypes ]
         user_datatypes_list   = [ datatype.name.upper() for datatype in catalog.userDatatypes ]
 
-        odbc_datatypes = dict( (dtype.data_type, dtype.type_name) for dtype in cls.get_connection(connection).cursor().getTypeInfo() )
+        odbc_datatypes = cls.get_odbc_datatypes(connection)
 
-        table_columns = cls.get_connection(connection).cursor().columns(catalog=catalog.name, schema=schema.name, table=table.name)
+        table_columns = cls.get_table_columns(connection, table)
         for column_info in table_columns:
             column = grt.classes.db_Column()
             column.name = column_info[3]  # column_name
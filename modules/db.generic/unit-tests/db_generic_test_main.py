@@ -0,0 +1,84 @@
+# Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2.0,
+# as published by the Free Software Foundation.
+#
+# This program is also distributed with certain software (including
+# but not limited to OpenSSL) that is licensed under separate terms, as
+# designated in a particular file or component or in included license
+# documentation.  The authors of MySQL hereby grant you an additional
+# permission to link the program and your derivative works with the
+# separately licensed software that they have included with MySQL.
+# This program is distributed in the hope that it will be useful,  but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+# the GNU General Public License, version 2.0, for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+import os
+import sys
+import glob
+import unittest
+
+import grt
+
+try:
+    import coverage
+except ImportError:
+    has_coverage = False
+else:
+    has_coverage = True
+
+CURRENT_DIR = os.path.abspath(os.path.dirname(__file__))
+SRC_DIR = os.path.abspath(os.path.join(CURRENT_DIR, '../../../'))
+
+# The SQLite ODBC driver as registered with unixODBC (see odbcinst.ini)
+test_params = { 'odbcDriver'    : 'SQLite3',
+               }
+
+def create_connection(database):
+    driver = None
+    for rdbms in grt.root.wb.rdbmsMgmt.rdbms:
+        if rdbms.name == 'Generic':
+            for rdbms_driver in rdbms.drivers:
+                if rdbms_driver.__id__ == 'com.mysql.rdbms.generic.driver.odbc_connstr':
+                    driver = rdbms_driver
+            break
+
+    conn = None
+    if driver:
+        conn = grt.classes.db_mgmt_Connection()
+        conn.driver = driver
+        conn.name = database
+        conn.hostIdentifier = "Generic@" + database
+        conn.parameterValues['connection_string'] = 'DRIVER=%s;DATABASE=%s' % (test_params['odbcDriver'], database)
+
+    return conn
+
+
+if __name__ == '__main__':
+    if has_coverage:
+        cov = coverage.coverage()
+        cov.start()
+
+    os.chdir(CURRENT_DIR)
+    sys.path[:0] = [ CURRENT_DIR, os.path.abspath(os.path.join(CURRENT_DIR, '..')), os.path.join(SRC_DIR, 'library/python') ]
+
+    suite = unittest.TestSuite()
+    names = [ os.path.splitext(fname)[0] for fname in glob.glob("test_*.py") ]
+    suite.addTest(unittest.defaultTestLoader.loadTestsFromNames(names))
+
+    result = unittest.TextTestRunner(stream=open(os.path.join(SRC_DIR, 'testing/python/test_results_db.generic.txt'), 'w'), verbosity=2).run(suite)
+
+    if has_coverage:
+        cov.stop()
+        report_file = open(os.path.join(SRC_DIR, 'testing/python/coverage_db_generic_report.txt'), 'a')
+        cov.report(file=report_file)
+        report_file.write('\n\n')
+
+    if not result.wasSuccessful():
+        sys.exit(1)
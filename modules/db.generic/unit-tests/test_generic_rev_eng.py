@@ -0,0 +1,134 @@
+# Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2.0,
+# as published by the Free Software Foundation.
+#
+# This program is also distributed with certain software (including
+# but not limited to OpenSSL) that is licensed under separate terms, as
+# designated in a particular file or component or in included license
+# documentation.  The authors of MySQL hereby grant you an additional
+# permission to link the program and your derivative works with the
+# separately licensed software that they have included with MySQL.
+# This program is distributed in the hope that it will be useful,  but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+# the GNU General Public License, version 2.0, for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+import os
+import sqlite3
+import tempfile
+import time
+import unittest
+
+import grt
+
+import db_generic_test_main
+from db_generic_re_grt import GenericReverseEngineering
+
+TABLE_COUNT = 2000
+COLUMN_COUNT = 10
+
+class TestGenericRevEngColumns(unittest.TestCase):
+    """Fetching the columns of a schema with one SQLColumns call against a call per table, over the SQLite ODBC
+    driver and unixODBC. Every catalog call is a round trip with remote drivers, so the difference is much bigger
+    there, but it is noticeable with a local driver already."""
+
+    @classmethod
+    def setUpClass(cls):
+        fd, cls.database = tempfile.mkstemp(suffix='.sqlite')
+        os.close(fd)
+        db = sqlite3.connect(cls.database)
+        for t in range(TABLE_COUNT):
+            db.execute('CREATE TABLE table_%i (id INTEGER PRIMARY KEY, %s)' %
+                       (t, ', '.join('column_%i VARCHAR(%i)' % (c, c + 1) for c in range(COLUMN_COUNT - 1))))
+        db.commit()
+        db.close()
+
+        cls.connection = db_generic_test_main.create_connection(cls.database)
+        GenericReverseEngineering.connect(cls.connection, '')
+
+        catalog_name = GenericReverseEngineering.getCatalogNames(cls.connection)[0]
+        cls.catalog = GenericReverseEngineering.reverseEngineerCatalog(cls.connection, catalog_name)
+        cls.schema = cls.catalog.schemata[0]
+        for table_name in GenericReverseEngineering.getTableNames(cls.connection, catalog_name, cls.schema.name):
+            table = grt.classes.db_Table()
+            table.name = table_name
+            table.owner = cls.schema
+            cls.schema.tables.append(table)
+
+    @classmethod
+    def tearDownClass(cls):
+        GenericReverseEngineering.disconnect(cls.connection)
+        os.remove(cls.database)
+
+    def _fetch_columns(self, bulk):
+        """Returns the column names and types of all tables and the time it took to fetch them."""
+        connection_info = GenericReverseEngineering._connections[self.connection.__id__]
+        key = (self.catalog.name, self.schema.name)
+        if bulk:
+            connection_info.setdefault('schema_columns', {})[key] = None
+        start = time.time()
+        try:
+            columns = dict((table.name, [(row[3], row[4], row[6]) for row in GenericReverseEngineering.get_table_columns(self.connection, table)])
+                           for table in self.schema.tables)
+        finally:
+            connection_info.get('schema_columns', {}).pop(key, None)
+        return columns, time.time() - start
+
+    def test_bulk_columns_match_per_table(self):
+        per_table_columns, _ = self._fetch_columns(False)
+        bulk_columns, _ = self._fetch_columns(True)
+        self.assertEqual(len(per_table_columns), TABLE_COUNT)
+        self.assertEqual(len(per_table_columns['table_0']), COLUMN_COUNT)
+        self.assertEqual(bulk_columns, per_table_columns)
+
+    def _count_columns_calls(self, bulk):
+        """Returns the number of SQLColumns calls made to fetch the columns of all tables."""
+        calls = []
+        connection_info = GenericReverseEngineering._connections[self.connection.__id__]
+        odbc_connection = connection_info['connection']
+
+        class CountingCursor(object):
+            def __init__(self, cursor):
+                self._cursor = cursor
+            def columns(self, *args, **kwargs):
+                calls.append(kwargs.get('table'))
+                return self._cursor.columns(*args, **kwargs)
+            def __getattr__(self, name):
+                return getattr(self._cursor, name)
+
+        class CountingConnection(object):
+            def cursor(self):
+                return CountingCursor(odbc_connection.cursor())
+            def __getattr__(self, name):
+                return getattr(odbc_connection, name)
+
+        connection_info['connection'] = CountingConnection()
+        try:
+            self._fetch_columns(bulk)
+        finally:
+            connection_info['connection'] = odbc_connection
+        return len(calls)
+
+    def test_bulk_columns_catalog_calls(self):
+        # the time saved depends on the driver and the machine, the number of round trips does not
+        self.assertEqual(self._count_columns_calls(False), TABLE_COUNT)
+        self.assertEqual(self._count_columns_calls(True), 1)
+
+    def test_bulk_columns_selection(self):
+        table_names = [table.name for table in self.schema.tables]
+        use_bulk_columns = lambda names: GenericReverseEngineering.use_bulk_columns(self.connection, self.catalog.name, self.schema.name, names)
+        self.assertTrue(use_bulk_columns(table_names))
+        self.assertTrue(use_bulk_columns(table_names[:TABLE_COUNT / 2]))
+        # a small part of the schema is cheaper to fetch table by table
+        self.assertFalse(use_bulk_columns(table_names[:TABLE_COUNT / 10]))
+        self.assertFalse(use_bulk_columns(table_names[:GenericReverseEngineering.bulk_columns_min_tables - 1]))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -88,10 +88,6 @@ class MSAccessMigration(GenericMigration):
         return target_default_value
 
     def migrateDatatypeForColumn(self, state, source_column, target_column):
-        targetCatalog = state.targetCatalog
-
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-
         source_type = source_column.simpleType
 
         if source_type:
@@ -151,8 +147,9 @@ class MSAccessMigration(GenericMigration):
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("MSAccess migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column,
@@ -453,7 +453,7 @@ class MsAccessReverseEngineering(GenericReverseEngineering):
         simple_datatypes_list = [ datatype.name.upper() for datatype in catalog.simpleDatatypes ]
         user_datatypes_list   = [ datatype.name.upper() for datatype in catalog.userDatatypes ]
 
-        odbc_datatypes = dict( (dtype.data_type, dtype.type_name) for dtype in cls.get_connection(connection).cursor().getTypeInfo() )
+        odbc_datatypes = cls.get_odbc_datatypes(connection)
 
         table_columns = cls.get_connection(connection).cursor().columns(table=table.name)
         for column_info in table_columns:
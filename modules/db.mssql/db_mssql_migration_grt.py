@@ -203,8 +203,6 @@ class MSSQLMigration(GenericMigration):
     def migrateDatatypeForColumn(self, state, source_column, target_column):
         targetCatalog = state.targetCatalog
     
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-        
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
@@ -217,61 +215,11 @@ class MSSQLMigration(GenericMigration):
             # Decide which mysql datatype corresponds to the column datatype:
             source_datatype = source_type.name.upper()
             grt.log_debug3("Migration", "Migrating source column '%s' - type: %s, length: %s\n" % (source_column.name, source_datatype,source_column.length))
-            # string data types:
-            target_datatype = ''
-            #NCHAR and NVARCHAR in Microsoft SQL Server is always encoded as UCS-2 (UTF-16)
-            if source_datatype in ['NCHAR', 'NVARCHAR'] and target_version.is_supported_mysql_version_at_least(5,5,0):
-                target_column.characterSetName = 'utf8mb4'
-            if source_datatype in ['VARCHAR', 'NVARCHAR']:
-                if source_column.length == -1:  # VARCHAR(MAX) or NVARCHAR(MAX)
-                    target_datatype = 'LONGTEXT'  #TODO: Give the user the choice for this target datatype
-                elif 0 < source_column.length < 256:
-                    target_datatype = 'VARCHAR'
-                else:  # MySQL versions > 5.0 can hold up to 65535 chars in a VARCHAR column
-                    target_datatype = 'TEXT' if targetCatalog.version.majorNumber < 5 else 'VARCHAR'
-            elif source_datatype in ['TEXT', 'NTEXT']:
-                target_datatype = 'LONGTEXT'
-            elif source_datatype in ['CHAR', 'NCHAR']:  # MSSQL CHAR's (also VARCHAR's) max length is 8000 non Unicode characters
-                if 0 < source_column.length < 256:
-                    target_datatype = 'CHAR'
-                else:
-                    target_datatype = 'TEXT' 
-            # integer data types:
-            elif source_datatype in ['BIGINT', 'INT', 'SMALLINT']:
-                target_datatype = source_datatype
-                target_column.precision = -1
-            elif source_datatype == 'TINYINT':
-                target_datatype = source_datatype
-                target_column.precision = -1
-                if 'UNSIGNED' not in target_column.flags:
-                    target_column.flags.append('UNSIGNED')  # In MSSQL TINYINT is unsigned
-            elif source_datatype == 'UNIQUEIDENTIFIER':
-                target_datatype = 'VARCHAR'
-                target_column.length = 64
-                if 'UNIQUE' not in target_column.flags:
-                    target_column.flags.append('UNIQUE') # uniqueid must be UNIQUE... bug #43098
-                state.addMigrationLogEntry(0, source_column, target_column,
-                        "Source column type %s was migrated to %s(%s)" % (source_datatype, target_datatype, target_column.length))
-            elif source_datatype == 'SYSNAME':  # the relevant info is in http://msdn.microsoft.com/en-us/library/ms191240(v=sql.105).aspx
-                target_datatype = 'VARCHAR'
-                target_column.length = 160
-                state.addMigrationLogEntry(0, source_column, target_column,
-                        "Source column type %s was migrated to %s(%s)" % (source_datatype, target_datatype, target_column.length))
+            # most mappings are in columnMigrationRules(), shared with the native column migration
+            target_datatype = self.migrateDatatypeWithRules(state, source_datatype, source_column, target_column) or ''
+            if target_datatype:
+                pass
             # floating point datatypes:
-            elif source_datatype in ['DECIMAL', 'NUMERIC']:
-                if source_column.scale == 0:
-                    target_datatype = 'BIGINT'
-                    if source_column.precision < 5:
-                        target_datatype = 'SMALLINT'
-                    elif source_column.precision < 7:
-                        target_datatype = 'MEDIUMINT'
-                    elif source_column.precision < 10:
-                        target_datatype = 'INT'
-                    target_column.precision = -1
-                else:
-                    target_datatype = 'DECIMAL'
-            elif source_datatype == 'REAL':
-                target_datatype = 'FLOAT'
             elif source_datatype == 'FLOAT':
                 if source_column.precision > 24:
                     target_datatype = 'DOUBLE'
@@ -280,11 +228,6 @@ class MSSQLMigration(GenericMigration):
                 target_datatype = 'DECIMAL'
                 target_column.precision = source_column.simpleType.numericPrecision
                 target_column.scale = source_column.simpleType.numericScale
-            # binary datatypes:
-            elif source_datatype == 'IMAGE':
-                target_datatype = 'LONGBLOB'
-            elif source_datatype == 'VARBINARY' and source_column.length == -1:  # VARBINARY(MAX):
-                target_datatype = 'LONGBLOB'
             # datetime datatypes:
             elif source_datatype in ['DATETIME', 'SMALLDATETIME', 'DATETIME2', 'DATETIMEOFFSET']:
                 target_datatype = 'DATETIME'
@@ -296,30 +239,11 @@ class MSSQLMigration(GenericMigration):
             # and a nullable timestamp column is semantically equivalent to a varbinary(8) column.
             elif source_datatype in ['TIMESTAMP', 'ROWVERSION']:
                 target_datatype = 'BINARY' if source_column.isNotNull else 'VARBINARY'
-            elif source_datatype == 'DATE':
-                target_datatype = 'DATE'
-                target_column.precision = -1
             elif source_datatype == 'TIME':
                 target_datatype = 'TIME'
                 target_column.precision = -1
                 if target_version.is_supported_mysql_version_at_least(5,6,4):
                     target_column.precision = source_column.precision if source_column.precision < 7 else 6
-            elif source_datatype == 'BIT':
-                target_datatype = 'TINYINT'
-                target_column.length = 1
-                state.addMigrationLogEntry(0, source_column, target_column,
-                      "Source column type BIT was migrated to TINYINT(1)")
-            elif source_datatype == 'XML':
-                target_datatype = 'TEXT'
-                state.addMigrationLogEntry(0, source_column, target_column,
-                      "Source column type XML was migrated to TEXT")
-            elif source_datatype in ['GEOMETRY', 'GEOGRAPHY']:
-                target_datatype = 'GEOMETRY'
-            elif source_datatype == 'HIERARCHYID':
-                target_datatype = 'VARCHAR'
-                target_column.length = 255
-                state.addMigrationLogEntry(1, source_column, target_column,
-                        "Source column type HIERARCHYID was migrated to VARCHAR(255)")
             elif source_datatype == 'SQL_VARIANT':
                 target_datatype = 'TEXT'
                 state.addMigrationLogEntry(1, source_column, target_column,
@@ -328,8 +252,9 @@ class MSSQLMigration(GenericMigration):
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("Migration", "MSSQL migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column, 
@@ -345,6 +270,62 @@ class MSSQLMigration(GenericMigration):
         return True
 
 
+    def columnMigrationRules(self, target_version):
+        # Datatype mappings, also used by migrateDatatypeForColumn(), and default values accepted by migrateColumnDefaultValue().
+        # Date and time types, FLOAT, MONEY and SQL_VARIANT depend on more than the column itself and are left to the former
+        unicode_charset = 'utf8mb4' if Version.fromgrt(target_version).is_supported_mysql_version_at_least(5,5,0) else ''
+        defaults = ['string', 'number']
+        def rule(**kwargs):
+            kwargs['defaultLiterals'] = defaults
+            return kwargs
+        def varchar_rules(**kwargs):
+            return [rule(minLength=-1, maxLength=-1, target='LONGTEXT', **kwargs),
+                    rule(minLength=1, maxLength=255, target='VARCHAR', **kwargs),
+                    rule(target='TEXT' if target_version.majorNumber < 5 else 'VARCHAR', **kwargs)]
+        def char_rules(**kwargs):
+            return [rule(minLength=1, maxLength=255, target='CHAR', **kwargs), rule(target='TEXT', **kwargs)]
+        def integer_rules(name, **kwargs):
+            return [rule(target=name, precision=-1, autoIncrementMember='identity', **kwargs)]
+        def decimal_rules():
+            return [rule(minScale=0, maxScale=0, maxPrecision=4, target='SMALLINT', precision=-1),
+                    rule(minScale=0, maxScale=0, maxPrecision=6, target='MEDIUMINT', precision=-1),
+                    rule(minScale=0, maxScale=0, maxPrecision=9, target='INT', precision=-1),
+                    rule(minScale=0, maxScale=0, target='BIGINT', precision=-1),
+                    rule(target='DECIMAL')]
+        return {
+            'maxIdentifierLength': 64,
+            'quotedIdentifierChars': '["',
+            'collation': 'utf8_general_ci',
+            'datatypes': {
+                'VARCHAR': varchar_rules(),
+                'NVARCHAR': varchar_rules(characterSet=unicode_charset),
+                'TEXT': [rule(target='LONGTEXT')],
+                'NTEXT': [rule(target='LONGTEXT')],
+                'CHAR': char_rules(),
+                'NCHAR': char_rules(characterSet=unicode_charset),
+                'BIGINT': integer_rules('BIGINT'),
+                'INT': integer_rules('INT'),
+                'SMALLINT': integer_rules('SMALLINT'),
+                'TINYINT': integer_rules('TINYINT', flags=['UNSIGNED']),
+                'UNIQUEIDENTIFIER': [rule(target='VARCHAR', length=64, flags=['UNIQUE'],
+                                          message='Source column type UNIQUEIDENTIFIER was migrated to VARCHAR(64)')],
+                'SYSNAME': [rule(target='VARCHAR', length=160, message='Source column type SYSNAME was migrated to VARCHAR(160)')],
+                'DECIMAL': decimal_rules(),
+                'NUMERIC': decimal_rules(),
+                'REAL': [rule(target='FLOAT')],
+                'IMAGE': [rule(target='LONGBLOB')],
+                'VARBINARY': [rule(minLength=-1, maxLength=-1, target='LONGBLOB'), rule(target='VARBINARY')],
+                'DATE': [rule(target='DATE', precision=-1)],
+                'BIT': [rule(target='TINYINT', length=1, message='Source column type BIT was migrated to TINYINT(1)')],
+                'XML': [rule(target='TEXT', message='Source column type XML was migrated to TEXT')],
+                'GEOMETRY': [rule(target='GEOMETRY')],
+                'GEOGRAPHY': [rule(target='GEOMETRY')],
+                'HIERARCHYID': [rule(target='VARCHAR', length=255, messageType=1,
+                                     message='Source column type HIERARCHYID was migrated to VARCHAR(255)')],
+            }
+        }
+
+
     def migrateUpdateForChanges(self, state, target_catalog):
         """
         Create datatype cast expression for target column based on source datatype.
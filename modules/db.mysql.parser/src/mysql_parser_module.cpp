@@ -2096,6 +2096,34 @@ size_t MySQLParserServicesImpl::checkSqlSyntax(MySQLParserContext::Ref context,
 
 //----------------------------------------------------------------------------------------------------------------------
 
+/**
+ * Checks the given statements one after the other, as long as the token is not cancelled.
+ * Returns the number of statements checked.
+ */
+size_t MySQLParserServicesImpl::checkSqlSyntax(MySQLParserContext::Ref context, const char *sql,
+                                               const std::vector<StatementRange> &ranges, MySQLParseUnit type,
+                                               const base::CancellationToken &token,
+                                               std::vector<ParserErrorInfo> &errors) {
+  MySQLParserContextImpl *impl = dynamic_cast<MySQLParserContextImpl *>(context.get());
+
+  size_t count = 0;
+  for (auto &range : ranges) {
+    if (token.isCancelled())
+      break;
+
+    impl->errorCheck({sql + range.start, range.length}, type);
+    if (!impl->errors.empty()) {
+      std::vector<ParserErrorInfo> statementErrors = impl->errorsWithOffset(range.start);
+      errors.insert(errors.end(), statementErrors.begin(), statementErrors.end());
+    }
+    ++count;
+  }
+
+  return count;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
 class SchemaReferencesListener : public MySQLParserBaseListener {
 public:
   std::list<size_t> offsets;
@@ -178,6 +178,10 @@ public:
   size_t doSyntaxCheck(parser_ContextReferenceRef context_ref, const std::string &sql, const std::string &type);
   virtual size_t checkSqlSyntax(parsers::MySQLParserContext::Ref context, const char *sql, size_t length,
                                 MySQLParseUnit type) override;
+  virtual size_t checkSqlSyntax(parsers::MySQLParserContext::Ref context, const char *sql,
+                                const std::vector<parsers::StatementRange> &ranges, MySQLParseUnit type,
+                                const base::CancellationToken &token,
+                                std::vector<ParserErrorInfo> &errors) override;
 
   size_t doSchemaRefRename(parser_ContextReferenceRef context_ref, db_mysql_CatalogRef catalog,
                            const std::string old_name, const std::string new_name);
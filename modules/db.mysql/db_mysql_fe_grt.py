@@ -72,6 +72,30 @@ def apply_scripts_to_catalog(catalog, create_scripts, drop_scripts):
             apply_script(routine, sql, delim = delimiter)
 
 
+def quote_identifier(name):
+    return "`%s`" % name.replace("`", "``")
+
+
+def foreign_keys_sql(table):
+    """ALTER TABLE statement adding the foreign keys of a table created without them, None if it has none."""
+    clauses = []
+    for fk in table.foreignKeys:
+        if not fk.referencedTable or fk.modelOnly or fk.referencedTable.modelOnly:
+            continue
+        clause = "ADD CONSTRAINT %s FOREIGN KEY (%s) REFERENCES %s.%s (%s)" % (quote_identifier(fk.name),
+                    ", ".join(quote_identifier(column.name) for column in fk.columns),
+                    quote_identifier(fk.referencedTable.owner.name), quote_identifier(fk.referencedTable.name),
+                    ", ".join(quote_identifier(column.name) for column in fk.referencedColumns))
+        if fk.deleteRule:
+            clause += " ON DELETE " + fk.deleteRule
+        if fk.updateRule:
+            clause += " ON UPDATE " + fk.updateRule
+        clauses.append(clause)
+    if not clauses:
+        return None
+    return "ALTER TABLE %s.%s\n  %s" % (quote_identifier(table.owner.name), quote_identifier(table.name), ",\n  ".join(clauses))
+
+
 @ModuleInfo.export(grt.INT, grt.classes.db_mysql_Catalog, grt.classes.GrtVersion, grt.DICT)
 def generateSQLCreateStatements(catalog, targetVersion, objectCreationParams):
     options = grt.Dict()
@@ -85,12 +109,28 @@ def generateSQLCreateStatements(catalog, targetVersion, objectCreationParams):
     options['UseOIDAsResultDictKey'] = 1
     if targetVersion:
         options['DBSettings'] = grt.modules.DbMySQL.getTraitsForServerVersion(targetVersion.majorNumber, targetVersion.minorNumber, targetVersion.releaseNumber)
+    # With DeferForeignKeys, tables are created without their foreign keys, which are added at the end by the
+    # statements kept in the migration:foreign_keys_sql custom data of each table. Tables can then be created
+    # in any order and loaded before their foreign keys exist.
+    defer_foreign_keys = objectCreationParams.get("DeferForeignKeys", False)
+    if defer_foreign_keys:
+        options['SkipForeignKeys'] = 1
     create_scripts = grt.modules.DbMySQL.generateSQLForDifferences(grt.classes.db_mysql_Catalog(), catalog, options)
+    if defer_foreign_keys:
+        del options['SkipForeignKeys']
     if objectCreationParams.get("KeepSchemata", False):
         drop_scripts = {}
     else:
         drop_scripts = grt.modules.DbMySQL.generateSQLForDifferences(catalog, grt.classes.db_mysql_Catalog(), options)
     apply_scripts_to_catalog(catalog, create_scripts, drop_scripts)
+
+    for schema in catalog.schemata:
+        for table in schema.tables:
+            fk_sql = foreign_keys_sql(table) if defer_foreign_keys else None
+            if fk_sql:
+                table.customData["migration:foreign_keys_sql"] = fk_sql
+            elif table.customData.has_key("migration:foreign_keys_sql"):
+                del table.customData["migration:foreign_keys_sql"]
     
     preamble = getSchemaCreatePreamble(catalog, objectCreationParams)
     catalog.customData["migration:preamble"] = preamble
@@ -283,6 +323,13 @@ def createScriptForCatalogObjects(path, catalog, objectCreationParams):
                 file.write(object_heading("Trigger", "%s.%s" % (schema.name, trigger.name)))
                 file.write(trigger.temp_sql+";\n")
 
+    for schema in catalog.schemata:
+        for table in schema.tables:
+            fk_sql = table.customData.get("migration:foreign_keys_sql", None)
+            if fk_sql and not table.commentedOut:
+                file.write(object_heading("Foreign keys", "%s.%s" % (schema.name, table.name)))
+                file.write(fk_sql+";\n")
+
     postamble = catalog.customData["migration:postamble"]
     if postamble and postamble.temp_sql:
         #file.write(object_heading("Postamble script", ""))
@@ -376,6 +423,15 @@ def createCatalogObjects(connection, catalog, objectCreationParams, creationLog)
             grt.send_info("Scripts for %i tables, %i views and %i routines were executed for schema %s" % (tcount, vcount, rcount, schema.name))
             grt.end_progress_step()
 
+        for schema in catalog.schemata:
+            if schema.commentedOut:
+                continue
+            for table in schema.tables:
+                fk_sql = table.customData.get("migration:foreign_keys_sql", None)
+                if fk_sql and not table.commentedOut:
+                    grt.send_progress(1.0, "Creating foreign keys of table %s.%s" % (schema.name, table.name))
+                    execute_script(connection, fk_sql, makeLogObject(table))
+
         postamble = catalog.customData["migration:postamble"]
         grt.send_progress(1.0, "Executing postamble script...")
         execute_script(connection, postamble.temp_sql, makeLogObject(postamble))
@@ -22,6 +22,7 @@
  */
 
 #include <cstring>
+#include <stdexcept>
 #include "grtdb/db_helpers.h"
 #include "db_mysql_catalog_report.h"
 #include "mtemplate/template.h"
@@ -107,24 +108,80 @@ static void get_fk_desc(db_mysql_ForeignKeyRef fk, std::string &col_list, std::s
 ActionGenerateReport::ActionGenerateReport(grt::StringRef template_filename)
   : fname(template_filename.c_str()), current_table_dictionary(nullptr),
     current_schema_dictionary(nullptr), has_attributes(false), has_partitioning(false) {
+  tpl = mtemplate::GetTemplate(fname, mtemplate::STRIP_BLANK_LINES);
+  if (tpl == nullptr)
+    throw std::runtime_error("Report template file not found: " + fname);
   dictionary = mtemplate::CreateMainDictionary();
 }
 
 ActionGenerateReport::~ActionGenerateReport() {
+  delete current_table_dictionary;
+  delete current_schema_dictionary;
   delete dictionary;
+  delete tpl;
+}
+
+mtemplate::TemplateOutputSpool *ActionGenerateReport::section_output(const std::string &section) {
+  std::unique_ptr<mtemplate::TemplateOutputSpool> &spool = sections[section];
+  if (!spool)
+    spool.reset(new mtemplate::TemplateOutputSpool());
+  return spool.get();
+}
+
+// Starts a new top level object, which renders the previous one (if any).
+void ActionGenerateReport::begin_table(const char *section) {
+  flush_table();
+
+  current_table_section = section;
+  current_table_dictionary = new mtemplate::Dictionary(std::string("/") + section + "/", dictionary);
+}
+
+void ActionGenerateReport::flush_table() {
+  if (current_table_dictionary == nullptr)
+    return;
+
+  tpl->expandSection(current_table_section, current_table_dictionary, section_output(current_table_section));
+  delete current_table_dictionary;
+  current_table_dictionary = nullptr;
+}
+
+void ActionGenerateReport::flush_schema() {
+  if (current_schema_dictionary == nullptr)
+    return;
+
+  tpl->expandSection(kbtr_ALTER_SCHEMA, current_schema_dictionary, section_output(kbtr_ALTER_SCHEMA));
+  delete current_schema_dictionary;
+  current_schema_dictionary = nullptr;
+}
+
+// Renders a top level section which has only a single value.
+void ActionGenerateReport::expand_section(const char *section, const char *key, const std::string &value) {
+  mtemplate::Dictionary section_dictionary(std::string("/") + section + "/", dictionary);
+  section_dictionary.setValue(key, value);
+  tpl->expandSection(section, &section_dictionary, section_output(section));
 }
 
 std::string ActionGenerateReport::generate_output() {
-  mtemplate::Template *tpl = mtemplate::GetTemplate(fname, mtemplate::STRIP_BLANK_LINES);
   mtemplate::TemplateOutputString output;
-  tpl->expand(dictionary, &output);
+  generate_output(&output);
 
   return output.get();
 }
 
+void ActionGenerateReport::generate_output(mtemplate::TemplateOutput *output) {
+  flush_table();
+  flush_schema();
+
+  tpl->expand(dictionary, output, [this](const base::utf8string &section, mtemplate::TemplateOutput *output) {
+    std::map<std::string, std::unique_ptr<mtemplate::TemplateOutputSpool> >::iterator iter = sections.find(section);
+    if (iter != sections.end())
+      iter->second->replay(output);
+  });
+}
+
 // create table
 void ActionGenerateReport::create_table_props_begin(db_mysql_TableRef table) {
-  current_table_dictionary = dictionary->addSectionDictionary(kbtr_CREATE_TABLE);
+  begin_table(kbtr_CREATE_TABLE);
   current_table_dictionary->setValue(kbtr_CREATE_TABLE_NAME, object_name(table));
 
   has_attributes = false;
@@ -325,13 +382,13 @@ void ActionGenerateReport::create_table_index_dir(grt::StringRef value) {
 
 // drop table
 void ActionGenerateReport::drop_table(db_mysql_TableRef table) {
-  current_table_dictionary = dictionary->addSectionDictionary(kbtr_DROP_TABLE);
+  begin_table(kbtr_DROP_TABLE);
   current_table_dictionary->setValue(kbtr_DROP_TABLE_NAME, object_name(table));
 }
 
 // alter table
 void ActionGenerateReport::alter_table_props_begin(db_mysql_TableRef table) {
-  current_table_dictionary = dictionary->addSectionDictionary(kbtr_ALTER_TABLE);
+  begin_table(kbtr_ALTER_TABLE);
   current_table_dictionary->setValue(kbtr_ALTER_TABLE_NAME, object_name(table));
 
   has_attributes = false;
@@ -667,57 +724,57 @@ void ActionGenerateReport::alter_table_fks_end(db_mysql_TableRef table) {
 
 // triggers create/drop
 void ActionGenerateReport::create_trigger(db_mysql_TriggerRef trigger, bool for_alter) {
-  dictionary->addSectionDictionary(kbtr_CREATE_TRIGGER)->setValue(kbtr_CREATE_TRIGGER_NAME, trigger_name(trigger));
+  expand_section(kbtr_CREATE_TRIGGER, kbtr_CREATE_TRIGGER_NAME, trigger_name(trigger));
 }
 
 void ActionGenerateReport::drop_trigger(db_mysql_TriggerRef trigger, bool for_alter) {
-  dictionary->addSectionDictionary(kbtr_DROP_TRIGGER)->setValue(kbtr_DROP_TRIGGER_NAME, trigger_name(trigger));
+  expand_section(kbtr_DROP_TRIGGER, kbtr_DROP_TRIGGER_NAME, trigger_name(trigger));
 }
 
 // views create/drop
 void ActionGenerateReport::create_view(db_mysql_ViewRef view) {
-  dictionary->addSectionDictionary(kbtr_CREATE_VIEW)->setValue(kbtr_CREATE_VIEW_NAME, object_name(view));
+  expand_section(kbtr_CREATE_VIEW, kbtr_CREATE_VIEW_NAME, object_name(view));
 }
 
 void ActionGenerateReport::drop_view(db_mysql_ViewRef view) {
-  dictionary->addSectionDictionary(kbtr_DROP_VIEW)->setValue(kbtr_DROP_VIEW_NAME, object_name(view));
+  expand_section(kbtr_DROP_VIEW, kbtr_DROP_VIEW_NAME, object_name(view));
 }
 
 // routines create/drop
 void ActionGenerateReport::create_routine(db_mysql_RoutineRef routine, bool for_alter) {
-  dictionary->addSectionDictionary(kbtr_CREATE_ROUTINE)->setValue(kbtr_CREATE_ROUTINE_NAME, object_name(routine));
+  expand_section(kbtr_CREATE_ROUTINE, kbtr_CREATE_ROUTINE_NAME, object_name(routine));
 }
 
 void ActionGenerateReport::drop_routine(db_mysql_RoutineRef routine, bool for_alter) {
-  dictionary->addSectionDictionary(kbtr_DROP_ROUTINE)->setValue(kbtr_DROP_ROUTINE_NAME, object_name(routine));
+  expand_section(kbtr_DROP_ROUTINE, kbtr_DROP_ROUTINE_NAME, object_name(routine));
 }
 
 // users create/drop
 void ActionGenerateReport::create_user(db_UserRef user) {
-  dictionary->addSectionDictionary(kbtr_CREATE_USER)->setValue(kbtr_CREATE_USER_NAME, object_name(user));
+  expand_section(kbtr_CREATE_USER, kbtr_CREATE_USER_NAME, object_name(user));
 }
 
 void ActionGenerateReport::drop_user(db_UserRef user) {
-  dictionary->addSectionDictionary(kbtr_DROP_USER)->setValue(kbtr_DROP_USER_NAME, object_name(user));
+  expand_section(kbtr_DROP_USER, kbtr_DROP_USER_NAME, object_name(user));
 }
 
 // schema create/drop
 void ActionGenerateReport::create_schema(db_mysql_SchemaRef schema) {
-  dictionary->addSectionDictionary(kbtr_CREATE_SCHEMA)->setValue(kbtr_CREATE_SCHEMA_NAME, object_name(schema));
+  expand_section(kbtr_CREATE_SCHEMA, kbtr_CREATE_SCHEMA_NAME, object_name(schema));
 }
 
 void ActionGenerateReport::drop_schema(db_mysql_SchemaRef schema) {
-  dictionary->addSectionDictionary(kbtr_DROP_SCHEMA)->setValue(kbtr_DROP_SCHEMA_NAME, object_name(schema));
+  expand_section(kbtr_DROP_SCHEMA, kbtr_DROP_SCHEMA_NAME, object_name(schema));
 }
 
 // alter schema
 void ActionGenerateReport::alter_schema_props_begin(db_mysql_SchemaRef) {
-  current_schema_dictionary = NULL;
+  flush_schema();
 }
 
 void ActionGenerateReport::alter_schema_name(db_mysql_SchemaRef schema, grt::StringRef value) {
   if (current_schema_dictionary == NULL) {
-    current_schema_dictionary = dictionary->addSectionDictionary(kbtr_ALTER_SCHEMA);
+    current_schema_dictionary = new mtemplate::Dictionary(std::string("/") + kbtr_ALTER_SCHEMA + "/", dictionary);
     current_schema_dictionary->setValue(kbtr_ALTER_SCHEMA_NAME, object_name(schema));
   }
 
@@ -728,7 +785,7 @@ void ActionGenerateReport::alter_schema_name(db_mysql_SchemaRef schema, grt::Str
 
 void ActionGenerateReport::alter_schema_default_charset(db_mysql_SchemaRef schema, grt::StringRef value) {
   if (current_schema_dictionary == NULL) {
-    current_schema_dictionary = dictionary->addSectionDictionary(kbtr_ALTER_SCHEMA);
+    current_schema_dictionary = new mtemplate::Dictionary(std::string("/") + kbtr_ALTER_SCHEMA + "/", dictionary);
     current_schema_dictionary->setValue(kbtr_ALTER_SCHEMA_NAME, object_name(schema));
   }
 
@@ -740,7 +797,7 @@ void ActionGenerateReport::alter_schema_default_charset(db_mysql_SchemaRef schem
 
 void ActionGenerateReport::alter_schema_default_collate(db_mysql_SchemaRef schema, grt::StringRef value) {
   if (current_schema_dictionary == NULL) {
-    current_schema_dictionary = dictionary->addSectionDictionary(kbtr_ALTER_SCHEMA);
+    current_schema_dictionary = new mtemplate::Dictionary(std::string("/") + kbtr_ALTER_SCHEMA + "/", dictionary);
     current_schema_dictionary->setValue(kbtr_ALTER_SCHEMA_NAME, object_name(schema));
   }
 
@@ -751,4 +808,5 @@ void ActionGenerateReport::alter_schema_default_collate(db_mysql_SchemaRef schem
 }
 
 void ActionGenerateReport::alter_schema_props_end(db_mysql_SchemaRef schema) {
+  flush_schema();
 }
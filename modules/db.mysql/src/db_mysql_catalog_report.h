@@ -33,6 +33,8 @@
 #endif
 
 #include <cstddef>
+#include <map>
+#include <memory>
 
 #include "grt/common.h"
 
@@ -48,21 +50,38 @@
 
 namespace mtemplate {
   class DictionaryInterface;
+  class Template;
+  struct TemplateOutput;
+  class TemplateOutputSpool;
 };
 
+// Top level objects (tables, schemata, views etc.) are rendered into per section spools as soon as they are
+// complete and their dictionaries are freed right after that. Only the final assembly of all sections
+// happens in generate_output(), so memory no longer grows with the number of objects in the catalog.
 class ActionGenerateReport : public DiffSQLGeneratorBEActionInterface {
   std::string fname;
+  mtemplate::Template* tpl;
   mtemplate::DictionaryInterface* dictionary;
   mtemplate::DictionaryInterface* current_table_dictionary;
   mtemplate::DictionaryInterface* current_schema_dictionary;
+  std::string current_table_section;
+
+  std::map<std::string, std::unique_ptr<mtemplate::TemplateOutputSpool> > sections;
 
   bool has_attributes, has_partitioning; //, schema_altered;
 
+  mtemplate::TemplateOutputSpool* section_output(const std::string& section);
+  void begin_table(const char* section);
+  void flush_table();
+  void flush_schema();
+  void expand_section(const char* section, const char* key, const std::string& value);
+
 public:
   ActionGenerateReport(grt::StringRef template_filename);
   virtual ~ActionGenerateReport();
 
   std::string generate_output();
+  void generate_output(mtemplate::TemplateOutput* output);
 
   std::string object_name(const GrtNamedObjectRef obj) const;
   std::string trigger_name(const GrtNamedObjectRef obj) const;
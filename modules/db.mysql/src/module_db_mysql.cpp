@@ -39,6 +39,7 @@
 
 #include "db_mysql_diffsqlgen_grant.h"
 #include "db_mysql_catalog_report.h"
+#include "mtemplate/template.h"
 #include "base/string_utilities.h"
 #include "base/sqlstring.h"
 #include "base/util_functions.h"
@@ -1698,6 +1699,19 @@ ssize_t DbMySQLImpl::generateSQL(GrtNamedObjectRef org_object, const grt::DictRe
   return 0;
 }
 
+// If an output file is given the report is streamed directly into it and the file name is returned instead of
+// the report text.
+static grt::StringRef report_output(ActionGenerateReport &report, const grt::DictRef &options) {
+  if (options.has_key("OutputFileName")) {
+    std::string filename = options.get_string("OutputFileName");
+    mtemplate::TemplateOutputFile output(filename);
+    report.generate_output(&output);
+    return grt::StringRef(filename);
+  }
+
+  return grt::StringRef(report.generate_output());
+}
+
 grt::StringRef DbMySQLImpl::generateReport(GrtNamedObjectRef org_object, const grt::DictRef& options,
                                            std::shared_ptr<DiffChange> changes) {
   grt::StringRef tpl_file = grt::StringRef::cast_from(options.get("TemplateFile"));
@@ -1708,9 +1722,7 @@ grt::StringRef DbMySQLImpl::generateReport(GrtNamedObjectRef org_object, const g
     DiffSQLGeneratorBE(options, grt::DictRef::cast_from(options.get("DBSettings", getDefaultTraits())), &r)
       .process_diff_change(org_object, changes.get(), grt::StringListRef(), grt::ListRef<GrtNamedObject>());
 
-    grt::StringRef retval(r.generate_output());
-
-    return retval;
+    return report_output(r, options);
   }
 }
 
@@ -1733,9 +1745,7 @@ grt::StringRef DbMySQLImpl::generateReportForDifferences(GrtNamedObjectRef org_o
     DiffSQLGeneratorBE(options, grt::DictRef::cast_from(options.get("DBSettings", getDefaultTraits())), &r)
       .process_diff_change(org_object, alter_change.get(), grt::StringListRef(), grt::ListRef<GrtNamedObject>());
 
-    grt::StringRef retval(r.generate_output());
-
-    return retval;
+    return report_output(r, options);
   }
 }
 
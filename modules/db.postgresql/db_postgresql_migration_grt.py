@@ -121,17 +121,13 @@ class PostgresqlMigration(Sql92Migration):
 
 
     def migrateDatatypeForColumn(self, state, source_column, target_column):
-        targetCatalog = state.targetCatalog
-
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
             source_type = source_column.userType.actualType
 
             if not source_type and source_column.userType.sqlDefinition.startswith('enum('):
-                target_column.simpleType = mysql_simpleTypes['ENUM']
+                target_column.simpleType = state.lookupTargetDatatype('ENUM')
                 target_column.datatypeExplicitParams = source_column.userType.sqlDefinition[4:]
                 return True
 
@@ -140,93 +136,15 @@ class PostgresqlMigration(Sql92Migration):
         if source_type:
             # Decide which mysql datatype corresponds to the column datatype:
             source_datatype = source_type.name.upper()
-            # string data types:
-            target_datatype = ''
-            if source_datatype == 'VARCHAR':
-                if 0 <= source_column.length < 256:
-                    target_datatype = 'VARCHAR'
-                elif 0 <= source_column.length < 65536:  # MySQL versions > 5.0 can hold up to 65535 chars in a VARCHAR column
-                    if targetCatalog.version.majorNumber < 5:
-                        target_datatype = 'MEDIUMTEXT'
-                    else:
-                        target_datatype = 'VARCHAR'
-                else:
-                    target_datatype = 'LONGTEXT'
-            elif source_datatype == 'CHAR':
-                if source_column.length < 256:
-                    target_datatype = 'CHAR'
-                else:
-                    target_datatype = 'LONGTEXT'
-            # integer data types:
-            elif source_datatype in ['SMALLINT', 'INT', 'BIGINT']:
-                target_datatype = source_datatype
-                target_column.precision = -1
-            elif source_datatype == 'SMALLSERIAL':
-                target_datatype = 'SMALLINT'
-                target_column.autoIncrement = 1
-            elif source_datatype == 'SERIAL':
-                target_datatype = 'INTEGER'
-                target_column.autoIncrement = 1
-            elif source_datatype == 'BIGSERIAL':
-                target_datatype = 'BIGINT'
-                target_column.autoIncrement = 1
-            # numeric
-            elif source_datatype in ['DECIMAL', 'NUMERIC']:
-                target_datatype = 'DECIMAL'
-            elif source_datatype == 'MONEY':
-                target_datatype = 'DECIMAL'
-                target_column.precision = 19
-                target_column.scale = 2
-            # floating point datatypes:
-            elif source_datatype == 'REAL':
-                target_datatype = 'FLOAT'
-            elif source_datatype == 'DOUBLE PRECISION':
-                target_datatype = 'DOUBLE'
-            # binary datatypes:
-            elif source_datatype == 'BYTEA':
-                target_datatype = 'LONGBLOB'
-            elif source_datatype == 'TEXT':
-                target_datatype = 'LONGTEXT'
-            # datetime datatypes:
-            elif source_datatype == 'TIMESTAMP':
-                target_datatype = 'DATETIME'
-            elif source_datatype == 'DATE':
-                target_datatype = 'DATE'
-            elif source_datatype == 'TIME':
-                target_datatype = 'TIME'
-            elif source_datatype == 'INTERVAL':
-                target_datatype = 'TIME'
-                state.addMigrationLogEntry(0, source_column, target_column,
-                      "Source column type INTERVAL was migrated to TIME")
-            elif source_datatype in ['BIT', 'BIT VARYING']:
-                target_datatype = 'BIT'
-            elif source_datatype == 'BOOLEAN':
-                target_datatype = 'TINYINT'
-                target_column.length = 1
-            # network address types
-            elif source_datatype == 'CIDR':
-                target_datatype = 'VARCHAR'
-                target_column.length = 43
-            elif source_datatype == 'INET':
-                target_datatype = 'VARCHAR'
-                target_column.length = 43
-            elif source_datatype == 'MACADDR':
-                target_datatype = 'VARCHAR'
-                target_column.length = 17
-            # others
-            elif source_datatype == 'UUID':
-                target_datatype = 'VARCHAR'
-                target_column.length = 36
-            elif source_datatype in ['XML', 'JSON', 'TSVECTOR', 'TSQUERY', 'ARRAY']:
-                target_datatype = 'LONGTEXT'
-            elif source_datatype in ['POINT', 'LINE', 'LSEG', 'BOX', 'PATH', 'POLYGON', 'CIRCLE', 'TXID_SNAPSHOT']:
-                target_datatype = 'VARCHAR'
-            else:
+            # the mappings are in columnMigrationRules(), shared with the native column migration
+            target_datatype = self.migrateDatatypeWithRules(state, source_datatype, source_column, target_column)
+            if not target_datatype:
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("PostgreSQL migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column,
@@ -242,6 +160,56 @@ class PostgresqlMigration(Sql92Migration):
         return True
 
 
+    def columnMigrationRules(self, target_version):
+        # Datatype mappings, also used by migrateDatatypeForColumn(), and default values accepted by migrateColumnDefaultValue()
+        return {
+            'maxIdentifierLength': 64,
+            'datatypes': {
+                'VARCHAR': [dict(minLength=0, maxLength=255, target='VARCHAR'),
+                            dict(minLength=0, maxLength=65535, target='VARCHAR' if target_version.majorNumber >= 5 else 'MEDIUMTEXT'),
+                            dict(target='LONGTEXT')],
+                'CHAR': [dict(maxLength=255, target='CHAR'), dict(target='LONGTEXT')],
+                'SMALLINT': [dict(target='SMALLINT', precision=-1, defaultLiterals=['integer'])],
+                'INT': [dict(target='INT', precision=-1, defaultLiterals=['integer'])],
+                'BIGINT': [dict(target='BIGINT', precision=-1, defaultLiterals=['integer'])],
+                'SMALLSERIAL': [dict(target='SMALLINT', autoIncrement=1)],
+                'SERIAL': [dict(target='INTEGER', autoIncrement=1)],
+                'BIGSERIAL': [dict(target='BIGINT', autoIncrement=1)],
+                'DECIMAL': [dict(target='DECIMAL', defaultLiterals=['number'])],
+                'NUMERIC': [dict(target='DECIMAL', defaultLiterals=['number'])],
+                'MONEY': [dict(target='DECIMAL', precision=19, scale=2)],
+                'REAL': [dict(target='FLOAT', defaultLiterals=['number'])],
+                'DOUBLE PRECISION': [dict(target='DOUBLE', defaultLiterals=['number'])],
+                'BYTEA': [dict(target='LONGBLOB')],
+                'TEXT': [dict(target='LONGTEXT')],
+                'TIMESTAMP': [dict(target='DATETIME')],
+                'DATE': [dict(target='DATE')],
+                'TIME': [dict(target='TIME')],
+                'INTERVAL': [dict(target='TIME', message='Source column type INTERVAL was migrated to TIME')],
+                'BIT': [dict(target='BIT')],
+                'BIT VARYING': [dict(target='BIT')],
+                'BOOLEAN': [dict(target='TINYINT', length=1, defaultValues={'TRUE': '1', 'FALSE': '0'})],
+                'CIDR': [dict(target='VARCHAR', length=43)],
+                'INET': [dict(target='VARCHAR', length=43)],
+                'MACADDR': [dict(target='VARCHAR', length=17)],
+                'UUID': [dict(target='VARCHAR', length=36)],
+                'XML': [dict(target='LONGTEXT')],
+                'JSON': [dict(target='LONGTEXT')],
+                'TSVECTOR': [dict(target='LONGTEXT')],
+                'TSQUERY': [dict(target='LONGTEXT')],
+                'ARRAY': [dict(target='LONGTEXT')],
+                'POINT': [dict(target='VARCHAR')],
+                'LINE': [dict(target='VARCHAR')],
+                'LSEG': [dict(target='VARCHAR')],
+                'BOX': [dict(target='VARCHAR')],
+                'PATH': [dict(target='VARCHAR')],
+                'POLYGON': [dict(target='VARCHAR')],
+                'CIRCLE': [dict(target='VARCHAR')],
+                'TXID_SNAPSHOT': [dict(target='VARCHAR')],
+            }
+        }
+
+
     def migrateUpdateForChanges(self, state, target_catalog):
         """
         Create datatype cast expression for target column based on source datatype.
@@ -95,15 +95,13 @@ class SQLAnywhereMigration(GenericMigration):
     def migrateDatatypeForColumn(self, state, source_column, target_column):
         targetCatalog = state.targetCatalog
 
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
             source_type = source_column.userType.actualType
 
             if not source_type and source_column.userType.sqlDefinition.startswith('enum('):
-                target_column.simpleType = mysql_simpleTypes['ENUM']
+                target_column.simpleType = state.lookupTargetDatatype('ENUM')
                 target_column.datatypeExplicitParams = source_column.userType.sqlDefinition[4:]
                 return True
 
@@ -195,8 +193,9 @@ class SQLAnywhereMigration(GenericMigration):
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("SQLAnywhere migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column,
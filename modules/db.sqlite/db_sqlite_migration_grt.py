@@ -113,17 +113,13 @@ class SQLiteMigration(GenericMigration):
 
 
     def migrateDatatypeForColumn(self, state, source_column, target_column):
-        targetCatalog = state.targetCatalog
-
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
             source_type = source_column.userType.actualType
 
             if not source_type and source_column.userType.sqlDefinition.startswith('enum('):
-                target_column.simpleType = mysql_simpleTypes['ENUM']
+                target_column.simpleType = state.lookupTargetDatatype('ENUM')
                 target_column.datatypeExplicitParams = source_column.userType.sqlDefinition[4:]
                 return True
 
@@ -132,62 +128,15 @@ class SQLiteMigration(GenericMigration):
         if source_type:
             # Decide which mysql datatype corresponds to the column datatype:
             source_datatype = source_type.name.upper()
-            # string data types:
-            target_datatype = ''
-            if source_datatype in ['VARCHAR', 'NVARCHAR']:
-                if 0 <= source_column.length < 256:
-                    target_datatype = 'VARCHAR'
-                elif 0 <= source_column.length < 65536:  # MySQL versions > 5.0 can hold up to 65535 chars in a VARCHAR column
-                    if targetCatalog.version.majorNumber < 5:
-                        target_datatype = 'MEDIUMTEXT'
-                    else:
-                        target_datatype = 'VARCHAR'
-                else:
-                    target_datatype = 'LONGTEXT'
-            elif source_datatype in ['CHAR', 'NCHAR']:
-                if source_column.length < 256:
-                    target_datatype = 'CHAR'
-                else:
-                    target_datatype = 'LONGTEXT'
-            # integer data types:
-            elif source_datatype == 'BIT':
-                target_datatype = 'TINYINT'
-            elif source_datatype == 'INTEGER':
-                target_datatype = 'INT'
-            elif source_datatype in ['SMALLINT', 'INT', 'BIGINT']:
-                target_datatype = source_datatype
-                target_column.precision = -1
-            # numeric
-            elif source_datatype in ['DECIMAL', 'NUMERIC']:
-                target_datatype = 'DECIMAL'
-            # floating point datatypes:
-            elif source_datatype == 'REAL':
-                target_datatype = 'FLOAT'
-            elif source_datatype == 'DOUBLE PRECISION':
-                target_datatype = 'DOUBLE'
-            # binary datatypes:
-            elif source_datatype in ['CLOB', 'TEXT']:
-                target_datatype = 'LONGTEXT'
-            elif source_datatype == 'BLOB':
-                target_datatype = 'LONGBLOB'
-            # datetime datatypes:
-            elif source_datatype == 'TIMESTAMP':
-                target_datatype = 'DATETIME'
-            elif source_datatype == 'DATE':
-                target_datatype = 'DATE'
-            elif source_datatype == 'TIME':
-                target_datatype = 'TIME'
-            elif source_datatype == 'DATETIMEOFFSET':
-                target_datatype = 'TIME'
-                state.addMigrationLogEntry(0, source_column, target_column,
-                      "Source column type DATETIMEOFFSET was migrated to TIME")
-            # others
-            else:
+            # the mappings are in columnMigrationRules(), shared with the native column migration
+            target_datatype = self.migrateDatatypeWithRules(state, source_datatype, source_column, target_column)
+            if not target_datatype:
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("SQLite migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column,
@@ -203,6 +152,44 @@ class SQLiteMigration(GenericMigration):
         return True
 
 
+    def columnMigrationRules(self, target_version):
+        # Datatype mappings, also used by migrateDatatypeForColumn(), and default values accepted by migrateColumnDefaultValue()
+        string_defaults = ['string', 'number']
+        return {
+            'maxIdentifierLength': 64,
+            'datatypes': {
+                'VARCHAR': [dict(minLength=0, maxLength=255, target='VARCHAR', defaultLiterals=string_defaults),
+                            dict(minLength=0, maxLength=65535, target='VARCHAR' if target_version.majorNumber >= 5 else 'MEDIUMTEXT',
+                                 defaultLiterals=string_defaults),
+                            dict(target='LONGTEXT', defaultLiterals=string_defaults)],
+                'NVARCHAR': [dict(minLength=0, maxLength=255, target='VARCHAR', defaultLiterals=string_defaults),
+                             dict(minLength=0, maxLength=65535, target='VARCHAR' if target_version.majorNumber >= 5 else 'MEDIUMTEXT',
+                                  defaultLiterals=string_defaults),
+                             dict(target='LONGTEXT', defaultLiterals=string_defaults)],
+                'CHAR': [dict(maxLength=255, target='CHAR', defaultLiterals=string_defaults),
+                         dict(target='LONGTEXT', defaultLiterals=string_defaults)],
+                'NCHAR': [dict(maxLength=255, target='CHAR', defaultLiterals=string_defaults),
+                          dict(target='LONGTEXT', defaultLiterals=string_defaults)],
+                'BIT': [dict(target='TINYINT')],
+                'INTEGER': [dict(target='INT', defaultLiterals=['integer'])],
+                'SMALLINT': [dict(target='SMALLINT', precision=-1, defaultLiterals=['integer'])],
+                'INT': [dict(target='INT', precision=-1)],
+                'BIGINT': [dict(target='BIGINT', precision=-1, defaultLiterals=['integer'])],
+                'DECIMAL': [dict(target='DECIMAL', defaultLiterals=['number'])],
+                'NUMERIC': [dict(target='DECIMAL', defaultLiterals=['number'])],
+                'REAL': [dict(target='FLOAT', defaultLiterals=['number'])],
+                'DOUBLE PRECISION': [dict(target='DOUBLE')],
+                'CLOB': [dict(target='LONGTEXT')],
+                'TEXT': [dict(target='LONGTEXT')],
+                'BLOB': [dict(target='LONGBLOB')],
+                'TIMESTAMP': [dict(target='DATETIME')],
+                'DATE': [dict(target='DATE')],
+                'TIME': [dict(target='TIME')],
+                'DATETIMEOFFSET': [dict(target='TIME', message='Source column type DATETIMEOFFSET was migrated to TIME')],
+            }
+        }
+
+
     def migrateUpdateForChanges(self, state, target_catalog):
         """
         Create datatype cast expression for target column based on source datatype.
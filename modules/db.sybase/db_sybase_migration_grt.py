@@ -95,8 +95,6 @@ class SybaseMigration(GenericMigration):
     def migrateDatatypeForColumn(self, state, source_column, target_column):
         targetCatalog = state.targetCatalog
     
-        mysql_simpleTypes = dict( (datatype.name.upper(), datatype) for datatype in targetCatalog.simpleDatatypes )
-        
         source_type = source_column.simpleType
         if not source_type and source_column.userType:
             # evaluate user type
@@ -200,8 +198,9 @@ class SybaseMigration(GenericMigration):
                 # just fall back to same type name and hope for the best
                 target_datatype = source_datatype
 
-            if mysql_simpleTypes.has_key(target_datatype):
-                target_column.simpleType = mysql_simpleTypes[target_datatype]
+            mysql_type = state.lookupTargetDatatype(target_datatype)
+            if mysql_type:
+                target_column.simpleType = mysql_type
             else:
                 grt.log_warning("Sybase migrateTableColumnsToMySQL", "Can't find datatype %s for type %s\n" % (target_datatype, source_datatype))
                 state.addMigrationLogEntry(2, source_column, target_column, 
@@ -50,8 +50,8 @@ DbMySQLDiffReporting::DbMySQLDiffReporting() {
 DbMySQLDiffReporting::~DbMySQLDiffReporting() {
 }
 
-std::string DbMySQLDiffReporting::generate_report(const db_mysql_CatalogRef& left_cat,
-                                                  const db_mysql_CatalogRef& right_cat) {
+void DbMySQLDiffReporting::generate_report(const db_mysql_CatalogRef& left_cat, const db_mysql_CatalogRef& right_cat,
+                                           const std::string& output_file) {
   std::string err;
   db_mysql_CatalogRef left_cat_copy, right_cat_copy;
 
@@ -105,8 +105,7 @@ std::string DbMySQLDiffReporting::generate_report(const db_mysql_CatalogRef& lef
   options.set("KeepOrder", grt::IntegerRef(1));
   options.set("SeparateForeignKeys", grt::IntegerRef(0));
   options.set("TemplateFile", grt::StringRef(bec::GRTManager::get()->get_data_file_path(tpath).c_str()));
+  options.set("OutputFileName", grt::StringRef(output_file));
 
-  grt::StringRef output_string(diffsql_module->generateReportForDifferences(left_cat_copy, right_cat_copy, options));
-
-  return *output_string;
+  diffsql_module->generateReportForDifferences(left_cat_copy, right_cat_copy, options);
 }
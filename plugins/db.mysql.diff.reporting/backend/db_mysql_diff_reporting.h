@@ -45,5 +45,7 @@ public:
   DbMySQLDiffReporting();
   virtual ~DbMySQLDiffReporting();
 
-  std::string generate_report(const db_mysql_CatalogRef& left_cat, const db_mysql_CatalogRef& right_cat);
+  // The report is written into output_file while it is generated, so it is never held in memory as a whole.
+  void generate_report(const db_mysql_CatalogRef& left_cat, const db_mysql_CatalogRef& right_cat,
+                       const std::string& output_file);
 };
@@ -27,6 +27,8 @@
 #include "db_mysql_diff_reporting.h"
 #include "backend/db_plugin_be.h"
 #include "base/string_utilities.h"
+#include "base/file_functions.h"
+#include "base/file_utilities.h"
 #include "mforms/treeview.h"
 
 using namespace grtui;
@@ -120,13 +122,17 @@ public:
     _text.set_language(mforms::LanguageNone);
   }
 
+  // The slot writes the report into a file and returns its path.
   void set_generate_text_slot(const std::function<std::string()> &slot) {
     _generate = slot;
   }
 
   virtual void enter(bool advancing) {
-    if (advancing)
-      _text.set_value(_generate());
+    if (advancing) {
+      std::string path = _generate();
+      load_text_from(path);
+      base::tryRemove(path);
+    }
   }
 
   virtual bool allow_cancel() {
@@ -138,6 +144,21 @@ public:
 
 protected:
   std::function<std::string()> _generate;
+
+  // Passes the file to the editor block by block, so that there is no second copy of a big report in memory.
+  void load_text_from(const std::string &path) {
+    _text.set_value("");
+
+    FILE *file = base_fopen(path.c_str(), "rb");
+    if (file == NULL)
+      return;
+
+    char buffer[64 * 1024];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+      _text.append_text(buffer, length);
+    fclose(file);
+  }
 };
 
 //--------------------------------------------------------------------------------
@@ -217,14 +238,14 @@ public:
     else if (_source_page->get_right_source() == DataSourceSelector::ModelSource)
       right_catalog = _be.get_model_catalog();
 
-    std::string report;
+    std::string path = base::makePath(bec::GRTManager::get()->get_tmp_dir(), "diff_report.txt");
     try {
-      report = _be.generate_report(db_mysql_CatalogRef::cast_from(left_catalog),
-                                   db_mysql_CatalogRef::cast_from(right_catalog));
+      _be.generate_report(db_mysql_CatalogRef::cast_from(left_catalog), db_mysql_CatalogRef::cast_from(right_catalog),
+                          path);
     } catch (const std::exception &exc) {
-      report = base::strfmt("Error generating report: %s", exc.what());
+      base::setTextFileContent(path, base::strfmt("Error generating report: %s", exc.what()));
     }
-    return report;
+    return path;
   }
 
   virtual WizardPage *get_next_page(WizardPage *current) {
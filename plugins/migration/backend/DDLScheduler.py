@@ -0,0 +1,291 @@
+# Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2.0,
+# as published by the Free Software Foundation.
+#
+# This program is also distributed with certain software (including
+# but not limited to OpenSSL) that is licensed under separate terms, as
+# designated in a particular file or component or in included license
+# documentation.  The authors of MySQL hereby grant you an additional
+# permission to link the program and your derivative works with the
+# separately licensed software that they have included with MySQL.
+# This program is distributed in the hope that it will be useful,  but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+# the GNU General Public License, version 2.0, for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+import re
+import Queue
+import threading
+import grt
+from workbench import db_utils
+
+
+# Identifiers in a CREATE statement, quoted or not, used to find the objects it refers to
+_identifier = re.compile(r"`((?:[^`]|``)+)`|([A-Za-z_$][A-Za-z0-9_$]*)")
+
+# Jobs of each kind are started in this order when several are ready, so that the tables, which the data copy
+# waits for, are created first
+_kind_priority = {"table": 0, "trigger": 1, "routine": 2, "view": 3, "foreign_keys": 4}
+
+
+def referenced_names(sql):
+    names = set()
+    for quoted, plain in _identifier.findall(sql):
+        names.add((quoted.replace("``", "`") if quoted else plain).lower())
+    return names
+
+
+class DDLJob(object):
+    def __init__(self, obj, kind, statements, order):
+        self.object = obj
+        self.kind = kind
+        self.statements = statements
+        self.order = order
+        self.dependents = []
+        self.pending = 0  # dependencies not created yet
+        self.done = False
+        self.error = None
+        self.logged = False
+
+
+class DDLScheduler(object):
+    """Creates the objects of a migrated catalog in the target server over several connections.
+
+    The catalog must have been processed with DbMySQLFE.generateSQLCreateStatements(), preferably with the
+    DeferForeignKeys option, so that tables can be created in any order. Schemata are created first, then
+    tables, triggers, views and routines are created in parallel as soon as the objects they depend on exist:
+    triggers wait for their table, views for the tables, views and functions they mention and routines for
+    the routines they call. Foreign keys are added by add_foreign_keys(), once the data has been copied.
+
+    Connections only run SQL in the worker threads. GRT objects are touched only by the thread calling wait().
+    """
+    def __init__(self, message_target, connection, password, catalog, creation_log=None, worker_count=4):
+        assert hasattr(message_target, "send_info") and hasattr(message_target, "send_warning") and hasattr(message_target, "send_progress")
+        self._owner = message_target
+        self._connection_object = connection
+        self._password = password
+        self._catalog = catalog
+        self._creation_log = creation_log
+        self._worker_count = max(1, worker_count)
+
+        self._jobs = []
+        self._queue = Queue.PriorityQueue()
+        self._condition = threading.Condition()
+        self._running = 0
+        self._cancelled = False
+        self._connections = []
+        self._workers = []
+
+
+    def _split(self, sql):
+        return [sql[start:start+length] for start, length in grt.modules.MysqlSqlFacade.getSqlStatementRanges(sql)]
+
+
+    def _add_job(self, obj, kind, sql):
+        job = DDLJob(obj, kind, self._split(sql), len(self._jobs))
+        self._jobs.append(job)
+        return job
+
+
+    def _depend(self, job, dependencies):
+        for dependency in dependencies:
+            if dependency is not job and job not in dependency.dependents:
+                dependency.dependents.append(job)
+                job.pending += 1
+
+
+    def _build_jobs(self):
+        tables = {}
+        views = {}
+        routines = {}
+        for schema in self._catalog.schemata:
+            if schema.commentedOut:
+                continue
+            for table in schema.tables:
+                if not table.commentedOut:
+                    tables.setdefault(table.name.lower(), []).append(self._add_job(table, "table", table.temp_sql))
+            for view in schema.views:
+                if not view.commentedOut:
+                    views.setdefault(view.name.lower(), []).append(self._add_job(view, "view", view.temp_sql))
+            for routine in schema.routines:
+                if not routine.commentedOut:
+                    routines.setdefault(routine.name.lower(), []).append(self._add_job(routine, "routine", routine.temp_sql))
+            for table in schema.tables:
+                for trigger in table.triggers:
+                    if not trigger.commentedOut:
+                        job = self._add_job(trigger, "trigger", trigger.temp_sql)
+                        self._depend(job, tables.get(table.name.lower(), []))
+
+        # Names can't tell objects of different schemata apart, or a column from a table with the same name, so
+        # dependencies may be more than needed. That only costs parallelism, cycles are broken when nothing else runs.
+        for job in self._jobs:
+            if job.kind in ("view", "routine"):
+                names = referenced_names("\n".join(job.statements))
+                names.discard(job.object.name.lower())
+                for name in names:
+                    if job.kind == "view":
+                        self._depend(job, tables.get(name, []) + views.get(name, []))
+                    self._depend(job, routines.get(name, []))
+
+
+    def start(self):
+        """Creates the schemata and starts creating the other objects in the background."""
+        preamble = self._catalog.customData["migration:preamble"]
+        preamble_statements = self._split(preamble.temp_sql) if preamble and preamble.temp_sql else []
+
+        for i in range(self._worker_count):
+            connection = db_utils.MySQLConnection(self._connection_object, password=self._password)
+            connection.connect()
+            for statement in preamble_statements:
+                connection.execute(statement)
+            self._connections.append(connection)
+
+        for schema in self._catalog.schemata:
+            if schema.commentedOut:
+                continue
+            self._owner.send_info("Creating schema %s..." % schema.name)
+            error = None
+            try:
+                for statement in self._split(schema.temp_sql):
+                    self._connections[0].execute(statement)
+            except db_utils.QueryError, exc:
+                error = str(exc)
+            self._log(schema, error)
+
+        self._build_jobs()
+        self._owner.send_info("Creating %i objects over %i connections..." % (len(self._jobs), len(self._connections)))
+        self._enqueue_ready()
+
+        for connection in self._connections:
+            worker = threading.Thread(target=self._work, args=(connection,))
+            worker.daemon = True
+            worker.start()
+            self._workers.append(worker)
+
+
+    def _enqueue_ready(self):
+        for job in self._jobs:
+            if job.pending == 0:
+                self._enqueue(job)
+        self._release_waiting()
+
+
+    def _release_waiting(self):
+        if self._running == 0:
+            # only a dependency cycle can leave jobs waiting now, release the first one
+            waiting = [j for j in self._jobs if not j.done and j.pending > 0]
+            if waiting:
+                waiting[0].pending = 0
+                self._enqueue(waiting[0])
+
+
+    def _enqueue(self, job):
+        self._running += 1
+        self._queue.put((_kind_priority[job.kind], job.order, job))
+
+
+    def _work(self, connection):
+        while True:
+            priority, order, job = self._queue.get()
+            if job is None:
+                break
+            error = None
+            if self._cancelled:
+                error = "Canceled by user"
+            else:
+                try:
+                    for statement in job.statements:
+                        connection.execute(statement)
+                except Exception, exc:
+                    error = str(exc)
+            self._finished(job, error)
+
+
+    def _finished(self, job, error):
+        with self._condition:
+            job.done = True
+            job.error = error
+            self._running -= 1
+            # objects depending on a failed one are still tried, the server tells whether they can be created
+            for dependent in job.dependents:
+                dependent.pending -= 1
+                if dependent.pending == 0:
+                    self._enqueue(dependent)
+            self._release_waiting()
+            self._condition.notify_all()
+
+
+    def _log(self, obj, error):
+        if self._creation_log is not None:
+            log = grt.classes.GrtLogObject()
+            log.logObject = obj
+            entry = grt.classes.GrtLogEntry()
+            entry.owner = log
+            entry.entryType = 2 if error else 0
+            if error:
+                entry.name = error
+            log.entries.append(entry)
+            self._creation_log.append(log)
+        if error:
+            self._owner.send_warning(error)
+            grt.log_error("Migration", "Error creating %s: %s\n" % (obj.name, error))
+
+
+    def wait(self, kinds=None):
+        """Waits until the objects of the given kinds ("table", "trigger", "view", "routine", "foreign_keys"),
+        or all of them, have been created and logs the results. Returns the number of objects that failed."""
+        jobs = [job for job in self._jobs if kinds is None or job.kind in kinds]
+        with self._condition:
+            while True:
+                done = len([job for job in self._jobs if job.done])
+                self._owner.send_progress(float(done) / len(self._jobs) if self._jobs else 1.0,
+                                          "%i of %i objects created" % (done, len(self._jobs)))
+                if all(job.done for job in jobs):
+                    break
+                if grt.query_status():
+                    self._cancelled = True
+                self._condition.wait(0.5)
+
+        failed = 0
+        for job in self._jobs:
+            if job.done and not job.logged:
+                job.logged = True
+                self._log(job.object, job.error)
+        for job in jobs:
+            if job.error:
+                failed += 1
+        if self._cancelled:
+            raise grt.UserInterrupt("Canceled by user")
+        return failed
+
+
+    def add_foreign_keys(self):
+        """Adds the foreign keys deferred by generateSQLCreateStatements() and waits for them."""
+        with self._condition:
+            for schema in self._catalog.schemata:
+                if schema.commentedOut:
+                    continue
+                for table in schema.tables:
+                    sql = table.customData.get("migration:foreign_keys_sql", None)
+                    if sql and not table.commentedOut:
+                        self._enqueue(self._add_job(table, "foreign_keys", sql))
+        return self.wait(("foreign_keys",))
+
+
+    def close(self):
+        """Stops the workers, skipping the objects not created yet, and closes the connections."""
+        self._cancelled = True
+        for worker in self._workers:
+            self._queue.put((len(_kind_priority), 0, None))
+        for worker in self._workers:
+            worker.join()
+        for connection in self._connections:
+            connection.disconnect()
+        self._workers = []
+        self._connections = []
@@ -183,6 +183,55 @@ class TableCopyWorker(Thread):
         self.process.wait()
 
 
+class ModuleCopyWorker(Thread):
+    """Runs the copy in the MigrationCopyTables module instead of a wbcopytables process.
+
+    Events polled from the module are put in the result queue in the same form TableCopyWorker uses for the lines
+    printed by the helper, so process_until_done() handles both.
+    """
+    def __init__(self, owner, options, tables, result_queue):
+        Thread.__init__(self)
+        self._owner = owner
+        self.result_queue = result_queue
+        self._job = grt.modules.MigrationCopyTables.startCopy(options, tables)
+        grt.log_debug3("Migration", "Started copy job %s for %i tables" % (self._job, len(tables)))
+
+    def run(self):
+        import time
+        try:
+            finished = False
+            while not finished:
+                if self._owner.query_cancel_status():
+                    raise grt.UserInterrupt("Canceled by user")
+                events = grt.modules.MigrationCopyTables.pollEvents(self._job)
+                for event in events:
+                    if event["type"] == "FINISHED":
+                        self.result_queue.put(("DONE", event["message"] or None))
+                        finished = True
+                    elif event["type"] == "PROGRESS":
+                        self.result_queue.put(("PROGRESS", "%s:%i:%i:%i:%.0f:%i:%.0f" % (event["table"], event["rows"], event["totalRows"],
+                                                                                         event["bytes"], event["rowsPerSecond"],
+                                                                                         event["batchRows"], event["batchSeconds"] * 1000)))
+                    elif event["type"] in ("ERROR", "BEGIN", "END"):
+                        self.result_queue.put((event["type"], "%s:%s" % (event["table"], event["message"])))
+                if not events:
+                    time.sleep(0.2)
+        except grt.UserInterrupt, e:
+            self._owner.send_info("Copy task interrupted by user, stopping copy job %s..." % self._job)
+            self.terminate()
+            self.result_queue.put(("INTERRUPTED", None))
+        except Exception, e:
+            import traceback
+            traceback.print_exc()
+            self.result_queue.put(("DONE", str(e)))
+
+    def terminate(self):
+        if self._job is not None:
+            grt.modules.MigrationCopyTables.cancelCopy(self._job)
+            grt.modules.MigrationCopyTables.closeJob(self._job)
+            self._job = None
+
+
 class DataMigrator(object):
     copytable_path = "wbcopytables-bin"
 
@@ -237,8 +286,6 @@ class DataMigrator(object):
                 else:
                     table_param += ["--table", task["source_schema"], task["source_table"]]
 
-        stdout = ""
-
         if not self.copytable_path:
             raise RuntimeError("Path to wbcopytables not found")
 
@@ -250,6 +297,10 @@ class DataMigrator(object):
             args.append('--target-timeout=%s' % task['ttimeout'])
         if self._resume:
             args.append("--resume")
+        # tables are counted in parallel, using as many connections as the copy itself
+        args.append("--thread-count=%i" % self._options.get("workerCount", 2))
+        if self._options.get("EstimateRowCounts", False):
+            args.append("--estimate-only")
 
         argv = [self.copytable_path, "--count-only", "--passwords-from-stdin"] + args + table_param
         self._owner.send_info(" ".join(argv))
@@ -257,31 +308,42 @@ class DataMigrator(object):
         if sys.platform == "win32":
             # shell=True causes a created window to be hidden by default, this prevents a popup to be shown
             # on the migration wizard
-            out = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
+            out = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, shell=True)
         else:
-            out = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+            out = subprocess.Popen(argv, stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
 
         if self._resume:
             passwords= (self._src_password+"\t"+self._tgt_password+"\n").encode("utf8") 
         else:               
             passwords= (self._src_password+"\n").encode("utf8")
-        while out.poll() is None:
-            o, e = out.communicate(passwords)
-            passwords = None
-            if o:
-                stdout += o
-            if e:
-                for l in e.split("\n"):
-                    self._owner.send_info(l)
-            total = 0
+        out.stdin.write(passwords)
+        out.stdin.close()
+
+        # Estimates from the catalog statistics come first and are replaced by exact counts as they arrive.
+        # Tables are reported as soon as they are counted, so progress is shown while large tables are still pending.
+        counted = set()
+        for line in iter(out.stdout.readline, ""):
+            line = line.rstrip("\r\n")
+            if line.startswith("ROW_COUNT_ESTIMATE:") or line.startswith("ROW_COUNT:"):
+                kind, schema, table, count = line.split(":", 3)
+                task = working_set[schema+"."+table]
+                estimated = kind == "ROW_COUNT_ESTIMATE"
+                if estimated and task.get("row_count_estimated") is False:
+                    continue
+                task["row_count"] = int(count.strip())
+                task["row_count_estimated"] = estimated
+                counted.add(schema+"."+table)
+                self._owner.send_progress(float(len(counted)) / len(working_set), "Counted rows of %s.%s" % (schema, table))
+            elif line and line != "FINISHED":
+                self._owner.send_info(line)
+        out.wait()
+
         if out.returncode == 0:
-            for schema, table, count in [l.split(":")[1:] for l in stdout.split("\n") if l.startswith("ROW_COUNT")]:
-                count = int(count.strip())
-                total += count
-                working_set[schema+"."+table]["row_count"] = count
+            total = 0
+            for task in working_set.values():
+                total += task.get("row_count", 0)
             return total
         else:
-            self._owner.send_info(stdout)
             raise Exception("Error getting row count from source tables, wbcopytables exited with code %s" % out.returncode)
 
     def migrate_data(self, num_processes, working_set):
@@ -342,20 +404,73 @@ class DataMigrator(object):
 
         if self._resume:
             args.append("--resume")
+        # rows were already counted, the copied row count is checked against that in process_until_done()
+        if all(task.get("row_count_estimated") is False for task in working_set.values()):
+            args.append("--skip-row-count")
 
         argv = [self.copytable_path] + args + table_param
 
         self._working_set = working_set
         self._result_queue = Queue.Queue(len(working_set))
 
-        worker = TableCopyWorker(self._owner, argv, self._result_queue)
-        worker.feed_input(self._src_password+"\t"+self._tgt_password+"\n")
+        if self.can_copy_in_process():
+            worker = ModuleCopyWorker(self._owner, self.module_copy_options(num_processes, "--skip-row-count" in args, task),
+                                      [self.module_copy_table(task) for task in working_set.values()], self._result_queue)
+        else:
+            worker = TableCopyWorker(self._owner, argv, self._result_queue)
+            worker.feed_input(self._src_password+"\t"+self._tgt_password+"\n")
         worker.start()
         results = self.process_until_done()
         worker.terminate()
         return results
 
 
+    def can_copy_in_process(self):
+        # Python DB-API sources need the interpreter wbcopytables embeds, so they're always copied by the helper
+        if not hasattr(grt.modules, "MigrationCopyTables"):
+            return False
+        return not (isinstance(self._src_conn_object.driver, grt.classes.db_mgmt_PythonDBAPIDriver) and
+                    self._src_conn_object.driver.driverLibraryName != 'pyodbc')
+
+
+    def module_copy_options(self, num_processes, skip_row_count, task):
+        options = {}
+        if self._src_conn_object.driver.owner.name == "Mysql":
+            options["sourceType"] = "mysql"
+            options["sourceConnection"] = mysql_conn_string(self._src_conn_object)
+        else:
+            options["sourceType"] = "odbc"
+            options["sourceConnection"] = odbc_conn_string(self._src_conn_object, True)
+        options["sourcePassword"] = self._src_password
+        options["sourceRdbmsType"] = self._src_conn_object.driver.owner.name
+        options["sourceUseCleartext"] = 1 if self._src_conn_object.parameterValues.get("OPT_ENABLE_CLEARTEXT_PLUGIN", False) else 0
+        options["sourceIsUTF8"] = 1 if self._options.get("DriverSendsDataAsUTF8", False) else 0
+        default_charset = self._src_conn_object.parameterValues.get("defaultCharSet")
+        if default_charset:
+            options["sourceCharset"] = default_charset
+
+        options["targetConnection"] = mysql_conn_string(self._tgt_conn_object)
+        options["targetPassword"] = self._tgt_password
+        options["targetUseCleartext"] = 1 if self._tgt_conn_object.parameterValues.get("OPT_ENABLE_CLEARTEXT_PLUGIN", False) else 0
+
+        options["threadCount"] = num_processes
+        options["truncateTarget"] = 1 if self._options.get("TruncateTargetTables", False) else 0
+        options["countRows"] = 0 if skip_row_count else 1
+        options["resume"] = 1 if self._resume else 0
+        if 'stimeout' in task:
+            options["sourceTimeout"] = int(task['stimeout'])
+        if 'ttimeout' in task:
+            options["targetTimeout"] = int(task['ttimeout'])
+        return options
+
+
+    def module_copy_table(self, task):
+        table = dict((key, task[key]) for key in ("source_schema", "source_table", "target_schema", "target_table",
+                                                  "source_primary_key", "target_primary_key"))
+        table["select_expression"] = task.get("select_expression", None) or "*"
+        return table
+
+
     def helper_basic_arglist(self, include_target_conn, noSSH = False):
         args = []
         if self._src_conn_object.driver.owner.name == "Mysql":
@@ -428,10 +543,13 @@ class DataMigrator(object):
 
     def process_until_done(self):
         total_row_count = 0
+        tasks_by_target = {}
         for table in self._working_set.values():
             total_row_count += table["row_count"]
+            tasks_by_target[table["target_schema"]+"."+table["target_table"]] = table
 
         progress_row_count = {}
+        rows_per_second = {}
 
         self.interrupted = False
 
@@ -460,8 +578,19 @@ class DataMigrator(object):
                 target_table = message.split(":")[0]
                 if target_table in active_job_names:
                     active_job_names.remove(target_table)
-                self._owner.send_info(message)
-                progress_row_count[target_table] = (True, progress_row_count.get(target_table, (False, 0))[1])
+                copied = re.search("Finished copying ([0-9]+) rows", message)
+                copied = int(copied.group(1)) if copied else progress_row_count.get(target_table, (False, 0))[1]
+                task = tasks_by_target.get(target_table, {})
+                if task.get("row_count_estimated") is False and copied != task["row_count"]:
+                    message = "%s:Failed copying %i rows" % (target_table, task["row_count"] - copied)
+                    self._owner.send_error(message)
+                    self._owner.add_log_entry(2, target_table, message)
+                    grt.log_error("Migration", "%s\n"%message)
+                    self._resume = True
+                    progress_row_count[target_table] = (False, copied)
+                else:
+                    self._owner.send_info(message)
+                    progress_row_count[target_table] = (True, copied)
 
             elif msgtype == "ERROR":
                 target_table = message.split(":")[0]
@@ -474,9 +603,17 @@ class DataMigrator(object):
                 self._resume = True
 
             elif msgtype == "PROGRESS":
-                target_table, current, total = message.split(":")
+                # <table>:<rows>:<total rows>[:<bytes>:<rows per second>[:<rows per batch>:<batch ms>]]
+                fields = message.split(":")
+                target_table, current = fields[0], fields[1]
                 progress_row_count[target_table] = (False, int(current))
-                self._owner.send_progress(float(sum([x[1] for x in progress_row_count.values()])) / total_row_count, "Copying %s" % ", ".join(active_job_names))
+                if len(fields) > 4:
+                    rows_per_second[target_table] = int(float(fields[4]))
+                if len(fields) > 6 and fields[5] != "0":
+                    grt.log_debug3("Migration", "Copying %s with %s rows per INSERT, %s ms each" % (target_table, fields[5], fields[6]))
+                status = ", ".join("%s (%i rows/s)" % (name, rows_per_second[name]) if rows_per_second.get(name) else name
+                                   for name in active_job_names)
+                self._owner.send_progress(min(1.0, float(sum([x[1] for x in progress_row_count.values()])) / max(1, total_row_count)), "Copying %s" % status)
             elif msgtype == "LOG":
                 self._owner.send_info(message)
             elif msgtype == "DONE":
@@ -27,7 +27,9 @@
 #include "base/log.h"
 #include "base/string_utilities.h"
 #include <string>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 
 DEFAULT_LOG_DOMAIN("copytable");
 
@@ -43,6 +45,25 @@ void BaseConverter::init_mysql_time(MYSQL_TIME* target) {
   target->neg = 0;
 }
 
+// Value of the count digits at source, stopping at the first character that is not a digit.
+static unsigned int parse_digits(const char* source, size_t count) {
+  unsigned int value = 0;
+  for (size_t i = 0; i < count && source[i] >= '0' && source[i] <= '9'; i++)
+    value = value * 10 + (source[i] - '0');
+  return value;
+}
+
+// Fraction of a second in microseconds, from the digits after the decimal point.
+static unsigned long parse_fraction(const char* source) {
+  unsigned long value = 0;
+  int digits = 0;
+  for (; digits < 6 && source[digits] >= '0' && source[digits] <= '9'; digits++)
+    value = value * 10 + (source[digits] - '0');
+  for (; digits < 6; digits++)
+    value *= 10;
+  return value;
+}
+
 void BaseConverter::convert_date(DATE_STRUCT* source, MYSQL_TIME* target) {
   init_mysql_time(target);
 
@@ -59,19 +80,15 @@ void BaseConverter::convert_date(const char* source, MYSQL_TIME* target) {
   // Date could come in the format of YYYY-MM-DD
   //                                  0123456789
   // Additional formats might be added as needed
-  std::string time(source);
-
-  // A call to std::string.substr with a start position past the end
-  // of the string will yield an out_of_range exception, hence:
-  if (time.length() < 10) // 9 is also valid but probably shouldn't be accepted
+  if (strnlen(source, 10) < 10) // 9 is also valid but probably shouldn't be accepted
   {
     logWarning("Invalid date literal detected: '%s'\n", source);
     return;
   }
 
-  target->year = base::atoi<int>(time.substr(0, 4).c_str(), 0);
-  target->month = base::atoi<int>(time.substr(5, 2).c_str(), 0);
-  target->day = base::atoi<int>(time.substr(8, 2).c_str(), 0);
+  target->year = parse_digits(source, 4);
+  target->month = parse_digits(source + 5, 2);
+  target->day = parse_digits(source + 8, 2);
 
   target->time_type = MYSQL_TIMESTAMP_DATE;
 }
@@ -82,25 +99,18 @@ void BaseConverter::convert_time(const char* source, MYSQL_TIME* target) {
   // time comes in the format of
   // HH:MM:SS.mmmmm
   // 01234567890123
-  std::string time(source);
-
-  if (time.length() < 8) {
+  size_t length = strnlen(source, 10);
+  if (length < 8) {
     logWarning("Invalid time literal detected: '%s'\n", source);
     return;
   }
 
-  std::string msec = "0";
-
+  target->hour = parse_digits(source, 2);
+  target->minute = parse_digits(source + 3, 2);
+  target->second = parse_digits(source + 6, 2);
   // Get the milliseconds if present
-  if (time.length() > 9) {
-    msec = time.substr(9, time.length() - 9);
-    msec.resize(6, '0');
-  }
-
-  target->hour = base::atoi<int>(time.substr(0, 2).c_str(), 0);
-  target->minute = base::atoi<int>(time.substr(3, 2).c_str(), 0);
-  target->second = base::atoi<int>(time.substr(6, 2).c_str(), 0);
-  target->second_part = base::atoi<int>(msec.c_str(), 0);
+  if (length > 9)
+    target->second_part = parse_fraction(source + 9);
 
   target->time_type = MYSQL_TIMESTAMP_TIME;
 }
@@ -113,7 +123,7 @@ void BaseConverter::convert_timestamp(TIMESTAMP_STRUCT* source, MYSQL_TIME* targ
   target->hour = source->hour;
   target->minute = source->minute;
   target->second = source->second;
-  target->second_part = source->fraction;
+  target->second_part = source->fraction / 1000; // ODBC fractions are in nanoseconds
 
   target->time_type = MYSQL_TIMESTAMP_DATETIME;
   target->neg = 0;
@@ -125,29 +135,22 @@ void BaseConverter::convert_timestamp(const char* source, MYSQL_TIME* target) {
   // Timestamp comes in the format of YYYY-MM-DD HH:MM:SS:mmm...
   //                                  01234567890123456789012...
   // Additional formats might be added as needed
-  std::string time(source);
-
-  if (time.length() < 19) {
+  size_t length = strnlen(source, 21);
+  if (length < 19) {
     logWarning("Invalid timestamp literal detected: '%s'\n", source);
     return;
   }
 
-  std::string msecond = "0";
+  target->year = parse_digits(source, 4);
+  target->month = parse_digits(source + 5, 2);
+  target->day = parse_digits(source + 8, 2);
 
+  target->hour = parse_digits(source + 11, 2);
+  target->minute = parse_digits(source + 14, 2);
+  target->second = parse_digits(source + 17, 2);
   // Get the milliseconds if present
-  if (time.length() > 20) {
-    msecond = time.substr(20, time.length() - 20);
-    msecond.resize(6, '0');
-  }
-
-  target->year = base::atoi<int>(time.substr(0, 4).c_str(), 0);
-  target->month = base::atoi<int>(time.substr(5, 2).c_str(), 0);
-  target->day = base::atoi<int>(time.substr(8, 2).c_str(), 0);
-
-  target->hour = base::atoi<int>(time.substr(11, 2).c_str(), 0);
-  target->minute = base::atoi<int>(time.substr(14, 2).c_str(), 0);
-  target->second = base::atoi<int>(time.substr(17, 2).c_str(), 0);
-  target->second_part = base::atoi<int>(msecond.c_str(), 0);
+  if (length > 20)
+    target->second_part = parse_fraction(source + 20);
 
   target->time_type = MYSQL_TIMESTAMP_DATETIME;
 }
@@ -166,3 +169,17 @@ void BaseConverter::convert_date_time(const char* source, MYSQL_TIME* target, in
       break;
   }
 }
+
+bool BaseConverter::convert_int(long long source, bool is_unsigned, short* target) {
+  if (is_unsigned ? (source < 0 || source > UINT16_MAX) : (source < INT16_MIN || source > INT16_MAX))
+    return false;
+  *target = (short)source;
+  return true;
+}
+
+bool BaseConverter::convert_int(long long source, bool is_unsigned, char* target) {
+  if (is_unsigned ? (source < 0 || source > UINT8_MAX) : (source < INT8_MIN || source > INT8_MAX))
+    return false;
+  *target = (char)source;
+  return true;
+}
@@ -40,4 +40,9 @@ public:
   static void convert_timestamp(const char* source, MYSQL_TIME* target);
   static void convert_timestamp(TIMESTAMP_STRUCT* source, MYSQL_TIME* target);
   static void convert_date_time(const char* source, MYSQL_TIME* target, int type);
+
+  // Narrow an integer from a wider source column to a SMALLINT or TINYINT target column (signed or not).
+  // Return false, leaving target alone, if the value is out of the range of the target.
+  static bool convert_int(long long source, bool is_unsigned, short* target);
+  static bool convert_int(long long source, bool is_unsigned, char* target);
 };
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include <cstdint>
+
+#include <sqlite/connection.hpp>
+#include <sqlite/execute.hpp>
+#include <sqlite/query.hpp>
+
+#include "base/log.h"
+#include "base/boost_smart_ptr_helpers.h"
+
+#include "copy_journal.h"
+
+DEFAULT_LOG_DOMAIN("copytable");
+
+CopyJournal::CopyJournal(const std::string &path) : _path(path), _db(new sqlite::connection(path)) {
+  try {
+    // Each chunk is recorded right after it was committed on the target, the record must survive a crash.
+    sqlite::execute(*_db, "PRAGMA synchronous=FULL", true);
+    sqlite::execute(*_db,
+                    "create table if not exists chunks (table_name varchar(256), range_start integer, "
+                    "range_end integer, row_count integer, source_checksum varchar(32), target_checksum varchar(64), "
+                    "primary key (table_name, range_start))",
+                    true);
+    sqlite::execute(*_db, "create table if not exists shard_plans (table_name varchar(256) primary key, plan text)",
+                    true);
+    sqlite::execute(*_db,
+                    "create table if not exists shards (table_name varchar(256), shard integer, row_count integer, "
+                    "primary key (table_name, shard))",
+                    true);
+  } catch (...) {
+    delete _db;
+    throw;
+  }
+  logInfo("Using copy checkpoint file %s\n", path.c_str());
+}
+
+CopyJournal::~CopyJournal() {
+  delete _db;
+}
+
+std::vector<CopyJournal::Chunk> CopyJournal::get_chunks(const std::string &table) {
+  base::MutexLock lock(_mutex);
+
+  std::vector<Chunk> chunks;
+  sqlite::query q(*_db,
+                  "select range_start, range_end, row_count, source_checksum, target_checksum from chunks "
+                  "where table_name = ? order by range_start");
+  q.bind(1, table);
+  if (q.emit()) {
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(q.get_result()));
+    do {
+      Chunk chunk;
+      chunk.range_start = res->get_int64(0);
+      chunk.range_end = res->get_int64(1);
+      chunk.rows = res->get_int64(2);
+      chunk.source_checksum = res->get_string(3);
+      chunk.target_checksum = res->get_string(4);
+      chunks.push_back(chunk);
+    } while (res->next_row());
+  }
+  return chunks;
+}
+
+void CopyJournal::add_chunk(const std::string &table, const Chunk &chunk) {
+  base::MutexLock lock(_mutex);
+
+  sqlite::query q(*_db, "insert or replace into chunks values (?, ?, ?, ?, ?, ?)");
+  q.bind(1, table);
+  q.bind(2, (std::int64_t)chunk.range_start);
+  q.bind(3, (std::int64_t)chunk.range_end);
+  q.bind(4, (std::int64_t)chunk.rows);
+  q.bind(5, chunk.source_checksum);
+  q.bind(6, chunk.target_checksum);
+  q.emit();
+}
+
+void CopyJournal::remove_chunk(const std::string &table, long long range_start) {
+  base::MutexLock lock(_mutex);
+
+  sqlite::query q(*_db, "delete from chunks where table_name = ? and range_start = ?");
+  q.bind(1, table);
+  q.bind(2, (std::int64_t)range_start);
+  q.emit();
+}
+
+std::string CopyJournal::get_shard_plan(const std::string &table) {
+  base::MutexLock lock(_mutex);
+
+  std::string plan;
+  sqlite::query q(*_db, "select plan from shard_plans where table_name = ?");
+  q.bind(1, table);
+  if (q.emit()) {
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(q.get_result()));
+    plan = res->get_string(0);
+  }
+  return plan;
+}
+
+void CopyJournal::set_shard_plan(const std::string &table, const std::string &plan) {
+  base::MutexLock lock(_mutex);
+
+  sqlite::query clear(*_db, "delete from shards where table_name = ?");
+  clear.bind(1, table);
+  clear.emit();
+
+  sqlite::query q(*_db, "insert or replace into shard_plans values (?, ?)");
+  q.bind(1, table);
+  q.bind(2, plan);
+  q.emit();
+}
+
+std::map<int, long long> CopyJournal::get_shards(const std::string &table) {
+  base::MutexLock lock(_mutex);
+
+  std::map<int, long long> shards;
+  sqlite::query q(*_db, "select shard, row_count from shards where table_name = ?");
+  q.bind(1, table);
+  if (q.emit()) {
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(q.get_result()));
+    do
+      shards[res->get_int(0)] = res->get_int64(1);
+    while (res->next_row());
+  }
+  return shards;
+}
+
+void CopyJournal::add_shard(const std::string &table, int shard, long long rows) {
+  base::MutexLock lock(_mutex);
+
+  sqlite::query q(*_db, "insert or replace into shards values (?, ?, ?)");
+  q.bind(1, table);
+  q.bind(2, shard);
+  q.bind(3, (std::int64_t)rows);
+  q.emit();
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/threading.h"
+
+namespace sqlite {
+  struct connection;
+}
+
+// Checkpoint journal of a chunked table copy, kept in a local SQLite file. Every chunk of primary key values that
+// was committed to the target is recorded with its row count and checksums, so that an interrupted copy can go on
+// after the last committed chunk and a verification pass only needs to re-copy the chunks that don't match.
+// Tables copied in shards have their shard plan recorded, with the shards that were committed.
+// Tables are identified by their target names. The journal may be shared by several copy tasks.
+class CopyJournal {
+public:
+  struct Chunk {
+    long long range_start;
+    long long range_end;
+    long long rows;
+    std::string source_checksum; // over the rows as read from the source
+    std::string target_checksum; // as computed by the target server after the chunk was committed
+  };
+
+  CopyJournal(const std::string &path);
+  ~CopyJournal();
+
+  const std::string &path() const {
+    return _path;
+  }
+
+  // Chunks recorded for the table, ordered by their range.
+  std::vector<Chunk> get_chunks(const std::string &table);
+  void add_chunk(const std::string &table, const Chunk &chunk);
+  void remove_chunk(const std::string &table, long long range_start);
+
+  // Serialized ShardPlan of the table, empty if it was not copied in shards.
+  std::string get_shard_plan(const std::string &table);
+  // Records a new plan for the table, forgetting the shards copied with an earlier one.
+  void set_shard_plan(const std::string &table, const std::string &plan);
+  // Row counts of the shards recorded for the table, by shard number.
+  std::map<int, long long> get_shards(const std::string &table);
+  void add_shard(const std::string &table, int shard, long long rows);
+
+private:
+  std::string _path;
+  sqlite::connection *_db;
+  base::Mutex _mutex;
+};
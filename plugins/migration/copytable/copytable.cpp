@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <cstdlib>
 #include <cstdio>
+#include <algorithm>
 
 #include <mysql.h>
 
@@ -48,6 +49,9 @@
 DEFAULT_LOG_DOMAIN("copytable");
 
 #define TMP_TRIGGER_TABLE "wb_tmp_triggers"
+// Rows of a checkpointed shard committed at once, so that big shards don't make huge transactions
+#define SHARD_COMMIT_ROWS 100000
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
 
 #if defined(MYSQL_VERSION_MAJOR) && defined(MYSQL_VERSION_MINOR) && defined(MYSQL_VERSION_PATCH)
 #define MYSQL_CHECK_VERSION(major, minor, micro)                                                         \
@@ -57,6 +61,45 @@ DEFAULT_LOG_DOMAIN("copytable");
 #define MYSQL_CHECK_VERSION(major, minor, micro) false
 #endif
 
+// Splits a possibly qualified and quoted identifier like [db].[dbo].[table], "schema"."table" or `table` into its
+// unquoted parts.
+static std::vector<std::string> split_quoted_identifier(const std::string &name) {
+  std::vector<std::string> parts;
+  std::string part;
+  size_t i = 0;
+  while (i < name.size()) {
+    char open = name[i];
+    if (open == '`' || open == '"' || open == '[') {
+      char close = open == '[' ? ']' : open;
+      for (++i; i < name.size(); ++i) {
+        if (name[i] == close) {
+          if (i + 1 < name.size() && name[i + 1] == close)
+            ++i; // doubled quote char
+          else
+            break;
+        }
+        part.push_back(name[i]);
+      }
+      ++i;
+    } else if (open == '.') {
+      parts.push_back(part);
+      part.clear();
+      ++i;
+    } else
+      part.push_back(name[i++]);
+  }
+  parts.push_back(part);
+  return parts;
+}
+
+// Integer key values as returned by the source. Unsigned values over the range of long long are rejected.
+static bool parse_integer_key(const char *text, long long &value) {
+  char *end = NULL;
+  errno = 0;
+  value = strtoll(text, &end, 10);
+  return errno == 0 && end != text && *end == 0;
+}
+
 static const char *mysql_field_type_to_name(enum enum_field_types type) {
   switch (type) {
     case MYSQL_TYPE_DECIMAL:
@@ -260,7 +303,7 @@ std::string ConnectionError::process(SQLRETURN retcode, SQLSMALLINT htype, SQLHA
 
 RowBuffer::RowBuffer(std::shared_ptr<std::vector<ColumnInfo> > columns,
                      std::function<void(int, const char *, size_t)> send_blob_data, size_t max_packet_size)
-  : _current_field(0), _send_blob_data(send_blob_data) {
+  : _current_field(0), _blob_data_length(0), _send_blob_data(send_blob_data) {
   for (std::vector<ColumnInfo>::const_iterator col = columns->begin(); col != columns->end(); ++col) {
     MYSQL_BIND bind;
     memset(&bind, 0, sizeof(bind));
@@ -382,6 +425,7 @@ RowBuffer::~RowBuffer() {
 
 void RowBuffer::clear() {
   _current_field = 0;
+  _blob_data_length = 0;
 }
 
 void RowBuffer::prepare_add_string(char *&buffer, size_t &buffer_len, unsigned long *&length) {
@@ -496,9 +540,59 @@ enum enum_field_types RowBuffer::target_type(bool &unsig) {
 }
 
 void RowBuffer::send_blob_data(const char *data, size_t length) {
+  _blob_data_length += length;
   _send_blob_data(_current_field, data, length);
 }
 
+unsigned long long RowBuffer::data_length() const {
+  unsigned long long length = _blob_data_length;
+  for (const_iterator field = begin(); field != end(); ++field) {
+    if (field->is_null && !*field->is_null)
+      length += field->length ? *field->length : field->buffer_length;
+  }
+  return length;
+}
+
+static unsigned long long fnv1a(unsigned long long hash, const void *data, size_t length) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+unsigned long long RowBuffer::checksum(unsigned long long hash) const {
+  for (const_iterator field = begin(); field != end(); ++field) {
+    char is_null = !field->is_null || *field->is_null ? 1 : 0;
+    hash = fnv1a(hash, &is_null, 1);
+    if (is_null)
+      continue;
+
+    switch (field->buffer_type) {
+      case MYSQL_TYPE_TIME:
+      case MYSQL_TYPE_DATE:
+      case MYSQL_TYPE_NEWDATE:
+      case MYSQL_TYPE_DATETIME:
+      case MYSQL_TYPE_TIMESTAMP: {
+        // hashed member by member, the struct padding is not initialized
+        const MYSQL_TIME *time = (const MYSQL_TIME *)field->buffer;
+        unsigned long long values[] = {time->year,   time->month,  time->day,         time->hour,
+                                       time->minute, time->second, time->second_part, (unsigned long long)time->neg};
+        hash = fnv1a(hash, values, sizeof(values));
+        break;
+      }
+      default:
+        if (field->length)
+          hash = fnv1a(hash, field->buffer, std::min(*field->length, field->buffer_length));
+        else
+          hash = fnv1a(hash, field->buffer, field->buffer_length);
+        break;
+    }
+  }
+  return hash;
+}
+
 // -------------------------------------------------------------------------------------------------
 
 CopyDataSource::CopyDataSource()
@@ -576,6 +670,9 @@ SQLSMALLINT ODBCCopyDataSource::odbc_type_to_c_type(SQLSMALLINT type, bool is_un
     case SQL_WLONGVARCHAR:
       // FreeTDS converts the data to utf8
       return _force_utf8_input ? SQL_C_CHAR : SQL_C_WCHAR;
+    // Decimals are read as text, which is exact and what the server parses for DECIMAL columns anyway.
+    // SQL_C_NUMERIC would need the precision and scale set in the row descriptor of each column (drivers default
+    // to a scale of 0 and truncate otherwise) and then turning the 128 bit mantissa into text here.
     case SQL_DECIMAL:
     case SQL_NUMERIC:
       return SQL_C_CHAR;
@@ -862,6 +959,190 @@ size_t ODBCCopyDataSource::count_rows(const std::string &schema, const std::stri
   return (size_t)count;
 }
 
+long long ODBCCopyDataSource::estimate_rows(const std::string &schema, const std::string &table) {
+  // schema may hold the catalog when the table name is qualified with its schema, as with SQL Server
+  std::vector<std::string> parts = split_quoted_identifier(schema);
+  std::vector<std::string> table_parts = split_quoted_identifier(table);
+  parts.insert(parts.end(), table_parts.begin(), table_parts.end());
+
+  std::string table_name = parts.back();
+  std::string schema_name = parts.size() > 1 ? parts[parts.size() - 2] : "";
+  std::string catalog_name = parts.size() > 2 ? parts[parts.size() - 3] : "";
+
+  SQLHSTMT stmt;
+  SQLRETURN ret;
+  if (!SQL_SUCCEEDED(ret = SQLAllocHandle(SQL_HANDLE_STMT, _dbc, &stmt)))
+    return -1;
+
+  long long count = -1;
+  ret = SQLStatistics(stmt, catalog_name.empty() ? NULL : (SQLCHAR *)catalog_name.c_str(), SQL_NTS,
+                      schema_name.empty() ? NULL : (SQLCHAR *)schema_name.c_str(), SQL_NTS,
+                      (SQLCHAR *)table_name.c_str(), SQL_NTS, SQL_INDEX_ALL, SQL_QUICK);
+  if (SQL_SUCCEEDED(ret)) {
+    // The table statistics row comes first, followed by one row per index column.
+    while (count < 0 && SQL_SUCCEEDED(SQLFetch(stmt))) {
+      SQLSMALLINT type = 0;
+      SQLBIGINT cardinality = 0;
+      SQLLEN len_or_indicator = 0;
+      if (SQL_SUCCEEDED(SQLGetData(stmt, 7, SQL_C_SSHORT, &type, sizeof(type), NULL)) && type == SQL_TABLE_STAT &&
+          SQL_SUCCEEDED(SQLGetData(stmt, 11, SQL_C_SBIGINT, &cardinality, sizeof(cardinality), &len_or_indicator)) &&
+          len_or_indicator != SQL_NULL_DATA && cardinality >= 0)
+        count = cardinality;
+    }
+  } else
+    logDebug("SQLStatistics failed for %s.%s, no row count estimate available\n", schema.c_str(), table.c_str());
+
+  SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+  return count;
+}
+
+bool ODBCCopyDataSource::get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                       long long &min_value, long long &max_value) {
+  return query_key_range(schema, table, key, "", min_value, max_value);
+}
+
+bool ODBCCopyDataSource::get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                                      long long after, long long &next_value) {
+  long long max_value;
+  std::string where = base::strfmt("%s > %lli", key.c_str(), after);
+  return query_key_range(schema, table, key, where, next_value, max_value);
+}
+
+bool ODBCCopyDataSource::query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                         const std::string &where, long long &min_value, long long &max_value) {
+  SQLHSTMT stmt;
+  SQLRETURN ret;
+  if (!SQL_SUCCEEDED(ret = SQLAllocHandle(SQL_HANDLE_STMT, _dbc, &stmt)))
+    throw ConnectionError("SQLAllocHandle", ret, SQL_HANDLE_DBC, _dbc);
+
+  QueryBuilder q;
+  q.select_columns(base::strfmt("min(%s), max(%s)", key.c_str(), key.c_str()));
+  q.select_from_table(table, schema);
+  if (!where.empty())
+    q.add_where(where);
+
+  logDebug("Executing query: %s\n", q.build_query().c_str());
+  bool found = false;
+  if (SQL_SUCCEEDED(ret = SQLExecDirect(stmt, (SQLCHAR *)q.build_query().c_str(), SQL_NTS))) {
+    SQLCHAR name[256];
+    SQLSMALLINT name_length, data_type, decimal_digits, nullable;
+    SQLULEN column_size;
+    if (SQL_SUCCEEDED(SQLDescribeCol(stmt, 1, name, sizeof(name), &name_length, &data_type, &column_size,
+                                     &decimal_digits, &nullable)) &&
+        (data_type == SQL_TINYINT || data_type == SQL_SMALLINT || data_type == SQL_INTEGER ||
+         data_type == SQL_BIGINT || ((data_type == SQL_NUMERIC || data_type == SQL_DECIMAL) && decimal_digits == 0)) &&
+        SQL_SUCCEEDED(SQLFetch(stmt))) {
+      char values[2][64];
+      SQLLEN len_or_indicator[2];
+      found = SQL_SUCCEEDED(SQLGetData(stmt, 1, SQL_C_CHAR, values[0], sizeof(values[0]), &len_or_indicator[0])) &&
+              SQL_SUCCEEDED(SQLGetData(stmt, 2, SQL_C_CHAR, values[1], sizeof(values[1]), &len_or_indicator[1])) &&
+              len_or_indicator[0] != SQL_NULL_DATA && len_or_indicator[1] != SQL_NULL_DATA &&
+              parse_integer_key(values[0], min_value) && parse_integer_key(values[1], max_value);
+    }
+  } else
+    logWarning("Could not get the range of %s in %s.%s: %s\n", key.c_str(), schema.c_str(), table.c_str(),
+               ConnectionError("SQLExecDirect", ret, SQL_HANDLE_STMT, stmt).what());
+
+  SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+  return found;
+}
+
+std::vector<ShardKey> ODBCCopyDataSource::get_shard_keys(const std::string &schema, const std::string &table) {
+  std::vector<std::string> parts = split_quoted_identifier(schema);
+  std::vector<std::string> table_parts = split_quoted_identifier(table);
+  parts.insert(parts.end(), table_parts.begin(), table_parts.end());
+
+  std::string table_name = parts.back();
+  std::string schema_name = parts.size() > 1 ? parts[parts.size() - 2] : "";
+  std::string catalog_name = parts.size() > 2 ? parts[parts.size() - 3] : "";
+
+  // a space means the driver doesn't quote identifiers
+  char quote[8] = "";
+  SQLSMALLINT quote_length = 0;
+  if (!SQL_SUCCEEDED(SQLGetInfo(_dbc, SQL_IDENTIFIER_QUOTE_CHAR, quote, sizeof(quote), &quote_length)) ||
+      quote[0] == ' ')
+    quote[0] = 0;
+
+  SQLHSTMT stmt;
+  SQLRETURN ret;
+  if (!SQL_SUCCEEDED(ret = SQLAllocHandle(SQL_HANDLE_STMT, _dbc, &stmt)))
+    throw ConnectionError("SQLAllocHandle", ret, SQL_HANDLE_DBC, _dbc);
+
+  std::vector<std::string> columns;
+  ret = SQLColumns(stmt, catalog_name.empty() ? NULL : (SQLCHAR *)catalog_name.c_str(), SQL_NTS,
+                   schema_name.empty() ? NULL : (SQLCHAR *)schema_name.c_str(), SQL_NTS,
+                   (SQLCHAR *)table_name.c_str(), SQL_NTS, NULL, 0);
+  if (SQL_SUCCEEDED(ret)) {
+    while (SQL_SUCCEEDED(SQLFetch(stmt))) {
+      char name[256];
+      SQLSMALLINT type = 0, decimal_digits = 0;
+      SQLLEN len_or_indicator = 0;
+      if (SQL_SUCCEEDED(SQLGetData(stmt, 4, SQL_C_CHAR, name, sizeof(name), NULL)) &&
+          SQL_SUCCEEDED(SQLGetData(stmt, 5, SQL_C_SSHORT, &type, sizeof(type), NULL)) &&
+          SQL_SUCCEEDED(
+            SQLGetData(stmt, 9, SQL_C_SSHORT, &decimal_digits, sizeof(decimal_digits), &len_or_indicator)) &&
+          (type == SQL_TINYINT || type == SQL_SMALLINT || type == SQL_INTEGER || type == SQL_BIGINT ||
+           ((type == SQL_NUMERIC || type == SQL_DECIMAL) && len_or_indicator != SQL_NULL_DATA && decimal_digits == 0)))
+        columns.push_back(name);
+    }
+  } else
+    logDebug("SQLColumns failed for %s.%s, no columns to split it on\n", schema.c_str(), table.c_str());
+  SQLFreeStmt(stmt, SQL_CLOSE);
+
+  std::map<std::string, ShardIndex> indexes;
+  ret = SQLStatistics(stmt, catalog_name.empty() ? NULL : (SQLCHAR *)catalog_name.c_str(), SQL_NTS,
+                      schema_name.empty() ? NULL : (SQLCHAR *)schema_name.c_str(), SQL_NTS,
+                      (SQLCHAR *)table_name.c_str(), SQL_NTS, SQL_INDEX_ALL, SQL_QUICK);
+  if (SQL_SUCCEEDED(ret)) {
+    // rows come ordered by index and column position
+    while (SQL_SUCCEEDED(SQLFetch(stmt))) {
+      char index_name[256], column_name[256];
+      SQLSMALLINT non_unique = 1, type = 0;
+      SQLLEN len_or_indicator = 0;
+      if (SQL_SUCCEEDED(SQLGetData(stmt, 7, SQL_C_SSHORT, &type, sizeof(type), NULL)) && type != SQL_TABLE_STAT &&
+          SQL_SUCCEEDED(SQLGetData(stmt, 4, SQL_C_SSHORT, &non_unique, sizeof(non_unique), NULL)) &&
+          SQL_SUCCEEDED(SQLGetData(stmt, 6, SQL_C_CHAR, index_name, sizeof(index_name), NULL)) &&
+          SQL_SUCCEEDED(SQLGetData(stmt, 9, SQL_C_CHAR, column_name, sizeof(column_name), &len_or_indicator))) {
+        ShardIndex &index = indexes[index_name];
+        index.unique = non_unique == SQL_FALSE;
+        index.columns.push_back(len_or_indicator == SQL_NULL_DATA ? "" : column_name);
+      }
+    }
+  } else
+    logDebug("SQLStatistics failed for %s.%s, no indexes to split it on\n", schema.c_str(), table.c_str());
+  SQLFreeStmt(stmt, SQL_CLOSE);
+
+  std::string q(quote);
+  std::vector<ShardKey> keys = rank_shard_keys(columns, indexes, [q](const std::string &column) -> std::string {
+    return q.empty() ? column : q + base::replaceString(column, q, q + q) + q;
+  });
+
+  // PostgreSQL tables can be split by page, the page count is known from the size of the table
+  if (_source_rdbms_type == "Postgresql") {
+    std::string relation = base::replaceString(schema + "." + table, "'", "''");
+    std::string pages =
+      base::strfmt("SELECT pg_relation_size('%s'::regclass) / current_setting('block_size')::bigint", relation.c_str());
+    logDebug("Executing query: %s\n", pages.c_str());
+    if (SQL_SUCCEEDED(ret = SQLExecDirect(stmt, (SQLCHAR *)pages.c_str(), SQL_NTS)) &&
+        SQL_SUCCEEDED(SQLFetch(stmt))) {
+      char value[64];
+      SQLLEN len_or_indicator = 0;
+      ShardKey ctid(ShardKey::RowLocator, "ctid", "");
+      ctid.bound_format = "'(%lli,0)'::tid";
+      ctid.has_range = true;
+      ctid.min_value = 0;
+      if (SQL_SUCCEEDED(SQLGetData(stmt, 1, SQL_C_CHAR, value, sizeof(value), &len_or_indicator)) &&
+          len_or_indicator != SQL_NULL_DATA && parse_integer_key(value, ctid.max_value))
+        keys.push_back(ctid);
+    } else
+      logWarning("Could not get the page count of %s.%s: %s\n", schema.c_str(), table.c_str(),
+                 ConnectionError("SQLExecDirect", ret, SQL_HANDLE_STMT, stmt).what());
+  }
+
+  SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+  return keys;
+}
+
 std::shared_ptr<std::vector<ColumnInfo> > ODBCCopyDataSource::begin_select_table(
   const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
   const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys) {
@@ -869,6 +1150,7 @@ std::shared_ptr<std::vector<ColumnInfo> > ODBCCopyDataSource::begin_select_table
   _columns = columns;
   _schema_name = schema;
   _table_name = table;
+  _field_readers.clear();
 
   _stmt_ok = true;
   SQLRETURN ret;
@@ -956,229 +1238,395 @@ std::shared_ptr<std::vector<ColumnInfo> > ODBCCopyDataSource::begin_select_table
 }
 
 void ODBCCopyDataSource::end_select_table() {
-  SQLFreeHandle(SQL_HANDLE_STMT, _stmt);
+  // may be called again after an error, chunked copies end the select of each chunk
+  if (_stmt_ok)
+    SQLFreeHandle(SQL_HANDLE_STMT, _stmt);
   _column_types.clear();
+  _field_readers.clear();
   _columns.reset();
   _stmt_ok = false;
 }
 
-bool ODBCCopyDataSource::fetch_row(RowBuffer &rowbuffer) {
-  if (SQL_SUCCEEDED(SQLFetch(_stmt))) {
-    for (int i = 1; i <= _column_count; i++) {
-      SQLRETURN ret = 0;
-      SQLLEN len_or_indicator;
-      char *out_buffer;
-      size_t out_buffer_len;
-
-      // if this column is a blob, handle it as such
-      if (rowbuffer.check_if_blob() || (*_columns)[i - 1].is_long_data) {
-        ret = SQLGetData(_stmt, i, _column_types[i - 1], _blob_buffer.data(), _max_blob_chunk_size, &len_or_indicator);
-
-        // Saves the column length, at the first call it is the total column size
-        if (len_or_indicator > _max_parameter_size) {
-          if (_abort_on_oversized_blobs)
-            throw std::runtime_error(base::strfmt("oversized blob found in table %s.%s, size: %lli",
-                                                  _schema_name.c_str(), _table_name.c_str(),
-                                                  (long long)len_or_indicator));
-          else {
-            printf("oversized blob found in table %s.%s, size: %lli", _schema_name.c_str(), _table_name.c_str(),
-                   (long long)len_or_indicator);
-            rowbuffer.finish_field(true);
-            continue;
-          }
-        } else {
-          while (ret == SQL_SUCCESS_WITH_INFO) {
-            SQLUSMALLINT i = 0;
-            SQLINTEGER native;
-            SQLCHAR state[7];
-            SQLCHAR text[256];
-            SQLSMALLINT len;
-
-            ret = SQLGetDiagRec(SQL_HANDLE_STMT, _stmt, ++i, state, &native, text, sizeof(text), &len);
-
-            // This should be done ONLY if no bulk updates
-            // are being used
-            if (native == 1014 && !_use_bulk_inserts)
-              rowbuffer.send_blob_data(_blob_buffer.data(), len_or_indicator);
-
-            // Unrecognized characters were changed to ?? but data was read
-            else if (native == 2403) {
-              logWarning("[%s - %ld]: %s\n", state, (long int)native, text);
-              break;
-            }
+SQLRETURN ODBCCopyDataSource::get_blob_data(RowBuffer &rowbuffer, int column) {
+  SQLLEN len_or_indicator;
+  SQLRETURN ret =
+    SQLGetData(_stmt, column, _column_types[column - 1], _blob_buffer.data(), _max_blob_chunk_size, &len_or_indicator);
+
+  // Saves the column length, at the first call it is the total column size
+  if (len_or_indicator > _max_parameter_size) {
+    if (_abort_on_oversized_blobs)
+      throw std::runtime_error(base::strfmt("oversized blob found in table %s.%s, size: %lli", _schema_name.c_str(),
+                                            _table_name.c_str(), (long long)len_or_indicator));
+
+    printf("oversized blob found in table %s.%s, size: %lli", _schema_name.c_str(), _table_name.c_str(),
+           (long long)len_or_indicator);
+    rowbuffer.finish_field(true);
+    return SQL_SUCCESS;
+  }
 
-            ret =
-              SQLGetData(_stmt, i, _column_types[i - 1], _blob_buffer.data(), _max_blob_chunk_size, &len_or_indicator);
-          }
+  while (ret == SQL_SUCCESS_WITH_INFO) {
+    SQLUSMALLINT i = 0;
+    SQLINTEGER native;
+    SQLCHAR state[7];
+    SQLCHAR text[256];
+    SQLSMALLINT len;
 
-          if (ret == SQL_SUCCESS) {
-            bool was_null = len_or_indicator == SQL_NULL_DATA;
-
-            if (!was_null) {
-              char *final_data = _blob_buffer.data();
-              size_t final_length = len_or_indicator;
-
-              // Convers the data to utf8 if needed
-              if (_column_types[i - 1] == SQL_C_WCHAR && len_or_indicator > 0) {
-                std::string outbuf = base::wstring_to_string((wchar_t *)_blob_buffer.data());
-                // TODO take care of case where the utf8 data is bigger than _max_blob_chunk_size
-                if (outbuf.size() > _max_blob_chunk_size - 1)
-                  throw std::logic_error("Output buffer size is greater than max blob chunk size.");
-                std::fill(_blob_buffer.begin(), _blob_buffer.end(), 0);
-                std::strcpy(_blob_buffer.data(), outbuf.c_str());
-                final_length = outbuf.size();
-              }
+    ret = SQLGetDiagRec(SQL_HANDLE_STMT, _stmt, ++i, state, &native, text, sizeof(text), &len);
 
-              if (_use_bulk_inserts) {
-                if (rowbuffer[i - 1].buffer_length)
-                  free(rowbuffer[i - 1].buffer);
+    // This should be done ONLY if no bulk updates
+    // are being used
+    if (native == 1014 && !_use_bulk_inserts)
+      rowbuffer.send_blob_data(_blob_buffer.data(), len_or_indicator);
 
-                *rowbuffer[i - 1].length = (unsigned long)final_length;
-                rowbuffer[i - 1].buffer_length = (unsigned long)final_length;
-                rowbuffer[i - 1].buffer = malloc(final_length);
+    // Unrecognized characters were changed to ?? but data was read
+    else if (native == 2403) {
+      logWarning("[%s - %ld]: %s\n", state, (long int)native, text);
+      break;
+    }
 
-                memcpy(rowbuffer[i - 1].buffer, final_data, final_length);
-              } else
-                rowbuffer.send_blob_data(final_data, final_length);
-            }
+    ret = SQLGetData(_stmt, column, _column_types[column - 1], _blob_buffer.data(), _max_blob_chunk_size,
+                     &len_or_indicator);
+  }
 
-            rowbuffer.finish_field(was_null);
-          } else {
-            rowbuffer.finish_field(true);
-            throw ConnectionError("SQLGetData", ret, SQL_HANDLE_STMT, _stmt);
-          }
-          continue;
-        }
-      }
+  if (ret != SQL_SUCCESS)
+    return SQL_SUCCEEDED(ret) ? SQL_ERROR : ret;
+
+  bool was_null = len_or_indicator == SQL_NULL_DATA;
+  if (!was_null) {
+    char *final_data = _blob_buffer.data();
+    size_t final_length = len_or_indicator;
+
+    // Convers the data to utf8 if needed
+    if (_column_types[column - 1] == SQL_C_WCHAR && len_or_indicator > 0) {
+      std::string outbuf = base::wstring_to_string((wchar_t *)_blob_buffer.data());
+      // TODO take care of case where the utf8 data is bigger than _max_blob_chunk_size
+      if (outbuf.size() > _max_blob_chunk_size - 1)
+        throw std::logic_error("Output buffer size is greater than max blob chunk size.");
+      std::fill(_blob_buffer.begin(), _blob_buffer.end(), 0);
+      std::strcpy(_blob_buffer.data(), outbuf.c_str());
+      final_length = outbuf.size();
+    }
+
+    if (_use_bulk_inserts) {
+      if (rowbuffer[column - 1].buffer_length)
+        free(rowbuffer[column - 1].buffer);
+
+      *rowbuffer[column - 1].length = (unsigned long)final_length;
+      rowbuffer[column - 1].buffer_length = (unsigned long)final_length;
+      rowbuffer[column - 1].buffer = malloc(final_length);
+
+      memcpy(rowbuffer[column - 1].buffer, final_data, final_length);
+    } else
+      rowbuffer.send_blob_data(final_data, final_length);
+  }
+
+  rowbuffer.finish_field(was_null);
+  return ret;
+}
+
+// During the migration process some non standard data types are migrated as strings
+// Those will come as SQL_C_BINARY but will be migrated as NULL for now
+SQLRETURN ODBCCopyDataSource::get_null_data(RowBuffer &rowbuffer, int column) {
+  rowbuffer.finish_field(true);
+  return SQL_SUCCESS;
+}
+
+SQLRETURN ODBCCopyDataSource::get_bit_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, SQL_C_STINYINT, out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_tiny_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, _column_types[column - 1], out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_short_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_short(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, _column_types[column - 1], out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+// SQL_C_SLONG and SQL_C_ULONG columns are 32 bit values, widened here so that the range checks work for both
+SQLRETURN ODBCCopyDataSource::get_int_value(int column, long long &value, SQLLEN &len_or_indicator) {
+  SQLRETURN ret;
+  if (_column_types[column - 1] == SQL_C_ULONG) {
+    SQLUINTEGER tmp_buffer = 0;
+    ret = SQLGetData(_stmt, column, SQL_C_ULONG, &tmp_buffer, sizeof(tmp_buffer), &len_or_indicator);
+    value = tmp_buffer;
+  } else {
+    SQLINTEGER tmp_buffer = 0;
+    ret = SQLGetData(_stmt, column, SQL_C_SLONG, &tmp_buffer, sizeof(tmp_buffer), &len_or_indicator);
+    value = tmp_buffer;
+  }
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_int_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+  long long value;
+
+  SQLRETURN ret = get_int_value(column, value, len_or_indicator);
+  if (SQL_SUCCEEDED(ret)) {
+    rowbuffer.prepare_add_long(out_buffer, out_buffer_len);
+    *(int *)out_buffer = (int)value;
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  }
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_int_as_short_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+  long long value;
+
+  SQLRETURN ret = get_int_value(column, value, len_or_indicator);
+  if (SQL_SUCCEEDED(ret)) {
+    rowbuffer.prepare_add_short(out_buffer, out_buffer_len);
+    if (len_or_indicator != SQL_NULL_DATA &&
+        !BaseConverter::convert_int(value, rowbuffer[column - 1].is_unsigned != 0, (short *)out_buffer))
+      throw std::logic_error(base::strfmt("Range error fetching field %i (value %lli, target is %s)", column, value,
+                                          mysql_field_type_to_name(MYSQL_TYPE_SHORT)));
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  }
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_int_as_tiny_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+  long long value;
+
+  SQLRETURN ret = get_int_value(column, value, len_or_indicator);
+  if (SQL_SUCCEEDED(ret)) {
+    rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
+    if (len_or_indicator != SQL_NULL_DATA &&
+        !BaseConverter::convert_int(value, rowbuffer[column - 1].is_unsigned != 0, (char *)out_buffer))
+      throw std::logic_error(base::strfmt("Range error fetching field %i (value %lli, target is %s)", column, value,
+                                          mysql_field_type_to_name(MYSQL_TYPE_TINY)));
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  }
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_bigint_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_bigint(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, _column_types[column - 1], out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_float_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_float(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, SQL_C_FLOAT, out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+SQLRETURN ODBCCopyDataSource::get_double_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+
+  rowbuffer.prepare_add_double(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, SQL_C_DOUBLE, out_buffer, out_buffer_len, &len_or_indicator);
+  if (SQL_SUCCEEDED(ret))
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  return ret;
+}
+
+// DATE and TIMESTAMP columns are fetched in the ODBC binary structs, which saves formatting them as text in the
+// driver and parsing that text again here.
+SQLRETURN ODBCCopyDataSource::get_date_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+  DATE_STRUCT value;
+
+  rowbuffer.prepare_add_time(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, SQL_C_TYPE_DATE, &value, sizeof(value), &len_or_indicator);
+  if (SQL_SUCCEEDED(ret)) {
+    if (len_or_indicator != SQL_NULL_DATA)
+      BaseConverter::convert_date(&value, (MYSQL_TIME *)out_buffer);
+    else
+      ((MYSQL_TIME *)out_buffer)->time_type = MYSQL_TIMESTAMP_NONE;
+
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  }
+  return ret;
+}
+
+// TIME_STRUCT has no fraction field, so TIME columns are read as text to keep their fractional seconds.
+SQLRETURN ODBCCopyDataSource::get_time_data(RowBuffer &rowbuffer, int column) {
+  return get_date_time_data(rowbuffer, column, MYSQL_TYPE_TIME);
+}
+
+SQLRETURN ODBCCopyDataSource::get_timestamp_data(RowBuffer &rowbuffer, int column) {
+  char *out_buffer;
+  size_t out_buffer_len;
+  SQLLEN len_or_indicator;
+  TIMESTAMP_STRUCT value;
+
+  rowbuffer.prepare_add_time(out_buffer, out_buffer_len);
+  SQLRETURN ret = SQLGetData(_stmt, column, SQL_C_TYPE_TIMESTAMP, &value, sizeof(value), &len_or_indicator);
+  if (SQL_SUCCEEDED(ret)) {
+    if (len_or_indicator != SQL_NULL_DATA)
+      BaseConverter::convert_timestamp(&value, (MYSQL_TIME *)out_buffer);
+    else
+      ((MYSQL_TIME *)out_buffer)->time_type = MYSQL_TIMESTAMP_NONE;
+
+    rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+  }
+  return ret;
+}
+
+// Text columns migrated to temporal types
+SQLRETURN ODBCCopyDataSource::get_date_time_string_data(RowBuffer &rowbuffer, int column) {
+  return get_date_time_data(rowbuffer, column, rowbuffer[column - 1].buffer_type);
+}
 
-      switch (_column_types[i - 1]) {
+void ODBCCopyDataSource::compile_field_readers(RowBuffer &rowbuffer) {
+  _field_readers.clear();
+  _field_readers.reserve(_column_count);
+
+  for (int i = 0; i < _column_count; i++) {
+    enum enum_field_types target_type = rowbuffer[i].buffer_type;
+    FieldReader reader;
+
+    // if this column is a blob, handle it as such
+    if (target_type == MYSQL_TYPE_BLOB || (*_columns)[i].is_long_data)
+      reader = &ODBCCopyDataSource::get_blob_data;
+    else {
+      switch (_column_types[i]) {
         case SQL_C_BIT:
-          rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
-          ret = SQLGetData(_stmt, i, SQL_C_STINYINT, out_buffer, out_buffer_len, &len_or_indicator);
-          if (SQL_SUCCEEDED(ret))
-            rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+          reader = &ODBCCopyDataSource::get_bit_data;
           break;
         case SQL_C_FLOAT:
         case SQL_C_DOUBLE:
-          if (rowbuffer[i - 1].buffer_type == MYSQL_TYPE_FLOAT) {
-            rowbuffer.prepare_add_float(out_buffer, out_buffer_len);
-            ret = SQLGetData(_stmt, i, SQL_C_FLOAT, out_buffer, out_buffer_len, &len_or_indicator);
-            if (SQL_SUCCEEDED(ret))
-              rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
-          } else {
-            rowbuffer.prepare_add_double(out_buffer, out_buffer_len);
-            ret = SQLGetData(_stmt, i, SQL_C_DOUBLE, out_buffer, out_buffer_len, &len_or_indicator);
-            if (SQL_SUCCEEDED(ret))
-              rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
-          }
+          if (target_type == MYSQL_TYPE_FLOAT)
+            reader = &ODBCCopyDataSource::get_float_data;
+          else
+            reader = &ODBCCopyDataSource::get_double_data;
           break;
         case SQL_C_DATE:
-          ret = get_date_time_data(rowbuffer, i, MYSQL_TYPE_DATE);
+          reader = &ODBCCopyDataSource::get_date_data;
           break;
         case SQL_C_TIME:
-          ret = get_date_time_data(rowbuffer, i, MYSQL_TYPE_TIME);
+          reader = &ODBCCopyDataSource::get_time_data;
           break;
         case SQL_C_TIMESTAMP:
-          ret = get_date_time_data(rowbuffer, i, MYSQL_TYPE_TIMESTAMP);
+          reader = &ODBCCopyDataSource::get_timestamp_data;
           break;
         case SQL_C_UBIGINT:
         case SQL_C_SBIGINT:
-          rowbuffer.prepare_add_bigint(out_buffer, out_buffer_len);
-          ret = SQLGetData(_stmt, i, _column_types[i - 1], out_buffer, out_buffer_len, &len_or_indicator);
-          if (SQL_SUCCEEDED(ret))
-            rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+          reader = &ODBCCopyDataSource::get_bigint_data;
           break;
         case SQL_C_ULONG:
-        case SQL_C_SLONG: {
-          long tmp_buffer;
-          bool unsig;
-          enum enum_field_types target_type;
-          ret = SQLGetData(_stmt, i, _column_types[i - 1], &tmp_buffer, sizeof(tmp_buffer), &len_or_indicator);
-          if (SQL_SUCCEEDED(ret)) {
-            switch ((target_type = rowbuffer.target_type(unsig))) {
-              case MYSQL_TYPE_SHORT:
-                rowbuffer.prepare_add_short(out_buffer, out_buffer_len);
-                if ((unsig && (tmp_buffer < 0 || tmp_buffer > UINT16_MAX)) ||
-                    (!unsig && (tmp_buffer > INT16_MAX || tmp_buffer < INT16_MIN)))
-                  throw std::logic_error(base::strfmt("Range error fetching field %i (value %li, target is %s)", i,
-                                                      tmp_buffer, mysql_field_type_to_name(target_type)));
-                *(short *)out_buffer = (short)tmp_buffer;
-                break;
-              case MYSQL_TYPE_TINY:
-                rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
-                if ((unsig && (tmp_buffer < 0 || tmp_buffer > UINT8_MAX)) ||
-                    (!unsig && (tmp_buffer > INT8_MAX || tmp_buffer < INT8_MIN)))
-                  throw std::logic_error(base::strfmt("Range error fetching field %i (value %li, target is %s)", i,
-                                                      tmp_buffer, mysql_field_type_to_name(target_type)));
-                *(char *)out_buffer = (char)tmp_buffer;
-                break;
-              default:
-                rowbuffer.prepare_add_long(out_buffer, out_buffer_len);
-                *(long *)out_buffer = tmp_buffer;
-                break;
-            }
-            rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+        case SQL_C_SLONG:
+          switch (target_type) {
+            case MYSQL_TYPE_SHORT:
+              reader = &ODBCCopyDataSource::get_int_as_short_data;
+              break;
+            case MYSQL_TYPE_TINY:
+              reader = &ODBCCopyDataSource::get_int_as_tiny_data;
+              break;
+            default:
+              reader = &ODBCCopyDataSource::get_int_data;
+              break;
           }
           break;
-        }
         case SQL_C_USHORT:
         case SQL_C_SSHORT:
-          rowbuffer.prepare_add_short(out_buffer, out_buffer_len);
-          ret = SQLGetData(_stmt, i, _column_types[i - 1], out_buffer, out_buffer_len, &len_or_indicator);
-          if (SQL_SUCCEEDED(ret))
-            rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+          reader = &ODBCCopyDataSource::get_short_data;
           break;
         case SQL_C_UTINYINT:
         case SQL_C_STINYINT:
-          rowbuffer.prepare_add_tiny(out_buffer, out_buffer_len);
-          ret = SQLGetData(_stmt, i, _column_types[i - 1], out_buffer, out_buffer_len, &len_or_indicator);
-          if (SQL_SUCCEEDED(ret))
-            rowbuffer.finish_field(len_or_indicator == SQL_NULL_DATA);
+          reader = &ODBCCopyDataSource::get_tiny_data;
           break;
         case SQL_C_WCHAR:
-        case SQL_C_CHAR: {
-          switch (rowbuffer[i - 1].buffer_type) {
+        case SQL_C_CHAR:
+          switch (target_type) {
             case MYSQL_TYPE_TIME:
             case MYSQL_TYPE_DATE:
             case MYSQL_TYPE_DATETIME:
             case MYSQL_TYPE_NEWDATE:
-              ret = get_date_time_data(rowbuffer, i, rowbuffer[i - 1].buffer_type);
+              reader = &ODBCCopyDataSource::get_date_time_string_data;
               break;
             case MYSQL_TYPE_GEOMETRY:
-              ret = get_geometry_buffer_data(rowbuffer, i);
+              reader = &ODBCCopyDataSource::get_geometry_buffer_data;
               break;
             default:
-              if (_column_types[i - 1] == SQL_C_WCHAR)
-                ret = get_wchar_buffer_data(rowbuffer, i);
+              if (_column_types[i] == SQL_C_WCHAR)
+                reader = &ODBCCopyDataSource::get_wchar_buffer_data;
               else
-                ret = get_char_buffer_data(rowbuffer, i);
+                reader = &ODBCCopyDataSource::get_char_buffer_data;
               break;
           }
           break;
-        }
-        case SQL_C_BINARY: {
-          bool was_null = true;
-          // During the migration process some non standard data types are migrated as strings
-          // Those will come as SQL_C_BINARY but will be migrated as NULL for now
-          if (rowbuffer[i - 1].buffer_type != MYSQL_TYPE_STRING) {
-            was_null = false;
-            ret = get_char_buffer_data(rowbuffer, i);
-          }
-
-          rowbuffer.finish_field(was_null);
-        } break;
+        case SQL_C_BINARY:
+          if (target_type == MYSQL_TYPE_STRING)
+            reader = &ODBCCopyDataSource::get_null_data;
+          else
+            reader = &ODBCCopyDataSource::get_char_buffer_data;
+          break;
 
         default:
-          throw std::logic_error(base::strfmt("Unhandled type %i", _column_types[i - 1]));
-      }
-      if (!SQL_SUCCEEDED(ret)) {
-        rowbuffer.finish_field(true);
-        throw ConnectionError("SQLGetData", ret, SQL_HANDLE_STMT, _stmt);
+          throw std::logic_error(base::strfmt("Unhandled type %i", _column_types[i]));
       }
     }
-    return true;
+    _field_readers.push_back(reader);
   }
-  return false;
+}
+
+bool ODBCCopyDataSource::fetch_row(RowBuffer &rowbuffer) {
+  if (!SQL_SUCCEEDED(SQLFetch(_stmt)))
+    return false;
+
+  if (_field_readers.size() != (size_t)_column_count)
+    compile_field_readers(rowbuffer);
+
+  for (int i = 1; i <= _column_count; i++) {
+    SQLRETURN ret = (this->*_field_readers[i - 1])(rowbuffer, i);
+    if (!SQL_SUCCEEDED(ret)) {
+      rowbuffer.finish_field(true);
+      throw ConnectionError("SQLGetData", ret, SQL_HANDLE_STMT, _stmt);
+    }
+  }
+  return true;
 }
 
 MySQLCopyDataSource::MySQLCopyDataSource(const std::string &hostname, int port, const std::string &username,
@@ -1300,10 +1748,125 @@ size_t MySQLCopyDataSource::count_rows(const std::string &schema, const std::str
 
   mysql_free_result(result);
 
-  if ((spec.type == CopyAll || spec.type == CopyWhere) && spec.max_count > 0 && spec.max_count < count)
-    count = spec.max_count;
+  if ((spec.type == CopyAll || spec.type == CopyWhere) && spec.max_count > 0 && spec.max_count < count)
+    count = spec.max_count;
+
+  return (size_t)count;
+}
+
+long long MySQLCopyDataSource::estimate_rows(const std::string &schema, const std::string &table) {
+  std::string schema_name = split_quoted_identifier(schema).back();
+  std::string table_name = split_quoted_identifier(table).back();
+
+  // Statistics for all tables of a schema are fetched at once, the first time one of them is asked for.
+  std::map<std::string, std::map<std::string, long long> >::iterator tables = _estimated_rows.find(schema_name);
+  if (tables == _estimated_rows.end()) {
+    tables = _estimated_rows.insert(std::make_pair(schema_name, std::map<std::string, long long>())).first;
+
+    std::vector<char> escaped(schema_name.size() * 2 + 1);
+    mysql_real_escape_string(&_mysql, &escaped[0], schema_name.data(), (unsigned long)schema_name.size());
+    std::string q = base::strfmt(
+      "SELECT TABLE_NAME, TABLE_ROWS FROM information_schema.TABLES WHERE TABLE_SCHEMA = '%s'", &escaped[0]);
+
+    MYSQL_RES *result;
+    if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0 ||
+        (result = mysql_store_result(&_mysql)) == NULL) {
+      logWarning("Could not get table statistics for schema %s: %s\n", schema_name.c_str(), mysql_error(&_mysql));
+      return -1;
+    }
+
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(result)) != NULL) {
+      if (row[0] && row[1]) // TABLE_ROWS is NULL for views
+        tables->second[row[0]] = strtoll(row[1], NULL, 10);
+    }
+    mysql_free_result(result);
+  }
+
+  std::map<std::string, long long>::const_iterator rows = tables->second.find(table_name);
+  return rows == tables->second.end() ? -1 : rows->second;
+}
+
+bool MySQLCopyDataSource::get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                        long long &min_value, long long &max_value) {
+  return query_key_range(schema, table, key, "", min_value, max_value);
+}
+
+bool MySQLCopyDataSource::get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                                       long long after, long long &next_value) {
+  long long max_value;
+  std::string where = base::strfmt("%s > %lli", key.c_str(), after);
+  return query_key_range(schema, table, key, where, next_value, max_value);
+}
+
+bool MySQLCopyDataSource::query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                          const std::string &where, long long &min_value, long long &max_value) {
+  QueryBuilder select_query;
+  select_query.select_columns(base::strfmt("min(%s), max(%s)", key.c_str(), key.c_str()));
+  select_query.select_from_table(table, schema);
+  if (!where.empty())
+    select_query.add_where(where);
+  std::string q = select_query.build_query();
+
+  logDebug("Executing query: %s\n", q.c_str());
+  MYSQL_RES *result;
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0 ||
+      (result = mysql_store_result(&_mysql)) == NULL)
+    throw ConnectionError("mysql_query(" + q + ")", &_mysql);
+
+  bool found = false;
+  MYSQL_FIELD *field = mysql_fetch_field(result);
+  MYSQL_ROW row = mysql_fetch_row(result);
+  if (row && row[0] && row[1] &&
+      (field->type == MYSQL_TYPE_TINY || field->type == MYSQL_TYPE_SHORT || field->type == MYSQL_TYPE_INT24 ||
+       field->type == MYSQL_TYPE_LONG || field->type == MYSQL_TYPE_LONGLONG))
+    found = parse_integer_key(row[0], min_value) && parse_integer_key(row[1], max_value);
+  mysql_free_result(result);
+
+  return found;
+}
+
+std::vector<ShardKey> MySQLCopyDataSource::get_shard_keys(const std::string &schema, const std::string &table) {
+  std::string schema_name = split_quoted_identifier(schema).back();
+  std::string table_name = split_quoted_identifier(table).back();
+
+  std::vector<char> escaped_schema(schema_name.size() * 2 + 1);
+  mysql_real_escape_string(&_mysql, &escaped_schema[0], schema_name.data(), (unsigned long)schema_name.size());
+  std::vector<char> escaped_table(table_name.size() * 2 + 1);
+  mysql_real_escape_string(&_mysql, &escaped_table[0], table_name.data(), (unsigned long)table_name.size());
+
+  std::vector<std::string> columns;
+  std::map<std::string, ShardIndex> indexes;
+  std::string queries[] = {
+    base::strfmt("SELECT COLUMN_NAME FROM information_schema.COLUMNS WHERE TABLE_SCHEMA = '%s' AND TABLE_NAME = '%s' "
+                 "AND DATA_TYPE IN ('tinyint', 'smallint', 'mediumint', 'int', 'bigint') ORDER BY ORDINAL_POSITION",
+                 &escaped_schema[0], &escaped_table[0]),
+    base::strfmt("SELECT INDEX_NAME, NON_UNIQUE, COLUMN_NAME FROM information_schema.STATISTICS "
+                 "WHERE TABLE_SCHEMA = '%s' AND TABLE_NAME = '%s' ORDER BY INDEX_NAME, SEQ_IN_INDEX",
+                 &escaped_schema[0], &escaped_table[0])};
+  for (int i = 0; i < 2; ++i) {
+    logDebug("Executing query: %s\n", queries[i].c_str());
+    MYSQL_RES *result;
+    if (mysql_real_query(&_mysql, queries[i].data(), (unsigned long)queries[i].length()) != 0 ||
+        (result = mysql_store_result(&_mysql)) == NULL)
+      throw ConnectionError("mysql_query(" + queries[i] + ")", &_mysql);
+
+    MYSQL_ROW row;
+    while ((row = mysql_fetch_row(result)) != NULL) {
+      if (i == 0)
+        columns.push_back(row[0]);
+      else {
+        ShardIndex &index = indexes[row[0]];
+        index.unique = row[1] && std::string(row[1]) == "0";
+        index.columns.push_back(row[2] ? row[2] : ""); // NULL for functional index parts
+      }
+    }
+    mysql_free_result(result);
+  }
 
-  return (size_t)count;
+  return rank_shard_keys(columns, indexes, [](const std::string &column) -> std::string {
+    return base::sqlstring("!", 0) << column;
+  });
 }
 
 std::shared_ptr<std::vector<ColumnInfo> > MySQLCopyDataSource::begin_select_table(
@@ -1467,6 +2030,58 @@ MySQLCopyDataSource::~MySQLCopyDataSource() {
 
 // -------------------------------------------------------------------------------------------------
 
+BatchSizeController::BatchSizeController()
+  : _adaptive(true),
+    _size(100),
+    _step(100),
+    _min_size(10),
+    _max_size(100000),
+    _target_latency(0.25),
+    _throughput(0),
+    _latency(0),
+    _min_latency(0) {
+}
+
+void BatchSizeController::set_fixed_size(int size) {
+  _adaptive = size <= 0;
+  if (!_adaptive)
+    _size = size;
+  reset();
+}
+
+void BatchSizeController::reset() {
+  if (_adaptive)
+    _size = _step;
+  _throughput = 0;
+  _latency = 0;
+  _min_latency = 0;
+}
+
+void BatchSizeController::batch_sent(int rows, double seconds, bool packet_full) {
+  if (rows <= 0)
+    return;
+
+  if (_min_latency == 0 || seconds < _min_latency)
+    _min_latency = seconds;
+
+  double throughput = seconds > 0 ? rows / seconds : 0;
+  if (_adaptive) {
+    if (seconds - _min_latency > _target_latency) {
+      // the server is struggling, back off
+      _size = std::max(_min_size, _size / 2);
+      logDebug2("Batch of %i rows took %.3fs (fastest %.3fs), reducing batch size to %i\n", rows, seconds,
+                _min_latency, _size);
+    } else if (rows >= _size && !packet_full && (_throughput == 0 || throughput >= 0.8 * _throughput)) {
+      _size = std::min(_max_size, _size + _step);
+      logDebug3("Batch of %i rows took %.3fs, increasing batch size to %i\n", rows, seconds, _size);
+    }
+  }
+  _throughput = _throughput == 0 ? throughput : 0.8 * _throughput + 0.2 * throughput;
+  _latency = _latency == 0 ? seconds : 0.8 * _latency + 0.2 * seconds;
+}
+
+// -------------------------------------------------------------------------------------------------
+
 void MySQLCopyDataTarget::init() {
   /*
    As of MySQL 5.1.57, the max_long_data_size system variable controls the maximum size of parameter
@@ -1759,7 +2374,6 @@ MySQLCopyDataTarget::MySQLCopyDataTarget(const std::string &hostname, int port,
     _use_bulk_inserts(true),
     _bulk_insert_buffer(this),
     _bulk_insert_record(this),
-    _bulk_insert_batch(0),
     _source_rdbms_type(source_rdbms_type),
     _connection_timeout(connection_timeout) {
   std::string host = hostname;
@@ -1864,6 +2478,10 @@ void MySQLCopyDataTarget::get_generated_columns(const std::string &schema, const
 
 void MySQLCopyDataTarget::set_target_table(const std::string &schema, const std::string &table,
                                            std::shared_ptr<std::vector<ColumnInfo> > columns) {
+  // chunked and sharded copies set the same table again for every part
+  if (schema != _schema || table != _table)
+    _bulk_insert_batch.reset();
+
   _schema = schema;
   _table = table;
   _columns = columns;
@@ -1930,11 +2548,8 @@ void MySQLCopyDataTarget::set_target_table(const std::string &schema, const std:
   } else
     throw ConnectionError("mysql_stmt_init", &_mysql);
 
-  if (_truncate) {
-    logInfo("Truncating table %s.%s\n", schema.c_str(), table.c_str());
-    if (mysql_query(&_mysql, base::strfmt("TRUNCATE %s.%s", schema.c_str(), table.c_str()).c_str()) != 0)
-      logWarning("Error executing TRUNCATE %s.%s: %s\n", schema.c_str(), table.c_str(), mysql_error(&_mysql));
-  }
+  if (_truncate)
+    truncate_table(schema, table);
 
   // TODO: Bulk inserts should be disabled when a single record can be bigger than the max_packet_size
   _use_bulk_inserts = true;
@@ -1944,6 +2559,12 @@ void MySQLCopyDataTarget::set_target_table(const std::string &schema, const std:
   }
 }
 
+void MySQLCopyDataTarget::truncate_table(const std::string &schema, const std::string &table) {
+  logInfo("Truncating table %s.%s\n", schema.c_str(), table.c_str());
+  if (mysql_query(&_mysql, base::strfmt("TRUNCATE %s.%s", schema.c_str(), table.c_str()).c_str()) != 0)
+    logWarning("Error executing TRUNCATE %s.%s: %s\n", schema.c_str(), table.c_str(), mysql_error(&_mysql));
+}
+
 void MySQLCopyDataTarget::send_long_data(int column, const char *data, size_t length) {
   if (mysql_stmt_send_long_data(_insert_stmt, column, data, (unsigned long)length)) {
     std::string error = base::strfmt("Error sending long data: %s", mysql_stmt_error(_insert_stmt));
@@ -2022,6 +2643,7 @@ int MySQLCopyDataTarget::do_insert(bool final) {
     if (_init_bulk_insert) {
       add_comma = false;
       _init_bulk_insert = false;
+      _bulk_insert_start = std::chrono::steady_clock::now();
 
       _bulk_insert_buffer.append(_bulk_insert_query.c_str(), _bulk_insert_query.length());
 
@@ -2035,6 +2657,7 @@ int MySQLCopyDataTarget::do_insert(bool final) {
 
     // This will be disabled if still have records but they still fit into the buffer
     bool do_insert = true;
+    bool packet_full = false;
 
     // If it is not the last insert (there still pending records)
     // Then continues with the formatting
@@ -2050,9 +2673,13 @@ int MySQLCopyDataTarget::do_insert(bool final) {
           _bulk_insert_record.reset(_max_allowed_packet);
           _bulk_record_count++;
 
-          // Forces the insert when the max number of records has been reached
-          do_insert = _bulk_record_count == _bulk_insert_batch;
-        }
+          // Forces the insert when the max number of records has been reached, or when the rows waited too long
+          do_insert = _bulk_record_count >= _bulk_insert_batch.size() ||
+                      (_bulk_insert_batch.adaptive() &&
+                       std::chrono::duration<double>(std::chrono::steady_clock::now() - _bulk_insert_start).count() >
+                         _bulk_insert_batch.max_batch_delay());
+        } else
+          packet_full = true;
       } else {
         throw std::runtime_error("Found record bigger than max_allowed_packet");
       }
@@ -2061,12 +2688,16 @@ int MySQLCopyDataTarget::do_insert(bool final) {
     if (do_insert) {
       ret_val = _bulk_record_count;
       _init_bulk_insert = true;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
       if (mysql_real_query(&_mysql, _bulk_insert_buffer.buffer, (unsigned long)_bulk_insert_buffer.length) != 0) {
         _bulk_insert_buffer.buffer[_bulk_insert_buffer.length] = 0;
         logInfo("Statement execution failed: %s:\n%s\n", mysql_error(&_mysql), _bulk_insert_buffer.buffer);
 
         throw ConnectionError("Inserting Data", &_mysql);
       }
+      _bulk_insert_batch.batch_sent(_bulk_record_count,
+                                    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(),
+                                    packet_full);
       _bulk_insert_buffer.reset(_max_allowed_packet);
       _bulk_record_count = 0;
     }
@@ -2274,6 +2905,83 @@ RowBuffer &MySQLCopyDataTarget::row_buffer() {
   return *_row_buffer;
 }
 
+void MySQLCopyDataTarget::begin_transaction() {
+  if (mysql_query(&_mysql, "START TRANSACTION") != 0)
+    throw ConnectionError("START TRANSACTION", &_mysql);
+}
+
+void MySQLCopyDataTarget::commit() {
+  if (mysql_commit(&_mysql) != 0)
+    throw ConnectionError("COMMIT", &_mysql);
+}
+
+void MySQLCopyDataTarget::rollback() {
+  if (mysql_rollback(&_mysql) != 0)
+    logWarning("Error rolling back changes to %s.%s: %s\n", _schema.c_str(), _table.c_str(), mysql_error(&_mysql));
+}
+
+void MySQLCopyDataTarget::delete_range(const std::string &key, long long range_start, long long range_end) {
+  std::string q = base::strfmt("DELETE FROM %s.%s WHERE %s BETWEEN %lli AND %lli", _schema.c_str(), _table.c_str(),
+                               key.c_str(), range_start, range_end);
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0)
+    throw ConnectionError("mysql_query(" + q + ")", &_mysql);
+  if (mysql_affected_rows(&_mysql) > 0)
+    logInfo("Deleted %lli rows of %s.%s with %s between %lli and %lli to copy them again\n",
+            (long long)mysql_affected_rows(&_mysql), _schema.c_str(), _table.c_str(), key.c_str(), range_start,
+            range_end);
+}
+
+std::string MySQLCopyDataTarget::range_checksum(const std::string &key, long long range_start, long long range_end) {
+  // CONCAT_WS() skips NULLs, so which columns are NULL is hashed as well
+  std::string columns, nulls;
+  for (std::vector<ColumnInfo>::const_iterator col = _columns->begin(); col != _columns->end(); ++col) {
+    std::string name = base::sqlstring("!", 0) << col->target_name;
+    columns.append(", ").append(name);
+    nulls.append(nulls.empty() ? "" : ", ").append("ISNULL(").append(name).append(")");
+  }
+
+  std::string q = base::strfmt(
+    "SELECT COUNT(*), BIT_XOR(CRC32(CONCAT_WS('#'%s, CONCAT(%s)))) FROM %s.%s WHERE %s BETWEEN %lli AND %lli",
+    columns.c_str(), nulls.c_str(), _schema.c_str(), _table.c_str(), key.c_str(), range_start, range_end);
+  MYSQL_RES *result;
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0 ||
+      (result = mysql_store_result(&_mysql)) == NULL)
+    throw ConnectionError("mysql_query(" + q + ")", &_mysql);
+
+  std::string checksum;
+  MYSQL_ROW row = mysql_fetch_row(result);
+  if (row)
+    checksum = base::strfmt("%s:%s", row[0] ? row[0] : "0", row[1] ? row[1] : "0");
+  mysql_free_result(result);
+
+  return checksum;
+}
+
+void MySQLCopyDataTarget::delete_rows(const std::string &where) {
+  std::string q = base::strfmt("DELETE FROM %s.%s WHERE %s", _schema.c_str(), _table.c_str(), where.c_str());
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0)
+    throw ConnectionError("mysql_query(" + q + ")", &_mysql);
+  if (mysql_affected_rows(&_mysql) > 0)
+    logInfo("Deleted %lli rows of %s.%s with %s to copy them again\n", (long long)mysql_affected_rows(&_mysql),
+            _schema.c_str(), _table.c_str(), where.c_str());
+}
+
+long long MySQLCopyDataTarget::count_rows(const std::string &where) {
+  std::string q = base::strfmt("SELECT COUNT(*) FROM %s.%s WHERE %s", _schema.c_str(), _table.c_str(), where.c_str());
+  MYSQL_RES *result;
+  if (mysql_real_query(&_mysql, q.data(), (unsigned long)q.length()) != 0 ||
+      (result = mysql_store_result(&_mysql)) == NULL)
+    throw ConnectionError("mysql_query(" + q + ")", &_mysql);
+
+  long long count = 0;
+  MYSQL_ROW row = mysql_fetch_row(result);
+  if (row && row[0])
+    count = std::strtoll(row[0], NULL, 10);
+  mysql_free_result(result);
+
+  return count;
+}
+
 long long MySQLCopyDataTarget::get_max_value(const std::string &key) {
   std::string q = base::sqlstring("SELECT max(!) FROM !.!", 0) << key << _schema << _table;
   mysql_query(&_mysql, q.c_str());
@@ -2489,34 +3197,66 @@ void MySQLCopyDataTarget::restore_triggers(std::set<std::string> &schemas) {
   }
 }
 
-TaskQueue::TaskQueue() {
+TaskQueue::TaskQueue() : _cancelled(false), _splittable(false), _splitting(0) {
+}
+
+void TaskQueue::cancel() {
+  std::lock_guard<std::mutex> lock(_task_mutex);
+  _cancelled = true;
+  // Shards stay queued, their tasks finish the table they belong to without copying anything.
+  _tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(), [](const TableParam &task) { return !task.shards; }),
+               _tasks.end());
+  _task_changed.notify_all();
 }
 
 void TaskQueue::add_task(const TableParam &task) {
-  base::MutexLock lock(_task_mutex);
+  std::lock_guard<std::mutex> lock(_task_mutex);
   _tasks.push_back(task);
+  _task_changed.notify_one();
 }
 
-bool TaskQueue::get_task(TableParam &task) {
-  bool ret_val = false;
+void TaskQueue::add_shards(const std::vector<TableParam> &shards) {
+  std::lock_guard<std::mutex> lock(_task_mutex);
+  // also when canceled, as the table is only finished by the tasks of its shards
+  _tasks.insert(_tasks.begin(), shards.begin(), shards.end());
+  _task_changed.notify_all();
+}
 
-  base::MutexLock lock(_task_mutex);
+bool TaskQueue::get_task(TableParam &task) {
+  std::unique_lock<std::mutex> lock(_task_mutex);
+  // a table being copied may still be split in shards
+  _task_changed.wait(lock, [this]() { return !_tasks.empty() || _splitting == 0 || _cancelled; });
 
-  if (_tasks.size() > 0) {
-    ret_val = true;
-    task = _tasks.front();
-    _tasks.erase(_tasks.begin());
-  }
+  if (_tasks.empty())
+    return false;
+  task = _tasks.front();
+  _tasks.erase(_tasks.begin());
+  if (_splittable && !task.shards)
+    _splitting++;
+  return true;
+}
 
-  return ret_val;
+void TaskQueue::task_done(const TableParam &task) {
+  std::lock_guard<std::mutex> lock(_task_mutex);
+  if (_splittable && !task.shards && --_splitting == 0)
+    _task_changed.notify_all();
 }
 
 CopyDataTask::CopyDataTask(const std::string name, CopyDataSource *psource, MySQLCopyDataTarget *ptarget,
-                           TaskQueue *ptasks, bool show_progress)
+                           TaskQueue *ptasks, CopyDataListener *listener, bool show_progress, bool count_rows,
+                           CopyJournal *journal, long long chunk_size, bool verify_chunks, int shard_count,
+                           long long shard_min_rows)
   : _source(psource), _target(ptarget) {
   _name = name;
   _tasks = ptasks;
+  _listener = listener;
   _show_progress = show_progress;
+  _count_rows = count_rows;
+  _journal = journal;
+  _chunk_size = chunk_size;
+  _verify_chunks = verify_chunks;
+  _shard_count = shard_count;
+  _shard_min_rows = shard_min_rows;
 
   _thread = base::create_thread(&CopyDataTask::thread_func, this);
 }
@@ -2528,84 +3268,750 @@ gpointer CopyDataTask::thread_func(gpointer data) {
 
   while (self->_tasks->get_task(tparam)) {
     self->copy_table(tparam);
+    self->_tasks->task_done(tparam);
   }
 
   return NULL;
 }
 
 void CopyDataTask::copy_table(const TableParam &task) {
+  if (task.shards) {
+    copy_shard(task);
+    return;
+  }
+
   std::shared_ptr<std::vector<ColumnInfo> > columns;
 
-  long long i = 0, total = 0;
+  // total_rows stays -1 if rows are not counted, the caller then checks the copied row count itself
+  CopyTableStats stats = {0, -1, 0, 0};
   int inserted_records;
+  bool failed = false;
 
-  time_t start = time(NULL);
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
   try {
-    std::vector<std::string> last_pkeys;
-    if (task.copy_spec.resume)
-      last_pkeys = _target->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table);
-    total =
-      _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns, task.copy_spec, last_pkeys);
-    columns = _source->begin_select_table(task.source_schema, task.source_table, task.source_pk_columns,
-                                          task.select_expression, task.copy_spec, last_pkeys);
+    long long min_key = 0, max_key = 0;
+    bool chunked = _chunk_size > 0 && task.copy_spec.type == CopyAll && task.copy_spec.max_count <= 0 &&
+                   task.source_pk_columns.size() == 1 && task.target_pk_columns.size() == 1;
+    if (chunked && !_source->get_key_range(task.source_schema, task.source_table, task.source_pk_columns[0], min_key,
+                                           max_key)) {
+      logInfo("Table %s.%s can't be split in chunks by its primary key, copying it in one piece\n",
+              task.source_schema.c_str(), task.source_table.c_str());
+      chunked = false;
+    }
+    if (chunked)
+      copy_chunks(task, min_key, max_key, stats, start);
+    else if (_shard_count > 1 && shard_table(task, stats, start))
+      return; // the shard tasks report the end of the table
+    else {
+      std::vector<std::string> last_pkeys;
+      if (task.copy_spec.resume)
+        last_pkeys = _target->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table);
+      if (_count_rows)
+        stats.total_rows = _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns,
+                                               task.copy_spec, last_pkeys);
+      columns = _source->begin_select_table(task.source_schema, task.source_table, task.source_pk_columns,
+                                            task.select_expression, task.copy_spec, last_pkeys);
+
+      _listener->table_begin(task, columns->size(), stats.total_rows);
+
+      _target->set_get_field_lengths_from_target(_source->get_get_field_lengths_from_target());
+
+      _target->set_target_table(task.target_schema, task.target_table, columns);
+
+      _source->set_bulk_inserts(_target->bulk_inserts());
+
+      _target->begin_inserts();
+      while (_source->fetch_row(_target->row_buffer())) {
+        stats.bytes += _target->row_buffer().data_length();
+        inserted_records = _target->do_insert();
+        stats.rows += inserted_records;
+
+        if (_show_progress && inserted_records) {
+          report_progress(task, stats, start);
+        }
 
-    printf("BEGIN:%s.%s:Copying %li columns of %lli rows from table %s.%s\n", task.target_schema.c_str(),
-           task.target_table.c_str(), (long)columns->size(), total, task.source_schema.c_str(),
-           task.source_table.c_str());
-    fflush(stdout);
+        _target->row_buffer().clear();
 
-    _target->set_get_field_lengths_from_target(_source->get_get_field_lengths_from_target());
+        if ((task.copy_spec.type == CopyCount && stats.rows >= task.copy_spec.row_count) ||
+            (task.copy_spec.max_count > 0 && stats.rows >= task.copy_spec.max_count))
+          break;
+        if (_tasks->cancelled())
+          throw std::runtime_error("Copy was canceled");
+      }
 
-    _target->set_target_table(task.target_schema, task.target_table, columns);
+      inserted_records = _target->end_inserts();
+      stats.rows += inserted_records;
 
-    _source->set_bulk_inserts(_target->bulk_inserts());
+      if (_show_progress && inserted_records) {
+        report_progress(task, stats, start);
+      }
+
+      _source->end_select_table();
+    }
+  } catch (std::exception &e) {
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    _listener->table_error(task, stats, e.what());
+    _target->end_inserts(false);
+    _source->end_select_table();
+    failed = true;
+  }
+
+  finish_table(task, stats, start, failed);
+}
+
+void CopyDataTask::finish_table(const TableParam &task, CopyTableStats &stats,
+                                std::chrono::steady_clock::time_point start, bool failed) {
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (stats.total_rows >= 0 && stats.rows != stats.total_rows)
+    _listener->table_error(task, stats, base::strfmt("Failed copying %lli rows", stats.total_rows - stats.rows));
+  else if (failed)
+    _listener->table_error(task, stats, base::strfmt("Failed copying table after %lli rows", stats.rows));
+  else
+    _listener->table_end(task, stats);
+}
+
+void CopyDataTask::report_progress(const TableParam &task, CopyTableStats &stats,
+                                   std::chrono::steady_clock::time_point start) {
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  stats.batch_rows = _target->bulk_insert_batch().size();
+  stats.batch_seconds = _target->bulk_insert_batch().latency();
+  _listener->table_progress(task, stats);
+}
+
+void CopyDataTask::begin_chunk(const TableParam &task, const CopyJournal::Chunk &chunk, const CopyTableStats &stats,
+                               bool &begun) {
+  CopySpec spec = task.copy_spec;
+  spec.type = CopyRange;
+  spec.resume = false;
+  spec.range_key = task.source_pk_columns[0];
+  spec.range_start = chunk.range_start;
+  spec.range_end = chunk.range_end;
+
+  std::shared_ptr<std::vector<ColumnInfo> > columns =
+    _source->begin_select_table(task.source_schema, task.source_table, task.source_pk_columns,
+                                task.select_expression, spec, std::vector<std::string>());
+  if (!begun) {
+    _listener->table_begin(task, columns->size(), stats.total_rows);
+    begun = true;
+  }
+
+  _target->set_get_field_lengths_from_target(_source->get_get_field_lengths_from_target());
+  _target->set_target_table(task.target_schema, task.target_table, columns);
+  // the table is truncated before the first chunk only
+  _target->set_truncate(false);
+
+  _source->set_bulk_inserts(_target->bulk_inserts());
+  _target->begin_inserts();
+}
+
+void CopyDataTask::copy_chunk(const TableParam &task, CopyJournal::Chunk &chunk, CopyTableStats &stats,
+                              std::chrono::steady_clock::time_point start, bool &begun) {
+  begin_chunk(task, chunk, stats, begun);
+
+  unsigned long long checksum = FNV_OFFSET_BASIS;
+  long long rows = 0;
+  int inserted_records;
+
+  _target->begin_transaction();
+  try {
+    // Leftovers of a chunk that was committed but not recorded before the copy was interrupted, or of a chunk
+    // that didn't pass verification.
+    _target->delete_range(task.target_pk_columns[0], chunk.range_start, chunk.range_end);
 
-    _target->begin_inserts();
     while (_source->fetch_row(_target->row_buffer())) {
+      checksum = _target->row_buffer().checksum(checksum);
+      stats.bytes += _target->row_buffer().data_length();
       inserted_records = _target->do_insert();
-      i += inserted_records;
+      rows += inserted_records;
+      stats.rows += inserted_records;
 
-      if (_show_progress && inserted_records)
-        report_progress(task.target_schema, task.target_table, i, total);
+      if (_show_progress && inserted_records) {
+        report_progress(task, stats, start);
+      }
 
       _target->row_buffer().clear();
 
-      if ((task.copy_spec.type == CopyCount && i >= task.copy_spec.row_count) ||
-          (task.copy_spec.max_count > 0 && i >= task.copy_spec.max_count))
-        break;
+      if (_tasks->cancelled())
+        throw std::runtime_error("Copy was canceled");
     }
 
     inserted_records = _target->end_inserts();
-    i += inserted_records;
+    rows += inserted_records;
+    stats.rows += inserted_records;
+
+    chunk.rows = rows;
+    chunk.source_checksum = base::strfmt("%016llx", checksum);
+    chunk.target_checksum = _target->range_checksum(task.target_pk_columns[0], chunk.range_start, chunk.range_end);
+    if (!base::hasPrefix(chunk.target_checksum, base::strfmt("%lli:", rows)))
+      throw std::runtime_error(base::strfmt("Rows with %s between %lli and %lli don't match in the target after copy "
+                                            "(%lli copied, count:checksum is %s)",
+                                            task.target_pk_columns[0].c_str(), chunk.range_start, chunk.range_end,
+                                            rows, chunk.target_checksum.c_str()));
+    _target->commit();
+  } catch (...) {
+    _target->rollback();
+    throw;
+  }
+  _source->end_select_table();
+
+  if (_journal)
+    _journal->add_chunk(task.target_schema + "." + task.target_table, chunk);
+
+  if (_show_progress) {
+    report_progress(task, stats, start);
+  }
+}
+
+bool CopyDataTask::verify_chunk(const TableParam &task, const CopyJournal::Chunk &chunk, const CopyTableStats &stats,
+                                bool &begun) {
+  begin_chunk(task, chunk, stats, begun);
+
+  unsigned long long checksum = FNV_OFFSET_BASIS;
+  while (_source->fetch_row(_target->row_buffer())) {
+    checksum = _target->row_buffer().checksum(checksum);
+    _target->row_buffer().clear();
+
+    if (_tasks->cancelled())
+      throw std::runtime_error("Copy was canceled");
+  }
+  _target->end_inserts(false);
+  _source->end_select_table();
+
+  if (base::strfmt("%016llx", checksum) != chunk.source_checksum) {
+    logInfo("Rows of %s.%s with %s between %lli and %lli changed in the source since they were copied\n",
+            task.source_schema.c_str(), task.source_table.c_str(), task.source_pk_columns[0].c_str(),
+            chunk.range_start, chunk.range_end);
+    return false;
+  }
+  if (_target->range_checksum(task.target_pk_columns[0], chunk.range_start, chunk.range_end) !=
+      chunk.target_checksum) {
+    logInfo("Rows of %s.%s with %s between %lli and %lli changed in the target since they were copied\n",
+            task.target_schema.c_str(), task.target_table.c_str(), task.target_pk_columns[0].c_str(),
+            chunk.range_start, chunk.range_end);
+    return false;
+  }
+  return true;
+}
+
+void CopyDataTask::copy_chunks(const TableParam &task, long long min_key, long long max_key, CopyTableStats &stats,
+                               std::chrono::steady_clock::time_point start) {
+  std::string table = task.target_schema + "." + task.target_table;
+
+  // Chunks recorded in the journal were committed by an earlier run, these are kept and only the others copied.
+  // Their ranges are taken as they are, in case the chunk size changed in between.
+  std::map<long long, CopyJournal::Chunk> done;
+  if (_journal) {
+    std::vector<CopyJournal::Chunk> chunks = _journal->get_chunks(table);
+    for (std::vector<CopyJournal::Chunk>::const_iterator chunk = chunks.begin(); chunk != chunks.end(); ++chunk)
+      done[chunk->range_start] = *chunk;
+  }
+  if (!done.empty())
+    logInfo("Resuming copy of table %s, %li chunks were already copied\n", table.c_str(), (long)done.size());
+
+  if (_count_rows) {
+    CopySpec spec = task.copy_spec;
+    spec.resume = false;
+    stats.total_rows = _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns, spec,
+                                           std::vector<std::string>());
+  }
+
+  bool truncate = _target->truncate();
+  if (!done.empty())
+    _target->set_truncate(false);
+
+  // start with the recorded chunk holding min_key, if any
+  long long key = min_key;
+  std::map<long long, CopyJournal::Chunk>::const_iterator first = done.upper_bound(min_key);
+  if (first != done.begin() && (--first)->second.range_end >= min_key)
+    key = first->first;
+
+  bool begun = false;
+  int recopied = 0;
+  // Set when the last chunk had fewer rows than keys, i.e. the keys have gaps. The next chunk then reaches from
+  // where the last ended to _chunk_size keys past the next existing key, so that a gap of any size takes a single
+  // chunk instead of one query per _chunk_size missing keys.
+  bool sparse = false;
+  try {
+    for (;;) {
+      CopyJournal::Chunk chunk;
+      std::map<long long, CopyJournal::Chunk>::const_iterator found = done.find(key);
+      if (found != done.end()) {
+        chunk = found->second;
+        if (!_verify_chunks || verify_chunk(task, chunk, stats, begun))
+          stats.rows += chunk.rows;
+        else {
+          copy_chunk(task, chunk, stats, start, begun);
+          recopied++;
+        }
+      } else {
+        chunk.range_start = key;
+        long long first_key = key;
+        if (sparse && !_source->get_next_key(task.source_schema, task.source_table, task.source_pk_columns[0],
+                                             key - 1, first_key))
+          first_key = key;
+        if (first_key >= max_key ||
+            (unsigned long long)max_key - (unsigned long long)first_key < (unsigned long long)_chunk_size)
+          chunk.range_end = max_key;
+        else
+          chunk.range_end = first_key + _chunk_size - 1;
+        // stop before the next recorded chunk
+        found = done.upper_bound(key);
+        if (found != done.end() && found->first <= chunk.range_end)
+          chunk.range_end = found->first - 1;
+        copy_chunk(task, chunk, stats, start, begun);
+      }
+
+      if (chunk.range_end >= max_key)
+        break;
+      key = chunk.range_end + 1;
+      sparse = chunk.rows < _chunk_size;
+    }
+  } catch (...) {
+    _target->set_truncate(truncate);
+    throw;
+  }
+  _target->set_truncate(truncate);
+
+  if (!begun) // everything was copied before
+    _listener->table_begin(task, 0, stats.total_rows);
+  if (recopied > 0)
+    logInfo("%i chunks of table %s did not pass verification and were copied again\n", recopied, table.c_str());
+
+  if (_show_progress) {
+    report_progress(task, stats, start);
+  }
+}
+
+bool CopyDataTask::shard_table(const TableParam &task, CopyTableStats &stats,
+                               std::chrono::steady_clock::time_point start) {
+  if (task.copy_spec.type != CopyAll || task.copy_spec.resume || task.copy_spec.max_count > 0)
+    return false;
+
+  std::shared_ptr<TableShards> shards(new TableShards());
+  shards->table = task.target_schema + "." + task.target_table;
+
+  // An interrupted copy goes on with the shards it started with, whatever the planner would pick now.
+  std::string recorded = _journal ? _journal->get_shard_plan(shards->table) : "";
+  std::map<int, long long> done;
+  if (!recorded.empty() && ShardPlan::deserialize(recorded, shards->plan))
+    done = _journal->get_shards(shards->table);
+  else {
+    ShardPlanner planner(_source.get(), _shard_count);
+    planner.set_min_rows(_shard_min_rows);
+    shards->plan = planner.plan(task);
+    if (shards->plan.strategy == ShardPlan::Unsharded)
+      return false;
+    recorded.clear();
+  }
+
+  // Shards are found again in the target by their key, which row locators don't have. Those are not recorded, so
+  // that a resumed copy doesn't take a stale plan for them.
+  shards->checkpoint = _journal && !shards->plan.key_name.empty();
+  if (_journal && recorded.empty())
+    _journal->set_shard_plan(shards->table, shards->checkpoint ? shards->plan.serialize() : "");
+
+  if (done.empty() && _target->truncate())
+    _target->truncate_table(task.target_schema, task.target_table);
+
+  if (_count_rows)
+    stats.total_rows = _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns,
+                                           task.copy_spec, std::vector<std::string>());
+  for (std::map<int, long long>::const_iterator shard = done.begin(); shard != done.end(); ++shard)
+    stats.rows += shard->second;
+
+  std::vector<TableParam> queued;
+  for (size_t shard = 0; shard < shards->plan.shard_count(); ++shard) {
+    if (done.find((int)shard) == done.end()) {
+      TableParam shard_task(task);
+      shard_task.shards = shards;
+      shard_task.shard = shard;
+      queued.push_back(shard_task);
+    }
+  }
+  shards->stats = stats;
+  shards->start = start;
+  shards->pending = queued.size();
+  shards->begun = false;
+  shards->failed = false;
+
+  logInfo("Copying table %s.%s in %li shards (%s)%s\n", task.source_schema.c_str(), task.source_table.c_str(),
+          (long)shards->plan.shard_count(), shards->plan.description().c_str(),
+          done.empty() ? "" : base::strfmt(", %li of them were already copied", (long)done.size()).c_str());
+
+  if (queued.empty()) {
+    _listener->table_begin(task, 0, stats.total_rows);
+    finish_table(task, stats, start, false);
+  } else
+    _tasks->add_shards(queued);
+  return true;
+}
+
+void CopyDataTask::copy_shard(const TableParam &task) {
+  TableShards &shards = *task.shards;
+
+  {
+    base::MutexLock lock(shards.mutex);
+    // no use copying the rest of a table that failed or was canceled
+    if (shards.failed || _tasks->cancelled()) {
+      shards.failed = true;
+      if (--shards.pending == 0)
+        finish_table(task, shards.stats, shards.start, true);
+      return;
+    }
+  }
+
+  CopySpec spec = task.copy_spec;
+  spec.type = CopyWhere;
+  spec.where_expression = shards.plan.condition(task.shard);
+
+  long long rows = 0;
+  long long committed_rows = 0;
+  bool in_transaction = false;
+  bool truncate = _target->truncate();
+  std::string error;
+  try {
+    std::shared_ptr<std::vector<ColumnInfo> > columns =
+      _source->begin_select_table(task.source_schema, task.source_table, task.source_pk_columns,
+                                  task.select_expression, spec, std::vector<std::string>());
+    {
+      base::MutexLock lock(shards.mutex);
+      if (!shards.begun) {
+        _listener->table_begin(task, columns->size(), shards.stats.total_rows);
+        shards.begun = true;
+      }
+    }
+
+    _target->set_get_field_lengths_from_target(_source->get_get_field_lengths_from_target());
+    // the table was truncated before it was split
+    _target->set_truncate(false);
+    _target->set_target_table(task.target_schema, task.target_table, columns);
+    _target->set_truncate(truncate);
+
+    // The same condition selects the shard in the target, with the key column as named there
+    std::string target_where;
+    if (shards.checkpoint) {
+      for (std::vector<ColumnInfo>::const_iterator col = columns->begin(); col != columns->end(); ++col) {
+        if (col->source_name == shards.plan.key_name) {
+          target_where = shards.plan.condition(task.shard, base::sqlstring("!", 0) << col->target_name);
+          break;
+        }
+      }
+      if (target_where.empty())
+        throw std::runtime_error(base::strfmt("Column %s the table was split on is not in the target",
+                                              shards.plan.key_name.c_str()));
+    }
+
+    _source->set_bulk_inserts(_target->bulk_inserts());
+    _target->begin_inserts();
+    if (!target_where.empty()) {
+      _target->begin_transaction();
+      in_transaction = true;
+      // Leftovers of a shard that was committed but not recorded before the copy was interrupted
+      _target->delete_rows(target_where);
+    }
+
+    unsigned long long bytes = 0;
+    int inserted_records;
+    for (bool more = true; more;) {
+      more = _source->fetch_row(_target->row_buffer());
+      if (more) {
+        bytes += _target->row_buffer().data_length();
+        inserted_records = _target->do_insert();
+        _target->row_buffer().clear();
+      } else
+        inserted_records = _target->end_inserts();
+
+      if (inserted_records || !more) {
+        rows += inserted_records;
+        base::MutexLock lock(shards.mutex);
+        shards.stats.rows += inserted_records;
+        shards.stats.bytes += bytes;
+        bytes = 0;
+        if (_show_progress && inserted_records)
+          report_progress(task, shards.stats, shards.start);
+      }
+
+      // The shard is recorded in the journal only once it's complete, so rows committed before a failure are
+      // deleted again when the copy is resumed.
+      if (in_transaction && more && inserted_records && rows - committed_rows >= SHARD_COMMIT_ROWS) {
+        _target->commit();
+        _target->begin_transaction();
+        committed_rows = rows;
+      }
 
-    if (_show_progress && inserted_records) {
-      report_progress(task.target_schema, task.target_table, i, total);
+      if (_tasks->cancelled())
+        throw std::runtime_error("Copy was canceled");
     }
 
+    if (in_transaction) {
+      long long target_rows = _target->count_rows(target_where);
+      if (target_rows != rows)
+        throw std::runtime_error(base::strfmt("Rows of shard %li don't match in the target after copy (%lli copied, "
+                                              "%lli found)",
+                                              (long)task.shard, rows, target_rows));
+      _target->commit();
+      in_transaction = false;
+    }
     _source->end_select_table();
+
+    if (shards.checkpoint)
+      _journal->add_shard(shards.table, (int)task.shard, rows);
   } catch (std::exception &e) {
-    printf("ERROR:%s.%s:%s\n", task.target_schema.c_str(), task.target_table.c_str(), e.what());
-    fflush(stdout);
+    if (in_transaction)
+      _target->rollback();
     _target->end_inserts(false);
     _source->end_select_table();
+    _target->set_truncate(truncate);
+    error = e.what();
+  }
+
+  base::MutexLock lock(shards.mutex);
+  if (!error.empty()) {
+    if (in_transaction) // the rows of the shard since the last commit were rolled back
+      shards.stats.rows -= rows - committed_rows;
+    if (!shards.failed) {
+      shards.failed = true;
+      shards.stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - shards.start).count();
+      _listener->table_error(task, shards.stats, base::strfmt("Shard %li: %s", (long)task.shard, error.c_str()));
+    }
+  }
+  if (--shards.pending == 0)
+    finish_table(task, shards.stats, shards.start, shards.failed);
+}
+
+CopyDataTask::~CopyDataTask() {
+}
+
+CountDataTask::CountDataTask(const std::string name, CopyDataSource *psource, MySQLCopyDataTarget *ptarget,
+                             TaskQueue *ptasks, CopyDataListener *listener)
+  : _source(psource), _target(ptarget) {
+  _name = name;
+  _tasks = ptasks;
+  _listener = listener;
+  _failed = false;
+
+  _thread = base::create_thread(&CountDataTask::thread_func, this);
+}
+
+gpointer CountDataTask::thread_func(gpointer data) {
+  CountDataTask *self = (CountDataTask *)data;
+
+  TableParam tparam;
+
+  while (self->_tasks->get_task(tparam)) {
+    self->count_table(tparam);
+  }
+
+  return NULL;
+}
+
+void CountDataTask::count_table(const TableParam &task) {
+  try {
+    std::vector<std::string> last_pkeys;
+    if (task.copy_spec.resume)
+      last_pkeys = _target->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table);
+    size_t total =
+      _source->count_rows(task.source_schema, task.source_table, task.source_pk_columns, task.copy_spec, last_pkeys);
+
+    _listener->row_count(task, (long long)total, false);
+  } catch (std::exception &e) {
+    logError("%s: error counting rows of %s.%s: %s\n", _name.c_str(), task.source_schema.c_str(),
+             task.source_table.c_str(), e.what());
+    _failed = true;
   }
+}
+
+CountDataTask::~CountDataTask() {
+}
+
+void PrintCopyDataListener::row_count(const TableParam &task, long long count, bool estimated) {
+  printf("%s:%s:%s: %lli\n", estimated ? "ROW_COUNT_ESTIMATE" : "ROW_COUNT", task.source_schema.c_str(),
+         task.source_table.c_str(), count);
+  fflush(stdout);
+}
 
-  time_t end = time(NULL);
-  if (i != total)
-    printf("ERROR:%s.%s:Failed copying %lli rows\n", task.target_schema.c_str(), task.target_table.c_str(), total - i);
+void PrintCopyDataListener::table_begin(const TableParam &task, size_t column_count, long long total_rows) {
+  if (total_rows >= 0)
+    printf("BEGIN:%s.%s:Copying %li columns of %lli rows from table %s.%s\n", task.target_schema.c_str(),
+           task.target_table.c_str(), (long)column_count, total_rows, task.source_schema.c_str(),
+           task.source_table.c_str());
   else
-    printf("END:%s.%s:Finished copying %lli rows in %im%02is\n", task.target_schema.c_str(), task.target_table.c_str(),
-           i, (int)((end - start) / 60), (int)((end - start) % 60));
+    printf("BEGIN:%s.%s:Copying %li columns from table %s.%s\n", task.target_schema.c_str(), task.target_table.c_str(),
+           (long)column_count, task.source_schema.c_str(), task.source_table.c_str());
   fflush(stdout);
 }
 
-void CopyDataTask::report_progress(const std::string &schema, const std::string &table, long long current,
-                                   long long total) {
-  printf("PROGRESS:%s.%s:%lli:%lli\n", schema.c_str(), table.c_str(), current, total);
+void PrintCopyDataListener::table_progress(const TableParam &task, const CopyTableStats &stats) {
+  printf("PROGRESS:%s.%s:%lli:%lli:%llu:%.0f:%i:%.0f\n", task.target_schema.c_str(), task.target_table.c_str(),
+         stats.rows, stats.total_rows, stats.bytes, stats.rows_per_second(), stats.batch_rows,
+         stats.batch_seconds * 1000);
   fflush(stdout);
 }
 
-CopyDataTask::~CopyDataTask() {
+void PrintCopyDataListener::table_end(const TableParam &task, const CopyTableStats &stats) {
+  printf("END:%s.%s:Finished copying %lli rows in %im%02is\n", task.target_schema.c_str(), task.target_table.c_str(),
+         stats.rows, (int)stats.seconds / 60, (int)stats.seconds % 60);
+  fflush(stdout);
+}
+
+void PrintCopyDataListener::table_error(const TableParam &task, const CopyTableStats &stats,
+                                        const std::string &message) {
+  printf("ERROR:%s.%s:%s\n", task.target_schema.c_str(), task.target_table.c_str(), message.c_str());
+  fflush(stdout);
+}
+
+CopyDataEngine::CopyDataEngine(SourceFactory create_source, TargetFactory create_target, CopyDataListener *listener)
+  : _create_source(create_source),
+    _create_target(create_target),
+    _listener(listener),
+    _thread_count(1),
+    _show_progress(false),
+    _count_rows(true),
+    _truncate_target(false),
+    _abort_on_oversized_blobs(false),
+    _bulk_insert_batch_size(0),
+    _chunk_size(0),
+    _verify_chunks(false),
+    _shard_count(1),
+    _shard_min_rows(0) {
+}
+
+bool CopyDataEngine::count_rows(TaskQueue &tables, bool estimate_only) {
+  std::unique_ptr<CopyDataSource> psource(_create_source());
+
+  // Catalog statistics are reported first, so that callers have an idea of the table sizes right away.
+  TaskQueue to_count;
+  TableParam task;
+  bool needs_target = false;
+  while (tables.get_task(task)) {
+    long long estimate = -1;
+    if (task.copy_spec.type == CopyAll && !task.copy_spec.resume)
+      estimate = psource->estimate_rows(task.source_schema, task.source_table);
+    if (estimate >= 0) {
+      if (task.copy_spec.max_count > 0 && task.copy_spec.max_count < estimate)
+        estimate = task.copy_spec.max_count;
+      _listener->row_count(task, estimate, true);
+    }
+    if (estimate < 0 || !estimate_only) {
+      needs_target = needs_target || task.copy_spec.resume; // to find where to resume from
+      to_count.add_task(task);
+    }
+  }
+
+  int count_threads = std::max(1, std::min(_thread_count, (int)to_count.size()));
+  std::vector<CountDataTask *> threads;
+  try {
+    for (int index = 0; index < count_threads && !to_count.empty(); index++) {
+      CopyDataSource *source = index == 0 ? psource.release() : _create_source();
+      MySQLCopyDataTarget *target = NULL;
+      try {
+        if (needs_target)
+          target = _create_target();
+      } catch (...) {
+        delete source;
+        throw;
+      }
+      threads.push_back(new CountDataTask(base::strfmt("Task %d", index + 1), source, target, &to_count, _listener));
+    }
+  } catch (...) {
+    to_count.cancel();
+    for (size_t index = 0; index < threads.size(); index++) {
+      threads[index]->wait();
+      delete threads[index];
+    }
+    throw;
+  }
+
+  bool failed = false;
+  for (size_t index = 0; index < threads.size(); index++) {
+    threads[index]->wait();
+    failed = failed || threads[index]->failed();
+    delete threads[index];
+  }
+  return !failed;
+}
+
+void CopyDataEngine::copy_tables(TaskQueue &tables, const std::set<std::string> &trigger_schemas) {
+  std::set<std::string> schemas(trigger_schemas);
+  std::unique_ptr<MySQLCopyDataTarget> trigger_target;
+  if (!schemas.empty()) {
+    trigger_target.reset(_create_target());
+    trigger_target->backup_triggers(schemas);
+  }
+
+  std::unique_ptr<CopyJournal> journal;
+  if (!_checkpoint_file.empty())
+    journal.reset(new CopyJournal(_checkpoint_file));
+
+  // Tables are split in shards by the task that takes them, the other tasks wait for these. Splitting is no use with
+  // a single task.
+  int shard_count = _thread_count > 1 ? _shard_count : 1;
+  tables.set_splittable(shard_count > 1);
+
+  std::vector<CopyDataTask *> threads;
+  try {
+    for (int index = 0; index < _thread_count; index++) {
+      std::unique_ptr<CopyDataSource> psource(_create_source());
+      std::unique_ptr<MySQLCopyDataTarget> ptarget(_create_target());
+
+      psource->set_max_blob_chunk_size(ptarget->get_max_allowed_packet());
+      psource->set_max_parameter_size((unsigned long)ptarget->get_max_long_data_size());
+      psource->set_abort_on_oversized_blobs(_abort_on_oversized_blobs);
+      ptarget->set_truncate(_truncate_target);
+      ptarget->set_bulk_insert_batch_size((int)_bulk_insert_batch_size);
+
+      threads.push_back(new CopyDataTask(base::strfmt("Task %d", index + 1), psource.release(), ptarget.release(),
+                                         &tables, _listener, _show_progress, _count_rows, journal.get(),
+                                         _chunk_size, _verify_chunks, shard_count, _shard_min_rows));
+    }
+  } catch (...) {
+    // stop the tasks already running, the triggers stay backed up for a later --reenable-triggers-on
+    tables.cancel();
+    for (size_t index = 0; index < threads.size(); index++) {
+      threads[index]->wait();
+      delete threads[index];
+    }
+    throw;
+  }
+
+  for (size_t index = 0; index < threads.size(); index++) {
+    threads[index]->wait();
+    delete threads[index];
+  }
+
+  if (trigger_target)
+    trigger_target->restore_triggers(schemas);
+}
+
+bool parse_mysql_connstring(const std::string &connstring, std::string &user, std::string &password,
+                            std::string &host, int &port, std::string &sock) {
+  // Format is user[:pass]@host:port or user[:pass]@::socket,
+  // like what cmdline utilities use.
+  std::string::size_type p = connstring.rfind('@');
+  if (p == std::string::npos)
+    return false;
+
+  std::string user_part = connstring.substr(0, p);
+  std::string server_part = connstring.substr(p + 1);
+
+  if ((p = user_part.find(':')) != std::string::npos) {
+    user = user_part.substr(0, p);
+    password = user_part.substr(p + 1);
+  } else
+    user = user_part;
+
+  p = server_part.find(':');
+  if (p != std::string::npos) {
+    host = server_part.substr(0, p);
+    server_part = server_part.substr(p + 1);
+    p = server_part.find(':');
+    if (p != std::string::npos)
+      sock = server_part.substr(p + 1);
+    else if (!sscanf(server_part.substr(0, p).c_str(), "%i", &port))
+      return false;
+  } else
+    host = server_part;
+  return true;
 }
 
 void MySQLCopyDataTarget::InsertBuffer::reset(size_t size) {
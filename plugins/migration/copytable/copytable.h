@@ -38,6 +38,10 @@
 #include <stdexcept>
 #include <memory>
 #include <functional>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
 
 #ifdef __APPLE
 #pragma GCC diagnostic ignored "-Wdeprecated-register"
@@ -46,6 +50,8 @@
 #endif
 
 #include "converter.h"
+#include "copy_journal.h"
+#include "shard_planner.h"
 #include "glib.h"
 #include "base/threading.h"
 
@@ -112,9 +118,10 @@ struct ColumnInfo {
 
 class RowBuffer : public std::vector<MYSQL_BIND> {
   int _current_field;
+  unsigned long long _blob_data_length;
   std::function<void(int, const char *, size_t)> _send_blob_data;
 
-  RowBuffer(const RowBuffer &o) : std::vector<MYSQL_BIND>(), _current_field(0) {
+  RowBuffer(const RowBuffer &o) : std::vector<MYSQL_BIND>(), _current_field(0), _blob_data_length(0) {
   }
 
 public:
@@ -139,6 +146,13 @@ public:
 
   bool check_if_blob();
   void send_blob_data(const char *data, size_t length);
+
+  // Size of the data fetched into the buffer since the last clear(), including blob data sent in chunks.
+  unsigned long long data_length() const;
+
+  // Folds the values fetched into the buffer into hash (FNV-1a), for the checksums of chunked copies.
+  // Blob data sent in chunks is not included.
+  unsigned long long checksum(unsigned long long hash) const;
 };
 
 enum CopyType { CopyAll, CopyRange, CopyCount, CopyWhere };
@@ -155,6 +169,8 @@ struct CopySpec {
   bool resume;
 };
 
+struct TableShards;
+
 struct TableParam {
   std::string source_schema;
   std::string source_table;
@@ -164,6 +180,10 @@ struct TableParam {
   std::vector<std::string> source_pk_columns;
   std::vector<std::string> target_pk_columns;
   CopySpec copy_spec;
+
+  // Set for the tasks that copy one shard of a table, see CopyDataTask::shard_table().
+  std::shared_ptr<TableShards> shards;
+  size_t shard = 0;
 };
 
 class CopyDataSource {
@@ -206,6 +226,27 @@ public:
   virtual size_t count_rows(const std::string &schema, const std::string &table,
                             const std::vector<std::string> &pk_columns, const CopySpec &spec,
                             const std::vector<std::string> &last_pkeys) = 0;
+  // Row count of the whole table according to the catalog statistics, which is cheap to get but may be outdated.
+  // Returns -1 if the source has no statistics for the table.
+  virtual long long estimate_rows(const std::string &schema, const std::string &table) {
+    return -1;
+  }
+  // Smallest and largest value of an integer key column, used to split the table into chunks.
+  // Returns false if the source can't tell, if the table is empty or if the key is not an integer.
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value) {
+    return false;
+  }
+  // Smallest value of an integer key column above after, used to skip gaps in the key when copying in chunks.
+  // Returns false if there is none or if the source can't tell.
+  virtual bool get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                            long long after, long long &next_value) {
+    return false;
+  }
+  // Integer columns and row locators the table can be split on by ShardPlanner, in no particular order.
+  virtual std::vector<ShardKey> get_shard_keys(const std::string &schema, const std::string &table) {
+    return std::vector<ShardKey>();
+  }
   virtual std::shared_ptr<std::vector<ColumnInfo> > begin_select_table(
     const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
     const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys) = 0;
@@ -231,6 +272,35 @@ class ODBCCopyDataSource : public CopyDataSource {
 
   void ucs2_to_utf8(char *inbuf, size_t inbuf_len, char *&utf8buf, size_t &utf8buf_len);
 
+  // Reads a column of the current row into the row buffer, converting it to the target type
+  typedef SQLRETURN (ODBCCopyDataSource::*FieldReader)(RowBuffer &rowbuffer, int column);
+
+  // The reader for each column, picked from its source and target types on the first row of a table,
+  // so that the rows don't have to go through the type dispatch again
+  std::vector<FieldReader> _field_readers;
+
+  void compile_field_readers(RowBuffer &rowbuffer);
+
+  SQLRETURN get_blob_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_null_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_bit_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_tiny_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_short_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_int_value(int column, long long &value, SQLLEN &len_or_indicator);
+  SQLRETURN get_int_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_int_as_short_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_int_as_tiny_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_bigint_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_float_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_double_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_date_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_time_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_timestamp_data(RowBuffer &rowbuffer, int column);
+  SQLRETURN get_date_time_string_data(RowBuffer &rowbuffer, int column);
+
+  bool query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                       const std::string &where, long long &min_value, long long &max_value);
+
 public:
   ODBCCopyDataSource(SQLHENV env, const std::string &connstring, const std::string &password, bool force_utf8_input,
                      const std::string &source_rdbms_type);
@@ -245,6 +315,12 @@ public:
   virtual size_t count_rows(const std::string &schema, const std::string &table,
                             const std::vector<std::string> &pk_columns, const CopySpec &spec,
                             const std::vector<std::string> &last_pkeys);
+  virtual long long estimate_rows(const std::string &schema, const std::string &table);
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value);
+  virtual bool get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                            long long after, long long &next_value);
+  virtual std::vector<ShardKey> get_shard_keys(const std::string &schema, const std::string &table);
   virtual std::shared_ptr<std::vector<ColumnInfo> > begin_select_table(
     const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
     const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys);
@@ -257,6 +333,10 @@ class MySQLCopyDataSource : public CopyDataSource {
   MYSQL _mysql;
   MYSQL_STMT *_select_stmt;
   bool _has_long_data;
+  std::map<std::string, std::map<std::string, long long> > _estimated_rows; // schema -> table -> rows
+
+  bool query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                       const std::string &where, long long &min_value, long long &max_value);
 
 public:
   MySQLCopyDataSource(const std::string &hostname, int port, const std::string &username, const std::string &password,
@@ -266,6 +346,12 @@ public:
   virtual size_t count_rows(const std::string &schema, const std::string &table,
                             const std::vector<std::string> &pk_columns, const CopySpec &spec,
                             const std::vector<std::string> &last_pkeys);
+  virtual long long estimate_rows(const std::string &schema, const std::string &table);
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value);
+  virtual bool get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                            long long after, long long &next_value);
+  virtual std::vector<ShardKey> get_shard_keys(const std::string &schema, const std::string &table);
   virtual std::shared_ptr<std::vector<ColumnInfo> > begin_select_table(
     const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
     const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys);
@@ -273,6 +359,47 @@ public:
   virtual bool fetch_row(RowBuffer &rowbuffer);
 };
 
+// Chooses the number of rows sent per multi-row INSERT, from the time the server takes to run them (AIMD).
+// The size grows by a fixed step while batches run within the target latency without losing throughput and is
+// halved when a batch takes longer, but not below a floor. Batches that were sent because the packet was full don't
+// make it grow. The latency of a batch is taken above the fastest batch seen, which is about the round trip time of
+// the connection, so that a slow link alone doesn't shrink the batches (it's where big batches pay off most).
+class BatchSizeController {
+  bool _adaptive;
+  int _size;
+  int _step;
+  int _min_size;
+  int _max_size;
+  double _target_latency; // seconds
+  double _throughput;     // rows per second, moving average
+  double _latency;        // seconds, moving average
+  double _min_latency;    // seconds, fastest batch so far
+
+public:
+  BatchSizeController();
+
+  // 0 makes the size adaptive, starting at 100 rows
+  void set_fixed_size(int size);
+  // Starts over with the initial size, for a table whose rows may cost something else entirely.
+  void reset();
+  bool adaptive() const {
+    return _adaptive;
+  }
+  int size() const {
+    return _size;
+  }
+  double latency() const {
+    return _latency;
+  }
+  // Rows waiting for a batch to fill up are sent anyway after this many seconds, so that a slow source doesn't
+  // keep them from the target.
+  double max_batch_delay() const {
+    return 2 * _target_latency + _min_latency;
+  }
+
+  void batch_sent(int rows, double seconds, bool packet_full);
+};
+
 class MySQLCopyDataTarget {
   struct InsertBuffer {
     MYSQL *_mysql;
@@ -323,7 +450,8 @@ class MySQLCopyDataTarget {
   InsertBuffer _bulk_insert_buffer;
   InsertBuffer _bulk_insert_record;
   int _bulk_record_count;
-  int _bulk_insert_batch;
+  BatchSizeController _bulk_insert_batch;
+  std::chrono::steady_clock::time_point _bulk_insert_start; // when the first row of the pending batch came
   std::string _source_rdbms_type;
   unsigned int _connection_timeout;
 
@@ -359,16 +487,24 @@ public:
   }
 
   void set_truncate(bool flag);
+  bool truncate() const {
+    return _truncate;
+  }
 
   void set_target_table(const std::string &schema, const std::string &table,
                         std::shared_ptr<std::vector<ColumnInfo> > columns);
+  void truncate_table(const std::string &schema, const std::string &table);
   long long get_max_value(const std::string &key);
 
   bool bulk_inserts() {
     return _use_bulk_inserts;
   }
+  // 0 adapts the batch size to the server, see BatchSizeController
   void set_bulk_insert_batch_size(int value) {
-    _bulk_insert_batch = value;
+    _bulk_insert_batch.set_fixed_size(value);
+  }
+  const BatchSizeController &bulk_insert_batch() const {
+    return _bulk_insert_batch;
   }
 
   bool get_get_field_lengths_from_target() {
@@ -382,6 +518,19 @@ public:
   int end_inserts(bool flush = true);
   int do_insert(bool final = false);
 
+  // Used by chunked copies, which commit each chunk of the table in its own transaction.
+  void begin_transaction();
+  void commit();
+  void rollback();
+  // Deletes the rows of the current target table with key between range_start and range_end.
+  void delete_range(const std::string &key, long long range_start, long long range_end);
+  // Row count and checksum of the rows of the current target table with key between range_start and range_end,
+  // computed by the server.
+  std::string range_checksum(const std::string &key, long long range_start, long long range_end);
+  // Same for the rows of a shard, selected by a WHERE expression.
+  void delete_rows(const std::string &where);
+  long long count_rows(const std::string &where);
+
   void restore_triggers(std::set<std::string> &schemas);
   void backup_triggers(std::set<std::string> &schemas);
   void backup_triggers_for_schema(const std::string &schema);
@@ -397,12 +546,31 @@ public:
 class TaskQueue {
 private:
   std::vector<TableParam> _tasks;
-  base::Mutex _task_mutex;
+  std::mutex _task_mutex;
+  std::condition_variable _task_changed; // signalled when tasks are added or a splittable table is done
+  std::atomic<bool> _cancelled;
+  bool _splittable;
+  int _splitting; // whole table tasks taken from a splittable queue and not done yet
 
 public:
   TaskQueue();
   void add_task(const TableParam &task);
+  // With a splittable queue, get_task() doesn't tell the queue is done while a task taken from it may still add
+  // the shards of its table, it waits for them instead.
+  void set_splittable(bool flag) {
+    _splittable = flag;
+  }
+  // Queued before the remaining tables, so that the table is finished before the next ones start.
+  void add_shards(const std::vector<TableParam> &shards);
   bool get_task(TableParam &task);
+  void task_done(const TableParam &task);
+
+  // Drops the pending tables and makes the running tasks stop at the next row. Queued shards are still handed out,
+  // so that their tasks can report the end of the table they belong to.
+  void cancel();
+  bool cancelled() const {
+    return _cancelled;
+  }
 
   size_t size() {
     return _tasks.size();
@@ -412,27 +580,214 @@ public:
   }
 };
 
+// Progress of a table copy.
+struct CopyTableStats {
+  long long rows;           // rows copied so far
+  long long total_rows;     // rows to copy, -1 if they were not counted
+  unsigned long long bytes; // data read from the source so far
+  double seconds;           // time since the copy of the table started
+  int batch_rows;           // rows per INSERT currently used by the target, 0 if not known
+  double batch_seconds;     // average time the target server takes for a batch
+
+  double rows_per_second() const {
+    return seconds > 0 ? rows / seconds : 0;
+  }
+};
+
+// State of a table copied in shards, shared by the tasks copying them. The table begins with its first shard and
+// ends when the last one is done, the progress reported is that of all shards together.
+struct TableShards {
+  ShardPlan plan;
+  base::Mutex mutex;
+  CopyTableStats stats;
+  std::chrono::steady_clock::time_point start;
+  size_t pending;    // shards not done yet
+  bool begun;        // table_begin() was reported
+  bool failed;       // a shard failed, the error was reported
+  std::string table; // target schema.table, as recorded in the journal
+  bool checkpoint;   // whether copied shards are recorded in the journal
+};
+
+// Receives the results of the copy and count tasks, in place of the text output of wbcopytables.
+// Methods are called from the worker threads of the tasks and must be thread safe.
+class CopyDataListener {
+public:
+  virtual ~CopyDataListener() {
+  }
+
+  virtual void row_count(const TableParam &task, long long count, bool estimated) = 0;
+  virtual void table_begin(const TableParam &task, size_t column_count, long long total_rows) = 0;
+  virtual void table_progress(const TableParam &task, const CopyTableStats &stats) = 0;
+  virtual void table_end(const TableParam &task, const CopyTableStats &stats) = 0;
+  // stats tell how far the copy went before the error
+  virtual void table_error(const TableParam &task, const CopyTableStats &stats, const std::string &message) = 0;
+};
+
+// Writes the events to stdout, in the line format read by DataMigrator.py:
+// ROW_COUNT[_ESTIMATE]:<schema>:<table>: <count>
+// BEGIN|END|ERROR:<schema>.<table>:<message>
+// PROGRESS:<schema>.<table>:<rows>:<total rows>:<bytes>:<rows per second>:<rows per batch>:<batch ms>
+class PrintCopyDataListener : public CopyDataListener {
+public:
+  virtual void row_count(const TableParam &task, long long count, bool estimated);
+  virtual void table_begin(const TableParam &task, size_t column_count, long long total_rows);
+  virtual void table_progress(const TableParam &task, const CopyTableStats &stats);
+  virtual void table_end(const TableParam &task, const CopyTableStats &stats);
+  virtual void table_error(const TableParam &task, const CopyTableStats &stats, const std::string &message);
+};
+
 class CopyDataTask {
 private:
   std::string _name;
   std::unique_ptr<CopyDataSource> _source;
   std::unique_ptr<MySQLCopyDataTarget> _target;
   TaskQueue *_tasks;
+  CopyDataListener *_listener;
   bool _show_progress;
+  bool _count_rows;
+  CopyJournal *_journal;
+  long long _chunk_size;
+  bool _verify_chunks;
+  int _shard_count;
+  long long _shard_min_rows;
 
   GThread *_thread;
 
   static gpointer thread_func(gpointer data);
 
   void copy_table(const TableParam &task);
-
-  void report_progress(const std::string &schema, const std::string &table, long long current, long long total);
+  void report_progress(const TableParam &task, CopyTableStats &stats, std::chrono::steady_clock::time_point start);
+  void copy_chunks(const TableParam &task, long long min_key, long long max_key, CopyTableStats &stats,
+                   std::chrono::steady_clock::time_point start);
+  void begin_chunk(const TableParam &task, const CopyJournal::Chunk &chunk, const CopyTableStats &stats, bool &begun);
+  void copy_chunk(const TableParam &task, CopyJournal::Chunk &chunk, CopyTableStats &stats,
+                  std::chrono::steady_clock::time_point start, bool &begun);
+  bool verify_chunk(const TableParam &task, const CopyJournal::Chunk &chunk, const CopyTableStats &stats, bool &begun);
+  void finish_table(const TableParam &task, CopyTableStats &stats, std::chrono::steady_clock::time_point start,
+                    bool failed);
+  bool shard_table(const TableParam &task, CopyTableStats &stats, std::chrono::steady_clock::time_point start);
+  void copy_shard(const TableParam &task);
 
 public:
+  // With chunk_size > 0, tables with a single column integer primary key are copied in chunks of that many key
+  // values, each committed in its own transaction and recorded in journal (if any). Chunks already in the journal
+  // are skipped, or checked and copied again if they don't match with verify_chunks.
+  // With shard_count > 1, the other tables with at least shard_min_rows rows are split in that many shards by
+  // ShardPlanner, which are put back in the queue to be copied by all tasks at once.
   CopyDataTask(const std::string name, CopyDataSource *psource, MySQLCopyDataTarget *ptarget, TaskQueue *ptasks,
-               bool show_progress);
+               CopyDataListener *listener, bool show_progress, bool count_rows = true, CopyJournal *journal = NULL,
+               long long chunk_size = 0, bool verify_chunks = false, int shard_count = 1,
+               long long shard_min_rows = 0);
   ~CopyDataTask();
   void wait() {
     g_thread_join(_thread);
   }
 };
+
+// Counts the rows of the tables in a queue, for the count only mode. Several of these can work on the same queue,
+// each with its own source connection. The target is only needed to resume copies and may be NULL otherwise.
+class CountDataTask {
+private:
+  std::string _name;
+  std::unique_ptr<CopyDataSource> _source;
+  std::unique_ptr<MySQLCopyDataTarget> _target;
+  TaskQueue *_tasks;
+  CopyDataListener *_listener;
+  bool _failed;
+
+  GThread *_thread;
+
+  static gpointer thread_func(gpointer data);
+
+  void count_table(const TableParam &task);
+
+public:
+  CountDataTask(const std::string name, CopyDataSource *psource, MySQLCopyDataTarget *ptarget, TaskQueue *ptasks,
+                CopyDataListener *listener);
+  ~CountDataTask();
+  void wait() {
+    g_thread_join(_thread);
+  }
+  bool failed() const {
+    return _failed;
+  }
+};
+
+// Runs copy or row count tasks in worker threads, each with its own connections created by the given factories.
+// This is the whole data transfer as done by wbcopytables, usable in other processes too. Results go to the listener.
+class CopyDataEngine {
+public:
+  typedef std::function<CopyDataSource *()> SourceFactory;
+  typedef std::function<MySQLCopyDataTarget *()> TargetFactory;
+
+private:
+  SourceFactory _create_source;
+  TargetFactory _create_target;
+  CopyDataListener *_listener;
+  int _thread_count;
+  bool _show_progress;
+  bool _count_rows;
+  bool _truncate_target;
+  bool _abort_on_oversized_blobs;
+  long long _bulk_insert_batch_size;
+  long long _chunk_size;
+  std::string _checkpoint_file;
+  bool _verify_chunks;
+  int _shard_count;
+  long long _shard_min_rows;
+
+public:
+  CopyDataEngine(SourceFactory create_source, TargetFactory create_target, CopyDataListener *listener);
+
+  void set_thread_count(int count) {
+    _thread_count = count < 1 ? 1 : count;
+  }
+  void set_show_progress(bool flag) {
+    _show_progress = flag;
+  }
+  // When not set, the copy doesn't count the rows of a table before copying it and reports -1 as total.
+  void set_count_rows(bool flag) {
+    _count_rows = flag;
+  }
+  void set_truncate_target(bool flag) {
+    _truncate_target = flag;
+  }
+  void set_abort_on_oversized_blobs(bool flag) {
+    _abort_on_oversized_blobs = flag;
+  }
+  // 0 (the default) adapts the number of rows per INSERT to the target server.
+  void set_bulk_insert_batch_size(long long size) {
+    _bulk_insert_batch_size = size;
+  }
+  // Copies tables in chunks of size primary key values, see CopyDataTask. 0 copies tables in one piece.
+  void set_chunk_size(long long size) {
+    _chunk_size = size < 0 ? 0 : size;
+  }
+  // SQLite file where committed chunks are recorded, so that an interrupted copy can be resumed.
+  void set_checkpoint_file(const std::string &path) {
+    _checkpoint_file = path;
+  }
+  // Checks the chunks found in the checkpoint file against source and target and copies the mismatched ones again.
+  void set_verify_chunks(bool flag) {
+    _verify_chunks = flag;
+  }
+  // Splits the tables that are not copied in chunks in this many shards, copied in parallel. See ShardPlanner.
+  void set_shard_count(int count) {
+    _shard_count = count < 1 ? 1 : count;
+  }
+  // Tables with fewer rows than this (according to the source statistics) are not split.
+  void set_shard_min_rows(long long rows) {
+    _shard_min_rows = rows;
+  }
+
+  // Reports the catalog estimates of the row counts first, then the exact counts. With estimate_only, only tables
+  // without estimate are counted. Returns false if some table could not be counted.
+  bool count_rows(TaskQueue &tables, bool estimate_only);
+
+  // Copies all tables of the queue. The triggers of trigger_schemas are disabled while copying.
+  void copy_tables(TaskQueue &tables, const std::set<std::string> &trigger_schemas);
+};
+
+// Parses a MySQL connection string in the format user[:pass]@host:port or user[:pass]@::socket.
+bool parse_mysql_connstring(const std::string &connstring, std::string &user, std::string &password,
+                            std::string &host, int &port, std::string &sock);
@@ -0,0 +1,355 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "copytable.h"
+#include "grtpp_module_cpp.h"
+
+#include "base/log.h"
+#include "base/string_utilities.h"
+
+#include <thread>
+#include <deque>
+
+DEFAULT_LOG_DOMAIN("copytable");
+
+#define DOC_MigrationCopyTablesImpl                                                          \
+  "Table data copy engine of wbcopytables, for use in the Workbench process.\n"              \
+  "\n"                                                                                       \
+  "Copies run in background threads. Their progress is read as a list of events with\n"      \
+  "pollEvents(), instead of parsing the text output of the wbcopytables tool.\n"             \
+  "Only MySQL and ODBC sources are supported, Python DB-API sources need wbcopytables."
+
+// Collects the events of a copy until they are polled. Events are kept as plain structs and only turned into GRT
+// values in the polling thread.
+class EventQueueListener : public CopyDataListener {
+  struct Event {
+    std::string type;
+    std::string table;
+    std::string message;
+    CopyTableStats stats;
+  };
+
+  base::Mutex _mutex;
+  std::deque<Event> _events;
+
+  void push(const std::string &type, const TableParam &task, const std::string &message,
+            const CopyTableStats &stats) {
+    Event event;
+    event.type = type;
+    if (!task.target_table.empty())
+      event.table = task.target_schema + "." + task.target_table;
+    else if (!task.source_table.empty())
+      event.table = task.source_schema + "." + task.source_table;
+    event.message = message;
+    event.stats = stats;
+
+    base::MutexLock lock(_mutex);
+    _events.push_back(event);
+  }
+
+public:
+  grt::BaseListRef take_events() {
+    std::deque<Event> events;
+    {
+      base::MutexLock lock(_mutex);
+      events.swap(_events);
+    }
+
+    grt::BaseListRef list(true);
+    for (std::deque<Event>::const_iterator event = events.begin(); event != events.end(); ++event) {
+      grt::DictRef item(true);
+      item.gset("type", event->type);
+      item.gset("table", event->table);
+      item.gset("message", event->message);
+      item.set("rows", grt::IntegerRef((grt::internal::Integer::storage_type)event->stats.rows));
+      item.set("totalRows", grt::IntegerRef((grt::internal::Integer::storage_type)event->stats.total_rows));
+      item.set("bytes", grt::IntegerRef((grt::internal::Integer::storage_type)event->stats.bytes));
+      item.set("seconds", grt::DoubleRef(event->stats.seconds));
+      item.set("rowsPerSecond", grt::DoubleRef(event->stats.rows_per_second()));
+      item.set("batchRows", grt::IntegerRef(event->stats.batch_rows));
+      item.set("batchSeconds", grt::DoubleRef(event->stats.batch_seconds));
+      list.ginsert(item);
+    }
+    return list;
+  }
+
+  // Last event of a copy, with the error that stopped it, if any.
+  void finished(const std::string &error) {
+    CopyTableStats stats = {0, -1, 0, 0};
+    push("FINISHED", TableParam(), error, stats);
+  }
+
+  virtual void row_count(const TableParam &task, long long count, bool estimated) {
+    CopyTableStats stats = {0, count, 0, 0};
+    push(estimated ? "ROW_COUNT_ESTIMATE" : "ROW_COUNT", task, "", stats);
+  }
+
+  virtual void table_begin(const TableParam &task, size_t column_count, long long total_rows) {
+    std::string message =
+      total_rows >= 0
+        ? base::strfmt("Copying %li columns of %lli rows from table %s.%s", (long)column_count, total_rows,
+                       task.source_schema.c_str(), task.source_table.c_str())
+        : base::strfmt("Copying %li columns from table %s.%s", (long)column_count, task.source_schema.c_str(),
+                       task.source_table.c_str());
+    CopyTableStats stats = {0, total_rows, 0, 0};
+    push("BEGIN", task, message, stats);
+  }
+
+  virtual void table_progress(const TableParam &task, const CopyTableStats &stats) {
+    push("PROGRESS", task, "", stats);
+  }
+
+  virtual void table_end(const TableParam &task, const CopyTableStats &stats) {
+    push("END", task, base::strfmt("Finished copying %lli rows in %im%02is", stats.rows, (int)stats.seconds / 60,
+                                   (int)stats.seconds % 60),
+         stats);
+  }
+
+  virtual void table_error(const TableParam &task, const CopyTableStats &stats, const std::string &message) {
+    push("ERROR", task, message, stats);
+  }
+};
+
+class MigrationCopyTablesImpl : public grt::ModuleImplBase {
+public:
+  MigrationCopyTablesImpl(grt::CPPModuleLoader *loader) : grt::ModuleImplBase(loader), _last_job_id(0) {
+  }
+
+  virtual ~MigrationCopyTablesImpl() {
+    std::map<int, std::shared_ptr<Job> > jobs;
+    {
+      base::MutexLock lock(_mutex);
+      jobs.swap(_jobs);
+    }
+    for (std::map<int, std::shared_ptr<Job> >::iterator job = jobs.begin(); job != jobs.end(); ++job) {
+      job->second->tables.cancel();
+      if (job->second->thread.joinable())
+        job->second->thread.join();
+    }
+  }
+
+  DEFINE_INIT_MODULE_DOC(
+    "1.0", "Oracle", DOC_MigrationCopyTablesImpl, grt::ModuleImplBase,
+    DECLARE_MODULE_FUNCTION_DOC(
+      MigrationCopyTablesImpl::startCopy,
+      "Starts copying the given tables in background threads. Returns a job id for the other functions, which must "
+      "be released with closeJob() once the copy is finished.",
+      "options dictionary with the connection and copy options: sourceType (mysql or odbc), sourceConnection "
+      "(ODBC connection string or user@host:port), sourcePassword, sourceRdbmsType, sourceCharset, sourceIsUTF8, "
+      "sourceUseCleartext, sourceTimeout, targetConnection (user@host:port or user@::socket), targetPassword, "
+      "targetUseCleartext, targetTimeout, threadCount, truncateTarget, disableTriggers, countRows, resume, "
+      "bulkInsertBatchSize, abortOnOversizedBlobs, chunkSize, checkpointFile, verifyChunks, shardCount and "
+      "shardMinRows\n"
+      "tables list of dictionaries with source_schema, source_table, target_schema, target_table, "
+      "source_primary_key, target_primary_key and select_expression, like the --table arguments of wbcopytables"),
+    DECLARE_MODULE_FUNCTION_DOC(
+      MigrationCopyTablesImpl::pollEvents,
+      "Returns the events of a copy since the last call, as a list of dictionaries. Each event has a type "
+      "(ROW_COUNT, BEGIN, PROGRESS, END or ERROR), the target table, a message and the copy statistics rows, "
+      "totalRows, bytes, seconds, rowsPerSecond, batchRows (rows per INSERT) and batchSeconds (time the target "
+      "takes for an INSERT). A FINISHED event is the last one of a copy.",
+      "job_id the job id returned by startCopy()"),
+    DECLARE_MODULE_FUNCTION_DOC(MigrationCopyTablesImpl::cancelCopy,
+                                "Stops a copy. Tables being copied stop at the next row, pending ones are skipped.",
+                                "job_id the job id returned by startCopy()"),
+    DECLARE_MODULE_FUNCTION_DOC(MigrationCopyTablesImpl::closeJob,
+                                "Waits for a copy to finish and releases it.",
+                                "job_id the job id returned by startCopy()"),
+    NULL);
+
+  int startCopy(const grt::DictRef &options, const grt::BaseListRef &tables);
+  grt::BaseListRef pollEvents(int job_id);
+  int cancelCopy(int job_id);
+  int closeJob(int job_id);
+
+private:
+  struct Job {
+    SQLHENV odbc_env;
+    TaskQueue tables;
+    EventQueueListener listener;
+    std::unique_ptr<CopyDataEngine> engine;
+    std::set<std::string> trigger_schemas;
+    std::thread thread;
+
+    Job() : odbc_env(SQL_NULL_HANDLE) {
+    }
+    ~Job() {
+      if (odbc_env != SQL_NULL_HANDLE)
+        SQLFreeHandle(SQL_HANDLE_ENV, odbc_env);
+    }
+  };
+
+  std::shared_ptr<Job> get_job(int job_id);
+
+  base::Mutex _mutex;
+  int _last_job_id;
+  std::map<int, std::shared_ptr<Job> > _jobs;
+};
+
+GRT_MODULE_ENTRY_POINT(MigrationCopyTablesImpl);
+
+//----------------------------------------------------------------------------------------------------------------------
+
+std::shared_ptr<MigrationCopyTablesImpl::Job> MigrationCopyTablesImpl::get_job(int job_id) {
+  base::MutexLock lock(_mutex);
+  std::map<int, std::shared_ptr<Job> >::iterator job = _jobs.find(job_id);
+  if (job == _jobs.end())
+    throw std::invalid_argument("Invalid copy job id");
+  return job->second;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int MigrationCopyTablesImpl::startCopy(const grt::DictRef &options, const grt::BaseListRef &tables) {
+  std::shared_ptr<Job> job(new Job());
+
+  std::string source_type = options.get_string("sourceType", "mysql");
+  std::string source_connstring = options.get_string("sourceConnection");
+  std::string source_password = options.get_string("sourcePassword");
+  std::string source_rdbms_type = options.get_string("sourceRdbmsType", "Mysql");
+  std::string source_charset = options.get_string("sourceCharset");
+  bool source_is_utf8 = options.get_int("sourceIsUTF8") != 0;
+  bool source_use_cleartext = options.get_int("sourceUseCleartext") != 0;
+  unsigned int source_timeout = (unsigned int)options.get_int("sourceTimeout", 60);
+  std::string source_host, source_user, source_socket;
+  int source_port = -1;
+
+  if (source_type == "odbc") {
+    SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &job->odbc_env);
+    SQLSetEnvAttr(job->odbc_env, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0);
+  } else if (source_type != "mysql")
+    throw std::invalid_argument("Unsupported source type " + source_type);
+  else if (!parse_mysql_connstring(source_connstring, source_user, source_password, source_host, source_port,
+                                   source_socket))
+    throw std::invalid_argument("Invalid MySQL connection string for source database: " + source_connstring);
+
+  std::string target_password = options.get_string("targetPassword");
+  bool target_use_cleartext = options.get_int("targetUseCleartext") != 0;
+  unsigned int target_timeout = (unsigned int)options.get_int("targetTimeout", 60);
+  std::string target_host, target_user, target_socket;
+  int target_port = -1;
+  if (!parse_mysql_connstring(options.get_string("targetConnection"), target_user, target_password, target_host,
+                              target_port, target_socket))
+    throw std::invalid_argument("Invalid MySQL connection string for target database: " +
+                                options.get_string("targetConnection"));
+
+  SQLHENV odbc_env = job->odbc_env;
+  CopyDataEngine::SourceFactory create_source = [=]() -> CopyDataSource * {
+    if (odbc_env != SQL_NULL_HANDLE)
+      return new ODBCCopyDataSource(odbc_env, source_connstring, source_password, source_is_utf8, source_rdbms_type);
+    return new MySQLCopyDataSource(source_host, source_port, source_user, source_password, source_socket,
+                                   source_use_cleartext, source_timeout);
+  };
+  CopyDataEngine::TargetFactory create_target = [=]() -> MySQLCopyDataTarget * {
+    return new MySQLCopyDataTarget(target_host, target_port, target_user, target_password, target_socket,
+                                   target_use_cleartext, "MySQLWorkbench", source_charset, source_rdbms_type,
+                                   target_timeout);
+  };
+
+  job->engine.reset(new CopyDataEngine(create_source, create_target, &job->listener));
+  job->engine->set_thread_count((int)options.get_int("threadCount", 1));
+  job->engine->set_show_progress(true);
+  job->engine->set_count_rows(options.get_int("countRows", 1) != 0);
+  job->engine->set_truncate_target(options.get_int("truncateTarget") != 0);
+  job->engine->set_abort_on_oversized_blobs(options.get_int("abortOnOversizedBlobs") != 0);
+  job->engine->set_bulk_insert_batch_size(options.get_int("bulkInsertBatchSize"));
+  job->engine->set_chunk_size(options.get_int("chunkSize"));
+  job->engine->set_checkpoint_file(options.get_string("checkpointFile"));
+  job->engine->set_verify_chunks(options.get_int("verifyChunks") != 0);
+  job->engine->set_shard_count((int)options.get_int("shardCount", 1));
+  job->engine->set_shard_min_rows(options.get_int("shardMinRows", 10000));
+
+  bool resume = options.get_int("resume") != 0;
+  bool disable_triggers = options.get_int("disableTriggers", 1) != 0;
+  for (size_t i = 0; i < tables.count(); ++i) {
+    grt::DictRef table(grt::DictRef::cast_from(tables[i]));
+    TableParam param;
+    param.source_schema = table.get_string("source_schema");
+    param.source_table = table.get_string("source_table");
+    param.target_schema = table.get_string("target_schema");
+    param.target_table = table.get_string("target_table");
+    std::string pk = table.get_string("source_primary_key", "-");
+    if (!pk.empty() && pk != "-")
+      param.source_pk_columns = base::split(pk, ",", -1);
+    pk = table.get_string("target_primary_key", "-");
+    if (!pk.empty() && pk != "-")
+      param.target_pk_columns = base::split(pk, ",", -1);
+    param.select_expression = table.get_string("select_expression", "*");
+    if (param.select_expression.empty())
+      param.select_expression = "*";
+    param.copy_spec.type = CopyAll;
+    param.copy_spec.resume = resume;
+    param.copy_spec.max_count = 0;
+    param.copy_spec.range_start = param.copy_spec.range_end = param.copy_spec.row_count = 0;
+
+    job->tables.add_task(param);
+    if (disable_triggers)
+      job->trigger_schemas.insert(param.target_schema);
+  }
+
+  int job_id;
+  {
+    base::MutexLock lock(_mutex);
+    job_id = ++_last_job_id;
+    _jobs[job_id] = job;
+  }
+
+  Job *pjob = job.get();
+  job->thread = std::thread([pjob]() {
+    std::string error;
+    try {
+      pjob->engine->copy_tables(pjob->tables, pjob->trigger_schemas);
+    } catch (std::exception &e) {
+      logError("Copying table data failed: %s\n", e.what());
+      error = e.what();
+    }
+    pjob->listener.finished(error);
+  });
+
+  return job_id;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+grt::BaseListRef MigrationCopyTablesImpl::pollEvents(int job_id) {
+  return get_job(job_id)->listener.take_events();
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int MigrationCopyTablesImpl::cancelCopy(int job_id) {
+  get_job(job_id)->tables.cancel();
+  return 0;
+}
+
+//----------------------------------------------------------------------------------------------------------------------
+
+int MigrationCopyTablesImpl::closeJob(int job_id) {
+  std::shared_ptr<Job> job(get_job(job_id));
+  if (job->thread.joinable())
+    job->thread.join();
+
+  base::MutexLock lock(_mutex);
+  _jobs.erase(job_id);
+  return 0;
+}
@@ -59,22 +59,6 @@ public:
 
 DEFAULT_LOG_DOMAIN("copytable");
 
-static void count_rows(std::unique_ptr<CopyDataSource> &source,
-                       const std::string &source_schema,
-                       const std::string &source_table,
-                       const std::vector<std::string> &pk_columns,
-                       const CopySpec &spec,
-                       const std::vector<std::string> &last_pkeys) {
-  unsigned long long total = source->count_rows(source_schema, source_table,
-                                                pk_columns, spec, last_pkeys);
-
-  printf("ROW_COUNT:%s:%s: %llu\n", source_schema.c_str(), source_table.c_str(),
-         total);
-  fflush(stdout);
-}
-
-//-----------------------
-
 static bool set_log_level(const std::string &value) {
   std::string level = base::tolower(value);
   bool ret = base::Logger::active_level(level);
@@ -111,39 +95,6 @@ static bool check_arg_with_value(char **argv, int &argi, const char *arg,
   return false;
 }
 
-static bool parse_mysql_connstring(const std::string &connstring,
-                                   std::string &user, std::string &password,
-                                   std::string &host, int &port,
-                                   std::string &sock) {
-  // Format is user[:pass]@host:port or user[:pass]@::socket,
-  // like what cmdline utilities use.
-  std::string::size_type p = connstring.rfind('@');
-  if (p == std::string::npos)
-    return false;
-
-  std::string user_part = connstring.substr(0, p);
-  std::string server_part = connstring.substr(p + 1);
-
-  if ((p = user_part.find(':')) != std::string::npos) {
-    user = user_part.substr(0, p);
-    password = user_part.substr(p + 1);
-  } else
-    user = user_part;
-
-  p = server_part.find(':');
-  if (p != std::string::npos) {
-    host = server_part.substr(0, p);
-    server_part = server_part.substr(p + 1);
-    p = server_part.find(':');
-    if (p != std::string::npos)
-      sock = server_part.substr(p + 1);
-    else if (!sscanf(server_part.substr(0, p).c_str(), "%i", &port))
-      return false;
-  } else
-    host = server_part;
-  return true;
-}
-
 static void show_help() {
   printf("copytable --*-source=<source db> --target=<target db> <options> "
          "<table spec> [<table spec> ...]\n");
@@ -169,6 +120,8 @@ static void show_help() {
   printf("--truncate-target\n");
   printf("--progress\n");
   printf("--count-only\n");
+  printf("--estimate-only\n");
+  printf("--skip-row-count\n");
   printf("--jobs-from-stdin\n");
   printf("--abort-on-oversized-blobs\n");
   printf("--max-count=<max rows count>\n");
@@ -190,6 +143,11 @@ static void show_help() {
   printf("--log-level=<level>\n");
   printf("--thread-count=<count>\n");
   printf("--bulk-insert-batch-size=<size>\n");
+  printf("--chunk-size=<primary key values per chunk>\n");
+  printf("--checkpoint-file=<file_path>\n");
+  printf("--verify-chunks\n");
+  printf("--shard-count=<shards per table>\n");
+  printf("--shard-min-rows=<rows>\n");
   printf("--disable-triggers-on=<schema>\n");
   printf("--reenable-triggers-on=<schema>\n");
   printf("--dont-disable-triggers");
@@ -367,6 +325,8 @@ int main(int argc, char **argv) {
 
   bool passwords_from_stdin = false;
   bool count_only = false;
+  bool estimate_only = false;
+  bool skip_row_count = false;
   bool check_types_only = false;
   bool truncate_target = false;
   bool show_progress = false;
@@ -376,7 +336,12 @@ int main(int argc, char **argv) {
   bool disable_triggers_on_copy = true;
   bool resume = false;
   int thread_count = 1;
-  long long bulk_insert_batch = 100;
+  long long bulk_insert_batch = 0; // adaptive
+  long long chunk_size = 0;
+  std::string checkpoint_file;
+  bool verify_chunks = false;
+  int shard_count = 1;
+  long long shard_min_rows = 10000;
   long long max_count = 0;
 
   std::string table_file;
@@ -459,7 +424,11 @@ int main(int argc, char **argv) {
       // operations has not been indicated first
       if (!disable_triggers && !reenable_triggers)
         count_only = true;
-    } else if (strcmp(argv[i], "--check-types-only") == 0)
+    } else if (strcmp(argv[i], "--estimate-only") == 0)
+      estimate_only = true;
+    else if (strcmp(argv[i], "--skip-row-count") == 0)
+      skip_row_count = true;
+    else if (strcmp(argv[i], "--check-types-only") == 0)
       check_types_only = true;
     else if (strcmp(argv[i], "--passwords-from-stdin") == 0)
       passwords_from_stdin = true;
@@ -492,8 +461,18 @@ int main(int argc, char **argv) {
     } else if (check_arg_with_value(argv, i, "--bulk-insert-batch-size", argval, true)) {
       bulk_insert_batch = base::atoi<int>(argval, 0);
       if (bulk_insert_batch < 1)
-        bulk_insert_batch = 100;
-    } else if (check_arg_with_value(argv, i, "--source-ssh-port", argval, true))
+        bulk_insert_batch = 0;
+    } else if (check_arg_with_value(argv, i, "--chunk-size", argval, true))
+      chunk_size = base::atoi<long long>(argval, 0ll);
+    else if (check_arg_with_value(argv, i, "--checkpoint-file", argval, true))
+      checkpoint_file = argval;
+    else if (strcmp(argv[i], "--verify-chunks") == 0)
+      verify_chunks = true;
+    else if (check_arg_with_value(argv, i, "--shard-count", argval, true))
+      shard_count = base::atoi<int>(argval, 1);
+    else if (check_arg_with_value(argv, i, "--shard-min-rows", argval, true))
+      shard_min_rows = base::atoi<long long>(argval, 0ll);
+    else if (check_arg_with_value(argv, i, "--source-ssh-port", argval, true))
       sourceConfig.remoteSSHport = base::atoi<int>(argval, 0);
     else if (check_arg_with_value(argv, i, "--source-ssh-host", argval, true))
       sourceConfig.remoteSSHhost = argval;
@@ -809,115 +788,53 @@ int main(int argc, char **argv) {
     state = PyEval_SaveThread();
   }
   try {
+    if (source_type == ST_ODBC) {
+      SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &odbc_env);
+      SQLSetEnvAttr(odbc_env, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0);
+    }
+    auto create_source = [&]() -> CopyDataSource * {
+      if (source_type == ST_ODBC)
+        return new ODBCCopyDataSource(odbc_env, source_connstring, source_password, source_is_utf8, source_rdbms_type);
+      else if (source_type == ST_MYSQL)
+        return new MySQLCopyDataSource(source_host, source_port, source_user, source_password, source_socket,
+                                       source_use_cleartext_plugin, source_connection_timeout);
+      return new PythonCopyDataSource(source_connstring, source_password);
+    };
+    auto create_target = [&]() -> MySQLCopyDataTarget * {
+      return new MySQLCopyDataTarget(target_host, target_port, target_user, target_password, target_socket,
+                                     target_use_cleartext_plugin, app_name, source_charset, source_rdbms_type,
+                                     target_connection_timeout);
+    };
+
+    PrintCopyDataListener listener;
+    CopyDataEngine engine(create_source, create_target, &listener);
+    engine.set_thread_count(thread_count);
+
     if (count_only) {
-      std::unique_ptr<CopyDataSource> psource;
-
-      if (source_type == ST_ODBC) {
-        SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &odbc_env);
-        SQLSetEnvAttr(odbc_env, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0);
-
-        psource.reset(new ODBCCopyDataSource(odbc_env, source_connstring,
-                                             source_password, source_is_utf8,
-                                             source_rdbms_type));
-      } else if (source_type == ST_MYSQL)
-        psource.reset(new MySQLCopyDataSource(
-            source_host, source_port, source_user, source_password,
-            source_socket, source_use_cleartext_plugin,
-            source_connection_timeout));
-      else
-        psource.reset(
-            new PythonCopyDataSource(source_connstring, source_password));
-
-      std::unique_ptr<MySQLCopyDataTarget> ptarget;
-      TableParam task;
-      while (tables.get_task(task)) {
-        std::vector<std::string> last_pkeys;
-        if (task.copy_spec.resume) {
-          if (!ptarget.get())
-            ptarget.reset(new MySQLCopyDataTarget(
-                target_host, target_port, target_user, target_password,
-                target_socket, target_use_cleartext_plugin, app_name,
-                source_charset, source_rdbms_type, target_connection_timeout));
-          last_pkeys = ptarget->get_last_pkeys(task.target_pk_columns, task.target_schema, task.target_table);
-        }
-        count_rows(psource, task.source_schema, task.source_table, task.source_pk_columns, task.copy_spec, last_pkeys);
-      }
+      if (!engine.count_rows(tables, estimate_only))
+        throw std::runtime_error("Could not count the rows of all tables");
     } else if (reenable_triggers || disable_triggers) {
-      std::unique_ptr<MySQLCopyDataTarget> ptarget;
-      ptarget.reset(new MySQLCopyDataTarget(
-          target_host, target_port, target_user, target_password, target_socket,
-          target_use_cleartext_plugin, app_name, source_charset,
-          source_rdbms_type, target_connection_timeout));
+      std::unique_ptr<MySQLCopyDataTarget> ptarget(create_target());
 
       if (disable_triggers)
         ptarget->backup_triggers(trigger_schemas);
       else
         ptarget->restore_triggers(trigger_schemas);
-    } else {
-      std::vector<CopyDataTask *> threads;
-
-      std::unique_ptr<MySQLCopyDataTarget> ptarget_conn;
-      MySQLCopyDataTarget *ptarget = NULL;
-      CopyDataSource *psource = NULL;
-
-      if (disable_triggers_on_copy) {
-        ptarget_conn.reset(new MySQLCopyDataTarget(
-            target_host, target_port, target_user, target_password,
-            target_socket, target_use_cleartext_plugin, app_name,
-            source_charset, source_rdbms_type, target_connection_timeout));
-        ptarget_conn->backup_triggers(trigger_schemas);
-      }
-
-      for (int index = 0; index < thread_count; index++) {
-        if (source_type == ST_ODBC) {
-          SQLAllocHandle(SQL_HANDLE_ENV, SQL_NULL_HANDLE, &odbc_env);
-          SQLSetEnvAttr(odbc_env, SQL_ATTR_ODBC_VERSION, (void *)SQL_OV_ODBC3, 0);
-
-          psource = new ODBCCopyDataSource(odbc_env, source_connstring,
-                                           source_password, source_is_utf8,
-                                           source_rdbms_type);
-        } else if (source_type == ST_MYSQL)
-          psource = new MySQLCopyDataSource(
-              source_host, source_port, source_user, source_password,
-              source_socket, source_use_cleartext_plugin,
-              source_connection_timeout);
-        else
-          psource = new PythonCopyDataSource(source_connstring, source_password);
-
-        ptarget = new MySQLCopyDataTarget(
-            target_host, target_port, target_user, target_password,
-            target_socket, target_use_cleartext_plugin, app_name,
-            source_charset, source_rdbms_type, target_connection_timeout);
-
-        psource->set_max_blob_chunk_size(ptarget->get_max_allowed_packet());
-        psource->set_max_parameter_size((unsigned long)ptarget->get_max_long_data_size());
-        psource->set_abort_on_oversized_blobs(abort_on_oversized_blobs);
-        ptarget->set_truncate(truncate_target);
-        if (max_count > 0)
-          bulk_insert_batch = max_count;
-        ptarget->set_bulk_insert_batch_size((int)bulk_insert_batch);
-
-        if (check_types_only) {
-          // XXXX
-          delete psource;
-        } else {
-          threads.push_back(new CopyDataTask(base::strfmt("Task %d", index + 1),
-                                             psource, ptarget, &tables,
-                                             show_progress));
-        }
-      }
-
-      // Waits for all the threads to complete
-      for (size_t index = 0; index < threads.size(); index++)
-        threads[index]->wait();
-
-      // Finally destroys the threads and connections
-      for (size_t index = 0; index < threads.size(); index++)
-        delete threads[index];
-
-      // Finally restores the triggers
-      if (disable_triggers_on_copy)
-        ptarget_conn->restore_triggers(trigger_schemas);
+    } else if (!check_types_only) {
+      if (max_count > 0)
+        bulk_insert_batch = max_count;
+      engine.set_show_progress(show_progress);
+      engine.set_count_rows(!skip_row_count);
+      engine.set_truncate_target(truncate_target);
+      engine.set_abort_on_oversized_blobs(abort_on_oversized_blobs);
+      engine.set_bulk_insert_batch_size(bulk_insert_batch);
+      engine.set_chunk_size(chunk_size);
+      engine.set_checkpoint_file(checkpoint_file);
+      engine.set_verify_chunks(verify_chunks);
+      engine.set_shard_count(shard_count);
+      engine.set_shard_min_rows(shard_min_rows);
+
+      engine.copy_tables(tables, disable_triggers_on_copy ? trigger_schemas : std::set<std::string>());
     }
   } catch (std::exception &e) {
     logError("Exception: %s\n", e.what());
@@ -274,6 +274,151 @@ size_t PythonCopyDataSource::count_rows(const std::string &schema, const std::st
   return count;
 }
 
+bool PythonCopyDataSource::get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                         long long &min_value, long long &max_value) {
+  return query_key_range(schema, table, key, "", min_value, max_value);
+}
+
+bool PythonCopyDataSource::get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                                        long long after, long long &next_value) {
+  long long max_value;
+  std::string where = base::strfmt("%s > %lli", key.c_str(), after);
+  return query_key_range(schema, table, key, where, next_value, max_value);
+}
+
+bool PythonCopyDataSource::query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                                           const std::string &where, long long &min_value, long long &max_value) {
+  _init();
+
+  PyGILState_STATE state = PyGILState_Ensure();
+
+  std::string q;
+  if (!_schema_name.empty() && base::trim(_schema_name, "`\"'") != "def") {
+    q = base::strfmt("USE %s", schema.c_str());
+    PyObject_CallMethod(_cursor, (char *)"execute", (char *)"(s)", q.c_str());
+    if (PyErr_Occurred()) {
+      PyErr_Print();
+      logWarning("The query \"USE %s\" failed\n", schema.c_str());
+    }
+  }
+
+  q = base::strfmt("SELECT min(%s), max(%s) FROM %s", key.c_str(), key.c_str(), table.c_str());
+  if (!where.empty())
+    q += " WHERE " + where;
+  if (PyObject_CallMethod(_cursor, (char *)"execute", (char *)"(s)", q.c_str()) == NULL) {
+    PyErr_Print();
+    PyGILState_Release(state);
+    logWarning("Could not get the range of %s in %s.%s\n", key.c_str(), schema.c_str(), table.c_str());
+    return false;
+  }
+
+  bool found = false;
+  PyObject *row = PyObject_CallMethod(_cursor, (char *)"fetchone", NULL);
+  if (row && PySequence_Check(row) && PySequence_Size(row) == 2) {
+    PyObject *min_element = PySequence_GetItem(row, 0);
+    PyObject *max_element = PySequence_GetItem(row, 1);
+    // the values of a column may have any type in some sources (like SQLite), only integers are taken
+    if ((PyInt_Check(min_element) || PyLong_Check(min_element)) &&
+        (PyInt_Check(max_element) || PyLong_Check(max_element))) {
+      min_value = PyLong_AsLongLong(min_element);
+      max_value = PyLong_AsLongLong(max_element);
+      found = !PyErr_Occurred();
+    }
+    Py_DECREF(min_element);
+    Py_DECREF(max_element);
+  }
+  if (PyErr_Occurred())
+    PyErr_Clear();
+  Py_XDECREF(row);
+
+  PyGILState_Release(state);
+
+  return found;
+}
+
+bool PythonCopyDataSource::fetch_all(const std::string &query, std::vector<std::vector<std::string> > &rows) {
+  PyObject *result = PyObject_CallMethod(_cursor, (char *)"execute", (char *)"(s)", query.c_str());
+  if (result == NULL) {
+    PyErr_Print();
+    return false;
+  }
+  Py_DECREF(result);
+
+  PyObject *all = PyObject_CallMethod(_cursor, (char *)"fetchall", NULL);
+  if (!all || !PySequence_Check(all)) {
+    if (PyErr_Occurred())
+      PyErr_Print();
+    Py_XDECREF(all);
+    return false;
+  }
+  for (Py_ssize_t i = 0; i < PySequence_Size(all); ++i) {
+    PyObject *row = PySequence_GetItem(all, i);
+    std::vector<std::string> values;
+    for (Py_ssize_t j = 0; row && PySequence_Check(row) && j < PySequence_Size(row); ++j) {
+      PyObject *element = PySequence_GetItem(row, j);
+      std::string value;
+      pystring_to_string(element, value, true);
+      values.push_back(value);
+      Py_DECREF(element);
+    }
+    rows.push_back(values);
+    Py_XDECREF(row);
+  }
+  Py_DECREF(all);
+  return true;
+}
+
+std::vector<ShardKey> PythonCopyDataSource::get_shard_keys(const std::string &schema, const std::string &table) {
+  std::vector<ShardKey> keys;
+  // the catalog is specific to each database module, only SQLite is known
+  if (_python_module != "sqlite3")
+    return keys;
+
+  _init();
+
+  PyGILState_STATE state = PyGILState_Ensure();
+
+  // Column types are only hints in SQLite, the affinity rules tell which columns hold integers
+  std::vector<std::vector<std::string> > rows;
+  std::vector<std::string> columns;
+  if (fetch_all(base::strfmt("PRAGMA table_info(%s)", table.c_str()), rows)) {
+    for (std::vector<std::vector<std::string> >::const_iterator row = rows.begin(); row != rows.end(); ++row)
+      if (row->size() > 2 && base::toupper((*row)[2]).find("INT") != std::string::npos)
+        columns.push_back((*row)[1]);
+  }
+
+  std::map<std::string, ShardIndex> indexes;
+  rows.clear();
+  if (fetch_all(base::strfmt("PRAGMA index_list(%s)", table.c_str()), rows)) {
+    for (std::vector<std::vector<std::string> >::const_iterator row = rows.begin(); row != rows.end(); ++row) {
+      if (row->size() < 3)
+        continue;
+      ShardIndex &index = indexes[(*row)[1]];
+      index.unique = (*row)[2] == "1";
+
+      std::vector<std::vector<std::string> > index_columns;
+      fetch_all(base::strfmt("PRAGMA index_info(\"%s\")", base::replaceString((*row)[1], "\"", "\"\"").c_str()),
+                index_columns);
+      // ordered by position in the index
+      for (std::vector<std::vector<std::string> >::const_iterator column = index_columns.begin();
+           column != index_columns.end(); ++column)
+        if (column->size() > 2)
+          index.columns.push_back((*column)[2]);
+    }
+  }
+  if (PyErr_Occurred())
+    PyErr_Clear();
+
+  PyGILState_Release(state);
+
+  keys = rank_shard_keys(columns, indexes, [](const std::string &column) -> std::string {
+    return "\"" + base::replaceString(column, "\"", "\"\"") + "\"";
+  });
+  // every table has one, except those created WITHOUT ROWID (the range of which can't be read, so it's skipped)
+  keys.push_back(ShardKey(ShardKey::RowLocator, "rowid", ""));
+  return keys;
+}
+
 std::shared_ptr<std::vector<ColumnInfo> > PythonCopyDataSource::begin_select_table(
   const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
   const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys) {
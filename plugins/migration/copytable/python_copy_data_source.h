@@ -45,6 +45,10 @@ class PythonCopyDataSource : public CopyDataSource {
 
   void _init();
   bool pystring_to_string(PyObject *strobject, std::string &ret_string, bool convert);
+  // Runs query and gets all rows of the result, as text. Must be called holding the GIL.
+  bool fetch_all(const std::string &query, std::vector<std::vector<std::string> > &rows);
+  bool query_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                       const std::string &where, long long &min_value, long long &max_value);
 
 public:
   PythonCopyDataSource(const std::string &connstring, const std::string &password);
@@ -54,6 +58,11 @@ public:
   virtual size_t count_rows(const std::string &schema, const std::string &table,
                             const std::vector<std::string> &pk_columns, const CopySpec &spec,
                             const std::vector<std::string> &last_pkeys);
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value);
+  virtual bool get_next_key(const std::string &schema, const std::string &table, const std::string &key,
+                            long long after, long long &next_value);
+  virtual std::vector<ShardKey> get_shard_keys(const std::string &schema, const std::string &table);
   virtual std::shared_ptr<std::vector<ColumnInfo> > begin_select_table(
     const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
     const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys);
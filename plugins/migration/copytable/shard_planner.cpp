@@ -0,0 +1,299 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+
+#include <cstdlib>
+
+#include "base/log.h"
+#include "base/string_utilities.h"
+
+#include "copytable.h"
+#include "shard_planner.h"
+
+DEFAULT_LOG_DOMAIN("copytable");
+
+// Buckets counted for each shard when balancing ranges with a histogram. More buckets give shards of more even
+// sizes, at the cost of one count query each.
+static const int HISTOGRAM_BUCKETS_PER_SHARD = 8;
+
+static std::string format_bound(const std::string &bound_format, long long value) {
+  std::string::size_type p = bound_format.find("%lli");
+  if (p == std::string::npos)
+    return std::to_string(value);
+  return bound_format.substr(0, p) + std::to_string(value) + bound_format.substr(p + 4);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShardKey::ShardKey(Kind kind, const std::string &expression, const std::string &column_name)
+  : kind(kind),
+    expression(expression),
+    column_name(column_name),
+    bound_format("%lli"),
+    has_range(false),
+    min_value(0),
+    max_value(0) {
+}
+
+std::vector<ShardKey> rank_shard_keys(const std::vector<std::string> &columns,
+                                      const std::map<std::string, ShardIndex> &indexes,
+                                      std::function<std::string(const std::string &)> quote) {
+  std::vector<ShardKey> keys;
+  for (std::vector<std::string>::const_iterator column = columns.begin(); column != columns.end(); ++column) {
+    ShardKey::Kind kind = ShardKey::PlainColumn;
+    for (std::map<std::string, ShardIndex>::const_iterator index = indexes.begin(); index != indexes.end(); ++index) {
+      if (index->second.columns.empty() || index->second.columns.front() != *column)
+        continue;
+      if (index->second.unique && index->second.columns.size() == 1)
+        kind = ShardKey::UniqueKey;
+      else if (kind == ShardKey::PlainColumn)
+        kind = ShardKey::IndexedKey;
+    }
+    keys.push_back(ShardKey(kind, quote(*column), *column));
+  }
+  return keys;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShardPlan::ShardPlan() : strategy(Unsharded), bound_format("%lli"), modulo(0) {
+}
+
+size_t ShardPlan::shard_count() const {
+  switch (strategy) {
+    case Unsharded:
+      return 1;
+    case HashModulo:
+      return (size_t)modulo;
+    default:
+      return bounds.size() + 1;
+  }
+}
+
+std::string ShardPlan::condition(size_t shard, const std::string &key_expression) const {
+  if (strategy == Unsharded)
+    return "";
+
+  if (strategy == HashModulo) {
+    std::string condition = base::strfmt("ABS(%s %% %i) = %i", key_expression.c_str(), modulo, (int)shard);
+    if (shard == 0)
+      condition = base::strfmt("(%s OR %s IS NULL)", condition.c_str(), key_expression.c_str());
+    return condition;
+  }
+
+  std::string upper;
+  if (shard < bounds.size())
+    upper = key_expression + " < " + format_bound(bound_format, bounds[shard]);
+  if (shard == 0)
+    return "(" + upper + " OR " + key_expression + " IS NULL)";
+
+  std::string lower = key_expression + " >= " + format_bound(bound_format, bounds[shard - 1]);
+  if (upper.empty())
+    return lower;
+  return lower + " AND " + upper;
+}
+
+std::string ShardPlan::description() const {
+  switch (strategy) {
+    case Unsharded:
+      return "unsharded";
+    case UniqueKeyRanges:
+      return base::strfmt("%li ranges of unique key %s", (long)shard_count(), key.c_str());
+    case HistogramRanges:
+      return base::strfmt("%li ranges of %s balanced by histogram", (long)shard_count(), key.c_str());
+    case RowLocatorRanges:
+      return base::strfmt("%li ranges of row locator %s", (long)shard_count(), key.c_str());
+    case HashModulo:
+      return base::strfmt("hash of %s modulo %i", key.c_str(), modulo);
+  }
+  return "";
+}
+
+std::string ShardPlan::serialize() const {
+  std::string text = base::strfmt("%i\t%s\t%s\t%s\t%i\t", (int)strategy, key.c_str(), key_name.c_str(),
+                                  bound_format.c_str(), modulo);
+  for (size_t i = 0; i < bounds.size(); ++i)
+    text.append(i > 0 ? "," : "").append(std::to_string(bounds[i]));
+  return text;
+}
+
+bool ShardPlan::deserialize(const std::string &text, ShardPlan &plan) {
+  std::vector<std::string> fields = base::split(text, "\t");
+  if (fields.size() != 6)
+    return false;
+
+  char *end;
+  long strategy = std::strtol(fields[0].c_str(), &end, 10);
+  if (*end || strategy < Unsharded || strategy > HashModulo)
+    return false;
+  // the format must take the bound and nothing else
+  std::string::size_type p = fields[3].find('%');
+  if (p == std::string::npos || fields[3].compare(p, 4, "%lli") != 0 || fields[3].find('%', p + 1) != std::string::npos)
+    return false;
+
+  ShardPlan result;
+  result.strategy = (Strategy)strategy;
+  result.key = fields[1];
+  result.key_name = fields[2];
+  result.bound_format = fields[3];
+  result.modulo = (int)std::strtol(fields[4].c_str(), &end, 10);
+  if (*end)
+    return false;
+  std::vector<std::string> bounds = base::split(fields[5], ",");
+  for (std::vector<std::string>::const_iterator bound = bounds.begin(); bound != bounds.end(); ++bound) {
+    result.bounds.push_back(std::strtoll(bound->c_str(), &end, 10));
+    if (*end || bound->empty() || (result.bounds.size() > 1 && result.bounds.back() <= result.bounds[result.bounds.size() - 2]))
+      return false;
+  }
+  if (result.key.empty() || (result.strategy == HashModulo ? result.modulo < 2 : result.bounds.empty()))
+    return false;
+
+  plan = result;
+  return true;
+}
+
+//--------------------------------------------------------------------------------------------------
+
+ShardPlanner::ShardPlanner(CopyDataSource *source, int shard_count)
+  : _source(source), _shard_count(shard_count), _min_rows(0) {
+}
+
+ShardPlan ShardPlanner::plan(const TableParam &task) {
+  ShardPlan plan;
+  if (_shard_count < 2)
+    return plan;
+
+  try {
+    long long estimate = _source->estimate_rows(task.source_schema, task.source_table);
+    if (estimate >= 0 && estimate < _min_rows) {
+      logDebug("Table %s.%s has about %lli rows, it's not split in shards\n", task.source_schema.c_str(),
+               task.source_table.c_str(), estimate);
+      return plan;
+    }
+
+    std::vector<ShardKey> keys = _source->get_shard_keys(task.source_schema, task.source_table);
+
+    // Ranges, in order of preference
+    static const ShardKey::Kind range_kinds[] = {ShardKey::UniqueKey, ShardKey::IndexedKey, ShardKey::RowLocator};
+    static const ShardPlan::Strategy range_strategies[] = {ShardPlan::UniqueKeyRanges, ShardPlan::HistogramRanges,
+                                                           ShardPlan::RowLocatorRanges};
+    for (int i = 0; i < 3; ++i) {
+      for (std::vector<ShardKey>::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+        long long min_value, max_value;
+        if (key->kind != range_kinds[i] || !key_range(task, *key, min_value, max_value))
+          continue;
+
+        if (key->kind == ShardKey::IndexedKey)
+          histogram_bounds(task, *key, min_value, max_value, plan.bounds);
+        else
+          equal_width_bounds(min_value, max_value, _shard_count, plan.bounds);
+        if (!plan.bounds.empty()) {
+          plan.strategy = range_strategies[i];
+          plan.key = key->expression;
+          plan.key_name = key->column_name;
+          plan.bound_format = key->bound_format;
+          return plan;
+        }
+      }
+    }
+
+    // Any integer column can be hashed, whatever its values are
+    for (std::vector<ShardKey>::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+      if (key->kind != ShardKey::RowLocator) {
+        plan.strategy = ShardPlan::HashModulo;
+        plan.key = key->expression;
+        plan.key_name = key->column_name;
+        plan.modulo = _shard_count;
+        return plan;
+      }
+    }
+  } catch (std::exception &e) {
+    logWarning("Could not split table %s.%s in shards: %s\n", task.source_schema.c_str(), task.source_table.c_str(),
+               e.what());
+  }
+  return ShardPlan();
+}
+
+bool ShardPlanner::key_range(const TableParam &task, const ShardKey &key, long long &min_value,
+                             long long &max_value) {
+  if (key.has_range) {
+    min_value = key.min_value;
+    max_value = key.max_value;
+  } else if (!_source->get_key_range(task.source_schema, task.source_table, key.expression, min_value, max_value))
+    return false;
+  return max_value > min_value;
+}
+
+void ShardPlanner::equal_width_bounds(long long min_value, long long max_value, int parts,
+                                      std::vector<long long> &bounds) {
+  // unsigned, as the span of a BIGINT may not fit in a signed one
+  unsigned long long span = (unsigned long long)max_value - (unsigned long long)min_value;
+  unsigned long long step = span / parts;
+  if (step == 0)
+    step = 1;
+  for (int i = 1; i < parts && step * i <= span; ++i)
+    bounds.push_back((long long)((unsigned long long)min_value + step * i));
+}
+
+void ShardPlanner::histogram_bounds(const TableParam &task, const ShardKey &key, long long min_value,
+                                    long long max_value, std::vector<long long> &bounds) {
+  // The buckets are shards of equal width themselves, only smaller
+  ShardPlan buckets;
+  buckets.strategy = ShardPlan::HistogramRanges;
+  buckets.key = key.expression;
+  buckets.bound_format = key.bound_format;
+  equal_width_bounds(min_value, max_value, _shard_count * HISTOGRAM_BUCKETS_PER_SHARD, buckets.bounds);
+
+  CopySpec spec;
+  spec.type = CopyWhere;
+  spec.range_start = spec.range_end = 0;
+  spec.row_count = 0;
+  spec.max_count = 0;
+  spec.resume = false;
+
+  std::vector<long long> counts;
+  long long total = 0;
+  for (size_t bucket = 0; bucket < buckets.shard_count(); ++bucket) {
+    spec.where_expression = buckets.condition(bucket);
+    counts.push_back((long long)_source->count_rows(task.source_schema, task.source_table, task.source_pk_columns,
+                                                    spec, std::vector<std::string>()));
+    total += counts.back();
+  }
+  if (total == 0)
+    return;
+
+  // A shard ends at the first bucket boundary where it got its share of the rows. A bucket with a lot of equal
+  // values may take the share of several shards, the plan has fewer shards then.
+  long long rows = 0;
+  int shard = 1;
+  for (size_t bucket = 0; bucket + 1 < counts.size() && shard < _shard_count; ++bucket) {
+    rows += counts[bucket];
+    if (rows * _shard_count >= total * shard) {
+      bounds.push_back(buckets.bounds[bucket]);
+      while (shard < _shard_count && rows * _shard_count >= total * shard)
+        shard++;
+    }
+  }
+  logDebug("Histogram of %s in %s.%s: %lli rows in %li buckets, %li shards\n", key.expression.c_str(),
+           task.source_schema.c_str(), task.source_table.c_str(), total, (long)counts.size(), (long)bounds.size() + 1);
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class CopyDataSource;
+struct TableParam;
+
+// Something the rows of a table can be split on, as reported by CopyDataSource::get_shard_keys().
+struct ShardKey {
+  enum Kind {
+    UniqueKey,   // integer column that is the only column of a unique index
+    IndexedKey,  // integer column that is the first column of an index
+    RowLocator,  // physical address of a row, like the rowid of SQLite or the ctid of PostgreSQL
+    PlainColumn  // other integer column
+  };
+
+  Kind kind;
+  std::string expression;   // as used in the source queries, quoted as needed
+  std::string column_name;  // as in the result set, to find the key in the target table (empty for row locators)
+  std::string bound_format; // how a key value is written in conditions, with %lli in place of the value
+  // Set for keys whose range the source knows without scanning them, like the page count of a table for ctid
+  bool has_range;
+  long long min_value;
+  long long max_value;
+
+  ShardKey(Kind kind, const std::string &expression, const std::string &column_name);
+};
+
+// An index of a source table, as needed to rank its columns as shard keys.
+struct ShardIndex {
+  bool unique;
+  std::vector<std::string> columns; // in index order
+};
+
+// Shard keys for the integer columns of a table, of the best kind the indexes (by name) allow. quote turns a column
+// name into an expression for the source.
+std::vector<ShardKey> rank_shard_keys(const std::vector<std::string> &columns,
+                                      const std::map<std::string, ShardIndex> &indexes,
+                                      std::function<std::string(const std::string &)> quote);
+
+// How a table is split into disjoint shards, which are copied by several copy tasks at once.
+//
+// Range plans split on key values: shard 0 takes the keys below bounds[0] and NULLs, shard i the keys from
+// bounds[i - 1] up to (not including) bounds[i] and the last shard the keys from the last bound on. Hash plans take
+// the rows with ABS(key % modulo) equal to the shard number, NULLs going to shard 0. The comparisons are left to
+// the source, so the shards don't overlap and cover all rows whatever the values of the key are.
+struct ShardPlan {
+  enum Strategy { Unsharded, UniqueKeyRanges, HistogramRanges, RowLocatorRanges, HashModulo };
+
+  Strategy strategy;
+  std::string key;          // source expression the rows are split on
+  std::string key_name;     // result column name of the key, empty if it can't be found in the target
+  std::string bound_format; // see ShardKey
+  std::vector<long long> bounds;
+  int modulo;
+
+  ShardPlan();
+
+  size_t shard_count() const;
+  // WHERE expression for the rows of a shard, with key_expression in place of the key (so that the same shard can
+  // be selected in the target table, where the key may have another name).
+  std::string condition(size_t shard, const std::string &key_expression) const;
+  std::string condition(size_t shard) const {
+    return condition(shard, key);
+  }
+  std::string description() const;
+
+  // Text form, kept in the checkpoint journal so that an interrupted copy goes on with the same shards.
+  std::string serialize() const;
+  static bool deserialize(const std::string &text, ShardPlan &plan);
+};
+
+// Picks how to split a table which can't be copied in primary key chunks, using the first of these that works:
+// - ranges of equal width of a unique integer key;
+// - ranges of an indexed integer column, balanced with a histogram of its values (one count per bucket);
+// - ranges of equal width of the physical row locator of the source, if it has one;
+// - hash modulo of an integer column, which costs a full scan per shard but doesn't depend on the key values.
+class ShardPlanner {
+public:
+  ShardPlanner(CopyDataSource *source, int shard_count);
+
+  // Tables with fewer rows than this according to the source statistics are not split.
+  void set_min_rows(long long rows) {
+    _min_rows = rows;
+  }
+
+  // Returns an Unsharded plan if the table has nothing to split on or is too small to be worth it.
+  ShardPlan plan(const TableParam &task);
+
+private:
+  CopyDataSource *_source;
+  int _shard_count;
+  long long _min_rows;
+
+  bool key_range(const TableParam &task, const ShardKey &key, long long &min_value, long long &max_value);
+  void equal_width_bounds(long long min_value, long long max_value, int parts, std::vector<long long> &bounds);
+  void histogram_bounds(const TableParam &task, const ShardKey &key, long long min_value, long long max_value,
+                        std::vector<long long> &bounds);
+};
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include "converter.h"
+#include "wb_helpers.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define VERBOSE_OUTPUT 0
+
+BEGIN_TEST_DATA_CLASS(copytable_converter_test)
+END_TEST_DATA_CLASS;
+
+TEST_MODULE(copytable_converter_test, "copytable type conversions");
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  MYSQL_TIME value;
+
+  BaseConverter::convert_date("2018-03-07", &value);
+  ensure_equals("date type", value.time_type, MYSQL_TIMESTAMP_DATE);
+  ensure("date", value.year == 2018 && value.month == 3 && value.day == 7 && value.hour == 0);
+
+  BaseConverter::convert_time("13:05:59.25", &value);
+  ensure_equals("time type", value.time_type, MYSQL_TIMESTAMP_TIME);
+  ensure("time", value.hour == 13 && value.minute == 5 && value.second == 59);
+  ensure_equals("time fraction", value.second_part, 250000U);
+
+  BaseConverter::convert_time("13:05:59", &value);
+  ensure_equals("time without fraction", value.second_part, 0U);
+
+  BaseConverter::convert_timestamp("2018-03-07 13:05:59.1234567", &value);
+  ensure_equals("timestamp type", value.time_type, MYSQL_TIMESTAMP_DATETIME);
+  ensure("timestamp", value.year == 2018 && value.month == 3 && value.day == 7 && value.hour == 13 &&
+                        value.minute == 5 && value.second == 59);
+  ensure_equals("timestamp fraction", value.second_part, 123456U);
+
+  BaseConverter::convert_timestamp("2018-03-07", &value);
+  ensure_equals("invalid timestamp", value.time_type, MYSQL_TIMESTAMP_NONE);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  MYSQL_TIME value;
+
+  DATE_STRUCT date = {2018, 3, 7};
+  BaseConverter::convert_date(&date, &value);
+  ensure("date", value.time_type == MYSQL_TIMESTAMP_DATE && value.year == 2018 && value.month == 3 && value.day == 7);
+
+  // TIME columns are read as text, as TIME_STRUCT would drop the fraction
+  BaseConverter::convert_date_time("13:05:59.123456", &value, MYSQL_TYPE_TIME);
+  ensure("time", value.time_type == MYSQL_TIMESTAMP_TIME && value.hour == 13 && value.minute == 5 &&
+                   value.second == 59);
+  ensure_equals("time fraction", value.second_part, 123456U);
+
+  TIMESTAMP_STRUCT timestamp = {2018, 3, 7, 13, 5, 59, 123456789};
+  BaseConverter::convert_timestamp(&timestamp, &value);
+  ensure("timestamp", value.time_type == MYSQL_TIMESTAMP_DATETIME && value.year == 2018 && value.second == 59);
+  ensure_equals("timestamp fraction", value.second_part, 123456U);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+/**
+ * Conversion speed for each pair of source and target types handled by BaseConverter. The readers for BIT, TINYINT,
+ * SMALLINT, BIGINT, FLOAT and DOUBLE columns (and INT to INT) have the driver write into the row buffer directly, so
+ * there's nothing to time here for them. benchmark_wbcopytables.py times them through a real ODBC driver.
+ */
+TEST_FUNCTION(3) {
+  const int count = 1000000;
+
+  typedef std::chrono::steady_clock Clock;
+  auto measure = [&](const char *name, std::function<unsigned long(int)> convert) {
+    unsigned long checksum = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < count; i++)
+      checksum += convert(i);
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    ensure(name, checksum > 0);
+#if VERBOSE_OUTPUT
+    std::cout << name << ": " << count / seconds / 1e6 << " M values/s" << std::endl;
+#else
+    (void)seconds;
+#endif
+  };
+
+  std::vector<std::string> dates, times, timestamps;
+  for (int i = 0; i < 1000; i++) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%04i-%02i-%02i", 1900 + i % 200, 1 + i % 12, 1 + i % 28);
+    dates.push_back(buffer);
+    snprintf(buffer, sizeof(buffer), "%02i:%02i:%02i.%03i", i % 24, i % 60, (i * 7) % 60, i);
+    times.push_back(buffer);
+    timestamps.push_back(dates.back() + " " + times.back());
+  }
+
+  MYSQL_TIME value;
+  measure("string -> DATE", [&](int i) {
+    BaseConverter::convert_date(dates[i % 1000].c_str(), &value);
+    return value.day;
+  });
+  measure("string -> TIME", [&](int i) {
+    BaseConverter::convert_time(times[i % 1000].c_str(), &value);
+    return value.second + value.second_part;
+  });
+  measure("string -> DATETIME", [&](int i) {
+    BaseConverter::convert_timestamp(timestamps[i % 1000].c_str(), &value);
+    return value.day + value.second_part;
+  });
+
+  DATE_STRUCT date = {2018, 3, 7};
+  TIMESTAMP_STRUCT timestamp = {2018, 3, 7, 13, 5, 59, 123456789};
+  measure("DATE_STRUCT -> DATE", [&](int i) {
+    date.day = 1 + i % 28;
+    BaseConverter::convert_date(&date, &value);
+    return value.day;
+  });
+  measure("TIMESTAMP_STRUCT -> DATETIME", [&](int i) {
+    timestamp.fraction = i * 1000;
+    BaseConverter::convert_timestamp(&timestamp, &value);
+    return value.day + value.second_part;
+  });
+
+  short short_value;
+  char tiny_value;
+  measure("SLONG -> SMALLINT", [&](int i) {
+    return BaseConverter::convert_int(i % 65536 - 32768, false, &short_value) ? short_value + 32769 : 0;
+  });
+  measure("ULONG -> SMALLINT UNSIGNED", [&](int i) {
+    return BaseConverter::convert_int(i % 65536, true, &short_value) ? (unsigned short)short_value + 1 : 0;
+  });
+  measure("SLONG -> TINYINT", [&](int i) {
+    return BaseConverter::convert_int(i % 256 - 128, false, &tiny_value) ? (signed char)tiny_value + 129 : 0;
+  });
+  measure("ULONG -> TINYINT UNSIGNED", [&](int i) {
+    return BaseConverter::convert_int(i % 256, true, &tiny_value) ? (unsigned char)tiny_value + 1 : 0;
+  });
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(4) {
+  // Integers narrowed to smaller target columns.
+  short short_value = 0;
+  ensure("smallint", BaseConverter::convert_int(-32768, false, &short_value) && short_value == -32768);
+  ensure("smallint max", BaseConverter::convert_int(32767, false, &short_value) && short_value == 32767);
+  ensure("smallint overflow", !BaseConverter::convert_int(32768, false, &short_value) && short_value == 32767);
+  ensure("smallint underflow", !BaseConverter::convert_int(-32769, false, &short_value));
+  ensure("smallint unsigned", BaseConverter::convert_int(65535, true, &short_value) &&
+                                (unsigned short)short_value == 65535);
+  ensure("smallint unsigned overflow", !BaseConverter::convert_int(65536, true, &short_value));
+  ensure("smallint unsigned negative", !BaseConverter::convert_int(-1, true, &short_value));
+
+  char tiny_value = 0;
+  ensure("tinyint", BaseConverter::convert_int(-128, false, &tiny_value) && (signed char)tiny_value == -128);
+  ensure("tinyint overflow", !BaseConverter::convert_int(128, false, &tiny_value) && (signed char)tiny_value == -128);
+  ensure("tinyint unsigned", BaseConverter::convert_int(255, true, &tiny_value) && (unsigned char)tiny_value == 255);
+  ensure("tinyint unsigned overflow", !BaseConverter::convert_int(256, true, &tiny_value));
+  ensure("tinyint unsigned negative", !BaseConverter::convert_int(-1, true, &tiny_value));
+}
+
+//--------------------------------------------------------------------------------------------------
+
+END_TESTS
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2.0,
+ * as published by the Free Software Foundation.
+ *
+ * This program is also distributed with certain software (including
+ * but not limited to OpenSSL) that is licensed under separate terms, as
+ * designated in a particular file or component or in included license
+ * documentation.  The authors of MySQL hereby grant you an additional
+ * permission to link the program and your derivative works with the
+ * separately licensed software that they have included with MySQL.
+ * This program is distributed in the hope that it will be useful,  but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+ * the GNU General Public License, version 2.0, for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA 
+ */
+
+#include <sqlite/connection.hpp>
+#include <sqlite/execute.hpp>
+#include <sqlite/query.hpp>
+
+#include "base/boost_smart_ptr_helpers.h"
+#include "base/string_utilities.h"
+
+#include "copytable.h"
+#include "shard_planner.h"
+#include "wb_helpers.h"
+
+// Source answering the planner queries from an in-memory SQLite table, which has no primary key.
+class SQLiteShardSource : public CopyDataSource {
+public:
+  sqlite::connection db;
+  std::vector<ShardKey> keys;
+  int count_queries;
+
+  SQLiteShardSource() : db(":memory:"), count_queries(0) {
+  }
+
+  long long query_int(const std::string &q) {
+    sqlite::query query(db, q);
+    if (!query.emit())
+      return 0;
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(query.get_result()));
+    return res->get_int64(0);
+  }
+
+  virtual size_t count_rows(const std::string &schema, const std::string &table,
+                            const std::vector<std::string> &pk_columns, const CopySpec &spec,
+                            const std::vector<std::string> &last_pkeys) {
+    count_queries++;
+    if (spec.type == CopyWhere)
+      return (size_t)query_int("select count(*) from " + table + " where " + spec.where_expression);
+    return (size_t)query_int("select count(*) from " + table);
+  }
+  virtual long long estimate_rows(const std::string &schema, const std::string &table) {
+    return query_int("select count(*) from " + table);
+  }
+  virtual bool get_key_range(const std::string &schema, const std::string &table, const std::string &key,
+                             long long &min_value, long long &max_value) {
+    if (query_int("select count(" + key + ") from " + table) == 0)
+      return false;
+    min_value = query_int("select min(" + key + ") from " + table);
+    max_value = query_int("select max(" + key + ") from " + table);
+    return true;
+  }
+  virtual std::vector<ShardKey> get_shard_keys(const std::string &schema, const std::string &table) {
+    return keys;
+  }
+  virtual std::shared_ptr<std::vector<ColumnInfo> > begin_select_table(
+    const std::string &schema, const std::string &table, const std::vector<std::string> &pk_columns,
+    const std::string &select_expression, const CopySpec &spec, const std::vector<std::string> &last_pkeys) {
+    return std::shared_ptr<std::vector<ColumnInfo> >(new std::vector<ColumnInfo>());
+  }
+  virtual void end_select_table() {
+  }
+  virtual bool fetch_row(RowBuffer &rowbuffer) {
+    return false;
+  }
+};
+
+BEGIN_TEST_DATA_CLASS(copytable_shard_planner_test)
+public:
+SQLiteShardSource source;
+TableParam task;
+
+TEST_DATA_CONSTRUCTOR(copytable_shard_planner_test) {
+  // uniq is unique, grp is indexed and skewed (half of the rows have the same value), val is not indexed and
+  // has NULLs and negative values
+  sqlite::execute(source.db, "create table t (uniq integer unique, grp integer, val integer, txt varchar(20))", true);
+  sqlite::execute(source.db, "create index t_grp on t (grp)", true);
+  for (int i = 0; i < 1000; ++i)
+    sqlite::execute(source.db,
+                    base::strfmt("insert into t values (%i, %i, %s, 'row %i')", i * 7 - 300, i < 500 ? 42 : i,
+                                 i % 10 == 0 ? "NULL" : std::to_string(i % 37 - 18).c_str(), i),
+                    true);
+
+  task.source_schema = "main";
+  task.source_table = "t";
+  task.target_schema = "target";
+  task.target_table = "t";
+  task.select_expression = "*";
+  task.copy_spec.type = CopyAll;
+  task.copy_spec.max_count = 0;
+  task.copy_spec.resume = false;
+}
+
+// Every row must be in exactly one shard.
+void ensure_disjoint(const std::string &what, const ShardPlan &plan) {
+  std::string matches;
+  for (size_t shard = 0; shard < plan.shard_count(); ++shard)
+    matches.append(shard > 0 ? " + " : "").append("coalesce((" + plan.condition(shard) + "), 0)");
+  ensure_equals(what + " rows in one shard", source.query_int("select count(*) from t where " + matches + " = 1"),
+                1000);
+}
+
+long long shard_rows(const ShardPlan &plan, size_t shard) {
+  return source.query_int("select count(*) from t where " + plan.condition(shard));
+}
+END_TEST_DATA_CLASS;
+
+TEST_MODULE(copytable_shard_planner_test, "copytable shard planner");
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(1) {
+  // Unique keys are preferred to everything else and split in ranges of equal width.
+  source.keys.clear();
+  source.keys.push_back(ShardKey(ShardKey::PlainColumn, "val", "val"));
+  source.keys.push_back(ShardKey(ShardKey::RowLocator, "rowid", ""));
+  source.keys.push_back(ShardKey(ShardKey::IndexedKey, "grp", "grp"));
+  source.keys.push_back(ShardKey(ShardKey::UniqueKey, "uniq", "uniq"));
+
+  ShardPlanner planner(&source, 4);
+  ShardPlan plan = planner.plan(task);
+  ensure_equals("strategy", plan.strategy, ShardPlan::UniqueKeyRanges);
+  ensure_equals("key", plan.key, "uniq");
+  ensure_equals("key name", plan.key_name, "uniq");
+  ensure_equals("shard count", plan.shard_count(), 4U);
+  ensure_disjoint("unique key", plan);
+  for (size_t shard = 0; shard < plan.shard_count(); ++shard)
+    ensure_equals("rows of unique key shard", shard_rows(plan, shard), 250);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(2) {
+  // Indexed columns are split with a histogram, so that shards get about the same number of rows.
+  source.keys.clear();
+  source.keys.push_back(ShardKey(ShardKey::PlainColumn, "val", "val"));
+  source.keys.push_back(ShardKey(ShardKey::IndexedKey, "grp", "grp"));
+
+  ShardPlanner planner(&source, 4);
+  source.count_queries = 0;
+  ShardPlan plan = planner.plan(task);
+  ensure_equals("strategy", plan.strategy, ShardPlan::HistogramRanges);
+  ensure_equals("key", plan.key, "grp");
+  ensure_equals("one count per bucket", source.count_queries, 32);
+  ensure_disjoint("histogram", plan);
+
+  // the 500 rows with grp = 42 can't be split, they take the share of two shards
+  ensure_equals("shard count", plan.shard_count(), 3U);
+  ensure("rows of skewed shard", shard_rows(plan, 0) >= 500);
+  for (size_t shard = 1; shard < plan.shard_count(); ++shard) {
+    long long rows = shard_rows(plan, shard);
+    ensure("rows of histogram shard", rows > 200 && rows < 300);
+  }
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(3) {
+  // Row locators come next, then hash of a plain column.
+  source.keys.clear();
+  source.keys.push_back(ShardKey(ShardKey::PlainColumn, "val", "val"));
+  source.keys.push_back(ShardKey(ShardKey::RowLocator, "rowid", ""));
+
+  ShardPlanner planner(&source, 3);
+  ShardPlan plan = planner.plan(task);
+  ensure_equals("strategy", plan.strategy, ShardPlan::RowLocatorRanges);
+  ensure_equals("key", plan.key, "rowid");
+  ensure_equals("no key name", plan.key_name, "");
+  ensure_equals("shard count", plan.shard_count(), 3U);
+  ensure_disjoint("row locator", plan);
+
+  source.keys.pop_back();
+  plan = planner.plan(task);
+  ensure_equals("strategy", plan.strategy, ShardPlan::HashModulo);
+  ensure_equals("key", plan.key, "val");
+  ensure_equals("modulo", plan.modulo, 3);
+  ensure_equals("shard count", plan.shard_count(), 3U);
+  ensure_disjoint("hash", plan);
+  ensure("NULLs in shard 0", shard_rows(plan, 0) >= 100);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(4) {
+  // Keys of a single value can't be split in ranges, small tables and single shards are not split at all.
+  sqlite::execute(source.db, "create table single (k integer, v integer)", true);
+  sqlite::execute(source.db, "insert into single values (5, 1), (5, 2), (5, NULL)", true);
+  source.keys.clear();
+  source.keys.push_back(ShardKey(ShardKey::UniqueKey, "k", "k"));
+  source.keys.push_back(ShardKey(ShardKey::IndexedKey, "v", "v"));
+  TableParam single(task);
+  single.source_table = "single";
+
+  ShardPlanner planner(&source, 4);
+  ShardPlan plan = planner.plan(single);
+  ensure_equals("falls back to the next key", plan.strategy, ShardPlan::HistogramRanges);
+  ensure_equals("key", plan.key, "v");
+
+  planner.set_min_rows(10);
+  ensure_equals("small table", planner.plan(single).strategy, ShardPlan::Unsharded);
+  planner.set_min_rows(0);
+
+  ShardPlanner one(&source, 1);
+  ensure_equals("one shard", one.plan(task).strategy, ShardPlan::Unsharded);
+
+  // ranges of the full BIGINT span don't overflow
+  sqlite::execute(source.db, "create table wide (k integer)", true);
+  sqlite::execute(source.db, "insert into wide values (-9223372036854775807 - 1), (0), (9223372036854775807)", true);
+  single.source_table = "wide";
+  source.keys.clear();
+  source.keys.push_back(ShardKey(ShardKey::UniqueKey, "k", "k"));
+  plan = planner.plan(single);
+  ensure_equals("wide strategy", plan.strategy, ShardPlan::UniqueKeyRanges);
+  ensure_equals("wide shard count", plan.shard_count(), 4U);
+  for (size_t i = 1; i < plan.bounds.size(); ++i)
+    ensure("wide bounds ascending", plan.bounds[i - 1] < plan.bounds[i]);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(5) {
+  ShardPlan plan;
+  plan.strategy = ShardPlan::RowLocatorRanges;
+  plan.key = "ctid";
+  plan.bound_format = "'(%lli,0)'::tid";
+  plan.bounds.push_back(10);
+  plan.bounds.push_back(20);
+  ensure_equals("first shard", plan.condition(0), "(ctid < '(10,0)'::tid OR ctid IS NULL)");
+  ensure_equals("middle shard", plan.condition(1), "ctid >= '(10,0)'::tid AND ctid < '(20,0)'::tid");
+  ensure_equals("last shard", plan.condition(2), "ctid >= '(20,0)'::tid");
+
+  ShardPlan hash;
+  hash.strategy = ShardPlan::HashModulo;
+  hash.key = "`val`";
+  hash.key_name = "val";
+  hash.modulo = 3;
+  ensure_equals("hash shard 0", hash.condition(0), "(ABS(`val` % 3) = 0 OR `val` IS NULL)");
+  ensure_equals("hash shard in target", hash.condition(2, "`v`"), "ABS(`v` % 3) = 2");
+
+  ShardPlan copy;
+  ensure("deserialize range plan", ShardPlan::deserialize(plan.serialize(), copy));
+  ensure_equals("range strategy", copy.strategy, plan.strategy);
+  ensure_equals("range key", copy.key, plan.key);
+  ensure_equals("range format", copy.bound_format, plan.bound_format);
+  ensure("range bounds", copy.bounds == plan.bounds);
+  ensure("deserialize hash plan", ShardPlan::deserialize(hash.serialize(), copy));
+  ensure_equals("hash key name", copy.key_name, "val");
+  ensure_equals("hash modulo", copy.modulo, 3);
+  ensure("hash bounds", copy.bounds.empty());
+
+  // journal contents end up in queries, anything odd is rejected
+  ensure("garbage", !ShardPlan::deserialize("garbage", copy));
+  ensure("bad format", !ShardPlan::deserialize("1\tk\tk\t%s\t0\t10,20", copy));
+  ensure("two values", !ShardPlan::deserialize("1\tk\tk\t%lli%lli\t0\t10,20", copy));
+  ensure("unordered bounds", !ShardPlan::deserialize("1\tk\tk\t%lli\t0\t20,10", copy));
+  ensure("bad bound", !ShardPlan::deserialize("1\tk\tk\t%lli\t0\t10,x", copy));
+  ensure("no bounds", !ShardPlan::deserialize("1\tk\tk\t%lli\t0\t", copy));
+  ensure("unknown strategy", !ShardPlan::deserialize("9\tk\tk\t%lli\t0\t10", copy));
+  ensure("plan unchanged", copy.bounds.empty() && copy.modulo == 3);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+TEST_FUNCTION(6) {
+  // The sources read the integer columns and indexes from their catalogs and rank them all with rank_shard_keys(),
+  // here with the indexes of the test table as SQLite reports them.
+  std::vector<std::string> columns;
+  sqlite::query table_info(source.db, "pragma table_info(t)");
+  if (table_info.emit()) {
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(table_info.get_result()));
+    do {
+      if (base::toupper(res->get_string(2)).find("INT") != std::string::npos)
+        columns.push_back(res->get_string(1));
+    } while (res->next_row());
+  }
+  ensure_equals("integer columns", base::join(columns, ","), "uniq,grp,val");
+
+  std::map<std::string, ShardIndex> indexes;
+  sqlite::query index_list(source.db, "pragma index_list(t)");
+  if (index_list.emit()) {
+    std::shared_ptr<sqlite::result> res(BoostHelper::convertPointer(index_list.get_result()));
+    do {
+      ShardIndex &index = indexes[res->get_string(1)];
+      index.unique = res->get_int(2) != 0;
+      sqlite::query index_info(source.db, "pragma index_info(\"" + res->get_string(1) + "\")");
+      if (index_info.emit()) {
+        std::shared_ptr<sqlite::result> info(BoostHelper::convertPointer(index_info.get_result()));
+        do
+          index.columns.push_back(info->get_string(2));
+        while (info->next_row());
+      }
+    } while (res->next_row());
+  }
+
+  std::function<std::string(const std::string &)> quote = [](const std::string &column) -> std::string {
+    return "\"" + column + "\"";
+  };
+  std::vector<ShardKey> keys = rank_shard_keys(columns, indexes, quote);
+  ensure_equals("key count", keys.size(), 3U);
+  ensure_equals("unique key", keys[0].kind, ShardKey::UniqueKey);
+  ensure_equals("unique key expression", keys[0].expression, "\"uniq\"");
+  ensure_equals("unique key name", keys[0].column_name, "uniq");
+  ensure_equals("indexed key", keys[1].kind, ShardKey::IndexedKey);
+  ensure_equals("plain column", keys[2].kind, ShardKey::PlainColumn);
+
+  // A unique index over several columns only makes its first column an indexed key, the other columns don't count.
+  // Index parts without a column (functional indexes in MySQL, expressions in ODBC) are empty.
+  indexes.clear();
+  indexes["uk"].unique = true;
+  indexes["uk"].columns.push_back("grp");
+  indexes["uk"].columns.push_back("uniq");
+  indexes["expr"].unique = true;
+  indexes["expr"].columns.push_back("");
+  indexes["expr"].columns.push_back("val");
+  keys = rank_shard_keys(columns, indexes, quote);
+  ensure_equals("second column of unique index", keys[0].kind, ShardKey::PlainColumn);
+  ensure_equals("first column of unique index", keys[1].kind, ShardKey::IndexedKey);
+  ensure_equals("column after expression", keys[2].kind, ShardKey::PlainColumn);
+
+  // The best kind wins when a column is in several indexes.
+  indexes["u_grp"].unique = true;
+  indexes["u_grp"].columns.push_back("grp");
+  keys = rank_shard_keys(columns, indexes, quote);
+  ensure_equals("unique and indexed", keys[1].kind, ShardKey::UniqueKey);
+}
+
+//--------------------------------------------------------------------------------------------------
+
+END_TESTS
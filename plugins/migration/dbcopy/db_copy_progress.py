@@ -30,6 +30,7 @@ import mforms
 from workbench.ui import WizardPage
 from migration_source_selection import request_password
 from DataMigrator import DataMigrator
+from DDLScheduler import DDLScheduler
 
 #==================================================================================
 class Task(object):
@@ -438,6 +439,7 @@ class ProgressMainView(WizardPage):
        
         grt.pop_message_handler()
         grt.pop_status_query_handler()
+        self._close_ddl_scheduler()
 
         self._progress.show(False)
         self._progress.stop()
@@ -459,6 +461,7 @@ class ProgressMainView(WizardPage):
         
         grt.pop_message_handler()
         grt.pop_status_query_handler()
+        self._close_ddl_scheduler()
 
         self._progress.show(False)
         self._progress.stop()
@@ -546,7 +549,11 @@ class ProgressMainView(WizardPage):
 
     def create_tasks(self):
         self._tasks = []
+        self._close_ddl_scheduler()
         self.main.plan.state.dataBulkTransferParams["LiveDataCopy"] = 1
+        # tables are created without foreign keys, so that they can be created in parallel and in any order,
+        # the foreign keys are added once the data is copied
+        self.main.plan.state.objectCreationParams["DeferForeignKeys"] = 1
         source_password = self.main.plan.migrationSource.password
         if source_password is None:
             source_password = request_password(self.main.plan.migrationSource.connection)
@@ -562,16 +569,18 @@ class ProgressMainView(WizardPage):
                       self.main.plan.migrationTarget.connection, target_password)
 
         self._transferer.copytable_path = self.main.plan.wbcopytables_path_bin
+        self._target_password = target_password
         for idx, schema_name in enumerate(self.main.plan.migrationSource.selectedSchemataNames):
             self._tasks.extend(
               [
                 (idx+1, ThreadedTask(self, partial(self._rev_eng_schema, schema_name), 'Reverse Engineering')),
                 (idx+1, Task(self, self._migrate_schema, 'Migrating')),
                 (idx+1, Task(self, self._fwd_eng_schema, 'Generating Code')),
-                (idx+1, ThreadedTask(self, self._create_schema, 'Creating target schema')),
                 (idx+1, Task(self, self._prepare_copy, 'Selecting tables to copy')),
+                (idx+1, ThreadedTask(self, self._create_schema, 'Creating target schema')),
                 (idx+1, ThreadedTask(self, self._row_count, 'Counting table rows to copy')),
                 (idx+1, ThreadedTask(self, self._data_copy, 'Copying table data')),
+                (idx+1, ThreadedTask(self, self._finish_schema, 'Creating remaining objects and foreign keys')),
               ]
             )
             
@@ -591,7 +600,30 @@ class ProgressMainView(WizardPage):
 
     def _create_schema(self):
         self.main.plan.migrationTarget.connect()  #TODO: Is this necessary?
-        self.main.plan.createTarget()      
+        self.main.plan.state.creationLog.remove_all()
+        # Only the schema is created here. Tables, triggers, views and routines keep being created in the background
+        # while rows are counted, the data copy waits just for the tables and their triggers.
+        self._ddl_scheduler = DDLScheduler(self, self.main.plan.migrationTarget.connection, self._target_password,
+                                           self.main.plan.migrationTarget.catalog, self.main.plan.state.creationLog,
+                                           self.main.plan.state.objectCreationParams.get("DDLWorkerCount", 4))
+        self._ddl_scheduler.start()
+
+    def _finish_schema(self):
+        if not self._ddl_scheduler:
+            return
+        try:
+            failed = self._ddl_scheduler.wait()
+            failed += self._ddl_scheduler.add_foreign_keys()
+            if failed:
+                self.send_warning("%i objects could not be created in the target server" % failed)
+        finally:
+            self._close_ddl_scheduler()
+
+    def _close_ddl_scheduler(self):
+        scheduler = getattr(self, "_ddl_scheduler", None)
+        self._ddl_scheduler = None
+        if scheduler:
+            scheduler.close()
 
     def _prepare_copy(self):
         # create work list
@@ -643,6 +675,8 @@ class ProgressMainView(WizardPage):
         self.send_info("%i total rows in %i tables need to be copied:" % (total, len(self._working_set)))
 
     def _data_copy(self):
+        if self._ddl_scheduler:
+            self._ddl_scheduler.wait(("table", "trigger"))
         if not self.main.plan.migrationSource.catalog.schemata[0].tables:  # Do not copy data if there are no tables in the source schema
             return
         self.send_progress(0, 'Data copy starting')
@@ -159,6 +159,11 @@ class SetupMainView(WizardPage):
         self._driver_sends_utf8.set_name("Send UTF8 Data")
         self.options_box.add(self._driver_sends_utf8, False, True)
 
+        self._estimate_row_counts = mforms.newCheckBox()
+        self._estimate_row_counts.set_text("Use table statistics for row counts instead of counting all rows (faster for large tables)")
+        self._estimate_row_counts.set_name("Estimate Row Counts")
+        self.options_box.add(self._estimate_row_counts, False, True)
+
 
         ###
 
@@ -222,6 +227,7 @@ All tables are copied by default.""")
         self.main.plan.state.dataBulkTransferParams["DebugTableCopy"] = 1 if self._debug_copy.get_active() else 0
         self.main.plan.state.dataBulkTransferParams["DriverSendsDataAsUTF8"] = 1 if self._driver_sends_utf8.get_active() else 0
         self.main.plan.state.dataBulkTransferParams["TruncateTargetTables"] = 1 if self._truncate_db.get_active() else 0
+        self.main.plan.state.dataBulkTransferParams["EstimateRowCounts"] = 1 if self._estimate_row_counts.get_active() else 0
 
         for key in self.main.plan.state.dataBulkTransferParams.keys():
             if key.endswith(":rangeKey"):
@@ -697,7 +703,7 @@ fi
 
         self.send_info("%i total rows in %i tables need to be copied:" % (total, len(self._working_set)))
         for task in self._working_set.values():
-            self.send_info("- %s.%s: %s" % (task["source_schema"], task["source_table"], task.get("row_count", "error")))
+            self.send_info("- %s.%s: %s%s" % (task["source_schema"], task["source_table"], "~" if task.get("row_count_estimated") else "", task.get("row_count", "error")))
 
 
     def _migrate_data(self):
@@ -735,7 +741,8 @@ fi
                 else:
                     count = 0
                     ok = False
-                if ok and count == row_count:
+                # estimated counts can't be checked, so copytable finishing the table without errors is all we know
+                if ok and (count == row_count or task.get("row_count_estimated")):
                     fully_copied = fully_copied + 1
 
                     target_table = "%s.%s" % (task["target_schema"], task["target_table"])
@@ -0,0 +1,154 @@
+# Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2.0,
+# as published by the Free Software Foundation.
+#
+# This program is also distributed with certain software (including
+# but not limited to OpenSSL) that is licensed under separate terms, as
+# designated in a particular file or component or in included license
+# documentation.  The authors of MySQL hereby grant you an additional
+# permission to link the program and your derivative works with the
+# separately licensed software that they have included with MySQL.
+# This program is distributed in the hope that it will be useful,  but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+# the GNU General Public License, version 2.0, for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+"""
+Benchmark for the bulk insert batch sizing of wbcopytables
+==========================================================
+
+Copies a narrow, a wide, a numeric and a BLOB table from a generated sqlite file to
+every MySQL instance in settings.py, once for each of a few fixed batch sizes and
+once with the adaptive batch size, and prints the time taken by each copy.
+
+Each copy is made twice: reading the file through the sqlite3 Python module and
+through the SQLite ODBC driver (unixODBC or iODBC). The latter goes through the
+ODBC field readers of wbcopytables, for every fixed width column type in the
+numeric table. Set sqlite_odbc_driver in settings.py to the name the driver is
+registered with in odbcinst.ini if it's not SQLite3, or to an empty string to
+skip the ODBC copies.
+
+Uses the same settings.py as test_wbcopytables (see the instructions there). Run it with:
+    python benchmark_wbcopytables.py [<row count>]
+
+"""
+
+import os
+import sys
+import time
+import sqlite3
+import subprocess
+import tempfile
+
+import settings
+
+from test_wbcopytables import scramble_pwd
+
+
+# --bulk-insert-batch-size values to compare, 0 being the adaptive batch size
+batch_sizes = (100, 1000, 0)
+
+# name: (sqlite column definitions, MySQL column definitions, row value generator)
+tables = {
+    'NarrowTable': ('id INTEGER PRIMARY KEY, value INTEGER',
+                    '`id` INT NOT NULL, `value` INT NULL, PRIMARY KEY (`id`)',
+                    lambda i: (i, i * 7)),
+    'WideTable': ('id INTEGER PRIMARY KEY, ' + ', '.join('c%i VARCHAR(32)' % c for c in range(50)),
+                  '`id` INT NOT NULL, ' + ', '.join('`c%i` VARCHAR(32) NULL' % c for c in range(50)) + ', PRIMARY KEY (`id`)',
+                  lambda i: (i,) + tuple('value %i/%i' % (i, c) for c in range(50))),
+    'NumericTable': ('id INTEGER PRIMARY KEY, b BIT, t TINYINT, s SMALLINT, i INTEGER, l BIGINT, f REAL, d DOUBLE',
+                     '`id` INT NOT NULL, `b` BIT(1) NULL, `t` TINYINT NULL, `s` SMALLINT NULL, `i` INT NULL, '
+                     '`l` BIGINT NULL, `f` FLOAT NULL, `d` DOUBLE NULL, PRIMARY KEY (`id`)',
+                     lambda i: (i, i % 2, i % 128, i % 32768, i, i * 1000003, i / 7.0, i / 3.0)),
+    'BlobTable': ('id INTEGER PRIMARY KEY, data BLOB',
+                  '`id` INT NOT NULL, `data` LONGBLOB NULL, PRIMARY KEY (`id`)',
+                  lambda i: (i, buffer(os.urandom(64 * (1 + i % 256))))),
+}
+
+
+def create_source(path, row_count):
+    if os.path.exists(path):
+        os.remove(path)
+    conn = sqlite3.connect(path)
+    for name, (columns, _, values) in tables.items():
+        conn.execute('CREATE TABLE %s (%s)' % (name, columns))
+        sample = values(0)
+        conn.executemany('INSERT INTO %s VALUES (%s)' % (name, ', '.join('?' * len(sample))),
+                         (values(i) for i in xrange(row_count)))
+    conn.commit()
+    conn.close()
+
+
+def mysql(target_info, sql):
+    mysql_call = (settings.mysql_client + ' -u %(user)s -p%(password)s -h %(host)s -P %(port)d' % target_info +
+                  ' -e "%s"' % sql.replace('`', '\\`'))
+    if subprocess.Popen(mysql_call, shell=True).wait() != 0:
+        raise RuntimeError('Error calling the MySQL Client with command: %s' % scramble_pwd(mysql_call))
+
+
+# name: wbcopytables option for the source, taking the path of the sqlite file
+sources = [('python', ''' --pythondbapi-source="sqlite3://'%s'"''')]
+sqlite_odbc_driver = getattr(settings, 'sqlite_odbc_driver', 'SQLite3')
+if sqlite_odbc_driver:
+    sources.append(('odbc', ' --odbc-source="DRIVER=%s;DATABASE=%%s"' % sqlite_odbc_driver))
+
+
+def run(source_path, source_option, target_info, table, batch_size):
+    database = target_info['database']
+    mysql(target_info, 'DROP DATABASE IF EXISTS `%s`; CREATE DATABASE `%s`; CREATE TABLE `%s`.`%s` (%s)'
+                       % (database, database, database, table, tables[table][1]))
+    table_file = tempfile.NamedTemporaryFile(suffix='.txt', delete=False)
+    table_file.write('def\t%s\t%s\t%s\t*\n' % (table, database, table))
+    table_file.close()
+
+    copytables_params = (source_option % source_path +
+                         ' --source-password=""' +
+                         ' --target="%(user)s@%(host)s:%(port)d" --target-password="%(password)s"' % target_info +
+                         ' --table-file="%s"' % table_file.name)
+    if batch_size:
+        copytables_params += ' --bulk-insert-batch-size=%i' % batch_size
+    start = time.time()
+    p = subprocess.Popen(settings.copytables_path + copytables_params, shell=True, stdout=subprocess.PIPE)
+    output = p.communicate()[0]
+    elapsed = time.time() - start
+    os.remove(table_file.name)
+    if p.returncode != 0:
+        raise RuntimeError('wbcopytables failed:\n%s' % output)
+
+    # The last progress line tells the batch size the adaptive copy settled on
+    batch_rows = None
+    for line in output.split('\n'):
+        if line.startswith('PROGRESS:'):
+            fields = line.split(':')
+            if len(fields) > 7:
+                batch_rows = fields[6]
+    mysql(target_info, 'DROP DATABASE `%s`' % database)
+    return elapsed, batch_rows
+
+
+def main(row_count):
+    source_path = os.path.join(tempfile.gettempdir(), 'wbcopytables_benchmark.sqlite')
+    create_source(source_path, row_count)
+    try:
+        for target_name, target_info in settings.mysql_instances:
+            print '%s, %i rows per table' % (target_name, row_count)
+            print '%-12s %-8s %10s %10s %16s' % ('table', 'source', 'batch', 'seconds', 'last batch rows')
+            for table in sorted(tables):
+                for source_name, source_option in sources:
+                    for batch_size in batch_sizes:
+                        elapsed, batch_rows = run(source_path, source_option, target_info, table, batch_size)
+                        print '%-12s %-8s %10s %10.2f %16s' % (table, source_name, batch_size or 'adaptive', elapsed,
+                                                               batch_rows or '-')
+            print
+    finally:
+        os.remove(source_path)
+
+
+if __name__ == '__main__':
+    main(int(sys.argv[1]) if len(sys.argv) > 1 else 100000)
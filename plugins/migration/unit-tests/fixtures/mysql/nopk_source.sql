@@ -0,0 +1,36 @@
+CREATE DATABASE IF NOT EXISTS wbcopytables_source;
+
+DROP TABLE IF EXISTS wbcopytables_source.NoKeyContainer;
+
+CREATE TABLE wbcopytables_source.NoKeyContainer (
+  id INT,
+  grp INT,
+  val BIGINT,
+  txt VARCHAR(20)
+);
+
+INSERT INTO wbcopytables_source.NoKeyContainer (id, grp, val, txt) VALUES
+  (6, 5, -5999982, 'row 6'),
+  (19, 57, 7000057, 'row 19'),
+  (23, 69, 11000069, 'row 23'),
+  (16, 48, 4000048, 'row 16'),
+  (8, 5, -3999976, 'row 8'),
+  (15, 45, NULL, 'row 15'),
+  (24, 72, 12000072, 'row 24'),
+  (22, 66, 10000066, 'row 22'),
+  (7, NULL, -4999979, 'row 7'),
+  (20, 60, NULL, 'row 20'),
+  (14, NULL, 2000042, 'row 14'),
+  (17, 51, 5000051, 'row 17'),
+  (9, 5, -2999973, 'row 9'),
+  (1, 5, -10999997, 'row 1'),
+  (10, 5, NULL, 'row 10'),
+  (12, 5, 36, 'row 12'),
+  (4, 5, -7999988, 'row 4'),
+  (18, 54, 6000054, 'row 18'),
+  (3, 5, -8999991, 'row 3'),
+  (2, 5, -9999994, 'row 2'),
+  (21, NULL, 9000063, 'row 21'),
+  (13, 39, 1000039, 'row 13'),
+  (5, 5, NULL, 'row 5'),
+  (11, 5, -999967, 'row 11');
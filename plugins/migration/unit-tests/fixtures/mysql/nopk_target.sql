@@ -0,0 +1,7 @@
+-- The source table has no primary key, the one of the target only gives the dump a stable row order
+CREATE  TABLE IF NOT EXISTS `NoKeyContainer` (
+  `id` INT NOT NULL ,
+  `grp` INT NULL DEFAULT NULL ,
+  `val` BIGINT NULL DEFAULT NULL ,
+  `txt` VARCHAR(20) NULL DEFAULT NULL ,
+  PRIMARY KEY (`id`) );
@@ -0,0 +1,11 @@
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+/*!40101 SET character_set_client = utf8 */;
+CREATE TABLE `UniqueKeyContainer` (
+  `id` int(11) NOT NULL,
+  `code` smallint(6) DEFAULT NULL,
+  `name` varchar(20) DEFAULT NULL,
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `code` (`code`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+/*!40101 SET character_set_client = @saved_cs_client */;
+INSERT INTO `UniqueKeyContainer` VALUES (1,963,'item 1'),(2,926,'item 2'),(3,889,'item 3'),(4,852,'item 4'),(5,815,'item 5'),(6,NULL,'item 6'),(7,741,'item 7'),(8,704,'item 8'),(9,667,'item 9'),(10,630,'item 10'),(11,593,'item 11'),(12,NULL,'item 12'),(13,519,'item 13'),(14,482,'item 14'),(15,445,'item 15'),(16,408,'item 16'),(17,371,'item 17'),(18,NULL,'item 18'),(19,297,'item 19'),(20,260,'item 20'),(21,223,'item 21'),(22,186,'item 22'),(23,149,'item 23'),(24,NULL,'item 24');
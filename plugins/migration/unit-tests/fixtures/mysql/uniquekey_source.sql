@@ -0,0 +1,36 @@
+CREATE DATABASE IF NOT EXISTS wbcopytables_source;
+
+DROP TABLE IF EXISTS wbcopytables_source.UniqueKeyContainer;
+
+CREATE TABLE wbcopytables_source.UniqueKeyContainer (
+  id INT,
+  code SMALLINT,
+  name VARCHAR(20),
+  UNIQUE KEY (code)
+);
+
+INSERT INTO wbcopytables_source.UniqueKeyContainer (id, code, name) VALUES
+  (4, 852, 'item 4'),
+  (6, NULL, 'item 6'),
+  (15, 445, 'item 15'),
+  (16, 408, 'item 16'),
+  (11, 593, 'item 11'),
+  (10, 630, 'item 10'),
+  (12, NULL, 'item 12'),
+  (17, 371, 'item 17'),
+  (14, 482, 'item 14'),
+  (18, NULL, 'item 18'),
+  (7, 741, 'item 7'),
+  (5, 815, 'item 5'),
+  (3, 889, 'item 3'),
+  (9, 667, 'item 9'),
+  (1, 963, 'item 1'),
+  (24, NULL, 'item 24'),
+  (20, 260, 'item 20'),
+  (13, 519, 'item 13'),
+  (22, 186, 'item 22'),
+  (2, 926, 'item 2'),
+  (19, 297, 'item 19'),
+  (23, 149, 'item 23'),
+  (21, 223, 'item 21'),
+  (8, 704, 'item 8');
@@ -0,0 +1,7 @@
+-- The source table has no primary key, the one of the target only gives the dump a stable row order
+CREATE  TABLE IF NOT EXISTS `UniqueKeyContainer` (
+  `id` INT NOT NULL ,
+  `code` SMALLINT NULL DEFAULT NULL ,
+  `name` VARCHAR(20) NULL DEFAULT NULL ,
+  PRIMARY KEY (`id`) ,
+  UNIQUE INDEX `code` (`code` ASC) );
@@ -0,0 +1,11 @@
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+/*!40101 SET character_set_client = utf8 */;
+CREATE TABLE `NoKeyContainer` (
+  `id` int(11) NOT NULL,
+  `grp` int(11) DEFAULT NULL,
+  `val` bigint(20) DEFAULT NULL,
+  `txt` varchar(20) DEFAULT NULL,
+  PRIMARY KEY (`id`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+/*!40101 SET character_set_client = @saved_cs_client */;
+INSERT INTO `NoKeyContainer` VALUES (1,5,-10999997,'row 1'),(2,5,-9999994,'row 2'),(3,5,-8999991,'row 3'),(4,5,-7999988,'row 4'),(5,5,NULL,'row 5'),(6,5,-5999982,'row 6'),(7,NULL,-4999979,'row 7'),(8,5,-3999976,'row 8'),(9,5,-2999973,'row 9'),(10,5,NULL,'row 10'),(11,5,-999967,'row 11'),(12,5,36,'row 12'),(13,39,1000039,'row 13'),(14,NULL,2000042,'row 14'),(15,45,NULL,'row 15'),(16,48,4000048,'row 16'),(17,51,5000051,'row 17'),(18,54,6000054,'row 18'),(19,57,7000057,'row 19'),(20,60,NULL,'row 20'),(21,NULL,9000063,'row 21'),(22,66,10000066,'row 22'),(23,69,11000069,'row 23'),(24,72,12000072,'row 24');
@@ -0,0 +1,39 @@
+BEGIN TRANSACTION;
+
+DROP TABLE IF EXISTS NoKeyContainer;
+
+CREATE TABLE NoKeyContainer (
+  id INTEGER,
+  grp INTEGER,
+  val BIGINT,
+  txt VARCHAR(20)
+);
+
+CREATE INDEX NoKeyContainer_grp ON NoKeyContainer (grp);
+
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (6, 5, -5999982, 'row 6');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (19, 57, 7000057, 'row 19');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (23, 69, 11000069, 'row 23');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (16, 48, 4000048, 'row 16');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (8, 5, -3999976, 'row 8');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (15, 45, NULL, 'row 15');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (24, 72, 12000072, 'row 24');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (22, 66, 10000066, 'row 22');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (7, NULL, -4999979, 'row 7');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (20, 60, NULL, 'row 20');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (14, NULL, 2000042, 'row 14');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (17, 51, 5000051, 'row 17');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (9, 5, -2999973, 'row 9');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (1, 5, -10999997, 'row 1');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (10, 5, NULL, 'row 10');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (12, 5, 36, 'row 12');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (4, 5, -7999988, 'row 4');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (18, 54, 6000054, 'row 18');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (3, 5, -8999991, 'row 3');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (2, 5, -9999994, 'row 2');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (21, NULL, 9000063, 'row 21');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (13, 39, 1000039, 'row 13');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (5, 5, NULL, 'row 5');
+INSERT INTO NoKeyContainer (id, grp, val, txt) VALUES (11, 5, -999967, 'row 11');
+
+COMMIT TRANSACTION;
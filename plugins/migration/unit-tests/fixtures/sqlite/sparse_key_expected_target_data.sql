@@ -0,0 +1,9 @@
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+/*!40101 SET character_set_client = utf8 */;
+CREATE TABLE `SparseKeyContainer` (
+  `id` bigint(20) NOT NULL DEFAULT '0',
+  `data` varchar(20) DEFAULT NULL,
+  PRIMARY KEY (`id`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+/*!40101 SET character_set_client = @saved_cs_client */;
+INSERT INTO `SparseKeyContainer` VALUES (1,'first'),(2,'second'),(3,'third'),(1000000000000,'after the gap'),(1000000000001,'last');
@@ -0,0 +1,16 @@
+BEGIN TRANSACTION;
+
+DROP TABLE IF EXISTS SparseKeyContainer;
+
+CREATE TABLE SparseKeyContainer (
+  id INTEGER PRIMARY KEY,
+  data VARCHAR(20)
+);
+
+INSERT INTO SparseKeyContainer (id, data) VALUES (1, 'first');
+INSERT INTO SparseKeyContainer (id, data) VALUES (2, 'second');
+INSERT INTO SparseKeyContainer (id, data) VALUES (3, 'third');
+INSERT INTO SparseKeyContainer (id, data) VALUES (1000000000000, 'after the gap');
+INSERT INTO SparseKeyContainer (id, data) VALUES (1000000000001, 'last');
+ 
+COMMIT TRANSACTION;
@@ -0,0 +1,4 @@
+CREATE  TABLE IF NOT EXISTS `SparseKeyContainer` (
+  `id` BIGINT NULL DEFAULT NULL ,
+  `data` VARCHAR(20) NULL DEFAULT NULL ,
+  PRIMARY KEY (`id`) );
@@ -0,0 +1,118 @@
+# Copyright (c) 2018, Oracle and/or its affiliates. All rights reserved.
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License, version 2.0,
+# as published by the Free Software Foundation.
+#
+# This program is also distributed with certain software (including
+# but not limited to OpenSSL) that is licensed under separate terms, as
+# designated in a particular file or component or in included license
+# documentation.  The authors of MySQL hereby grant you an additional
+# permission to link the program and your derivative works with the
+# separately licensed software that they have included with MySQL.
+# This program is distributed in the hope that it will be useful,  but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See
+# the GNU General Public License, version 2.0, for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation, Inc.,
+# 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+import unittest
+import Queue
+
+from DDLScheduler import DDLScheduler
+
+
+class Object(object):
+    def __init__(self, name, sql="", **members):
+        self.name = name
+        self.temp_sql = sql
+        self.commentedOut = 0
+        self.__dict__.update(members)
+
+
+class MessageTarget(object):
+    def send_info(self, msg):
+        pass
+
+    def send_warning(self, msg):
+        pass
+
+    def send_progress(self, pct, msg):
+        pass
+
+
+class Scheduler(DDLScheduler):
+    """Runs the jobs one by one in the calling thread, without connecting anywhere."""
+    def __init__(self, catalog):
+        DDLScheduler.__init__(self, MessageTarget(), None, "", catalog)
+        self.created = []
+
+    def _split(self, sql):
+        return [statement for statement in sql.split(";") if statement.strip()]
+
+    def run(self):
+        self._build_jobs()
+        self._enqueue_ready()
+        while True:
+            try:
+                priority, order, job = self._queue.get_nowait()
+            except Queue.Empty:
+                break
+            self.created.append(job.object.name)
+            self._finished(job, None)
+
+
+def catalog(tables=[], views=[], routines=[]):
+    return Object("def", schemata=[Object("sakila", "CREATE SCHEMA sakila", tables=tables, views=views, routines=routines)])
+
+
+class TestDDLScheduler(unittest.TestCase):
+    def test_dependencies(self):
+        actor = Object("actor", "CREATE TABLE actor (id INT)", triggers=[])
+        film = Object("film", "CREATE TABLE film (id INT)", triggers=[])
+        film.triggers.append(Object("film_ins", "CREATE TRIGGER film_ins AFTER INSERT ON film FOR EACH ROW SET @n = 1"))
+        scheduler = Scheduler(catalog(
+            tables=[actor, film],
+            views=[Object("film_list", "CREATE VIEW film_list AS SELECT * FROM film, actor_info"),
+                   Object("actor_info", "CREATE VIEW actor_info AS SELECT `actor`.id, film_count(`actor`.id) FROM actor")],
+            routines=[Object("film_count", "CREATE FUNCTION film_count(a INT) RETURNS INT RETURN film_total(a)"),
+                      Object("film_total", "CREATE FUNCTION film_total(a INT) RETURNS INT RETURN 0")]))
+        scheduler.run()
+
+        jobs = dict((job.object.name, job) for job in scheduler._jobs)
+        dependencies = dict((name, sorted(other.object.name for other in scheduler._jobs if jobs[name] in other.dependents))
+                            for name in jobs)
+        self.assertEqual(dependencies["actor"], [])
+        self.assertEqual(dependencies["film_ins"], ["film"])
+        self.assertEqual(dependencies["film_list"], ["actor_info", "film"])
+        self.assertEqual(dependencies["actor_info"], ["actor", "film_count"])
+        self.assertEqual(dependencies["film_count"], ["film_total"])
+
+        # everything is created once, tables first and every object after the ones it depends on
+        self.assertEqual(sorted(scheduler.created), sorted(jobs))
+        self.assertEqual(scheduler.created[:2], ["actor", "film"])
+        for name, names in dependencies.items():
+            for dependency in names:
+                self.assertLess(scheduler.created.index(dependency), scheduler.created.index(name))
+        self.assertEqual(scheduler._running, 0)
+
+    def test_cycle_without_ready_jobs(self):
+        # nothing can start at first, so one of the views must be released before any job finishes
+        scheduler = Scheduler(catalog(views=[Object("v1", "CREATE VIEW v1 AS SELECT * FROM v2"),
+                                             Object("v2", "CREATE VIEW v2 AS SELECT * FROM v1")]))
+        scheduler.run()
+        self.assertEqual(scheduler.created, ["v1", "v2"])
+        self.assertTrue(all(job.done for job in scheduler._jobs))
+
+    def test_cycle_after_ready_jobs(self):
+        # the cycle is only broken when nothing else runs anymore
+        scheduler = Scheduler(catalog(
+            tables=[Object("t", "CREATE TABLE t (id INT)", triggers=[])],
+            routines=[Object("p1", "CREATE PROCEDURE p1() BEGIN CALL p2(); END"),
+                      Object("p2", "CREATE PROCEDURE p2() BEGIN CALL p1(); END")]))
+        scheduler.run()
+        self.assertEqual(scheduler.created, ["t", "p1", "p2"])
+        self.assertEqual(scheduler.wait(), 0)
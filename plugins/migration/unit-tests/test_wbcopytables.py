@@ -45,6 +45,8 @@ import functools
 import logging
 import re
 import platform
+import tempfile
+import sqlite3
 
 import settings
 
@@ -68,6 +70,8 @@ else:
 
 class CopyTablesTestCase(unittest.TestCase):
     thread_count = 1
+    # Extra wbcopytables options for each run of the copy, all runs going to the same target tables
+    copytables_runs = ('',)
 
     @classmethod
     def setUpClass(cls):
@@ -134,14 +138,33 @@ class CopyTablesTestCase(unittest.TestCase):
             target_info: A dictionary with information about the mysql target server instance. This is
                 the dict associated to the target_instance key in settings.mysql_instances.
         """
-        # Run the source script in the source RDBMS instance:
+        source_param = self._prepare_source(test_info, source_instance, source_info)
+        self._prepare_target(test_info, target_info)
+
+        # Call copytables to transfer the data from source to target:
+        for run_params in self.copytables_runs:
+            self._copy_tables(test_info, source_param, source_info, target_info, run_params)
+        self.check_copy(test_info)
+
+        # Dump the MySQL data and compare it with the expected data:
+        self.assertTrue(self._target_data_matches(test_info, target_instance, target_info))
+
+    def _prepare_source(self, test_info, source_instance, source_info):
+        """Runs the source script of a test in the source RDBMS instance.
+
+        Returns the wbcopytables parameter to read from that source instance.
+        """
         logging.debug('Importing python module %s' % source_info['module'])
         __import__(source_info['module'])
         module = sys.modules[source_info['module']]
+        source_conn_str = None
         try:
-            source_conn_str = source_info['connection_string'] % source_info
-            logging.debug('source_conn_str = %s' % scramble_pwd(source_conn_str))
-            conn = module.connect(source_conn_str)
+            if 'connect_args' in source_info:
+                conn = module.connect(**source_info['connect_args'])
+            else:
+                source_conn_str = source_info['connection_string'] % source_info
+                logging.debug('source_conn_str = %s' % scramble_pwd(source_conn_str))
+                conn = module.connect(source_conn_str)
         except Exception:
             self.fail('Could not connect to the %s instance' % source_instance)
         else:
@@ -155,26 +178,46 @@ class CopyTablesTestCase(unittest.TestCase):
             else:
                 logging.debug('Running the whole script sentence by sentence')
                 for stmt in script.split(';'):
-                    cursor.execute(stmt)
+                    if stmt.strip():
+                        cursor.execute(stmt)
             conn.commit()
 
-        # Run the target script in the target MySQL instance:
+        if 'copytables_source' in source_info:
+            return ' ' + source_info['copytables_source'] % source_info
+        return ' --pythondbapi-source="%(module)s' % source_info + '''://'%s'"''' % source_conn_str
+
+    def _prepare_target(self, test_info, target_info):
+        """Runs the target script of a test in the target MySQL instance."""
         mysql_call = (settings.mysql_client + ' -u %(user)s -p%(password)s -h %(host)s -P %(port)d %(database)s < ' % target_info
                       + test_info['target'] )
         logging.debug('Calling the MySQL Client with command: %s' % scramble_pwd(mysql_call))
         subprocess.Popen(mysql_call, shell=True).wait()
 
-        # Call copytables to transfer the data from source to target:
-        copytables_params = (' --pythondbapi-source="%(module)s' % source_info + '''://'%s'"''' % source_conn_str + 
+    def _run_target_sql(self, target_info, sql):
+        """Runs SQL statements in the test database of the target MySQL instance and returns their output rows."""
+        mysql_call = (settings.mysql_client + ' -N -B -u %(user)s -p%(password)s -h %(host)s -P %(port)d %(database)s' % target_info
+                      + ' -e "%s"' % sql )
+        logging.debug('Calling the MySQL Client with command: %s' % scramble_pwd(mysql_call))
+        p = subprocess.Popen(mysql_call, shell=True, stdout=subprocess.PIPE)
+        return [line.split('\t') for line in p.communicate()[0].splitlines()]
+
+    def _copy_tables(self, test_info, source_param, source_info, target_info, run_params):
+        """Calls wbcopytables to transfer the data of a test from source to target, with extra options run_params."""
+        copytables_params = (source_param +
                              ' --source-password="%(password)s"' % source_info +
                              ' --target="%(user)s@%(host)s:%(port)d" --target-password="%(password)s"' % target_info +
                              ' --table-file="%(table_file)s"' % test_info +
-                             ' --thread-count=%u' % self.thread_count
+                             ' --thread-count=%u' % self.thread_count +
+                             run_params
                             )
         logging.debug('Calling copytables with command: %s' % settings.copytables_path + scramble_pwd(copytables_params))
         subprocess.Popen(settings.copytables_path + copytables_params, shell=True).wait()
 
-        # Dump the MySQL data and compare it with the expected data:
+    def _target_data_matches(self, test_info, target_instance, target_info, log_difference=True):
+        """Dumps the MySQL data of the target and tells whether it is the expected data of the test.
+
+        With log_difference, the dumped and expected data are logged when they differ.
+        """
         mysqldump_call = settings.mysql_dump + ' -u %(user)s -p%(password)s -h %(host)s -P %(port)d --compact %(database)s' % target_info
         logging.debug('Calling the MySQL Dump with command: %s' % scramble_pwd(mysqldump_call))
         p = subprocess.Popen(mysqldump_call, shell=True, stdout=subprocess.PIPE)
@@ -182,14 +225,18 @@ class CopyTablesTestCase(unittest.TestCase):
         dumped_hash = hashlib.md5(dumped_data).hexdigest()
         expected_data = open(test_info['expected'][target_instance], 'rb').read()
         expected_hash = hashlib.md5(expected_data).hexdigest()
-        if dumped_hash != expected_hash:
+        if log_difference and dumped_hash != expected_hash:
             logging.error('The dumped SQL file is different from the expected one.\n' +
                           60*'-' + '\nExpected file:\n' + 60*'-' +
                           '\n%s\n' % expected_data +
                           60*'-' + '\nDumped file:\n' + 60*'-' +
                           '\n%s\n' % dumped_data + 60*'-'
                          )
-        self.assertEqual(dumped_hash, expected_hash)
+        return dumped_hash == expected_hash
+
+    def check_copy(self, test_info):
+        """Checks the way the tables of a test were copied, after the last copy. Nothing to check by default."""
+        pass
 
     def tearDown(self):
         """Clean up after running each test in this class.
@@ -213,6 +260,147 @@ class CopyTablesTestCase(unittest.TestCase):
             os.putenv(*cls._env_var_original)
 
 
+class ChunkedCopyTablesTestCase(CopyTablesTestCase):
+    """Runs the same tests copying the tables in chunks of 2 primary key values.
+
+    The copy is done twice with the same checkpoint file. The second run must find all chunks already copied,
+    verify them against source and target and leave the target data as it is. The sparse key, corrupted chunk and
+    interrupted copy cases have their own tests, on the sparse_key and integer fixtures.
+    """
+    checkpoint_file = os.path.join(tempfile.gettempdir(), 'wbcopytables_test_checkpoint.sqlite')
+    copytables_runs = (' --chunk-size=2 --checkpoint-file="%s"' % checkpoint_file,
+                       ' --chunk-size=2 --checkpoint-file="%s" --verify-chunks' % checkpoint_file)
+
+    def setUp(self):
+        if os.path.exists(self.checkpoint_file):
+            os.remove(self.checkpoint_file)
+        super(ChunkedCopyTablesTestCase, self).setUp()
+
+    def tearDown(self):
+        super(ChunkedCopyTablesTestCase, self).tearDown()
+        if os.path.exists(self.checkpoint_file):
+            os.remove(self.checkpoint_file)
+
+    def _copy_fixture(self, test_name):
+        """Sets up the fixture test_name in the first source instance that has it and in the first MySQL instance,
+        then copies it once in chunks.
+
+        Returns the test info, the target instance and its info and the wbcopytables source parameter. Skips the test
+        if no source instance has that fixture.
+        """
+        for source_instance, source_info in settings.source_instances:
+            for test_info in available_tests(os.path.join(_this_dir, 'fixtures', source_instance)):
+                if test_info['test_name'] == test_name:
+                    target_instance, target_info = settings.mysql_instances[0]
+                    source_param = self._prepare_source(test_info, source_instance, source_info)
+                    self._prepare_target(test_info, target_info)
+                    self._copy_tables(test_info, source_param, source_info, target_info, self.copytables_runs[0])
+                    return test_info, target_instance, target_info, source_info, source_param
+        self.skipTest('No source instance has the %s fixture' % test_name)
+
+    def _recorded_chunks(self, table):
+        """(range_start, range_end, row_count) of the chunks recorded for table in the checkpoint file."""
+        conn = sqlite3.connect(self.checkpoint_file)
+        try:
+            return conn.execute('SELECT range_start, range_end, row_count FROM chunks WHERE table_name = ? '
+                                'ORDER BY range_start', (table,)).fetchall()
+        finally:
+            conn.close()
+
+    def test_sparse_key_chunks(self):
+        """A gap in the key values takes a single chunk, not one chunk per chunk size missing keys."""
+        test_info, target_instance, target_info, source_info, source_param = self._copy_fixture('sparse_key')
+        self.assertTrue(self._target_data_matches(test_info, target_instance, target_info))
+
+        chunks = self._recorded_chunks('%s.SparseKeyContainer' % target_info['database'])
+        self.assertTrue(0 < len(chunks) <= 4, 'Unexpected chunks for a key with a gap: %s' % chunks)
+        self.assertEqual(sum(chunk[2] for chunk in chunks), 5)
+        # the chunks still cover all the keys of the table, gap included
+        self.assertEqual(chunks[0][0], 1)
+        self.assertEqual(chunks[-1][1], 1000000000001)
+        for previous, chunk in zip(chunks, chunks[1:]):
+            self.assertEqual(chunk[0], previous[1] + 1)
+
+    def test_corrupted_chunk(self):
+        """Chunks whose rows were changed in the target since they were copied are copied again when verifying."""
+        test_info, target_instance, target_info, source_info, source_param = self._copy_fixture('integer')
+        table = '%s.IntegerContainer' % target_info['database']
+        chunks = self._recorded_chunks(table)
+        self.assertEqual(sum(chunk[2] for chunk in chunks), 4)
+
+        self._run_target_sql(target_info, 'UPDATE IntegerContainer SET tint = 42 WHERE id = 4; '
+                                          'DELETE FROM IntegerContainer WHERE id = 1')
+        self.assertFalse(self._target_data_matches(test_info, target_instance, target_info, False))
+
+        self._copy_tables(test_info, source_param, source_info, target_info, self.copytables_runs[1])
+        self.assertTrue(self._target_data_matches(test_info, target_instance, target_info))
+        self.assertEqual(self._recorded_chunks(table), chunks)
+
+    def test_resume_interrupted_copy(self):
+        """A copy interrupted before its last chunk was committed copies that chunk only when run again."""
+        test_info, target_instance, target_info, source_info, source_param = self._copy_fixture('integer')
+        table = '%s.IntegerContainer' % target_info['database']
+        chunks = self._recorded_chunks(table)
+        self.assertTrue(len(chunks) > 1, 'The integer fixture must take several chunks')
+
+        # Leave the checkpoint file and the target as they are when the copy stops before committing the last chunk
+        conn = sqlite3.connect(self.checkpoint_file)
+        try:
+            conn.execute('DELETE FROM chunks WHERE table_name = ? AND range_start = ?', (table, chunks[-1][0]))
+            conn.commit()
+        finally:
+            conn.close()
+        self._run_target_sql(target_info, 'DELETE FROM IntegerContainer WHERE id BETWEEN %d AND %d' % chunks[-1][:2])
+        # Mark a row of a committed chunk, to tell whether it is copied again
+        self._run_target_sql(target_info, 'UPDATE IntegerContainer SET tint = 42 WHERE id = %d' % chunks[0][0])
+
+        self._copy_tables(test_info, source_param, source_info, target_info, self.copytables_runs[0])
+        self.assertEqual(self._recorded_chunks(table), chunks)
+        self.assertEqual(self._run_target_sql(target_info, 'SELECT COUNT(*) FROM IntegerContainer'), [['4']])
+        self.assertEqual(self._run_target_sql(target_info, 'SELECT tint FROM IntegerContainer WHERE id = %d' %
+                                                           chunks[0][0]), [['42']])
+
+        # Verifying finds the marked chunk and copies it again
+        self._copy_tables(test_info, source_param, source_info, target_info, self.copytables_runs[1])
+        self.assertTrue(self._target_data_matches(test_info, target_instance, target_info))
+
+
+class ShardedCopyTablesTestCase(CopyTablesTestCase):
+    """Runs the same tests splitting every table in 3 shards, copied by 3 threads at once.
+
+    Tables are split whatever their size, on the best key the source has for them (see ShardPlanner in
+    copytable/shard_planner.h). The nopk and uniquekey tests cover tables without primary key, their
+    <test_name>_shard_key.txt file names the column the source must report as the best key. The shard plans are
+    read back from the checkpoint file to check it.
+    """
+    thread_count = 3
+    checkpoint_file = os.path.join(tempfile.gettempdir(), 'wbcopytables_test_shards.sqlite')
+    copytables_runs = (' --shard-count=3 --shard-min-rows=0 --checkpoint-file="%s"' % checkpoint_file,)
+
+    def setUp(self):
+        if os.path.exists(self.checkpoint_file):
+            os.remove(self.checkpoint_file)
+        super(ShardedCopyTablesTestCase, self).setUp()
+
+    def tearDown(self):
+        super(ShardedCopyTablesTestCase, self).tearDown()
+        if os.path.exists(self.checkpoint_file):
+            os.remove(self.checkpoint_file)
+
+    def check_copy(self, test_info):
+        if not test_info['shard_key']:
+            return
+        expected_key = open(test_info['shard_key']).read().strip()
+        conn = sqlite3.connect(self.checkpoint_file)
+        try:
+            # key name is the 3rd field of a serialized plan (see ShardPlan::serialize())
+            key_names = [plan.split('\t')[2] for plan, in conn.execute('SELECT plan FROM shard_plans') if plan]
+        finally:
+            conn.close()
+        self.assertTrue(key_names, 'No shard plan was recorded for test %s' % test_info['test_name'])
+        self.assertEqual(set(key_names), set([expected_key]))
+
+
 def available_tests(path):
     """Iterates over available tests in a given path.
     
@@ -240,6 +428,8 @@ def available_tests(path):
                 over the MySQL servers defined in settings.py) to the expected result
                 file, obtained from dumping the target table that contains the expected
                 data using "mysqldump --compact".
+            'shard_key' : The optional <test_name>_shard_key.txt file with the column the
+                tables of the test must be split on in sharded copies, or None.
     """
     if os.path.isdir(path):
         servers = [server[0] for server in settings.mysql_instances]
@@ -266,7 +456,9 @@ def available_tests(path):
                              'source'    : os.path.join(root, candidate_test),
                              'target'    : os.path.join(root, test_name + '_target.sql'),
                              'table_file': os.path.join(root, test_name + '_table_file.txt'),
-                             'expected'  : expected
+                             'expected'  : expected,
+                             'shard_key' : (os.path.join(root, test_name + '_shard_key.txt')
+                                            if test_name + '_shard_key.txt' in files else None)
                            }
                          )
 